@@ -392,6 +392,9 @@ void APP_Tasks ( void )
                 }
             }
 
+#if defined(TCPIP_STACK_USE_HTTP_NET_SERVER)
+            HTTP_APP_EventsTask();
+#endif // defined(TCPIP_STACK_USE_HTTP_NET_SERVER)
             break;
 
         default:
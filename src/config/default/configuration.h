@@ -121,6 +121,7 @@ extern "C" {
 #define SYS_FS_USE_LFN                    (1)
 #define SYS_FS_FILE_NAME_LEN              (255U)
 #define SYS_FS_CWD_STRING_LEN             (1024)
+#define SYS_FS_MPFS_MAPPED_ENABLE         true
 
 
 #define SYS_FS_FAT_VERSION                "v0.15"
@@ -230,7 +231,9 @@ extern "C" {
 
 /*** HTTP NET Configuration ***/
 #define TCPIP_STACK_USE_HTTP_NET_SERVER
-#define TCPIP_HTTP_NET_MAX_HEADER_LEN		    		15
+#define TCPIP_HTTP_NET_MAX_HEADER_LEN		    		20
+#define TCPIP_HTTP_NET_MAX_LINE_LEN                     256
+#define TCPIP_HTTP_NET_LINE_BUFFERS                     4
 #define TCPIP_HTTP_NET_CACHE_LEN		        		"600"
 #define TCPIP_HTTP_NET_TIMEOUT		            		45
 #define TCPIP_HTTP_NET_MAX_CONNECTIONS		    		6
@@ -245,6 +248,8 @@ extern "C" {
 #define TCPIP_HTTP_NET_USE_POST
 #define TCPIP_HTTP_NET_USE_COOKIES
 #define TCPIP_HTTP_NET_USE_AUTHENTICATION
+#define TCPIP_HTTP_NET_USE_CONDITIONAL_GET
+#define TCPIP_HTTP_NET_USE_RANGES
 #define TCPIP_HTTP_NET_MAX_DATA_LEN		        		100
 #define TCPIP_HTTP_NET_SKT_TX_BUFF_SIZE		    		1024
 #define TCPIP_HTTP_NET_SKT_RX_BUFF_SIZE		    		1024
@@ -275,6 +280,40 @@ extern "C" {
 #define TCPIP_HTTP_NET_SSI_VARIABLE_NAME_MAX_LENGTH     10
 #define TCPIP_HTTP_NET_SSI_VARIABLE_STRING_MAX_LENGTH   10
 #define TCPIP_HTTP_NET_SSI_ECHO_NOT_FOUND_MESSAGE       "SSI Echo - Not Found: "
+#define TCPIP_HTTP_NET_TEMPLATE_CACHE_ENTRIES           8
+#define TCPIP_HTTP_NET_TEMPLATE_MAX_DIRECTIVES          64
+#define TCPIP_HTTP_NET_CHUNK_COALESCE_SIZE              1024
+#define TCPIP_HTTP_NET_HEADER_CACHE_ENTRIES             8
+#define TCPIP_HTTP_NET_HEADER_CACHE_BLOCK_SIZE          200
+#define TCPIP_HTTP_NET_FILE_CACHE_ENTRIES               16
+#define TCPIP_HTTP_NET_FILE_CACHE_SIZE                  16384
+#define TCPIP_HTTP_NET_FILE_CACHE_MAX_FILE              4096
+#define TCPIP_HTTP_NET_PATH_CACHE_ENTRIES               16
+#define TCPIP_HTTP_NET_PATH_CACHE_URI_LEN               40
+#define TCPIP_HTTP_NET_FORM_NAME_LEN                    32
+#define TCPIP_HTTP_NET_FORM_HEADER_LEN                  100
+#define TCPIP_HTTP_NET_SNAPSHOT_FILES                   4
+#define TCPIP_HTTP_NET_SNAPSHOT_ENTRIES                 4
+#define TCPIP_HTTP_NET_SNAPSHOT_SIZE                    1024
+#define TCPIP_HTTP_NET_SNAPSHOT_FRESH_MS                100
+#define TCPIP_HTTP_NET_EVENT_CHANNELS                   2
+#define TCPIP_HTTP_NET_WEBSOCKET_ENDPOINTS              2
+#define TCPIP_HTTP_NET_WEBSOCKET_MAX_MESSAGE            128
+#define TCPIP_HTTP_NET_ACCESS_LOG_ENTRIES               32
+#define TCPIP_HTTP_NET_ACCESS_LOG_URI                   "accesslog.bin"
+#define TCPIP_HTTP_NET_AUTH_SESSIONS                    8
+#define TCPIP_HTTP_NET_AUTH_SESSION_TIMEOUT             600
+#define TCPIP_HTTP_NET_SCHED_QUANTUM                    1460
+#define TCPIP_HTTP_NET_SCHED_INTERACTIVE_WEIGHT         4
+#define TCPIP_HTTP_NET_SCHED_BULK_WEIGHT                1
+#define TCPIP_HTTP_NET_SCHED_BULK_SIZE                  16384
+#define TCPIP_HTTP_NET_SCHED_RULES                      4
+#define TCPIP_HTTP_NET_DEFLATE_WINDOW                   1024
+#define TCPIP_HTTP_NET_DEFLATE_MIN_HEAP                 8192
+#define TCPIP_HTTP_NET_ROUTES                           16
+#define TCPIP_HTTP_NET_ROUTE_NODES                      32
+#define TCPIP_HTTP_NET_PIPELINE_DEPTH                   4
+#define TCPIP_HTTP_NET_FILE_MAPPED_ACCESS               1
 #define TCPIP_HTTP_NET_CONNECTION_TIMEOUT          	0
 #define TCPIP_HTTP_NET_MALLOC_FUNC                  malloc
 #define TCPIP_HTTP_NET_FREE_FUNC                    free
@@ -288,6 +327,8 @@ extern "C" {
 #define TCPIP_TCP_SOCKET_DEFAULT_RX_SIZE			512
 #define TCPIP_TCP_DYNAMIC_OPTIONS             			true
 #define TCPIP_TCP_START_TIMEOUT_VAL		        	1000
+#define TCPIP_TCP_RTO_MIN		            		1000
+#define TCPIP_TCP_RTO_MAX		            		60000
 #define TCPIP_TCP_DELAYED_ACK_TIMEOUT		    		100
 #define TCPIP_TCP_FIN_WAIT_2_TIMEOUT		    		5000
 #define TCPIP_TCP_KEEP_ALIVE_TIMEOUT		    		10000
@@ -677,7 +677,8 @@ static const SYS_FS_FUNCTIONS FatFsFunctions =
     .testerror         = FATFS_error,
     .formatDisk        = (FORMAT_DISK)FATFS_mkfs,
     .partitionDisk     = FATFS_fdisk,
-    .getCluster        = FATFS_getclusters
+    .getCluster        = FATFS_getclusters,
+    .mappedAddr        = NULL
 };
 
 static const SYS_FS_FUNCTIONS MPFSFunctions =
@@ -715,7 +716,8 @@ static const SYS_FS_FUNCTIONS MPFSFunctions =
     .testerror         = NULL,
     .formatDisk        = NULL,
     .partitionDisk     = NULL,
-    .getCluster        = NULL
+    .getCluster        = NULL,
+    .mappedAddr        = MPFS_MappedAddressGet
 };
 
 
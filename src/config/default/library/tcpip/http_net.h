@@ -88,12 +88,18 @@ typedef enum
     TCPIP_HTTP_NET_STAT_REDIRECT,               // 302 Redirect will be returned
     TCPIP_HTTP_NET_STAT_TLS_REQUIRED,           // 403 Forbidden is returned, indicating 
                                                 // TLS is required
+    TCPIP_HTTP_NET_STAT_NOT_MODIFIED,           // 304 Not Modified will be returned:
+                                                // the conditional GET matched the client cached file
+    TCPIP_HTTP_NET_STAT_RANGE_NOT_SATISFIABLE,  // 416 Range Not Satisfiable will be returned
+    TCPIP_HTTP_NET_STAT_NO_CONTENT,             // 204 No Content will be returned:
+                                                // a virtual route was processed
     TCPIP_HTTP_NET_STAT_UPLOAD_FORM,            // Show the Upload form
     TCPIP_HTTP_NET_STAT_UPLOAD_STARTED,         // An upload operation is being processed
     TCPIP_HTTP_NET_STAT_UPLOAD_WRITE,           // An upload operation is currently writing
     TCPIP_HTTP_NET_STAT_UPLOAD_WRITE_WAIT,      // An upload operation is currently waiting for the write completion
     TCPIP_HTTP_NET_STAT_UPLOAD_OK,              // An Upload was successful
     TCPIP_HTTP_NET_STAT_UPLOAD_ERROR,           // An Upload was not a valid image
+    TCPIP_HTTP_NET_STAT_UPLOAD_BUSY,            // Another upload is in progress
 
 } TCPIP_HTTP_NET_STATUS;
 
@@ -242,6 +248,10 @@ typedef enum
     /* the echo operation failed */
     TCPIP_HTTP_NET_EVENT_SSI_ALLOC_ECHO_ERROR           = -20,
 
+    /* the FS upload image read back from the media does not match the received image */
+    /* the old image was invalidated and the new one is not committed */
+    TCPIP_HTTP_NET_EVENT_FS_VERIFY_ERROR                = -21,
+
     /* Dynamic parsing warnings. Multiple flags could be set */
 
     /* warning: a dynamic variable argument name too long, truncated */
@@ -628,6 +638,134 @@ TCPIP_HTTP_NET_READ_STATUS  TCPIP_HTTP_NET_ConnectionPostValueRead (TCPIP_HTTP_N
                                                    connHandle, uint8_t* cData, uint16_t wLen);
 
 
+// *****************************************************************************
+/*
+  Enumeration:
+    TCPIP_HTTP_NET_FORM_EVENT
+
+  Summary:
+    Events reported by the streaming form parser.
+
+  Description:
+    This enumeration defines the events that TCPIP_HTTP_NET_ConnectionFormParse
+    reports to the form callback, for every field of the POST body.
+
+  Remarks:
+    For each field the events are reported in order:
+    one NAME, zero or more VALUE fragments, one END.
+*/
+typedef enum
+{
+    /* a new field starts; the field name (and file name) are available */
+    TCPIP_HTTP_NET_FORM_EVENT_NAME,
+
+    /* the next fragment of the field value */
+    TCPIP_HTTP_NET_FORM_EVENT_VALUE,
+
+    /* the field value is complete */
+    TCPIP_HTTP_NET_FORM_EVENT_END,
+
+}TCPIP_HTTP_NET_FORM_EVENT;
+
+// *****************************************************************************
+/*
+  Structure:
+    TCPIP_HTTP_NET_FORM_FIELD
+
+  Summary:
+    Describes the form field currently parsed.
+
+  Description:
+    This data structure is passed to the form callback with each event.
+
+  Remarks:
+    The field and file names are truncated to TCPIP_HTTP_NET_FORM_NAME_LEN characters.
+*/
+typedef struct
+{
+    const char*     name;           // the decoded field name
+    const char*     fileName;       // multipart/form-data: the file name of a file field
+                                    // "" if not a file field
+    uint32_t        valueOffset;    // offset of the current fragment within the field value
+                                    // for the END event: the total value length
+}TCPIP_HTTP_NET_FORM_FIELD;
+
+// *****************************************************************************
+/*
+  Type:
+    TCPIP_HTTP_NET_FORM_CALLBACK
+
+  Summary:
+    Form callback used by TCPIP_HTTP_NET_ConnectionFormParse.
+
+  Description:
+    The callback is called for every parser event, as the POST data
+    is received from the network.
+    For a TCPIP_HTTP_NET_FORM_EVENT_VALUE event data and dataLen describe
+    the value fragment: URL decoded for application/x-www-form-urlencoded data,
+    the raw part data for multipart/form-data.
+    For the other events data is 0 and dataLen is 0.
+
+  Remarks:
+    The fragment data is valid only during the callback.
+
+    The callback returns true to continue parsing
+    or false to abort the POST operation.
+*/
+typedef bool (*TCPIP_HTTP_NET_FORM_CALLBACK)(TCPIP_HTTP_NET_CONN_HANDLE connHandle, TCPIP_HTTP_NET_FORM_EVENT event,
+                                             const TCPIP_HTTP_NET_FORM_FIELD* pField, const uint8_t* data, uint16_t dataLen, const void* param);
+
+//*****************************************************************************
+/*
+  Function:
+    TCPIP_HTTP_NET_IO_RESULT TCPIP_HTTP_NET_ConnectionFormParse(TCPIP_HTTP_NET_CONN_HANDLE connHandle,
+                                            TCPIP_HTTP_NET_FORM_CALLBACK formCback, const void* param)
+
+  Summary:
+    Parses the POST form data as it arrives from the network.
+
+  Description:
+    This function parses the application/x-www-form-urlencoded or
+    the multipart/form-data POST body, as selected by the request Content-Type header.
+    It is meant to be called from the template_ConnectionPostExecute callback
+    and it can replace the TCPIP_HTTP_NET_ConnectionPostNameRead/TCPIP_HTTP_NET_ConnectionPostValueRead
+    calls.
+
+    All the data available in the network transport buffer is consumed in one pass
+    and reported to the formCback as field names and value fragments.
+    The parser state is kept between calls so fields can span any number of calls
+    and the values can be of any length, not limited by the connection data buffer.
+
+    This function properly updates the connection byte count.
+
+  Precondition:
+    None.
+
+  Parameters:
+    connHandle  - HTTP connection handle
+    formCback   - callback to receive the form events
+    param       - parameter to be passed to the formCback
+
+  Returns:
+    - TCPIP_HTTP_NET_IO_RES_DONE - all the POST data has been parsed
+    - TCPIP_HTTP_NET_IO_RES_NEED_DATA - more POST data is expected,
+                                        call again when it arrives
+    - TCPIP_HTTP_NET_IO_RES_ERROR - the callback aborted the operation,
+                                    the multipart data is malformed or out of memory
+
+  Remarks:
+    The function should be called for the whole POST body;
+    it should not be mixed with other POST read functions.
+
+    For multipart/form-data the boundary is taken from the boundary parameter
+    of the request Content-Type header; a request without a valid boundary
+    is rejected with 400 Bad Request. Only a "--" + boundary line ends
+    the preamble. Part headers other than Content-Disposition are ignored.
+*/
+TCPIP_HTTP_NET_IO_RESULT    TCPIP_HTTP_NET_ConnectionFormParse(TCPIP_HTTP_NET_CONN_HANDLE connHandle,
+                                                   TCPIP_HTTP_NET_FORM_CALLBACK formCback, const void* param);
+
+
 //*****************************************************************************
 /*
   Function:
@@ -1662,8 +1800,31 @@ typedef struct
                                                 // This context is used by the HTTP server 
                                                 // and is irrelevant to the user.
                                                 // Should NOT be modified in any way by the user!
+    uint16_t                        varId;      // the dynamic variable ID: the index of the
+                                                // variable name in the table registered with
+                                                // TCPIP_HTTP_NET_DynVarNamesRegister
+                                                // TCPIP_HTTP_NET_DYN_VAR_ID_INVALID if not registered
+    uint16_t                        padding;    // not used
 }TCPIP_HTTP_DYN_VAR_DCPT;
 
+// *****************************************************************************
+/*
+  Constant:
+    TCPIP_HTTP_NET_DYN_VAR_ID_INVALID
+
+  Summary:
+    Invalid dynamic variable ID.
+
+  Description:
+    The ID reported in the TCPIP_HTTP_DYN_VAR_DCPT::varId
+    for a dynamic variable whose name was not registered
+    with TCPIP_HTTP_NET_DynVarNamesRegister.
+
+  Remarks:
+    None.
+*/
+#define TCPIP_HTTP_NET_DYN_VAR_ID_INVALID       0xffff
+
 // *****************************************************************************
 /*
   Data structure:
@@ -1849,6 +2010,537 @@ TCPIP_HTTP_NET_USER_HANDLE    TCPIP_HTTP_NET_UserHandlerRegister
 
 bool             TCPIP_HTTP_NET_UserHandlerDeregister(TCPIP_HTTP_NET_USER_HANDLE hHttp);
 
+// *****************************************************************************
+/* Function:
+    bool TCPIP_HTTP_NET_DynVarNamesRegister(TCPIP_HTTP_NET_USER_HANDLE hHttp, const char* const* varNames, uint16_t nNames)
+
+  Summary:
+    Registers the names of the dynamic variables processed by the user.
+    
+  Description:
+    This function registers a table of dynamic variable names with the HTTP server.
+    The HTTP server builds a hash index of the names and resolves each
+    dynamic variable it encounters in a web page to its index in this table.
+    The index is passed to the user dynamicPrint callback as the 
+    TCPIP_HTTP_DYN_VAR_DCPT::varId so the callback can dispatch
+    the variable processing directly, without any string comparisons.
+
+  Precondition:
+    The HTTP server module properly initialized.
+    A user callback registered with TCPIP_HTTP_NET_UserHandlerRegister.
+
+  Parameters:
+    hHttp       - A handle returned by a previous call to TCPIP_HTTP_NET_UserHandlerRegister
+    varNames    - table of dynamic variable names
+                  The table and the names must be persistent. 
+                  Could be 0 to remove a previous registration.
+    nNames      - number of names in the table
+
+  Returns:
+    - true  - if the call succeeded and the names were registered
+    - false - if no such handler is registered, invalid parameters or out of memory
+
+  Remarks:
+    Only one table of names can be registered.
+    A new registration replaces the previous one.
+
+    The table is removed when the user handler is deregistered.
+
+    If a name occurs multiple times in the table, the first index is used.
+ */
+
+bool             TCPIP_HTTP_NET_DynVarNamesRegister(TCPIP_HTTP_NET_USER_HANDLE hHttp, const char* const* varNames, uint16_t nNames);
+
+// *****************************************************************************
+/* Function:
+    bool TCPIP_HTTP_NET_SnapshotFileRegister(TCPIP_HTTP_NET_USER_HANDLE hHttp, const char* fileName, uint16_t freshMs)
+
+  Summary:
+    Enables the rendered snapshot cache for a dynamic file.
+    
+  Description:
+    This function registers a dynamic file (status.xml, for example)
+    whose rendered output can be shared between requests.
+    The first GET request for the file renders it as usual
+    and keeps a copy of the output.
+    For the next freshMs milliseconds the requests for the same file
+    and the same query string are served from this copy,
+    without processing the file and calling the dynamic variable callbacks.
+    Requests that arrive while the file is being rendered
+    wait for the output and are served from it.
+
+  Precondition:
+    The HTTP server module properly initialized.
+    A user callback registered with TCPIP_HTTP_NET_UserHandlerRegister.
+
+  Parameters:
+    hHttp       - A handle returned by a previous call to TCPIP_HTTP_NET_UserHandlerRegister
+    fileName    - name of the file, as requested by the client: "status.xml"
+    freshMs     - freshness window of the rendered output, in milliseconds
+                  If 0, TCPIP_HTTP_NET_SNAPSHOT_FRESH_MS is used
+
+  Returns:
+    - true  - if the call succeeded and the file was registered
+    - false - if no such handler is registered, invalid parameters
+              or TCPIP_HTTP_NET_SNAPSHOT_FILES files are already registered
+
+  Remarks:
+    The output of a file is shared only if all its dynamic variables
+    declared their output cacheable with TCPIP_HTTP_NET_DynamicCacheable.
+    A dynamic variable that doesn't is volatile: the file is rendered
+    for every request until the freshness window expires.
+    SSI directives, except include, are volatile as well.
+
+    The output is shared between all clients: the file should not
+    depend on cookies, authentication, etc.
+
+    Only output that fits into TCPIP_HTTP_NET_SNAPSHOT_SIZE bytes is kept.
+
+    The output compressed for the clients that accept the deflate coding
+    is kept separately from the plain output.
+
+    The registrations are removed when the user handler is deregistered.
+
+    The snapshot cache is not used if TCPIP_HTTP_NET_SNAPSHOT_ENTRIES == 0
+    or the dynamic output is not coalesced (TCPIP_HTTP_NET_CHUNK_COALESCE_SIZE == 0).
+ */
+
+bool             TCPIP_HTTP_NET_SnapshotFileRegister(TCPIP_HTTP_NET_USER_HANDLE hHttp, const char* fileName, uint16_t freshMs);
+
+// *****************************************************************************
+/* Function:
+    bool TCPIP_HTTP_NET_EventChannelRegister(TCPIP_HTTP_NET_USER_HANDLE hHttp, const char* chName)
+
+  Summary:
+    Registers a Server-Sent Events channel.
+    
+  Description:
+    This function registers a name that the clients can request
+    to receive events pushed by the application (text/event-stream).
+    A GET request for the channel name is answered with
+    the event stream headers and the connection is then kept open,
+    waiting for events published with TCPIP_HTTP_NET_EventPublish.
+
+  Precondition:
+    The HTTP server module properly initialized.
+    A user callback registered with TCPIP_HTTP_NET_UserHandlerRegister.
+
+  Parameters:
+    hHttp       - A handle returned by a previous call to TCPIP_HTTP_NET_UserHandlerRegister
+    chName      - name of the channel, as requested by the client: "status.evt"
+
+  Returns:
+    - true  - if the call succeeded and the channel was registered
+    - false - if no such handler is registered, invalid parameters
+              or TCPIP_HTTP_NET_EVENT_CHANNELS channels are already registered
+
+  Remarks:
+    The chName string is not copied; it has to be persistent.
+
+    A subscribed connection holds no file and is not run by the
+    periodic HTTP processing. It still counts as an open connection,
+    so TCPIP_HTTP_NET_MAX_CONNECTIONS should allow for the expected subscribers.
+
+    The file authentication callback is called for the channel name,
+    as for a regular file.
+
+    The channels are removed when the user handler is deregistered.
+ */
+
+bool             TCPIP_HTTP_NET_EventChannelRegister(TCPIP_HTTP_NET_USER_HANDLE hHttp, const char* chName);
+
+// *****************************************************************************
+/* Function:
+    int TCPIP_HTTP_NET_EventPublish(const char* chName, const char* evName, const char* evData)
+
+  Summary:
+    Sends an event to the clients subscribed to a channel.
+    
+  Description:
+    This function writes an event to all the connections
+    subscribed to the chName channel.
+    Each line of evData is sent as a separate data field.
+
+  Precondition:
+    The channel registered with TCPIP_HTTP_NET_EventChannelRegister.
+
+  Parameters:
+    chName      - name of the channel
+    evName      - event type; could be 0 for a generic message event
+    evData      - event data
+
+  Returns:
+    - >= 0  - the number of connections the event was written to
+    - < 0   - no such channel is registered
+
+  Remarks:
+    An event is never sent partially: a connection that doesn't have
+    enough TX buffer space for the whole event misses it.
+    The events should be small deltas.
+ */
+
+int              TCPIP_HTTP_NET_EventPublish(const char* chName, const char* evName, const char* evData);
+
+// *****************************************************************************
+/*
+  Enumeration:
+    TCPIP_HTTP_NET_WS_EVENT
+
+  Summary:
+    Events reported to a WebSocket handler.
+
+  Description:
+    This enumeration defines the events that the HTTP server
+    reports to the handler of a WebSocket endpoint.
+
+  Remarks:
+    None.
+*/
+typedef enum
+{
+    /* the handshake completed; messages can be sent on the connection */
+    TCPIP_HTTP_NET_WS_EVENT_OPEN,
+
+    /* a text message was received */
+    TCPIP_HTTP_NET_WS_EVENT_TEXT,
+
+    /* a binary message was received */
+    TCPIP_HTTP_NET_WS_EVENT_BINARY,
+
+    /* the connection is closed; no more messages can be sent */
+    TCPIP_HTTP_NET_WS_EVENT_CLOSE,
+}TCPIP_HTTP_NET_WS_EVENT;
+
+// *****************************************************************************
+/*
+  Type:
+    TCPIP_HTTP_NET_WS_HANDLER
+
+  Summary:
+    Handler of a WebSocket endpoint.
+
+  Description:
+    The handler is called by the HTTP server for every event
+    of a connection to the endpoint.
+    For the TEXT and BINARY events data and dataLen describe the whole
+    received message, unmasked and reassembled if it was fragmented.
+    For the other events data is 0 and dataLen is 0.
+
+  Remarks:
+    The data is valid only during the call.
+    The text messages are not null terminated.
+*/
+typedef void (*TCPIP_HTTP_NET_WS_HANDLER)(TCPIP_HTTP_NET_CONN_HANDLE connHandle, TCPIP_HTTP_NET_WS_EVENT wsEvent,
+                                          const uint8_t* data, uint16_t dataLen);
+
+// *****************************************************************************
+/* Function:
+    bool TCPIP_HTTP_NET_WebSocketRegister(TCPIP_HTTP_NET_USER_HANDLE hHttp, const char* uri, TCPIP_HTTP_NET_WS_HANDLER handler)
+
+  Summary:
+    Registers a WebSocket endpoint.
+    
+  Description:
+    This function registers a name that the clients can open
+    as a WebSocket (RFC 6455).
+    A GET request for the name that carries a valid handshake
+    (Upgrade: websocket and Sec-WebSocket-Key headers) is answered with
+    101 Switching Protocols and the connection then exchanges frames:
+    the received messages are passed to the handler and the application
+    sends its messages with TCPIP_HTTP_NET_WebSocketSend.
+    A request without a valid handshake is answered with 400 Bad Request.
+
+  Precondition:
+    The HTTP server module properly initialized.
+    A user callback registered with TCPIP_HTTP_NET_UserHandlerRegister.
+
+  Parameters:
+    hHttp       - A handle returned by a previous call to TCPIP_HTTP_NET_UserHandlerRegister
+    uri         - name of the endpoint, as requested by the client: "leds.ws"
+    handler     - handler to be called for the endpoint events
+
+  Returns:
+    - true  - if the call succeeded and the endpoint was registered
+    - false - if no such handler is registered, invalid parameters
+              or TCPIP_HTTP_NET_WEBSOCKET_ENDPOINTS endpoints are already registered
+
+  Remarks:
+    The uri string is not copied; it has to be persistent.
+
+    The file authentication callback is called for the endpoint name,
+    as for a regular file.
+
+    Messages longer than TCPIP_HTTP_NET_WEBSOCKET_MAX_MESSAGE bytes close
+    the connection with the 1009 status code.
+    A frame is processed only when it is entirely in the socket RX buffer,
+    so the socket RX buffer has to be larger than TCPIP_HTTP_NET_WEBSOCKET_MAX_MESSAGE.
+
+    An open WebSocket is not run by the periodic HTTP processing.
+    It still counts as an open connection.
+
+    The endpoints are removed when the user handler is deregistered.
+ */
+
+bool             TCPIP_HTTP_NET_WebSocketRegister(TCPIP_HTTP_NET_USER_HANDLE hHttp, const char* uri, TCPIP_HTTP_NET_WS_HANDLER handler);
+
+// *****************************************************************************
+/* Function:
+    bool TCPIP_HTTP_NET_WebSocketSend(TCPIP_HTTP_NET_CONN_HANDLE connHandle, bool isText, const void* data, uint16_t dataLen)
+
+  Summary:
+    Sends a message on a WebSocket connection.
+    
+  Description:
+    This function writes a message, as a single frame, to an open WebSocket connection.
+
+  Precondition:
+    The TCPIP_HTTP_NET_WS_EVENT_OPEN event was reported for the connection.
+
+  Parameters:
+    connHandle  - WebSocket connection handle
+    isText      - true for a text message, false for a binary one
+    data        - message data
+    dataLen     - size of the message
+
+  Returns:
+    - true  - if the message was written to the socket
+    - false - if the connection is not an open WebSocket
+              or there's not enough TX buffer space for the whole frame
+
+  Remarks:
+    A message is never sent partially; the call can be retried later.
+ */
+
+bool             TCPIP_HTTP_NET_WebSocketSend(TCPIP_HTTP_NET_CONN_HANDLE connHandle, bool isText, const void* data, uint16_t dataLen);
+
+// *****************************************************************************
+/* Function:
+    bool TCPIP_HTTP_NET_WebSocketClose(TCPIP_HTTP_NET_CONN_HANDLE connHandle, uint16_t closeCode)
+
+  Summary:
+    Starts the closing handshake of a WebSocket connection.
+    
+  Description:
+    This function sends a close frame on an open WebSocket connection.
+    The connection is closed when the client answers with its close frame.
+
+  Precondition:
+    The TCPIP_HTTP_NET_WS_EVENT_OPEN event was reported for the connection.
+
+  Parameters:
+    connHandle  - WebSocket connection handle
+    closeCode   - RFC 6455 status code; if 0, 1000 (normal closure) is used
+
+  Returns:
+    - true  - if the close frame was sent
+    - false - if the connection is not an open WebSocket
+              or there's not enough TX buffer space
+
+  Remarks:
+    The TCPIP_HTTP_NET_WS_EVENT_CLOSE event is reported when the connection is closed.
+ */
+
+bool             TCPIP_HTTP_NET_WebSocketClose(TCPIP_HTTP_NET_CONN_HANDLE connHandle, uint16_t closeCode);
+
+// *****************************************************************************
+/* Function:
+    bool TCPIP_HTTP_NET_ConnectionSessionEnd(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+
+  Summary:
+    Ends the authenticated session of the current request.
+    
+  Description:
+    After the credentials of a client are accepted by the userAuthenticate
+    callback, the server issues a session token in a cookie.
+    The following requests carrying the token are authorized without
+    decoding the credentials, until the session is idle for
+    TCPIP_HTTP_NET_AUTH_SESSION_TIMEOUT seconds.
+    A session authorizes only the files for which the fileAuthenticate
+    callback returns the same value as for the request that opened it.
+    This function invalidates the session that authorized the current request,
+    for example when the user logs out.
+
+  Precondition:
+    None.
+
+  Parameters:
+    connHandle  - HTTP connection handle
+
+  Returns:
+    - true  - if the session was ended
+    - false - if the request was not authorized by a session
+              or the sessions are not enabled
+
+  Remarks:
+    The sessions are enabled when TCPIP_HTTP_NET_USE_AUTHENTICATION and
+    TCPIP_HTTP_NET_USE_COOKIES are defined and TCPIP_HTTP_NET_AUTH_SESSIONS != 0.
+
+    A session token issued with the current response is not issued anymore.
+ */
+
+bool             TCPIP_HTTP_NET_ConnectionSessionEnd(TCPIP_HTTP_NET_CONN_HANDLE connHandle);
+
+// *****************************************************************************
+/*
+  Enumeration:
+    TCPIP_HTTP_NET_SCHED_CLASS
+
+  Summary:
+    Scheduling classes of the HTTP requests.
+
+  Description:
+    The connections that serve a message body share the server
+    in a deficit round robin manner.
+    In each turn a connection can send TCPIP_HTTP_NET_SCHED_QUANTUM bytes
+    times the weight of its class, before giving way to the other busy connections.
+
+  Remarks:
+    A connection that is alone is not limited.
+*/
+typedef enum
+{
+    /* pages, dynamic files, small files: weight TCPIP_HTTP_NET_SCHED_INTERACTIVE_WEIGHT */
+    TCPIP_HTTP_NET_SCHED_CLASS_INTERACTIVE,
+
+    /* large static files: weight TCPIP_HTTP_NET_SCHED_BULK_WEIGHT */
+    TCPIP_HTTP_NET_SCHED_CLASS_BULK,
+
+    /* number of classes */
+    TCPIP_HTTP_NET_SCHED_CLASSES
+}TCPIP_HTTP_NET_SCHED_CLASS;
+
+// *****************************************************************************
+/* Function:
+    bool TCPIP_HTTP_NET_SchedClassRegister(TCPIP_HTTP_NET_USER_HANDLE hHttp, const char* uriPrefix, TCPIP_HTTP_NET_SCHED_CLASS schedClass)
+
+  Summary:
+    Sets the scheduling class of the requests for a URI prefix.
+    
+  Description:
+    The requests for a name that starts with uriPrefix are served
+    in the schedClass class.
+    Without a matching prefix, the dynamic files and the files smaller than
+    TCPIP_HTTP_NET_SCHED_BULK_SIZE are interactive and the other files are bulk.
+
+  Precondition:
+    TCPIP_HTTP_NET_UserHandlerRegister has been called.
+
+  Parameters:
+    hHttp       - handle returned by TCPIP_HTTP_NET_UserHandlerRegister
+    uriPrefix   - the name prefix, for example "sdcard/"; the leading '/' is optional
+    schedClass  - the scheduling class of the matching requests
+
+  Returns:
+    - true  - if the prefix was registered or updated
+    - false - if there's no more room (TCPIP_HTTP_NET_SCHED_RULES)
+              or the scheduling is not enabled
+
+  Remarks:
+    The uriPrefix string is not copied; it has to be persistent.
+    The prefixes are checked in the registration order.
+ */
+
+bool             TCPIP_HTTP_NET_SchedClassRegister(TCPIP_HTTP_NET_USER_HANDLE hHttp, const char* uriPrefix, TCPIP_HTTP_NET_SCHED_CLASS schedClass);
+
+// *****************************************************************************
+/*
+  Enumeration:
+    TCPIP_HTTP_NET_ROUTE_FLAGS
+
+  Summary:
+    Flags of a HTTP route.
+
+  Description:
+    These flags select the request methods a route handles
+    and how the requested name is served.
+
+  Remarks:
+    Multiple flags can be set.
+*/
+typedef enum
+{
+    /* the route handles the GET requests */
+    TCPIP_HTTP_NET_ROUTE_FLAG_GET       = 0x01,
+
+    /* the route handles the POST requests */
+    TCPIP_HTTP_NET_ROUTE_FLAG_POST      = 0x02,
+
+    /* the name is not a file: no file system access is done for it */
+    /* the response is 204 No Content, unless the handler sets another status */
+    TCPIP_HTTP_NET_ROUTE_FLAG_VIRTUAL   = 0x04,
+}TCPIP_HTTP_NET_ROUTE_FLAGS;
+
+// *****************************************************************************
+/*
+  Type:
+    TCPIP_HTTP_NET_ROUTE_HANDLER
+
+  Summary:
+    Handler of a HTTP route.
+
+  Description:
+    The handler is called for the requests matching the route,
+    instead of the getExecute/postExecute user callbacks.
+    A GET handler is called for every request, with or without arguments.
+    A POST handler is called as the POST data arrives.
+    The handler returns the same results and can do the same operations
+    (redirect, cookies, form parsing, etc.) as getExecute/postExecute.
+
+  Parameters:
+    connHandle  - HTTP connection handle
+    routeParam  - the parameter passed at the route registration
+
+  Remarks:
+    None.
+*/
+typedef TCPIP_HTTP_NET_IO_RESULT (*TCPIP_HTTP_NET_ROUTE_HANDLER)(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam);
+
+// *****************************************************************************
+/* Function:
+    bool TCPIP_HTTP_NET_RouteRegister(TCPIP_HTTP_NET_USER_HANDLE hHttp, const char* pattern, 
+                                      TCPIP_HTTP_NET_ROUTE_FLAGS routeFlags, TCPIP_HTTP_NET_ROUTE_HANDLER handler, const void* routeParam)
+
+  Summary:
+    Registers a handler for a request name pattern.
+    
+  Description:
+    The routes are kept in a prefix trie and the server resolves
+    the handler of a request once, when the requested name is parsed.
+    The pattern is either a name, for example "forms.htm",
+    or a prefix ending in '*', for example "api*".
+    A name route takes precedence over a prefix route and a longer prefix
+    takes precedence over a shorter one.
+
+  Precondition:
+    TCPIP_HTTP_NET_UserHandlerRegister has been called.
+
+  Parameters:
+    hHttp       - handle returned by TCPIP_HTTP_NET_UserHandlerRegister
+    pattern     - the request name or prefix; the leading '/' is optional
+    routeFlags  - the methods handled and the virtual flag
+    handler     - the request handler
+    routeParam  - parameter passed to the handler
+
+  Returns:
+    - true  - if the route was registered
+    - false - if invalid parameters, the pattern is already registered for one of the methods,
+              there's no more room (TCPIP_HTTP_NET_ROUTES, TCPIP_HTTP_NET_ROUTE_NODES)
+              or the router is not enabled
+
+  Remarks:
+    The pattern string is not copied; it has to be persistent.
+
+    The name of a non virtual route is matched against the requested name
+    and, if the default file was added, against the name of the file served.
+
+    The file authentication callback is called for a virtual name,
+    as for a regular file.
+
+    The routes are removed when the user handler is deregistered.
+ */
+
+bool             TCPIP_HTTP_NET_RouteRegister(TCPIP_HTTP_NET_USER_HANDLE hHttp, const char* pattern, TCPIP_HTTP_NET_ROUTE_FLAGS routeFlags, TCPIP_HTTP_NET_ROUTE_HANDLER handler, const void* routeParam);
+
 // *****************************************************************************
 // Section: Templates for User-implemented Callback Function Prototypes
 // *****************************************************************************
@@ -2102,6 +2794,10 @@ uint8_t template_ConnectionFileAuthenticate(TCPIP_HTTP_NET_CONN_HANDLE connHandl
     This function is only called when an Authorization header is
     encountered.
 
+    When the authenticated sessions are enabled, a request carrying a valid
+    session token for the same fileAuthenticate result is not authenticated
+    again: this function is not called and the value stored with the session is used.
+
     This function may NOT write to the network transport buffer.
  */
 uint8_t template_ConnectionUserAuthenticate(TCPIP_HTTP_NET_CONN_HANDLE connHandle, 
@@ -2319,6 +3015,7 @@ void template_DynAcknowledge(TCPIP_HTTP_NET_CONN_HANDLE connHandle,
                     - TCPIP_HTTP_NET_EVENT_SSI_ALLOC_DESCRIPTOR_ERROR: SSI command pointer
                     - TCPIP_HTTP_NET_EVENT_PEEK_ALLOC_BUFFER_ERROR: string containing allocation size that failed
                     - TCPIP_HTTP_NET_EVENT_SSI_ALLOC_ECHO_ERROR: string containing allocation size that failed
+                    - TCPIP_HTTP_NET_EVENT_FS_VERIFY_ERROR: file name pointer
                     
                     - TCPIP_HTTP_NET_EVENT_DYNVAR_ARG_NAME_TRUNCATED: dynamic variable name pointer
                     - TCPIP_HTTP_NET_EVENT_DYNVAR_ARG_NUMBER_TRUNCATED: dynamic variable name pointer
@@ -2571,6 +3268,41 @@ bool TCPIP_HTTP_NET_DynamicWrite(const TCPIP_HTTP_DYN_VAR_DCPT* varDcpt,
 bool TCPIP_HTTP_NET_DynamicWriteString(const TCPIP_HTTP_DYN_VAR_DCPT* varDcpt, 
                                        const char* str, bool needAck);
 
+//*****************************************************************************
+/*
+  Function:
+    void TCPIP_HTTP_NET_DynamicCacheable(const TCPIP_HTTP_DYN_VAR_DCPT* varDcpt);
+
+  Summary:
+    Declares the output of a dynamic variable cacheable.
+    
+  Description:
+    This function marks the output of the current dynamic variable
+    as shareable between requests:
+    it has no side effects and it is valid for the freshness window
+    of a file registered with TCPIP_HTTP_NET_SnapshotFileRegister.
+
+  Precondition:
+    varDcpt     - a valid dynamic variable descriptor.
+
+  Parameters:
+    varDcpt    - dynamic variable descriptor as passed in the 
+                 template_DynPrint function
+
+  Returns:
+    None.
+     
+  Remarks:
+    A dynamic variable is volatile by default.
+    The call should be made from the template_DynPrint function,
+    every time the variable is processed.
+
+    The call has no effect for files not registered for the snapshot cache.
+
+ */
+
+void TCPIP_HTTP_NET_DynamicCacheable(const TCPIP_HTTP_DYN_VAR_DCPT* varDcpt);
+
 
 //*****************************************************************************
 /*
@@ -3037,6 +3769,46 @@ int   TCPIP_HTTP_NET_SSIVariablesNumberGet(int* pMaxNo);
 */
 const char*   TCPIP_HTTP_NET_SSIVariableGetByIndex(int varIndex, const char** pVarName, TCPIP_HTTP_DYN_ARG_TYPE* pVarType, int32_t* pVarInt);
 
+//*****************************************************************************
+/*
+  Function:
+    void TCPIP_HTTP_NET_FileCacheInvalidate(const char* fileName)
+
+  Summary:
+    Removes a file from the HTTP RAM file cache.
+
+  Description:
+    This function discards the RAM copy of a file that was changed
+    in the file system, so that the next request reads it again.
+    It also discards the cached URI to file name resolutions,
+    including the URIs that were not found.
+
+  Precondition:
+    None.
+
+  Parameters:
+    fileName - name of the file that was changed.
+               It can be a path that ends with the file name.
+
+  Returns:
+    None.
+
+  Remarks:
+    A cached file that is currently being served is deleted
+    when its transfer completes.
+
+    The whole cache is discarded when a new file system image is uploaded.
+
+    The rendered snapshots of the dynamic files are discarded as well.
+    So are the cached response headers of the file, which carry its
+    entity tag and date.
+
+    The RAM copy is not used if the RAM file cache is not enabled
+    (TCPIP_HTTP_NET_FILE_CACHE_ENTRIES == 0 or TCPIP_HTTP_NET_FILE_CACHE_SIZE == 0).
+    The URI resolutions are not cached if TCPIP_HTTP_NET_PATH_CACHE_ENTRIES == 0.
+ */
+void TCPIP_HTTP_NET_FileCacheInvalidate(const char* fileName);
+
 
 // *****************************************************************************
 // *****************************************************************************
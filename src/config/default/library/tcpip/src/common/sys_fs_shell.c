@@ -89,6 +89,7 @@ static int32_t  Shell_FileTell(const SYS_FS_SHELL_OBJ* pObj, SYS_FS_HANDLE handl
 static bool     Shell_FileEof(const SYS_FS_SHELL_OBJ* pObj, SYS_FS_HANDLE handle);
 static size_t Shell_FileRead(const SYS_FS_SHELL_OBJ* pObj, SYS_FS_HANDLE handle, void *buf, size_t nbyte);
 static size_t Shell_FileWrite(const SYS_FS_SHELL_OBJ* pObj, SYS_FS_HANDLE handle, const void *buf, size_t nbyte);
+static SYS_FS_RESULT Shell_FileMappedAddress(const SYS_FS_SHELL_OBJ* pObj, SYS_FS_HANDLE handle, const void** ppAddress);
 
 static SYS_FS_SHELL_RES Shell_GetRoot(const SYS_FS_SHELL_OBJ* pObj, char* rootBuff, size_t rootBuffSize);
 static SYS_FS_SHELL_RES Shell_GetCwd(const SYS_FS_SHELL_OBJ* pObj, char* cwdBuff, size_t cwdBuffSize);
@@ -113,6 +114,7 @@ static const SYS_FS_SHELL_OBJ  default_shell_obj =
     .fileEof    = Shell_FileEof,
     .fileRead   = Shell_FileRead,
     .fileWrite  = Shell_FileWrite,
+    .fileMappedAddress = Shell_FileMappedAddress,
     // 
     .cwdSet = Shell_Cwd, 
     .cwdGet = Shell_GetCwd,
@@ -580,6 +582,12 @@ static size_t Shell_FileWrite(const SYS_FS_SHELL_OBJ* pObj, SYS_FS_HANDLE handle
     return SYS_FS_FileWrite(handle, buf, nbyte);
 }
 
+static SYS_FS_RESULT Shell_FileMappedAddress(const SYS_FS_SHELL_OBJ* pObj, SYS_FS_HANDLE handle, const void** ppAddress)
+{
+    (void)pObj;
+    return SYS_FS_FileMappedAddressGet(handle, ppAddress);
+}
+
 static SYS_FS_SHELL_RES Shell_GetRoot(const SYS_FS_SHELL_OBJ* pObj, char* rootBuff, size_t rootBuffSize)
 {
     if(rootBuff == 0 || rootBuffSize == 0)
@@ -139,6 +139,10 @@ typedef struct _tag_SYS_FS_SHELL_OBJ
     size_t (*fileRead)(const struct _tag_SYS_FS_SHELL_OBJ* pObj, SYS_FS_HANDLE handle, void *buf, size_t nbyte);
     size_t (*fileWrite)(const struct _tag_SYS_FS_SHELL_OBJ* pObj, SYS_FS_HANDLE handle, const void *buf, size_t nbyte);
 
+    // direct access to the file data, if the file is stored on a memory mapped media
+    // the file position is not updated
+    SYS_FS_RESULT (*fileMappedAddress)(const struct _tag_SYS_FS_SHELL_OBJ* pObj, SYS_FS_HANDLE handle, const void** ppAddress);
+
     // change the current working directory
     // cwd starting with:
     //      "/" - relative/absolute based on the value of SYS_FS_SHELL_FLAG_REL_ROOT/SYS_FS_SHELL_FLAG_ABS_ROOT flag.
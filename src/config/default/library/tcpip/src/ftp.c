@@ -140,6 +140,7 @@ static bool TCPIP_FTP_CmdsExecute(TCPIP_FTP_CMD cmd, TCPIP_FTP_DCPT* pFTPDcpt);
 #ifdef TCPIP_FTP_PUT_ENABLED
 static bool TCPIP_FTP_FilePut(TCPIP_FTP_DCPT* pFTPDcpt);
 #endif
+static void _FTP_FileChanged(TCPIP_FTP_DCPT* pFTPDcpt);
 static bool TCPIP_FTP_Quit(TCPIP_FTP_DCPT* pFTPDcpt);
 static bool TCPIP_FTP_FileGet(TCPIP_FTP_DCPT* pFTPDcpt, uint8_t *cFile);
 static bool TCPIP_FTP_MakeDirectory(TCPIP_FTP_DCPT* pFTPDcpt);
@@ -1235,6 +1236,7 @@ static bool TCPIP_FTP_FilePut(TCPIP_FTP_DCPT* pFTPDcpt)
                     break;
                 }
                 pFTPDcpt->fileDescr = fp;
+                _FTP_FileChanged(pFTPDcpt);
                 pFTPDcpt->ftpCommandSm    = TCPIP_FTP_CMD_SM_RECEIVE;
             }
             else
@@ -1257,6 +1259,7 @@ static bool TCPIP_FTP_FilePut(TCPIP_FTP_DCPT* pFTPDcpt)
             {
             // If no bytes were read, an EOF was reached
                 pFTPDcpt->ftp_shell_obj->fileClose(pFTPDcpt->ftp_shell_obj,fp);
+                _FTP_FileChanged(pFTPDcpt);
                 pFTPDcpt->fileDescr = (int32_t) SYS_FS_HANDLE_INVALID;
                 pFTPDcpt->callbackPos = 0;
                 pFTPDcpt->ftpResponse = TCPIP_FTP_RESP_FILE_ACTION_SUCCESSFUL_CLOSING_DATA_CONNECTION;
@@ -1280,6 +1283,7 @@ static bool TCPIP_FTP_FilePut(TCPIP_FTP_DCPT* pFTPDcpt)
                     {
                         pFTPDcpt->ftpFlag.Bits.endCommunication = 0;
                         SYS_FS_FileClose(pFTPDcpt->fileDescr);
+                        _FTP_FileChanged(pFTPDcpt);
                         pFTPDcpt->fileDescr = SYS_FS_HANDLE_INVALID;
                         pFTPDcpt->callbackPos = 0;
                         pFTPDcpt->ftpResponse = TCPIP_FTP_RESP_DATA_CLOSE;
@@ -1295,6 +1299,7 @@ static bool TCPIP_FTP_FilePut(TCPIP_FTP_DCPT* pFTPDcpt)
                 if(wLen == 0)
                 {// If no bytes were read, an EOF was reached
                     pFTPDcpt->ftp_shell_obj->fileClose(pFTPDcpt->ftp_shell_obj,fp);
+                    _FTP_FileChanged(pFTPDcpt);
                     pFTPDcpt->fileDescr = (int32_t) SYS_FS_HANDLE_INVALID;
                     pFTPDcpt->callbackPos = 0;
                     pFTPDcpt->ftpResponse = TCPIP_FTP_RESP_DATA_CLOSE;
@@ -1307,6 +1312,7 @@ static bool TCPIP_FTP_FilePut(TCPIP_FTP_DCPT* pFTPDcpt)
                     if(pFTPDcpt->ftp_shell_obj->fileWrite(pFTPDcpt->ftp_shell_obj,fp,data,wLen) == SYS_FS_HANDLE_INVALID)
                     {
                         pFTPDcpt->ftp_shell_obj->fileClose(pFTPDcpt->ftp_shell_obj,fp);
+                        _FTP_FileChanged(pFTPDcpt);
                         pFTPDcpt->fileDescr = (int32_t) SYS_FS_HANDLE_INVALID;
                         pFTPDcpt->callbackPos = 0;
                         pFTPDcpt->ftpResponse = TCPIP_FTP_RESP_DATA_CLOSE;
@@ -1331,8 +1337,17 @@ static bool TCPIP_FTP_FilePut(TCPIP_FTP_DCPT* pFTPDcpt)
     }
     return false;
 }
+
 #endif
 
+// the FTP client changed or removed a file: discard what the HTTP server may have cached
+static void _FTP_FileChanged(TCPIP_FTP_DCPT* pFTPDcpt)
+{
+#if defined(TCPIP_STACK_USE_HTTP_NET_SERVER)
+    TCPIP_HTTP_NET_FileCacheInvalidate((const char*)pFTPDcpt->ftp_argv[1]);
+#endif  // defined(TCPIP_STACK_USE_HTTP_NET_SERVER)
+}
+
 static bool TCPIP_FTP_CmdList(TCPIP_FTP_DCPT* pFTPDcpt)
 {
     uint16_t wCount=0;
@@ -2376,7 +2391,11 @@ static SYS_FS_RESULT TCPIP_FTP_RemoveFile(TCPIP_FTP_DCPT * pFTPDcpt)
     char            ftpMsg[128];
 
     result = (pFTPDcpt->ftp_shell_obj->fileDelete)(pFTPDcpt->ftp_shell_obj,(const char*)pFTPDcpt->ftp_argv[1]);
-    if(result == SYS_FS_HANDLE_INVALID)
+    if(result != SYS_FS_HANDLE_INVALID)
+    {
+        _FTP_FileChanged(pFTPDcpt);
+    }
+    else
     {
         fs_err = SYS_FS_Error();
         memset(ftpMsg,0,sizeof(ftpMsg));
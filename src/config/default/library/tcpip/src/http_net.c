@@ -40,6 +40,7 @@ Microchip or any third party.
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
+#include <ctype.h>
 
 #include "tcpip/src/tcpip_private.h"
 
@@ -51,6 +52,8 @@ Microchip or any third party.
 #define MPFS_SIGNATURE "MPFS\x02\x01"
 // size of the MPFS upload operation write buffer
 #define MPFS_UPLOAD_WRITE_BUFFER_SIZE   (4 * 1024)
+// number of upload write buffers: the socket fills one while the media writes the other(s)
+#define MPFS_UPLOAD_WRITE_BUFFERS       2
 
 #include "system/fs/sys_fs_media_manager.h"
 #endif  // defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
@@ -156,6 +159,9 @@ static const char * const HTTPResponseHeaders[] =
     "501 Not Implemented\r\n",                  // TCPIP_HTTP_NET_STAT_NOT_IMPLEMENTED
     "302 Found\r\nLocation: ",                  // TCPIP_HTTP_NET_STAT_REDIRECT
     "403 Forbidden\r\n",                        // TCPIP_HTTP_NET_STAT_TLS_REQUIRED
+    "304 Not Modified\r\n",                     // TCPIP_HTTP_NET_STAT_NOT_MODIFIED
+    "416 Range Not Satisfiable\r\n",            // TCPIP_HTTP_NET_STAT_RANGE_NOT_SATISFIABLE
+    "204 No Content\r\n",                       // TCPIP_HTTP_NET_STAT_NO_CONTENT
 #if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
     "200 OK\r\nContent-Type: text/html\r\n",    // TCPIP_HTTP_NET_STAT_UPLOAD_FORM
     0,                                          // TCPIP_HTTP_NET_STAT_UPLOAD_STARTED
@@ -163,6 +169,7 @@ static const char * const HTTPResponseHeaders[] =
     0,                                          // TCPIP_HTTP_NET_STAT_UPLOAD_WRITE_WAIT
     "200 OK\r\nContent-Type: text/html\r\n",    // TCPIP_HTTP_NET_STAT_UPLOAD_OK
     "500 Internal Server Error\r\nContent-Type: text/html\r\n", // TCPIP_HTTP_NET_STAT_UPLOAD_ERROR
+    "503 Service Unavailable\r\nRetry-After: 30\r\nContent-Type: text/html\r\n", // TCPIP_HTTP_NET_STAT_UPLOAD_BUSY
 #endif
 
 };
@@ -181,6 +188,9 @@ static const char * const HTTPResponseMessages[] =
     "\r\n501 Not Implemented: Only GET and POST supported\r\n",         // TCPIP_HTTP_NET_STAT_NOT_IMPLEMENTED
     0,                                                                  // TCPIP_HTTP_NET_STAT_REDIRECT
     "\r\n403 Forbidden: TLS Required - use HTTPS\r\n",                  // TCPIP_HTTP_NET_STAT_TLS_REQUIRED
+    0,                                                                  // TCPIP_HTTP_NET_STAT_NOT_MODIFIED
+    "\r\n416 Range Not Satisfiable\r\n",                              // TCPIP_HTTP_NET_STAT_RANGE_NOT_SATISFIABLE
+    0,                                                                  // TCPIP_HTTP_NET_STAT_NO_CONTENT
 
 #if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
     0,                                                                  // TCPIP_HTTP_NET_STAT_UPLOAD_FORM
@@ -190,6 +200,8 @@ static const char * const HTTPResponseMessages[] =
                                                                         // TCPIP_HTTP_NET_STAT_UPLOAD_OK
     "\r\n<html><body style=\"margin:100px\"><b>FS Update Successful</b><p><a href=\"/\">Site main page</a></body></html>",
     0,                                                                  // TCPIP_HTTP_NET_STAT_UPLOAD_ERROR
+                                                                        // TCPIP_HTTP_NET_STAT_UPLOAD_BUSY
+    "\r\n<html><body style=\"margin:100px\"><b>Another FS Upload Is In Progress</b><p>Try again later</body></html>",
 #endif
 };
 
@@ -223,6 +235,9 @@ static const _HTTP_HeaderMsgFnc HTTPResponseFunctions[] =
     _HTTP_HeaderMsg_Generic,        // TCPIP_HTTP_NET_STAT_NOT_IMPLEMENTED
     _HTTP_HeaderMsg_Redirect,       // TCPIP_HTTP_NET_STAT_REDIRECT
     _HTTP_HeaderMsg_Generic,        // TCPIP_HTTP_NET_STAT_TLS_REQUIRED
+    0,                              // TCPIP_HTTP_NET_STAT_NOT_MODIFIED
+    _HTTP_HeaderMsg_Generic,        // TCPIP_HTTP_NET_STAT_RANGE_NOT_SATISFIABLE
+    0,                              // TCPIP_HTTP_NET_STAT_NO_CONTENT
 #if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
     _HTTP_HeaderMsg_UploadForm,     // TCPIP_HTTP_NET_STAT_UPLOAD_FORM
     0,                              // TCPIP_HTTP_NET_STAT_UPLOAD_STARTED
@@ -230,6 +245,7 @@ static const _HTTP_HeaderMsgFnc HTTPResponseFunctions[] =
     0,                              // TCPIP_HTTP_NET_STAT_UPLOAD_WRITE_WAIT
     _HTTP_HeaderMsg_Generic,        // TCPIP_HTTP_NET_STAT_UPLOAD_OK
     _HTTP_HeaderMsg_UploadError,    // TCPIP_HTTP_NET_STAT_UPLOAD_ERROR
+    _HTTP_HeaderMsg_Generic,        // TCPIP_HTTP_NET_STAT_UPLOAD_BUSY
 #endif
 };
 
@@ -243,7 +259,15 @@ static const char * const HTTPRequestHeaders[] =
 {
     "Cookie:",
     "Authorization:",
-    "Content-Length:"
+    "Content-Length:",
+    "If-None-Match:",
+    "If-Modified-Since:",
+    "Range:",
+    "If-Range:",
+    "Content-Type:",
+    "Upgrade:",
+    "Sec-WebSocket-Key:",
+    "Accept-Encoding:",
 };
 
 /****************************************************************************
@@ -297,6 +321,21 @@ static const char * const HTTPRequestHeaders[] =
 // file path separator
 #define TCPIP_HTTP_FILE_PATH_SEP         '/'
 
+#if (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+// event stream response headers, ending the header block
+#define TCPIP_HTTP_EVENT_STREAM_HEADERS     "Content-Type: text/event-stream\r\nCache-Control: no-cache\r\n\r\n"
+// text/event-stream fields
+#define TCPIP_HTTP_EVENT_NAME_FIELD         "event: "
+#define TCPIP_HTTP_EVENT_DATA_FIELD         "data: "
+#endif  // (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+// appended to the Sec-WebSocket-Key for the accept value, RFC 6455
+#define TCPIP_HTTP_WS_GUID                  "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+// handshake response; the accept value follows
+#define TCPIP_HTTP_WS_HANDSHAKE             TCPIP_HTTP_NET_HEADER_PREFIX "101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: "
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+
 // list of dynamic variables that are keywords and can be processed internally 
 
 static TCPIP_HTTP_DYN_PRINT_RES TCPIP_HTTP_NET_DefaultIncludeFile(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const TCPIP_HTTP_DYN_VAR_DCPT* varDcpt, const struct _tag_TCPIP_HTTP_NET_USER_CALLBACK* pCBack);
@@ -328,6 +367,13 @@ static int                  httpChunksDepth = 0;    // chunk max depth
 static SINGLE_LIST          httpChunkPool;          // pool of chunks
 static TCPIP_HTTP_CHUNK_DCPT* httpAllocChunks = 0;  // allocated pool of chunks
 static SINGLE_LIST          httpFileBuffers;        // pool of file buffers
+static SINGLE_LIST          httpLineBuffers;        // pool of request line buffers
+static uint32_t             httpLineBuffEmpty = 0;  // line buffer pool empty counter
+static SINGLE_LIST          httpFileNames;          // interned file names: TCPIP_HTTP_FILE_NAME
+static uint32_t             httpFileNameBytes = 0;  // heap used by the interned file names
+#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+static TCPIP_HTTP_UPLOAD_DCPT*  httpUploadDcpt = 0; // the MPFS upload in progress; one at a time
+#endif  // defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
 
 static uint16_t             httpChunkPoolRetries = 0;  // max chunk pool retries number
 static uint16_t             httpFileBufferRetries = 0;  // max file buffer retries number
@@ -337,6 +383,10 @@ static int                  httpDynDescriptorsNo = 0;   // number of created buf
 static SINGLE_LIST          httpDynVarPool;         // pool of dynamic variable buffer descriptors
 static TCPIP_HTTP_DYNVAR_BUFF_DCPT* httpAllocDynDcpt = 0;// allocated pool of dyn var buffer descriptors
 static uint16_t             httpDynVarRetries = 0;  // max dynamic variable retries number
+
+static const char* const*   httpDynVarNames = 0;    // user registered dynamic variable names
+static uint16_t*            httpDynVarHash = 0;     // hash index of the registered names: name index or TCPIP_HTTP_NET_DYN_VAR_ID_INVALID
+static uint32_t             httpDynVarHashMask = 0; // hash index size - 1
 #endif  // (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0)
 
 // this is a parameter to allow working persistent or not
@@ -350,6 +400,9 @@ static uint16_t             httpPersistTmo;             // the timeout after whi
                                                         
 static tcpipSignalHandle    httpSignalHandle = 0;
 
+static TCPIP_HTTP_NET_CONN* httpReadyHead = 0;          // queue of connections signaled by their sockets
+static TCPIP_HTTP_NET_CONN* httpReadyTail = 0;
+
 static const void*          httpMemH = 0;              // handle to be used in the TCPIP_HEAP_ calls
 
 static TCPIP_HTTP_NET_USER_CALLBACK         httpRegistry;   // room for one callback registration
@@ -373,22 +426,220 @@ static uint32_t             httpDynPoolEmpty = 0;          // dynamic variables
 static int                  httpMaxRecurseDepth = 0;       // maximum chunk depth counter
 static uint32_t             httpDynParseRetry = 0;         // dynamic variables parsing was lost because it didn't fit in the buffer
 
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+// cache of compiled templates for dynamic files
+static TCPIP_HTTP_TMPL_ENTRY* httpTmplCache[TCPIP_HTTP_NET_TEMPLATE_CACHE_ENTRIES];
+static uint32_t             httpTmplStamp = 0;             // LRU stamp counter
+static uint32_t             httpTmplCacheHits = 0;         // template found in cache counter
+static uint32_t             httpTmplCacheMisses = 0;       // template recording started counter
+static uint32_t             httpTmplCacheFails = 0;        // template could not be recorded/cached counter
+static uint32_t             httpTmplPurges = 0;            // cache purges counter: discards the recordings in progress
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+
+#if (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
+// cached response header blocks
+static TCPIP_HTTP_HDR_ENTRY httpHdrCache[TCPIP_HTTP_NET_HEADER_CACHE_ENTRIES];
+static uint32_t             httpHdrStamp = 0;              // LRU stamp counter
+#endif  // (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
+
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+// RAM cache of small static files
+static TCPIP_HTTP_FILE_CACHE_ENTRY* httpFileCache[TCPIP_HTTP_NET_FILE_CACHE_ENTRIES];
+static uint32_t             httpFileCacheBytes = 0;        // file data currently cached
+static uint32_t             httpFileStamp = 0;             // LRU stamp counter
+static uint32_t             httpFileCacheHits = 0;         // file served from the cache counter
+static uint32_t             httpFileCacheMisses = 0;       // file opened in the file system counter
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+
+#if (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+// cached URI resolutions
+static TCPIP_HTTP_PATH_ENTRY httpPathCache[TCPIP_HTTP_NET_PATH_CACHE_ENTRIES];
+static uint32_t             httpPathStamp = 0;             // LRU stamp counter
+static uint32_t             httpPathCacheHits = 0;         // URI resolved from the cache counter
+static uint32_t             httpPathCacheMisses = 0;       // URI resolved in the file system counter
+#endif  // (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+// rendered snapshots of the polled dynamic files
+static TCPIP_HTTP_SNAP_FILE httpSnapFiles[TCPIP_HTTP_NET_SNAPSHOT_FILES];
+static TCPIP_HTTP_SNAP_ENTRY httpSnapCache[TCPIP_HTTP_NET_SNAPSHOT_ENTRIES];
+static uint32_t             httpSnapHits = 0;              // file served from a rendered snapshot counter
+static uint32_t             httpSnapMisses = 0;            // file rendered into a snapshot counter
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+
+#if (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+// Server-Sent Events channels: the names requested by the clients
+static const char*          httpEvChannels[TCPIP_HTTP_NET_EVENT_CHANNELS];
+static uint32_t             httpEvPublished = 0;           // events written to the subscribed connections counter
+static uint32_t             httpEvDropped = 0;             // events not written because of no socket TX space counter
+#endif  // (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+// WebSocket endpoints
+static TCPIP_HTTP_WS_ENDPOINT httpWsEndpoints[TCPIP_HTTP_NET_WEBSOCKET_ENDPOINTS];
+static uint32_t             httpWsMessages = 0;            // WebSocket messages received counter
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+// access log: ring of the last requests
+static TCPIP_HTTP_NET_LOG_ENTRY httpAccessLog[TCPIP_HTTP_NET_ACCESS_LOG_ENTRIES];
+static uint16_t             httpLogHead = 0;               // next record to be written
+static uint16_t             httpLogCount = 0;              // records currently in the log
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+
+#if (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+// authenticated sessions table
+static TCPIP_HTTP_SESSION_ENTRY httpSessions[TCPIP_HTTP_NET_AUTH_SESSIONS];
+static uint32_t             httpSessionHits = 0;           // requests authorized by a session token
+static uint32_t             httpSessionsIssued = 0;        // session tokens issued
+#endif  // (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+
+#if (_TCPIP_HTTP_NET_SCHED != 0)
+// connections scheduling: URI prefix rules, class weights and counters
+static TCPIP_HTTP_SCHED_RULE httpSchedRules[TCPIP_HTTP_NET_SCHED_RULES];
+static TCPIP_HTTP_NET_SCHED_STAT httpSchedStat[TCPIP_HTTP_NET_SCHED_CLASSES];
+static const uint16_t       httpSchedWeight[TCPIP_HTTP_NET_SCHED_CLASSES] = 
+{
+    TCPIP_HTTP_NET_SCHED_INTERACTIVE_WEIGHT,        // TCPIP_HTTP_NET_SCHED_CLASS_INTERACTIVE
+    TCPIP_HTTP_NET_SCHED_BULK_WEIGHT,               // TCPIP_HTTP_NET_SCHED_CLASS_BULK
+};
+#endif  // (_TCPIP_HTTP_NET_SCHED != 0)
+
+#if (_TCPIP_HTTP_NET_ROUTER != 0)
+// URL router: the registered routes and the trie of their patterns
+static TCPIP_HTTP_ROUTE_ENTRY httpRoutes[TCPIP_HTTP_NET_ROUTES];
+static TCPIP_HTTP_ROUTE_NODE httpRouteNodes[TCPIP_HTTP_NET_ROUTE_NODES];
+static uint16_t             httpRouteNodesNo = 1;          // nodes in use; the root is always there
+#endif  // (_TCPIP_HTTP_NET_ROUTER != 0)
+
+#if (_TCPIP_HTTP_NET_PIPELINE != 0)
+static uint32_t             httpPipelined = 0;             // requests answered back to back
+static uint32_t             httpPipeBreaks = 0;            // connections closed because the next request couldn't be found
+#endif  // (_TCPIP_HTTP_NET_PIPELINE != 0)
+
+#if (_TCPIP_HTTP_NET_DEFLATE != 0)
+// deflate compression counters
+static uint32_t             httpDeflateResponses = 0;      // responses sent compressed
+static uint32_t             httpDeflateLowHeap = 0;        // responses not compressed because of low heap
+static uint32_t             httpDeflateIn = 0;             // bytes given to the compressor
+static uint32_t             httpDeflateOut = 0;            // compressed bytes
+
+// length codes 257 - 285: base length and extra bits
+static const uint16_t       httpDeflateLenBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t        httpDeflateLenExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+// distance codes 0 - 29: base distance and extra bits
+static const uint16_t       httpDeflateDistBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t        httpDeflateDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+#endif  // (_TCPIP_HTTP_NET_DEFLATE != 0)
+
 
 /****************************************************************************
   Section:
     Function Prototypes
   ***************************************************************************/
-static bool _HTTP_HeaderParseLookup(TCPIP_HTTP_NET_CONN* pHttpCon, int reqIx);
+static bool _HTTP_HeaderParseLookup(TCPIP_HTTP_NET_CONN* pHttpCon, int reqIx, char* value);
+static int _HTTP_LineGet(TCPIP_HTTP_NET_CONN* pHttpCon);
+static bool _HTTP_LineBuffGet(TCPIP_HTTP_NET_CONN* pHttpCon);
+static void _HTTP_LineBuffRelease(TCPIP_HTTP_NET_CONN* pHttpCon);
+static bool _HTTP_FileNameSet(TCPIP_HTTP_NET_CONN* pHttpCon, const char* fName);
+static void _HTTP_FileNameRelease(TCPIP_HTTP_NET_CONN* pHttpCon);
 #if defined(TCPIP_HTTP_NET_USE_COOKIES)
-static bool _HTTP_HeaderParseCookie(TCPIP_HTTP_NET_CONN* pHttpCon);
+static bool _HTTP_HeaderParseCookie(TCPIP_HTTP_NET_CONN* pHttpCon, char* value);
 #endif
 #if defined(TCPIP_HTTP_NET_USE_AUTHENTICATION)
-static bool _HTTP_HeaderParseAuthorization(TCPIP_HTTP_NET_CONN* pHttpCon);
+static bool _HTTP_HeaderParseAuthorization(TCPIP_HTTP_NET_CONN* pHttpCon, char* value);
+static void _HTTP_AuthCredentialsCheck(TCPIP_HTTP_NET_CONN* pHttpCon, const char* value);
+#if (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+static void _HTTP_SessionCheck(TCPIP_HTTP_NET_CONN* pHttpCon, const char* value);
+static TCPIP_HTTP_SESSION_ENTRY* _HTTP_SessionFind(const uint32_t* token);
+static int _HTTP_SessionIssue(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer);
+#endif  // (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
 #endif
 #if defined(TCPIP_HTTP_NET_USE_POST)
-static bool _HTTP_HeaderParseContentLength(TCPIP_HTTP_NET_CONN* pHttpCon);
+static bool _HTTP_HeaderParseContentLength(TCPIP_HTTP_NET_CONN* pHttpCon, char* value);
 static TCPIP_HTTP_NET_READ_STATUS _HTTP_ReadTo(TCPIP_HTTP_NET_CONN* pHttpCon, uint8_t delim, uint8_t* buf, uint16_t len);
 #endif
+#if defined(TCPIP_HTTP_NET_USE_CONDITIONAL_GET)
+static bool _HTTP_HeaderParseIfNoneMatch(TCPIP_HTTP_NET_CONN* pHttpCon, char* value);
+static bool _HTTP_HeaderParseIfModifiedSince(TCPIP_HTTP_NET_CONN* pHttpCon, char* value);
+#endif  // defined(TCPIP_HTTP_NET_USE_CONDITIONAL_GET)
+#if defined(TCPIP_HTTP_NET_USE_RANGES)
+static bool _HTTP_HeaderParseRange(TCPIP_HTTP_NET_CONN* pHttpCon, char* value);
+static bool _HTTP_HeaderParseIfRange(TCPIP_HTTP_NET_CONN* pHttpCon, char* value);
+#endif  // defined(TCPIP_HTTP_NET_USE_RANGES)
+#if (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+static bool _HTTP_HeaderParseContentType(TCPIP_HTTP_NET_CONN* pHttpCon, char* value);
+static bool _HTTP_FormEvent(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_FORM_DCPT* pForm, TCPIP_HTTP_NET_FORM_EVENT event, const uint8_t* data, uint16_t dataLen,
+                            TCPIP_HTTP_NET_FORM_CALLBACK formCback, const void* param);
+static bool _HTTP_FormUrlParse(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_FORM_DCPT* pForm, uint8_t* buff, uint16_t buffLen,
+                               TCPIP_HTTP_NET_FORM_CALLBACK formCback, const void* param);
+static bool _HTTP_FormMultipartParse(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_FORM_DCPT* pForm, uint8_t* buff, uint16_t buffLen,
+                                     TCPIP_HTTP_NET_FORM_CALLBACK formCback, const void* param);
+static void _HTTP_FormPartHeaderParse(TCPIP_HTTP_FORM_DCPT* pForm);
+static void _HTTP_FormParamCopy(char* dest, const char* value);
+static TCPIP_HTTP_FORM_DCPT* _HTTP_FormAlloc(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_FORM_STATE state);
+static void _HTTP_FormRelease(TCPIP_HTTP_NET_CONN* pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+#if (_TCPIP_HTTP_NET_FILE_VALIDATORS != 0)
+static int  _HTTP_FileETagPrint(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer);
+static int  _HTTP_FileDatePrint(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer);
+static int  _HTTP_FileValidatorsPrint(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer);
+#endif  // (_TCPIP_HTTP_NET_FILE_VALIDATORS != 0)
+static void _HTTP_FileInfoGet(TCPIP_HTTP_NET_CONN* pHttpCon);
+static int  _HTTP_HeaderBlockPrint(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer, bool isPost);
+#if (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
+static TCPIP_HTTP_HDR_ENTRY* _HTTP_HeaderCacheFind(TCPIP_HTTP_NET_CONN* pHttpCon, uint32_t fStamp);
+static bool _HTTP_HeaderCacheLoad(TCPIP_HTTP_NET_CONN* pHttpCon);
+static void _HTTP_HeaderCacheAdd(TCPIP_HTTP_NET_CONN* pHttpCon);
+static void _HTTP_HeaderCacheDelete(TCPIP_HTTP_HDR_ENTRY* pHdr);
+static void _HTTP_HeaderCachePurge(const char* fName);
+#endif  // (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
+static bool _HTTP_ConnFileOpen(TCPIP_HTTP_NET_CONN* pHttpCon, const char* fName);
+static int32_t _HTTP_ConnFileSize(TCPIP_HTTP_NET_CONN* pHttpCon);
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+static TCPIP_HTTP_FILE_CACHE_ENTRY* _HTTP_FileCacheGet(const char* fName);
+static TCPIP_HTTP_FILE_CACHE_ENTRY* _HTTP_FileCacheLoad(SYS_FS_HANDLE fH, const char* fName, bool fileDynamic, uint32_t fStamp);
+static void _HTTP_FileCacheAdd(TCPIP_HTTP_NET_CONN* pHttpCon);
+static void _HTTP_FileCacheRelease(TCPIP_HTTP_FILE_CACHE_ENTRY* pEntry);
+static void _HTTP_FileCacheDelete(TCPIP_HTTP_FILE_CACHE_ENTRY** pSlot);
+static void _HTTP_FileCachePurge(const char* fName);
+static TCPIP_HTTP_CHUNK_RES _HTTP_AddCacheFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_FILE_CACHE_ENTRY* pEntry, TCPIP_HTTP_CHUNK_DCPT* pOwnDcpt);
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+static void _HTTP_DefaultFileAdd(TCPIP_HTTP_NET_CONN* pHttpCon, uint16_t nameLen);
+#if (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+static TCPIP_HTTP_PATH_ENTRY* _HTTP_PathCacheFind(const char* uri, uint16_t uriLen, uint32_t uriHash);
+static void _HTTP_PathCacheAdd(const char* uri, uint16_t uriLen, uint32_t uriHash, uint16_t pathFlags);
+static void _HTTP_PathCachePurge(void);
+#endif  // (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+static TCPIP_HTTP_SNAP_RES _HTTP_SnapshotGet(TCPIP_HTTP_NET_CONN* pHttpCon);
+static void _HTTP_SnapshotCapture(TCPIP_HTTP_NET_CONN* pHttpCon, const void* data, uint16_t dataLen);
+static void _HTTP_SnapshotEnd(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_SNAP_STATE endState);
+static void _HTTP_SnapshotPurge(bool freeData);
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+#if (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+static int _HTTP_EventChannelFind(const char* chName);
+static void _HTTP_EventWrite(NET_PRES_SKT_HANDLE_T skt, const char* evName, const char* evData);
+#endif  // (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+#if (_TCPIP_HTTP_NET_EVENT_STREAM != 0) || (_TCPIP_HTTP_NET_WEBSOCKET != 0) || (_TCPIP_HTTP_NET_ACCESS_LOG_DUMP != 0) || (_TCPIP_HTTP_NET_ROUTER != 0)
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ParseNoFile(TCPIP_HTTP_NET_CONN* pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_EVENT_STREAM != 0) || (_TCPIP_HTTP_NET_WEBSOCKET != 0) || (_TCPIP_HTTP_NET_ACCESS_LOG_DUMP != 0) || (_TCPIP_HTTP_NET_ROUTER != 0)
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+static bool _HTTP_HeaderParseUpgrade(TCPIP_HTTP_NET_CONN* pHttpCon, char* value);
+static bool _HTTP_HeaderParseWsKey(TCPIP_HTTP_NET_CONN* pHttpCon, char* value);
+static int  _HTTP_WsEndpointFind(const char* uri);
+static void _HTTP_Sha1(const uint8_t* data, uint16_t dataLen, uint8_t* digest);
+static bool _HTTP_WsFrameWrite(NET_PRES_SKT_HANDLE_T skt, uint8_t opCode, const void* data, uint16_t dataLen);
+static bool _HTTP_WsCloseSend(TCPIP_HTTP_NET_CONN* pHttpCon, uint16_t closeCode);
+static void _HTTP_WsRelease(TCPIP_HTTP_NET_CONN* pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+static void _HTTP_LogStamp(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_NET_LOG_STAGE stage);
+static void _HTTP_LogRecord(TCPIP_HTTP_NET_CONN* pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+#if (_TCPIP_HTTP_NET_ACCESS_LOG_DUMP != 0)
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_LogDump(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait);
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG_DUMP != 0)
 static uint16_t _HTTP_SktFifoRxFree(NET_PRES_SKT_HANDLE_T skt);
 
 static bool _HTTP_DataTryOutput(TCPIP_HTTP_NET_CONN* pHttpCon, const char* data, uint16_t dataLen, uint16_t checkLen);
@@ -405,6 +656,30 @@ static void TCPIP_HTTP_NET_ProcessConnection(TCPIP_HTTP_NET_CONN* pHttpCon);
 
 static void _HTTPSocketRxSignalHandler(NET_PRES_SKT_HANDLE_T skt, TCPIP_NET_HANDLE hNet, uint16_t sigType, const void* param);
 
+static void _HTTP_ProcessReady(void);
+
+static void _HTTP_ConnReadyAdd(TCPIP_HTTP_NET_CONN* pHttpCon);
+
+static void _HTTP_ConnCheckReset(TCPIP_HTTP_NET_CONN* pHttpCon);
+
+#if (_TCPIP_HTTP_NET_SCHED != 0)
+static void _HTTP_SchedClassSet(TCPIP_HTTP_NET_CONN* pHttpCon, int32_t bodyLen);
+static void _HTTP_SchedCredit(TCPIP_HTTP_NET_CONN* pHttpCon);
+static bool _HTTP_SchedYield(TCPIP_HTTP_NET_CONN* pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_SCHED != 0)
+
+#if (_TCPIP_HTTP_NET_ROUTER != 0)
+static int _HTTP_RouteNodeFind(const char* pattern, uint16_t patternLen, int* pNewNodes);
+static int _HTTP_RouteNodeAdd(const char* pattern, uint16_t patternLen);
+static uint8_t _HTTP_RouteFind(const char* name, int methodIx);
+static void _HTTP_RouteResolve(TCPIP_HTTP_NET_CONN* pHttpCon, const char* name);
+static void _HTTP_RoutesRemove(void);
+#endif  // (_TCPIP_HTTP_NET_ROUTER != 0)
+
+#if (_TCPIP_HTTP_NET_PIPELINE != 0)
+static uint32_t _HTTP_BodySkip(TCPIP_HTTP_NET_CONN* pHttpCon, uint32_t skipLen);
+#endif  // (_TCPIP_HTTP_NET_PIPELINE != 0)
+
 #if (TCPIP_STACK_DOWN_OPERATION != 0)
 static void _HTTP_Cleanup(const TCPIP_STACK_MODULE_CTRL* const stackCtrl);
 static void _HTTP_CloseConnections(TCPIP_NET_IF* pNetIf);
@@ -420,12 +695,35 @@ static TCPIP_HTTP_CHUNK_DCPT* _HTTP_AllocChunk(TCPIP_HTTP_NET_CONN* pHttpCon, TC
 static void _HTTP_FreeChunk(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK_DCPT* pChDcpt);
 
 static bool _HTTP_FileTypeIsDynamic(const char* fName);
+static bool _HTTP_IncludeIsDynamic(const char* fName, uint32_t* pStamp);
+static size_t _HTTP_ChunkFileRead(TCPIP_HTTP_FILE_CHUNK_DCPT* pFDcpt, int32_t fOffset, void* buffer, size_t nBytes);
+static int32_t _HTTP_ChunkFileSeek(TCPIP_HTTP_FILE_CHUNK_DCPT* pFDcpt, int32_t offset, SYS_FS_FILE_SEEK_CONTROL whence);
 
 static TCPIP_HTTP_CHUNK_RES _HTTP_ProcessChunks(TCPIP_HTTP_NET_CONN* pHttpCon);
 
-static uint16_t _HTTP_PrependStartHttpChunk(char* buffer, uint32_t chunkSize);
+static uint16_t _HTTP_PrependStartHttpChunk(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer, uint32_t chunkSize);
+
+static uint16_t _HTTP_AppendEndHttpChunk(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer, TCPIP_HTTP_CHUNK_END_TYPE endType);
+
+static bool _HTTP_ChunkFramingNeeded(TCPIP_HTTP_NET_CONN* pHttpCon);
+
+static uint16_t _HTTP_BodyWrite(TCPIP_HTTP_NET_CONN* pHttpCon, const void* data, uint16_t dataLen);
 
-static uint16_t _HTTP_AppendEndHttpChunk(char* buffer, TCPIP_HTTP_CHUNK_END_TYPE endType);
+#if (TCPIP_HTTP_NET_SSI_PROCESS != 0)
+static uint16_t _HTTP_BodyWriteIsReady(TCPIP_HTTP_NET_CONN* pHttpCon, uint16_t reqSize);
+#endif  // (TCPIP_HTTP_NET_SSI_PROCESS != 0)
+
+#if (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+static bool _HTTP_BodyFlush(TCPIP_HTTP_NET_CONN* pHttpCon, bool final);
+static void _HTTP_BodyBuffRelease(TCPIP_HTTP_NET_CONN* pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+
+#if (_TCPIP_HTTP_NET_DEFLATE != 0)
+static bool _HTTP_HeaderParseAcceptEncoding(TCPIP_HTTP_NET_CONN* pHttpCon, char* value);
+static void _HTTP_DeflateStart(TCPIP_HTTP_NET_CONN* pHttpCon);
+static uint16_t _HTTP_DeflateWrite(TCPIP_HTTP_NET_CONN* pHttpCon, const uint8_t* data, uint16_t dataLen);
+static bool _HTTP_DeflateEnd(TCPIP_HTTP_NET_CONN* pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_DEFLATE != 0)
 
 static TCPIP_HTTP_CHUNK_RES _HTTP_ProcessFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK_DCPT* pChDcpt);
 
@@ -473,19 +771,32 @@ static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessError(TCPIP_HTTP_NET_CONN* pHttpCo
 
 static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessDisconnect(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait);
 
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessEventStream(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait);
+
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessWebSocket(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait);
+
 #if (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0)
 static char* _HTTP_DynVarParse(char* dynVarBuff, char** pEndDyn, bool verifyOnly);
 static bool  _HTTP_DynVarExtract(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK_DCPT* pDynChDcpt, TCPIP_HTTP_CHUNK_DCPT* pFileChDcpt);
 static const TCPIP_HTTP_DYN_VAR_KEYWORD_ENTRY* _HTTP_SearchDynVarKeyEntry(const char* keyword);
+static uint16_t _HTTP_DynVarIdGet(const char* dynName);
+static void _HTTP_DynVarNamesRemove(void);
 static TCPIP_HTTP_CHUNK_RES _HTTP_ProcessDynVarChunk(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK_DCPT* pChDcpt);
 static TCPIP_HTTP_CHUNK_RES _HTTP_DynVarCallback(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK_DCPT* pChDcpt);
 static bool _HTTP_DynVarProcess(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK_DCPT* pChDcpt);
 static TCPIP_HTTP_DYNVAR_BUFF_DCPT* _HTTP_GetDynBuffDescriptor(TCPIP_HTTP_CHUNK_DCPT* pChDcpt);
 static void _HTTP_ReleaseDynBuffDescriptor(TCPIP_HTTP_DYNVAR_BUFF_DCPT* pDynDcpt);
 
+#endif // (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0)
+
+#if (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0) || (_TCPIP_HTTP_NET_FILE_MEMORY != 0)
 static uint16_t _HTTP_StartHttpChunk(TCPIP_HTTP_NET_CONN* pHttpCon, uint32_t chunkSize);
 static uint16_t _HTTP_EndHttpChunk(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK_END_TYPE endType);
-#endif // (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0)
+#endif // (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0) || (_TCPIP_HTTP_NET_FILE_MEMORY != 0)
+
+#if (_TCPIP_HTTP_NET_FILE_MEMORY != 0)
+static TCPIP_HTTP_CHUNK_RES _HTTP_ProcessMappedFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK_DCPT* pChDcpt);
+#endif  // (_TCPIP_HTTP_NET_FILE_MEMORY != 0)
 
 #if (TCPIP_HTTP_NET_SSI_PROCESS != 0)
 static char*                                _HTTP_SSILineParse(char* lineBuff, char** pEndProcess, bool verifyOnly);
@@ -511,6 +822,15 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_AddDynChunk(TCPIP_HTTP_NET_CONN* pHttpCon, TCP
 static TCPIP_HTTP_DYN_ARG_TYPE _HTTP_ArgType(char* argStr, int32_t* pIntArg);
 #endif  // (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0) || (TCPIP_HTTP_NET_SSI_PROCESS != 0)
 
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+static TCPIP_HTTP_TMPL_ENTRY* _HTTP_TemplateGet(TCPIP_HTTP_CHUNK_DCPT* pChDcpt, uint32_t fHash, uint32_t fStamp);
+static void _HTTP_TemplateRecord(TCPIP_HTTP_CHUNK_DCPT* pChDcpt);
+static void _HTTP_TemplateBuildEnd(TCPIP_HTTP_CHUNK_DCPT* pChDcpt);
+static void _HTTP_TemplateRelease(TCPIP_HTTP_TMPL_ENTRY* pTmpl);
+static void _HTTP_TemplateCachePurge(void);
+static size_t _HTTP_TemplateSpan(TCPIP_HTTP_CHUNK_DCPT* pChDcpt, size_t maxBytes);
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+
 // basic HTTP connection process function
 // processes a HTTP connection state: TCPIP_HTTP_NET_CONN_STATE
 // returns the next connection state needed
@@ -538,6 +858,8 @@ static const _HTTP_ConnProcessFunc  _HTTP_ConnProcess_Tbl[] =
     _HTTP_ProcessDone,                  // TCPIP_HTTP_CONN_STATE_DONE,             
     _HTTP_ProcessError,                 // TCPIP_HTTP_CONN_STATE_ERROR        
     _HTTP_ProcessDisconnect,            // TCPIP_HTTP_CONN_STATE_DISCONNECT        
+    _HTTP_ProcessEventStream,           // TCPIP_HTTP_CONN_STATE_EVENT_STREAM        
+    _HTTP_ProcessWebSocket,             // TCPIP_HTTP_CONN_STATE_WEBSOCKET        
 };
 
 
@@ -654,6 +976,8 @@ static const char* const _HTTP_DbgConnState_Tbl[] =
     "done",                 // TCPIP_HTTP_CONN_STATE_DONE,            
     "error",                // TCPIP_HTTP_CONN_STATE_ERROR       
     "discon",               // TCPIP_HTTP_CONN_STATE_DISCONNECT       
+    "evt_stream",           // TCPIP_HTTP_CONN_STATE_EVENT_STREAM       
+    "websocket",            // TCPIP_HTTP_CONN_STATE_WEBSOCKET       
 };
 
 static const char* const _HTTP_DbgHttpState_Tbl[] = 
@@ -668,12 +992,16 @@ static const char* const _HTTP_DbgHttpState_Tbl[] =
     "501",              // TCPIP_HTTP_NET_STAT_NOT_IMPLEMENTED,      
     "302",              // TCPIP_HTTP_NET_STAT_REDIRECT,             
     "403",              // TCPIP_HTTP_NET_STAT_TLS_REQUIRED,         
+    "304",              // TCPIP_HTTP_NET_STAT_NOT_MODIFIED,         
+    "416",              // TCPIP_HTTP_NET_STAT_RANGE_NOT_SATISFIABLE,
+    "204",              // TCPIP_HTTP_NET_STAT_NO_CONTENT,
     "upl",              // TCPIP_HTTP_NET_STAT_UPLOAD_FORM,                                            
     "upl_start",        // TCPIP_HTTP_NET_STAT_UPLOAD_STARTED,      
     "upl_write",        // TCPIP_HTTP_NET_STAT_UPLOAD_WRITE,      
     "upl_wait",         // TCPIP_HTTP_NET_STAT_UPLOAD_WRITE_WAIT,      
     "upl_ok",           // TCPIP_HTTP_NET_STAT_UPLOAD_OK,           
     "upl_err",          // TCPIP_HTTP_NET_STAT_UPLOAD_ERROR,        
+    "upl_busy",         // TCPIP_HTTP_NET_STAT_UPLOAD_BUSY,
                                   
 };
 
@@ -756,6 +1084,15 @@ static void _HTTP_DbgConnTmo(TCPIP_HTTP_NET_CONN* pHttpCon)
 
 #if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
 static TCPIP_HTTP_NET_IO_RESULT TCPIP_HTTP_NET_FSUpload(TCPIP_HTTP_NET_CONN* pHttpCon);
+static TCPIP_HTTP_UPLOAD_DCPT* _HTTP_UploadAlloc(TCPIP_HTTP_NET_CONN* pHttpCon);
+static void _HTTP_UploadRelease(TCPIP_HTTP_NET_CONN* pHttpCon);
+static void _HTTP_UploadPurge(void);
+static void _HTTP_UploadAdvance(TCPIP_HTTP_UPLOAD_DCPT* pUpload, uint16_t len);
+static int _HTTP_UploadCmdCheck(TCPIP_HTTP_UPLOAD_DCPT* pUpload);
+static bool _HTTP_UploadWrite(TCPIP_HTTP_UPLOAD_DCPT* pUpload, TCPIP_HTTP_UPLOAD_CMD cmd, uint32_t sectNo, uint8_t* pData, uint32_t nSectors);
+static bool _HTTP_UploadWriteNext(TCPIP_HTTP_UPLOAD_DCPT* pUpload);
+static bool _HTTP_UploadReadNext(TCPIP_HTTP_UPLOAD_DCPT* pUpload);
+static uint32_t _HTTP_Crc32(uint32_t crc, const uint8_t* pData, uint32_t len);
 #endif
 
 #define mMIN(a, b)  ((a<b)?a:b)
@@ -793,6 +1130,30 @@ static void _HTTP_CloseConnections(TCPIP_NET_IF* pNetIf)
                     pHttpCon->file = SYS_FS_HANDLE_INVALID;
                     _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_CLOSE, pHttpCon->fileName);
                 }
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+                if(pHttpCon->fileCache != 0)
+                {
+                    _HTTP_FileCacheRelease(pHttpCon->fileCache);
+                    pHttpCon->fileCache = 0;
+                }
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+#if (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+                _HTTP_BodyBuffRelease(pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+                _HTTP_LineBuffRelease(pHttpCon);
+                _HTTP_FileNameRelease(pHttpCon);
+#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+                _HTTP_UploadRelease(pHttpCon);
+#endif  // defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+#if (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+                _HTTP_FormRelease(pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+                _HTTP_SnapshotEnd(pHttpCon, TCPIP_HTTP_SNAP_STATE_FREE);
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+                _HTTP_WsRelease(pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
 
                 if(pNetIf == 0)
                 {   // stack going down
@@ -818,6 +1179,8 @@ static void _HTTP_CloseConnections(TCPIP_NET_IF* pNetIf)
 static void _HTTP_Cleanup(const TCPIP_STACK_MODULE_CTRL* const stackCtrl)
 {
     TCPIP_HTTP_FILE_BUFF_DCPT*  fileBuffDcpt;
+    TCPIP_HTTP_LINE_BUFF_DCPT*  lineBuffDcpt;
+    TCPIP_HTTP_FILE_NAME*       pName;
 
     if(httpConnData && httpConnCtrl)
     {
@@ -855,11 +1218,31 @@ static void _HTTP_Cleanup(const TCPIP_STACK_MODULE_CTRL* const stackCtrl)
         TCPIP_HEAP_Free(httpMemH, fileBuffDcpt);
     }
 
+    while((lineBuffDcpt = (TCPIP_HTTP_LINE_BUFF_DCPT*)TCPIP_Helper_SingleListHeadRemove(&httpLineBuffers)) != 0)
+    {
+        TCPIP_HEAP_Free(httpMemH, lineBuffDcpt);
+    }
+
+    while((pName = (TCPIP_HTTP_FILE_NAME*)TCPIP_Helper_SingleListHeadRemove(&httpFileNames)) != 0)
+    {
+        (*http_free_fnc)(pName);
+    }
+    httpFileNameBytes = 0;
+
+#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+    if(httpUploadDcpt != 0)
+    {
+        (*http_free_fnc)(httpUploadDcpt);
+        httpUploadDcpt = 0;
+    }
+#endif  // defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+
     if(httpSignalHandle)
     {
         _TCPIPStackSignalHandlerDeregister(httpSignalHandle);
         httpSignalHandle = 0;
     }
+    httpReadyHead = httpReadyTail = 0;
 
     if(httpFileShell != 0)
     {
@@ -876,6 +1259,44 @@ static void _HTTP_Cleanup(const TCPIP_STACK_MODULE_CTRL* const stackCtrl)
     }
 #endif // (TCPIP_HTTP_NET_SSI_PROCESS != 0)
 
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+    _HTTP_TemplateCachePurge();
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+
+#if (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
+    _HTTP_HeaderCachePurge(0);
+#endif  // (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
+
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+    _HTTP_FileCachePurge(0);
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+
+#if (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+    _HTTP_PathCachePurge();
+#endif  // (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+    _HTTP_SnapshotPurge(true);
+    memset(httpSnapFiles, 0, sizeof(httpSnapFiles));
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+
+#if (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+    memset(httpEvChannels, 0, sizeof(httpEvChannels));
+#endif  // (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+    memset(httpWsEndpoints, 0, sizeof(httpWsEndpoints));
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+#if (_TCPIP_HTTP_NET_SCHED != 0)
+    memset(httpSchedRules, 0, sizeof(httpSchedRules));
+#endif  // (_TCPIP_HTTP_NET_SCHED != 0)
+#if (_TCPIP_HTTP_NET_ROUTER != 0)
+    _HTTP_RoutesRemove();
+#endif  // (_TCPIP_HTTP_NET_ROUTER != 0)
+
+#if (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0)
+    _HTTP_DynVarNamesRemove();
+#endif  // (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0)
+
 #if (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0) || (TCPIP_HTTP_NET_SSI_PROCESS != 0) || defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
     http_malloc_fnc = 0;
     http_free_fnc = 0;
@@ -890,10 +1311,11 @@ bool TCPIP_HTTP_NET_Initialize(const TCPIP_STACK_MODULE_CTRL* const stackCtrl,
               const TCPIP_HTTP_NET_MODULE_CONFIG* httpInitData)
 {
     bool        initFail;
-    int         connIx, nConns, buffIx;
+    int         connIx, nConns, buffIx, lineIx;
     TCPIP_HTTP_NET_CONN*  pHttpCon;
     uint8_t*    pHttpData;
     TCPIP_HTTP_FILE_BUFF_DCPT*  fileBuffDcpt;
+    TCPIP_HTTP_LINE_BUFF_DCPT*  lineBuffDcpt;
     NET_PRES_SKT_T  sktType;
     uint16_t    fileBufferTotSize;
 
@@ -939,6 +1361,40 @@ bool TCPIP_HTTP_NET_Initialize(const TCPIP_STACK_MODULE_CTRL* const stackCtrl,
         memset(&httpRegistry, 0, sizeof(httpRegistry));
         httpUserCback = 0;
         httpDynPoolEmpty = httpMaxRecurseDepth = httpDynParseRetry = 0;
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+        httpTmplStamp = httpTmplCacheHits = httpTmplCacheMisses = httpTmplCacheFails = 0;
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+        httpFileStamp = httpFileCacheHits = httpFileCacheMisses = 0;
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+#if (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+        httpPathCacheHits = httpPathCacheMisses = 0;
+#endif  // (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+        httpSnapHits = httpSnapMisses = 0;
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+        httpLogHead = httpLogCount = 0;
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+#if (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+        memset(httpSessions, 0, sizeof(httpSessions));
+        httpSessionHits = httpSessionsIssued = 0;
+#endif  // (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+#if (_TCPIP_HTTP_NET_SCHED != 0)
+        memset(httpSchedStat, 0, sizeof(httpSchedStat));
+#endif  // (_TCPIP_HTTP_NET_SCHED != 0)
+#if (_TCPIP_HTTP_NET_DEFLATE != 0)
+        httpDeflateResponses = httpDeflateLowHeap = httpDeflateIn = httpDeflateOut = 0;
+#endif  // (_TCPIP_HTTP_NET_DEFLATE != 0)
+#if (_TCPIP_HTTP_NET_PIPELINE != 0)
+        httpPipelined = httpPipeBreaks = 0;
+#endif  // (_TCPIP_HTTP_NET_PIPELINE != 0)
+#if (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+        httpEvPublished = httpEvDropped = 0;
+#endif  // (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+        httpWsMessages = 0;
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
 
 
         httpChunksDepth = httpInitData->maxRecurseLevel;
@@ -946,6 +1402,9 @@ bool TCPIP_HTTP_NET_Initialize(const TCPIP_STACK_MODULE_CTRL* const stackCtrl,
         httpChunkPoolRetries = httpInitData->chunkPoolRetries;
         httpFileBufferRetries = httpInitData->fileBufferRetries;
         TCPIP_Helper_SingleListInitialize (&httpFileBuffers);
+        TCPIP_Helper_SingleListInitialize (&httpLineBuffers);
+        TCPIP_Helper_SingleListInitialize (&httpFileNames);
+        httpLineBuffEmpty = httpFileNameBytes = 0;
 
         httpMemH = stackCtrl->memH;
         httpConnCtrl = (TCPIP_HTTP_NET_CONN*)TCPIP_HEAP_Calloc(httpMemH, nConns, sizeof(*httpConnCtrl));
@@ -976,10 +1435,23 @@ bool TCPIP_HTTP_NET_Initialize(const TCPIP_STACK_MODULE_CTRL* const stackCtrl,
             }
         } 
 
+        // the request line buffers, shared by the connections
+        // a buffer is held only while a line is being assembled,
+        // so the pool can be smaller than the number of connections
+        for(lineIx = 0; lineIx < TCPIP_HTTP_NET_LINE_BUFFERS; lineIx++)
+        {
+            lineBuffDcpt = (TCPIP_HTTP_LINE_BUFF_DCPT*)TCPIP_HEAP_Malloc(httpMemH, sizeof(TCPIP_HTTP_LINE_BUFF_DCPT));
+            if(lineBuffDcpt == 0)
+            {   // failed
+                break;
+            }
+            TCPIP_Helper_SingleListTailAdd(&httpLineBuffers, (SGL_LIST_NODE*)lineBuffDcpt);
+        }
+
 #if (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0)
-        if(httpConnCtrl == 0 || httpConnData == 0 || httpAllocDynDcpt == 0 || httpAllocChunks == 0 || buffIx != httpInitData->nFileBuffers)
+        if(httpConnCtrl == 0 || httpConnData == 0 || httpAllocDynDcpt == 0 || httpAllocChunks == 0 || buffIx != httpInitData->nFileBuffers || lineIx != TCPIP_HTTP_NET_LINE_BUFFERS)
 #else
-        if(httpConnCtrl == 0 || httpConnData == 0 || httpAllocChunks == 0 || buffIx != httpInitData->nFileBuffers)
+        if(httpConnCtrl == 0 || httpConnData == 0 || httpAllocChunks == 0 || buffIx != httpInitData->nFileBuffers || lineIx != TCPIP_HTTP_NET_LINE_BUFFERS)
 #endif  // (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0)
         {   // failed
             SYS_ERROR(SYS_ERROR_ERROR, " HTTP: Dynamic allocation failed\r\n");
@@ -1002,6 +1474,7 @@ bool TCPIP_HTTP_NET_Initialize(const TCPIP_STACK_MODULE_CTRL* const stackCtrl,
         {
             pHttpCon->socket =  NET_PRES_INVALID_SOCKET;
             pHttpCon->file = SYS_FS_HANDLE_INVALID;
+            pHttpCon->fileName = "";
         }
 
         httpConnNo = nConns;
@@ -1056,7 +1529,7 @@ bool TCPIP_HTTP_NET_Initialize(const TCPIP_STACK_MODULE_CTRL* const stackCtrl,
             }
             pHttpCon->flags.sktLocalReset = 1;      // socket will start reset
 
-            pHttpCon->socketSignal = NET_PRES_SocketSignalHandlerRegister(pHttpCon->socket, TCPIP_TCP_SIGNAL_RX_DATA, _HTTPSocketRxSignalHandler, 0);
+            pHttpCon->socketSignal = NET_PRES_SocketSignalHandlerRegister(pHttpCon->socket, TCPIP_HTTP_NET_SKT_SIGNALS, _HTTPSocketRxSignalHandler, pHttpCon);
             if(pHttpCon->socketSignal == 0)
             {
                 SYS_ERROR(SYS_ERROR_ERROR, " HTTP: Signal creation failed\r\n");
@@ -1160,27 +1633,400 @@ void TCPIP_HTTP_NET_Task(void)
 
     sigPend = _TCPIPStackModuleSignalGet(TCPIP_THIS_MODULE_ID, TCPIP_MODULE_SIGNAL_MASK_ALL);
 
-    if(sigPend != 0)
-    { //  some signal occurred
+    if((sigPend & TCPIP_MODULE_SIGNAL_RX_PENDING) != 0)
+    { //  socket signal occurred; run the signaled connections
+        _HTTP_ProcessReady();
+    }
+
+    if((sigPend & TCPIP_MODULE_SIGNAL_TMO) != 0)
+    { // regular TMO occurred
         TCPIP_HTTP_NET_Process();
     }
 }
 
-// send a signal to the HTTP module that data is available
+// socket signal: data is available, TX space is available (data was acknowledged) or the remote party closed
+// queue the connection and send a signal to the HTTP module
 // no manager alert needed since this normally results as a higher layer (TCP) signal
 static void _HTTPSocketRxSignalHandler(NET_PRES_SKT_HANDLE_T skt, TCPIP_NET_HANDLE hNet, uint16_t sigType, const void* param)
 {
-    if(sigType == TCPIP_TCP_SIGNAL_RX_DATA)
+    if((sigType & TCPIP_HTTP_NET_SKT_SIGNALS) != 0 && param != 0)
     {
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+        if((sigType & TCPIP_TCP_SIGNAL_ESTABLISHED) != 0)
+        {   // the first request of the connection starts now
+            ((TCPIP_HTTP_NET_CONN*)param)->logAccept = SYS_TIME_CounterGet();
+        }
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+        _HTTP_ConnReadyAdd((TCPIP_HTTP_NET_CONN*)param);
         _TCPIPStackModuleSignalRequest(TCPIP_THIS_MODULE_ID, TCPIP_MODULE_SIGNAL_RX_PENDING, true); 
     }
 }
 
+// adds a connection to the ready queue, if not already there
+static void _HTTP_ConnReadyAdd(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    if(pHttpCon->readyQueued == 0)
+    {
+        pHttpCon->readyNext = 0;
+        if(httpReadyTail == 0)
+        {
+            httpReadyHead = pHttpCon;
+        }
+        else
+        {
+            httpReadyTail->readyNext = pHttpCon;
+        }
+        httpReadyTail = pHttpCon;
+        pHttpCon->readyQueued = 1;
+    }
+}
+
+// processes the connections in the ready queue
+// connections signaled while processing are run at the next module signal
+static void _HTTP_ProcessReady(void)
+{
+    TCPIP_HTTP_NET_CONN *pHttpCon, *pNext;
+
+    pHttpCon = httpReadyHead;
+    httpReadyHead = httpReadyTail = 0;
+
+    for(; pHttpCon != 0; pHttpCon = pNext)
+    {
+        pNext = pHttpCon->readyNext;
+        pHttpCon->readyQueued = 0;
+
+        if(pHttpCon->socket == NET_PRES_INVALID_SOCKET)
+        {
+            continue;
+        }
+
+        _HTTP_ConnCheckReset(pHttpCon);
+        if(pHttpCon->connState != TCPIP_HTTP_CONN_STATE_IDLE || NET_PRES_SocketReadIsReady(pHttpCon->socket))
+        {
+            TCPIP_HTTP_NET_ProcessConnection(pHttpCon);
+            if(pHttpCon->connState == TCPIP_HTTP_CONN_STATE_IDLE && NET_PRES_SocketReadIsReady(pHttpCon->socket))
+            {   // another request is already waiting; no new RX signal will come for it
+                _HTTP_ConnReadyAdd(pHttpCon);
+                _TCPIPStackModuleSignalRequest(TCPIP_THIS_MODULE_ID, TCPIP_MODULE_SIGNAL_RX_PENDING, true); 
+            }
+        }
+    }
+}
+
+// checks if a socket was reset
+// if the reset was not initiated locally the connection is aborted
+static void _HTTP_ConnCheckReset(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    // If a socket is reset at any time 
+    // forget about it and return to idle state.
+    if(NET_PRES_SocketWasReset(pHttpCon->socket) || NET_PRES_SocketWasDisconnected(pHttpCon->socket))
+    {
+        if(pHttpCon->flags.sktLocalReset != 0)
+        {   // http initiated the disconnect; no error
+            pHttpCon->flags.sktLocalReset = 0;
+        }
+        else
+        {   // some disconnect initiated by the remote party
+            pHttpCon->flags.discardRxBuff = 1;
+            pHttpCon->connState = TCPIP_HTTP_CONN_STATE_ERROR;
+            pHttpCon->closeEvent = TCPIP_HTTP_NET_EVENT_CLOSE_REMOTE;
+        }
+    }
+}
+
+#if (_TCPIP_HTTP_NET_SCHED != 0)
+// deficit round robin scheduling:
+// a connection gets a quantum of body bytes, proportional to the weight of its class, in each turn
+// when the quantum is used up and other connections are busy, it gives way to them
+
+// sets the scheduling class of the request when the message body starts
+// bodyLen is the length of a static body; < 0 if not known
+static void _HTTP_SchedClassSet(TCPIP_HTTP_NET_CONN* pHttpCon, int32_t bodyLen)
+{
+    int ix;
+    TCPIP_HTTP_SCHED_RULE* pRule;
+    uint8_t schedClass;
+
+    schedClass = (bodyLen >= TCPIP_HTTP_NET_SCHED_BULK_SIZE) ? TCPIP_HTTP_NET_SCHED_CLASS_BULK : TCPIP_HTTP_NET_SCHED_CLASS_INTERACTIVE;
+
+    pRule = httpSchedRules;
+    for(ix = 0; ix < sizeof(httpSchedRules) / sizeof(*httpSchedRules); ix++, pRule++)
+    {
+        if(pRule->uriPrefix != 0 && strncmp(pHttpCon->fileName, pRule->uriPrefix, pRule->prefixLen) == 0)
+        {
+            schedClass = (uint8_t)pRule->schedClass;
+            break;
+        }
+    }
+
+    pHttpCon->schedClass = schedClass;
+    httpSchedStat[schedClass].requests++;
+}
+
+// adds a quantum to the connection deficit
+// no credit is saved while the connection is not busy
+static void _HTTP_SchedCredit(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    int32_t quantum = TCPIP_HTTP_NET_SCHED_QUANTUM * httpSchedWeight[pHttpCon->schedClass];
+
+    if((pHttpCon->schedDeficit += quantum) > quantum)
+    {
+        pHttpCon->schedDeficit = quantum;
+    }
+}
+
+// checks if the connection has to give way to the others
+// returns true if the deficit is used up and other connections are busy
+static bool _HTTP_SchedYield(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    int connIx;
+    TCPIP_HTTP_NET_CONN* pOther;
+
+    if(pHttpCon->schedDeficit > 0)
+    {
+        return false;
+    }
+
+    pOther = httpConnCtrl;
+    for(connIx = 0; connIx < httpConnNo; connIx++, pOther++)
+    {
+        if(pOther == pHttpCon || pOther->socket == NET_PRES_INVALID_SOCKET)
+        {
+            continue;
+        }
+        if(pOther->readyQueued != 0 || (pOther->connState != TCPIP_HTTP_CONN_STATE_IDLE && pOther->connState <= TCPIP_HTTP_CONN_STATE_SERVE_CHUNKS))
+        {   // a request is waiting or in progress
+            pHttpCon->flags.schedYield = 1;
+            httpSchedStat[pHttpCon->schedClass].yields++;
+            return true;
+        }
+    }
+
+    // alone: a new turn right away
+    pHttpCon->schedDeficit = 0;
+    _HTTP_SchedCredit(pHttpCon);
+    return false;
+}
+#endif  // (_TCPIP_HTTP_NET_SCHED != 0)
+
+#if (_TCPIP_HTTP_NET_ROUTER != 0)
+// URL router: radix trie of the registered patterns
+// the edge labels point inside the persistent pattern strings
+
+// looks up the node where the pattern ends, without changing the trie
+// returns the node index; < 0 if there's no such node
+// and then *pNewNodes is the number of nodes adding the pattern takes
+static int _HTTP_RouteNodeFind(const char* pattern, uint16_t patternLen, int* pNewNodes)
+{
+    uint8_t nodeIx;
+    uint16_t commonLen;
+    TCPIP_HTTP_ROUTE_NODE* pNode;
+    TCPIP_HTTP_ROUTE_NODE* pChild;
+
+    pNode = httpRouteNodes;
+    while(patternLen != 0)
+    {
+        for(nodeIx = pNode->child; nodeIx != 0; nodeIx = httpRouteNodes[nodeIx].sibling)
+        {
+            if(httpRouteNodes[nodeIx].label[0] == *pattern)
+            {
+                break;
+            }
+        }
+
+        if(nodeIx == 0)
+        {   // a new leaf
+            *pNewNodes = 1;
+            return -1;
+        }
+
+        pChild = httpRouteNodes + nodeIx;
+        commonLen = 1;
+        while(commonLen < pChild->labelLen && commonLen < patternLen && pChild->label[commonLen] == pattern[commonLen])
+        {
+            commonLen++;
+        }
+
+        if(commonLen < pChild->labelLen)
+        {   // an edge split, plus a new leaf if the pattern goes on
+            *pNewNodes = commonLen == patternLen ? 1 : 2;
+            return -1;
+        }
+
+        pNode = pChild;
+        pattern += commonLen;
+        patternLen -= commonLen;
+    }
+
+    *pNewNodes = 0;
+    return pNode - httpRouteNodes;
+}
+
+// adds the pattern to the trie, splitting an edge if needed
+// returns the index of the node where the pattern ends; < 0 if no more nodes
+static int _HTTP_RouteNodeAdd(const char* pattern, uint16_t patternLen)
+{
+    uint16_t commonLen;
+    uint8_t* pLink;
+    TCPIP_HTTP_ROUTE_NODE* pNode;
+    TCPIP_HTTP_ROUTE_NODE* pChild;
+    TCPIP_HTTP_ROUTE_NODE* pNew;
+
+    pNode = httpRouteNodes;
+    while(patternLen != 0)
+    {
+        // the children start with different characters
+        for(pLink = &pNode->child; *pLink != 0; pLink = &httpRouteNodes[*pLink].sibling)
+        {
+            if(httpRouteNodes[*pLink].label[0] == *pattern)
+            {
+                break;
+            }
+        }
+
+        if(*pLink == 0)
+        {   // new leaf
+            if(httpRouteNodesNo == sizeof(httpRouteNodes) / sizeof(*httpRouteNodes))
+            {
+                return -1;
+            }
+            pNew = httpRouteNodes + httpRouteNodesNo;
+            memset(pNew, 0, sizeof(*pNew));
+            pNew->label = pattern;
+            pNew->labelLen = patternLen;
+            *pLink = (uint8_t)httpRouteNodesNo++;
+            return *pLink;
+        }
+
+        pChild = httpRouteNodes + *pLink;
+        commonLen = 1;
+        while(commonLen < pChild->labelLen && commonLen < patternLen && pChild->label[commonLen] == pattern[commonLen])
+        {
+            commonLen++;
+        }
+
+        if(commonLen < pChild->labelLen)
+        {   // split the edge: a new node takes the common part
+            if(httpRouteNodesNo == sizeof(httpRouteNodes) / sizeof(*httpRouteNodes))
+            {
+                return -1;
+            }
+            pNew = httpRouteNodes + httpRouteNodesNo;
+            memset(pNew, 0, sizeof(*pNew));
+            pNew->label = pChild->label;
+            pNew->labelLen = commonLen;
+            pNew->child = *pLink;
+            pNew->sibling = pChild->sibling;
+            pChild->sibling = 0;
+            pChild->label += commonLen;
+            pChild->labelLen -= commonLen;
+            *pLink = (uint8_t)httpRouteNodesNo++;
+            pChild = pNew;
+        }
+
+        pNode = pChild;
+        pattern += commonLen;
+        patternLen -= commonLen;
+    }
+
+    return pNode - httpRouteNodes;
+}
+
+// walks the trie for a requested name
+// methodIx: 0 for GET, 1 for POST
+// returns the route index + 1; 0 if no route matches
+static uint8_t _HTTP_RouteFind(const char* name, int methodIx)
+{
+    uint8_t nodeIx;
+    size_t nameLen = strlen(name);
+    TCPIP_HTTP_ROUTE_NODE* pNode = httpRouteNodes;
+    uint8_t routeIx = pNode->prefixRoute[methodIx];
+
+    while(nameLen != 0)
+    {
+        for(nodeIx = pNode->child; nodeIx != 0; nodeIx = httpRouteNodes[nodeIx].sibling)
+        {
+            if(httpRouteNodes[nodeIx].label[0] == *name)
+            {
+                break;
+            }
+        }
+
+        if(nodeIx == 0)
+        {   // the longest prefix, if any
+            return routeIx;
+        }
+
+        pNode = httpRouteNodes + nodeIx;
+        if(pNode->labelLen > nameLen || strncmp(pNode->label, name, pNode->labelLen) != 0)
+        {
+            return routeIx;
+        }
+
+        name += pNode->labelLen;
+        nameLen -= pNode->labelLen;
+        if(pNode->prefixRoute[methodIx] != 0)
+        {
+            routeIx = pNode->prefixRoute[methodIx];
+        }
+    }
+
+    return pNode->exactRoute[methodIx] != 0 ? pNode->exactRoute[methodIx] : routeIx;
+}
+
+// sets the route of a GET/POST request
+static void _HTTP_RouteResolve(TCPIP_HTTP_NET_CONN* pHttpCon, const char* name)
+{
+    if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_GET || pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_POST)
+    {
+        pHttpCon->routeIx = _HTTP_RouteFind(name, pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_GET ? 0 : 1);
+    }
+}
+
+// removes all the routes
+static void _HTTP_RoutesRemove(void)
+{
+    memset(httpRoutes, 0, sizeof(httpRoutes));
+    memset(httpRouteNodes, 0, sizeof(httpRouteNodes));
+    httpRouteNodesNo = 1;
+}
+#endif  // (_TCPIP_HTTP_NET_ROUTER != 0)
+
+#if (_TCPIP_HTTP_NET_PIPELINE != 0)
+// skips the part of the request body that was not read,
+// so that a pipelined request is parsed from its start
+// the bytes not received yet are skipped in the idle state, when they arrive
+// returns the number of bytes still to be skipped
+static uint32_t _HTTP_BodySkip(TCPIP_HTTP_NET_CONN* pHttpCon, uint32_t skipLen)
+{
+    uint16_t avlblBytes = NET_PRES_SocketReadIsReady(pHttpCon->socket);
+
+    pHttpCon->bodySkip += skipLen;
+    if(pHttpCon->bodySkip < avlblBytes)
+    {
+        avlblBytes = (uint16_t)pHttpCon->bodySkip;
+    }
+    pHttpCon->bodySkip -= _HTTP_ConnectionDiscard(pHttpCon, avlblBytes);
+
+    return pHttpCon->bodySkip;
+}
+#endif  // (_TCPIP_HTTP_NET_PIPELINE != 0)
+
+// periodic processing:
+// the connections are normally run when signaled by their sockets
+// the timer checks for the persistent connections timeout
+// and retries the connections that wait for internal resources (chunks, file buffers, dynamic variable retries, etc.),
+// which have no socket signal to run them
 static void TCPIP_HTTP_NET_Process(void)
 {
     TCPIP_HTTP_NET_CONN* pHttpCon;
     int conn;
 
+#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+    // free the buffers of an aborted upload
+    _HTTP_UploadPurge();
+#endif  // defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+
     pHttpCon = httpConnCtrl + 0;
     for(conn = 0; conn < httpConnNo; conn++, pHttpCon++)
     {
@@ -1189,24 +2035,15 @@ static void TCPIP_HTTP_NET_Process(void)
             continue;
         }
 
-        // If a socket is reset at any time 
-        // forget about it and return to idle state.
-        if(NET_PRES_SocketWasReset(pHttpCon->socket) || NET_PRES_SocketWasDisconnected(pHttpCon->socket))
-        {
-            if(pHttpCon->flags.sktLocalReset != 0)
-            {   // http initiated the disconnect; no error
-                pHttpCon->flags.sktLocalReset = 0;
-            }
-            else
-            {   // some disconnect initiated by the remote party
-                pHttpCon->flags.discardRxBuff = 1;
-                pHttpCon->connState = TCPIP_HTTP_CONN_STATE_ERROR;
-                pHttpCon->closeEvent = TCPIP_HTTP_NET_EVENT_CLOSE_REMOTE;
-            }
+        if(pHttpCon->connState == TCPIP_HTTP_CONN_STATE_EVENT_STREAM || pHttpCon->connState == TCPIP_HTTP_CONN_STATE_WEBSOCKET)
+        {   // parked: run by its socket signals only
+            continue;
         }
 
+        _HTTP_ConnCheckReset(pHttpCon);
+
         // Determine if this connection is eligible for processing
-        if(pHttpCon->connState != TCPIP_HTTP_CONN_STATE_IDLE || NET_PRES_SocketReadIsReady(pHttpCon->socket))
+        if(pHttpCon->connState != TCPIP_HTTP_CONN_STATE_IDLE)
         {
             TCPIP_HTTP_NET_ProcessConnection(pHttpCon);
         }
@@ -1232,6 +2069,13 @@ static void TCPIP_HTTP_NET_ProcessConnection(TCPIP_HTTP_NET_CONN* pHttpCon)
 
     // mark connection as active
     pHttpCon->connActiveSec = (uint16_t)_TCPIP_SecCountGet();
+#if (_TCPIP_HTTP_NET_SCHED != 0)
+    // a new turn
+    _HTTP_SchedCredit(pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_SCHED != 0)
+#if (_TCPIP_HTTP_NET_PIPELINE != 0)
+    pHttpCon->pipeCount = 0;
+#endif  // (_TCPIP_HTTP_NET_PIPELINE != 0)
 
     do
     {
@@ -1246,7 +2090,7 @@ static void TCPIP_HTTP_NET_ProcessConnection(TCPIP_HTTP_NET_CONN* pHttpCon)
 
 /*****************************************************************************
   Function:
-    static bool _HTTP_HeaderParseLookup(TCPIP_HTTP_NET_CONN* pHttpCon, int reqIx)
+    static bool _HTTP_HeaderParseLookup(TCPIP_HTTP_NET_CONN* pHttpCon, int reqIx, char* value)
 
   Description:
     Calls the appropriate header parser based on the index of the header
@@ -1256,44 +2100,96 @@ static void TCPIP_HTTP_NET_ProcessConnection(TCPIP_HTTP_NET_CONN* pHttpCon)
     None
 
   Parameters:
-    i - the index of a HTTP request (entry into the HTTPRequestHeaders table)
+    pHttpCon - connection pointer
+    reqIx - the index of a HTTP request (entry into the HTTPRequestHeaders table)
+    value - the header value, leading spaces removed
 
   Return Values:
     true if parsing succeeded
     false if some error
   ***************************************************************************/
-static bool _HTTP_HeaderParseLookup(TCPIP_HTTP_NET_CONN* pHttpCon, int reqIx)
+static bool _HTTP_HeaderParseLookup(TCPIP_HTTP_NET_CONN* pHttpCon, int reqIx, char* value)
 {
     // reqIx corresponds to an index in HTTPRequestHeaders
 
 #if defined(TCPIP_HTTP_NET_USE_COOKIES)
     if(reqIx == 0u)
     {
-        return _HTTP_HeaderParseCookie(pHttpCon);
+        return _HTTP_HeaderParseCookie(pHttpCon, value);
     }
 #endif
 
 #if defined(TCPIP_HTTP_NET_USE_AUTHENTICATION)    
     if(reqIx == 1u)
     {
-        return _HTTP_HeaderParseAuthorization(pHttpCon);
+        return _HTTP_HeaderParseAuthorization(pHttpCon, value);
     }
 #endif
 
 #if defined(TCPIP_HTTP_NET_USE_POST)
     if(reqIx == 2u)
     {
-        return _HTTP_HeaderParseContentLength(pHttpCon);
+        return _HTTP_HeaderParseContentLength(pHttpCon, value);
+    }
+#endif
+
+#if defined(TCPIP_HTTP_NET_USE_CONDITIONAL_GET)
+    if(reqIx == 3u)
+    {
+        return _HTTP_HeaderParseIfNoneMatch(pHttpCon, value);
+    }
+
+    if(reqIx == 4u)
+    {
+        return _HTTP_HeaderParseIfModifiedSince(pHttpCon, value);
+    }
+#endif
+
+#if defined(TCPIP_HTTP_NET_USE_RANGES)
+    if(reqIx == 5u)
+    {
+        return _HTTP_HeaderParseRange(pHttpCon, value);
+    }
+
+    if(reqIx == 6u)
+    {
+        return _HTTP_HeaderParseIfRange(pHttpCon, value);
     }
 #endif
 
+#if (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+    if(reqIx == 7u)
+    {
+        return _HTTP_HeaderParseContentType(pHttpCon, value);
+    }
+#endif  // (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+    if(reqIx == 8u)
+    {
+        return _HTTP_HeaderParseUpgrade(pHttpCon, value);
+    }
+
+    if(reqIx == 9u)
+    {
+        return _HTTP_HeaderParseWsKey(pHttpCon, value);
+    }
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+
+#if (_TCPIP_HTTP_NET_DEFLATE != 0)
+    if(reqIx == 10u)
+    {
+        return _HTTP_HeaderParseAcceptEncoding(pHttpCon, value);
+    }
+#endif  // (_TCPIP_HTTP_NET_DEFLATE != 0)
+
     return true;
 
 }
 
 /*****************************************************************************
   Function:
-    static bool _HTTP_HeaderParseAuthorization(TCPIP_HTTP_NET_CONN* pHttpCon)
+    static bool _HTTP_HeaderParseAuthorization(TCPIP_HTTP_NET_CONN* pHttpCon, char* value)
 
   Summary:
     Parses the "Authorization:" header for a request and verifies the
@@ -1312,7 +2208,8 @@ static bool _HTTP_HeaderParseLookup(TCPIP_HTTP_NET_CONN* pHttpCon, int reqIx)
     None
 
   Parameters:
-    connection pointer
+    pHttpCon - connection pointer
+    value - the header value, leading spaces removed
 
   Returns:
     true if parsing succeeded
@@ -1320,15 +2217,13 @@ static bool _HTTP_HeaderParseLookup(TCPIP_HTTP_NET_CONN* pHttpCon, int reqIx)
 
   Remarks:
     This function is ony available when TCPIP_HTTP_NET_USE_AUTHENTICATION is defined.
+    With the authentication sessions enabled, the credentials are saved and
+    checked at the end of the headers, only if no session authorized the request.
   ***************************************************************************/
 #if defined(TCPIP_HTTP_NET_USE_AUTHENTICATION)
-static bool _HTTP_HeaderParseAuthorization(TCPIP_HTTP_NET_CONN* pHttpCon)
+static bool _HTTP_HeaderParseAuthorization(TCPIP_HTTP_NET_CONN* pHttpCon, char* value)
 {
-    uint16_t len, nDec;
-    uint8_t inBuff[40];
-    char   outBuff[40 + 2];
-    char* passStr; 
-    char* queryStr;
+    uint16_t len;
 
     // If auth processing is not required, return
     if(pHttpCon->isAuthorized & 0x80)
@@ -1336,18 +2231,42 @@ static bool _HTTP_HeaderParseAuthorization(TCPIP_HTTP_NET_CONN* pHttpCon)
         return true;
     }
 
-    // Clear the auth type ("BASIC ")
-    _HTTP_ConnectionDiscard(pHttpCon, 6);
+    // Skip the auth type ("BASIC ")
+    len = strlen(value);
+    if(len < 6)
+    {
+        value += len;
+    }
+    else
+    {
+        value += 6;
+    }
 
-    // Find the terminating CRLF, make sure it's a multiple of four and limit the size
-    len = (uint16_t)_HTTP_ConnectionStringFind(pHttpCon, TCPIP_HTTP_NET_CRLF, 0, 0);
-    len += 3;
-    len &= 0xfc;
-    len = mMIN(len, sizeof(inBuff)-4);
+#if (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+    // a session cookie may follow: the credentials are checked at the end of the headers
+    strncpy(pHttpCon->authCred, value, TCPIP_HTTP_AUTH_CRED_LEN);
+    pHttpCon->authCred[TCPIP_HTTP_AUTH_CRED_LEN] = 0;
+#else
+    _HTTP_AuthCredentialsCheck(pHttpCon, value);
+#endif  // (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
 
+    return true;
+}
+
+// decodes the Basic credentials and verifies them with the userAuthenticate callback
+// the result is saved in pHttpCon->isAuthorized
+static void _HTTP_AuthCredentialsCheck(TCPIP_HTTP_NET_CONN* pHttpCon, const char* value)
+{
+    uint16_t len, nDec;
+    char   outBuff[40 + 2];
+    char* passStr; 
+    char* queryStr;
 
-    NET_PRES_SocketRead(pHttpCon->socket, inBuff, len);
-    nDec = TCPIP_Helper_Base64Decode(inBuff, len, (uint8_t*)outBuff, sizeof(outBuff) - 2);
+    // Limit the size and make sure it's a multiple of four
+    len = strlen(value);
+    len = mMIN(len, sizeof(outBuff) - 6) & 0xfffc;
+
+    nDec = TCPIP_Helper_Base64Decode((uint8_t*)value, len, (uint8_t*)outBuff, sizeof(outBuff) - 2);
     outBuff[nDec] = 0;
     queryStr = strstr(outBuff, ":");
     if(queryStr)
@@ -1361,6 +2280,11 @@ static bool _HTTP_HeaderParseAuthorization(TCPIP_HTTP_NET_CONN* pHttpCon)
         *passStr = 0;
     }
 
+#if (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+    // the session opened with these credentials is valid for this protected area only
+    pHttpCon->authContext = pHttpCon->isAuthorized;
+#endif  // (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+
     // Verify credentials
     if(httpUserCback && httpUserCback->userAuthenticate)
     {
@@ -1371,13 +2295,150 @@ static bool _HTTP_HeaderParseAuthorization(TCPIP_HTTP_NET_CONN* pHttpCon)
         pHttpCon->isAuthorized = 0;
     }
 
-    return true;
+#if (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+    pHttpCon->flags.sessionNew = (pHttpCon->isAuthorized & 0x80) != 0;
+#endif  // (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+}
+
+#if (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+// checks the session cookie in a "Cookie:" header value
+// a valid session for the same protected area authorizes the request:
+// the Authorization header is no longer decoded
+static void _HTTP_SessionCheck(TCPIP_HTTP_NET_CONN* pHttpCon, const char* value)
+{
+    int ix;
+    uint32_t token[TCPIP_HTTP_SESSION_TOKEN_WORDS];
+    TCPIP_HTTP_SESSION_ENTRY* pEntry;
+
+    if((pHttpCon->isAuthorized & 0x80) != 0)
+    {   // no authentication needed or already authorized by a session
+        return;
+    }
+
+    // find the session cookie: "...; HTTPSESSION=0123abcd..."
+    while(*value != 0)
+    {
+        value += strspn(value, " ");
+        if(strncmp(value, TCPIP_HTTP_SESSION_COOKIE "=", sizeof(TCPIP_HTTP_SESSION_COOKIE)) == 0)
+        {
+            value += sizeof(TCPIP_HTTP_SESSION_COOKIE);
+            break;
+        }
+        value += strcspn(value, ";");
+        if(*value == ';')
+        {
+            value++;
+        }
+    }
+
+    if(strcspn(value, "; ") != TCPIP_HTTP_SESSION_TOKEN_LEN)
+    {   // not found or not a token
+        return;
+    }
+
+    memset(token, 0, sizeof(token));
+    for(ix = 0; ix < TCPIP_HTTP_SESSION_TOKEN_LEN; ix += 2)
+    {
+        if(!isxdigit((uint8_t)value[ix]) || !isxdigit((uint8_t)value[ix + 1]))
+        {
+            return;
+        }
+        token[ix / 8] = (token[ix / 8] << 8) | hexatob(((uint16_t)value[ix] << 8) | (uint8_t)value[ix + 1]);
+    }
+
+    if((pEntry = _HTTP_SessionFind(token)) == 0 || pEntry->authContext != pHttpCon->isAuthorized)
+    {   // unknown, expired or opened for another protected area; the credentials are checked
+        return;
+    }
+
+    // sliding expiration
+    pEntry->expireSec = _TCPIP_SecCountGet() + TCPIP_HTTP_NET_AUTH_SESSION_TIMEOUT;
+    pHttpCon->isAuthorized = pEntry->isAuthorized;
+    pHttpCon->sessionEntry = pEntry;
+    httpSessionHits++;
+}
+
+// finds a valid session
+// returns the session entry or 0 if not found or expired
+static TCPIP_HTTP_SESSION_ENTRY* _HTTP_SessionFind(const uint32_t* token)
+{
+    int ix, sessIx;
+    TCPIP_HTTP_SESSION_ENTRY* pEntry;
+    uint32_t currSec = _TCPIP_SecCountGet();
+
+    // the token is random: the first word is the hash
+    sessIx = token[0] % TCPIP_HTTP_NET_AUTH_SESSIONS;
+    for(ix = 0; ix < TCPIP_HTTP_NET_AUTH_SESSIONS; ix++)
+    {
+        pEntry = httpSessions + sessIx;
+        if(memcmp(pEntry->token, token, sizeof(pEntry->token)) == 0)
+        {
+            return (int32_t)(pEntry->expireSec - currSec) > 0 ? pEntry : 0;
+        }
+        if(++sessIx == TCPIP_HTTP_NET_AUTH_SESSIONS)
+        {
+            sessIx = 0;
+        }
+    }
+
+    return 0;
+}
+
+// opens a new session for a connection that was authorized with credentials
+// the session replaces an expired one or the one that expires first
+// prints the "Set-Cookie:" header carrying the token in the buffer
+// returns the number of characters printed
+static int _HTTP_SessionIssue(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer)
+{
+    int ix, sessIx;
+    uint32_t token[TCPIP_HTTP_SESSION_TOKEN_WORDS];
+    TCPIP_HTTP_SESSION_ENTRY *pEntry, *pSession;
+    uint32_t currSec = _TCPIP_SecCountGet();
+
+    for(ix = 0; ix < TCPIP_HTTP_SESSION_TOKEN_WORDS; ix++)
+    {
+        if((token[ix] = SYS_RANDOM_CryptoGet()) == 0)
+        {   // no token without a good random source
+            return 0;
+        }
+    }
+
+    pSession = 0;
+    sessIx = token[0] % TCPIP_HTTP_NET_AUTH_SESSIONS;
+    for(ix = 0; ix < TCPIP_HTTP_NET_AUTH_SESSIONS; ix++)
+    {
+        pEntry = httpSessions + sessIx;
+        if((int32_t)(pEntry->expireSec - currSec) <= 0)
+        {   // free or expired
+            pSession = pEntry;
+            break;
+        }
+        if(pSession == 0 || (int32_t)(pEntry->expireSec - pSession->expireSec) < 0)
+        {
+            pSession = pEntry;
+        }
+        if(++sessIx == TCPIP_HTTP_NET_AUTH_SESSIONS)
+        {
+            sessIx = 0;
+        }
+    }
+
+    memcpy(pSession->token, token, sizeof(token));
+    pSession->expireSec = currSec + TCPIP_HTTP_NET_AUTH_SESSION_TIMEOUT;
+    pSession->isAuthorized = pHttpCon->isAuthorized;
+    pSession->authContext = pHttpCon->authContext;
+    pHttpCon->sessionEntry = pSession;
+    httpSessionsIssued++;
+
+    return sprintf(buffer, "Set-Cookie: " TCPIP_HTTP_SESSION_COOKIE "=%08lx%08lx%08lx%08lx; Path=/; HttpOnly\r\n",
+            (unsigned long)token[0], (unsigned long)token[1], (unsigned long)token[2], (unsigned long)token[3]);
 }
+#endif  // (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
 #endif
 
 /*****************************************************************************
   Function:
-    static bool _HTTP_HeaderParseCookie(TCPIP_HTTP_NET_CONN* pHttpCon)
+    static bool _HTTP_HeaderParseCookie(TCPIP_HTTP_NET_CONN* pHttpCon, char* value)
 
   Summary:
     Parses the "Cookie:" headers for a request and stores them as GET
@@ -1396,7 +2457,8 @@ static bool _HTTP_HeaderParseAuthorization(TCPIP_HTTP_NET_CONN* pHttpCon)
     None
 
   Parameters:
-    connection pointer
+    pHttpCon - connection pointer
+    value - the header value, leading spaces removed
 
   Returns:
     true if parsing succeeded
@@ -1406,42 +2468,41 @@ static bool _HTTP_HeaderParseAuthorization(TCPIP_HTTP_NET_CONN* pHttpCon)
     This function is ony available when TCPIP_HTTP_NET_USE_COOKIES is defined.
   ***************************************************************************/
 #if defined(TCPIP_HTTP_NET_USE_COOKIES)
-static bool _HTTP_HeaderParseCookie(TCPIP_HTTP_NET_CONN* pHttpCon)
+static bool _HTTP_HeaderParseCookie(TCPIP_HTTP_NET_CONN* pHttpCon, char* value)
 {
-    uint16_t lenA, lenB;
+    uint16_t lenA;
+
+#if (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+    _HTTP_SessionCheck(pHttpCon, value);
+#endif  // (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
 
     // Verify there's enough space
-    lenB = (uint16_t)_HTTP_ConnectionStringFind(pHttpCon, TCPIP_HTTP_NET_CRLF, 0, 0);
-    if(lenB >= (uint16_t)(pHttpCon->httpData + httpConnDataSize - pHttpCon->ptrData - 2))
+    if(strlen(value) >= (uint16_t)(pHttpCon->httpData + httpConnDataSize - pHttpCon->ptrData - 2))
     {   // If not, overflow
         pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_OVERFLOW;
         return false;
     }
 
-    // While a CRLF is not immediate, grab a cookie value
-    while(lenB != 0u)
+    // While not at the end of line, grab a cookie value
+    while(*value != 0)
     {
-        // Look for a ';' and use the shorter of that or a CRLF
-        lenA = _HTTP_ConnectionCharFind(pHttpCon, ';', 0, 0);
+        // Look for a ';' or the end of line
+        lenA = strcspn(value, ";");
 
-        // Read to the terminator
-        pHttpCon->ptrData += NET_PRES_SocketRead(pHttpCon->socket, pHttpCon->ptrData, mMIN(lenA, lenB));
+        // Copy to the terminator
+        memcpy(pHttpCon->ptrData, value, lenA);
+        pHttpCon->ptrData += lenA;
+        value += lenA;
 
         // Insert an & to anticipate another cookie
         *(pHttpCon->ptrData++) = '&';
 
         // If semicolon, trash it and whitespace
-        if(lenA < lenB)
+        if(*value == ';')
         {
-            _HTTP_ConnectionDiscard(pHttpCon, 1);
-            while(_HTTP_ConnectionCharFind(pHttpCon, ' ', 0, 0) == 0u)
-            {
-                _HTTP_ConnectionDiscard(pHttpCon, 1);
-            }
+            value++;
+            value += strspn(value, " ");
         }
-
-        // Find the new distance to the CRLF
-        lenB = (uint16_t)_HTTP_ConnectionStringFind(pHttpCon, TCPIP_HTTP_NET_CRLF, 0, 0);
     }
 
     return true;
@@ -1451,7 +2512,7 @@ static bool _HTTP_HeaderParseCookie(TCPIP_HTTP_NET_CONN* pHttpCon)
 
 /*****************************************************************************
   Function:
-    static bool _HTTP_HeaderParseContentLength(TCPIP_HTTP_NET_CONN* pHttpCon)
+    static bool _HTTP_HeaderParseContentLength(TCPIP_HTTP_NET_CONN* pHttpCon, char* value)
 
   Summary:
     Parses the "Content-Length:" header for a request.
@@ -1465,7 +2526,8 @@ static bool _HTTP_HeaderParseCookie(TCPIP_HTTP_NET_CONN* pHttpCon)
     None
 
   Parameters:
-    connection pointer
+    pHttpCon - connection pointer
+    value - the header value, leading spaces removed
 
   Returns:
     true if parsing succeeded
@@ -1475,1853 +2537,5769 @@ static bool _HTTP_HeaderParseCookie(TCPIP_HTTP_NET_CONN* pHttpCon)
     This function is ony available when TCPIP_HTTP_NET_USE_POST is defined.
   ***************************************************************************/
 #if defined(TCPIP_HTTP_NET_USE_POST)
-static bool _HTTP_HeaderParseContentLength(TCPIP_HTTP_NET_CONN* pHttpCon)
+static bool _HTTP_HeaderParseContentLength(TCPIP_HTTP_NET_CONN* pHttpCon, char* value)
 {
-    uint16_t len;
-    uint8_t buf[10];
-
-    // Read up to the CRLF (max 9 bytes)
-    len = (uint16_t)_HTTP_ConnectionStringFind(pHttpCon, TCPIP_HTTP_NET_CRLF, 0, 0);
-    if(len >= sizeof(buf))
+    // max 9 digits
+    if(strlen(value) >= 10)
     {
         pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_BAD_REQUEST;
         pHttpCon->byteCount = 0;
+        pHttpCon->flags.pipeBreak = 1;
         return false;
     }   
-    len = NET_PRES_SocketRead(pHttpCon->socket, buf, len);
-    buf[len] = '\0';
 
-    pHttpCon->byteCount = atol((char*)buf);
+    pHttpCon->byteCount = atol(value);
 
     return true;
 }
 #endif
 
-// process HTTP idle state: TCPIP_HTTP_CONN_STATE_IDLE
-// returns the next connection state
-// also signals if waiting for resources
-static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessIdle(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+// parses the "Content-Type:" header of a request
+// selects the form data format for TCPIP_HTTP_NET_ConnectionFormParse
+// multipart/form-data needs a valid boundary parameter: the form parser state is allocated
+// with the delimiter; a request without one is rejected
+#if (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+static bool _HTTP_HeaderParseContentType(TCPIP_HTTP_NET_CONN* pHttpCon, char* value)
 {
-    uint16_t lenA;
-
-    // Check how much data is waiting
-    lenA = NET_PRES_SocketReadIsReady(pHttpCon->socket);
-    if(lenA == 0)
-    {   // no data; wait some more
-        *pWait = true;
-        return TCPIP_HTTP_CONN_STATE_IDLE;
-    }
+    char* pParams = strchr(value, ';');
+    char* pParamEnd;
+    char paramEnd;
+    bool isBoundary;
+    const char* pBoundary = 0;
+    size_t boundLen = 0;
+    TCPIP_HTTP_FORM_DCPT* pForm;
 
-    // process the request
-    // Clear out state info and move to next state
-    pHttpCon->ptrData = pHttpCon->httpData;
-    pHttpCon->isAuthorized = 0xff;
-    pHttpCon->hasArgs = 0;
-    pHttpCon->httpTick = SYS_TMR_TickCountGet() + TCPIP_HTTP_NET_TIMEOUT * SYS_TMR_TickCounterFrequencyGet();
-    pHttpCon->callbackPos = 0xffffffff;
-    pHttpCon->byteCount = 0;
-    pHttpCon->smPost = 0x00;
-    pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_GET; // show no error condition
-    pHttpCon->closeEvent = 0;
-    if(pHttpCon->flags.sktIsConnected == 0)
-    {   // report it once
-        _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_OPEN, 0);
+    if(pParams != 0)
+    {
+        *pParams++ = 0;
     }
-    pHttpCon->flags.val = 0;
-    pHttpCon->flags.sktIsConnected = 1;
-
-    return TCPIP_HTTP_CONN_STATE_IDLE + 1;
-
-}
-
-// parse HTTP request state: TCPIP_HTTP_CONN_STATE_PARSE_REQUEST
-// returns the next connection state
-// also signals if waiting for resources
-// Retrieves the file name in pHttpCon->httpData!
-static TCPIP_HTTP_NET_CONN_STATE _HTTP_ParseRequest(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
-{
-    uint16_t lenA, lenB;
+    value[strcspn(value, " ")] = 0;
 
-    // check that there is some registered HTTP app
-    if(httpUserCback == 0)
+    _HTTP_FormRelease(pHttpCon);
+    pHttpCon->flags.formMultipart = 0;
+    if(stricmp(value, "multipart/form-data") != 0)
     {
-        pHttpCon->flags.discardRxBuff = 1;
-        return TCPIP_HTTP_CONN_STATE_ERROR;
+        return true;
     }
 
-    // Verify the entire first line is in the FIFO
-    if((lenB = _HTTP_ConnectionCharFind(pHttpCon, TCPIP_HTTP_NET_LINE_END, 0, 0)) == 0xffff)
-    {   // First line isn't here yet
-        if(_HTTP_SktFifoRxFree(pHttpCon->socket) == 0)
-        {   // If the FIFO is full, we overflowed
-            pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_OVERFLOW;
-            pHttpCon->flags.discardRxBuff = 1;
-            pHttpCon->flags.requestError = 1;
-            return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
+    // look for the boundary parameter: quoted or token
+    while(pParams != 0 && pBoundary == 0)
+    {
+        pParams += strspn(pParams, " ");
+        pParamEnd = pParams + strcspn(pParams, "=; ");
+        paramEnd = *pParamEnd;
+        *pParamEnd = 0;
+        isBoundary = paramEnd == '=' && stricmp(pParams, "boundary") == 0;
+        *pParamEnd = paramEnd;
+        if(isBoundary)
+        {
+            pParams = pParamEnd + 1;
+            if(*pParams == '"')
+            {
+                pBoundary = ++pParams;
+                boundLen = strcspn(pBoundary, "\"");
+                if(pBoundary[boundLen] != '"')
+                {   // unterminated
+                    boundLen = 0;
+                }
+            }
+            else
+            {
+                pBoundary = pParams;
+                boundLen = strcspn(pBoundary, "; ");
+            }
         }
-
-        if((int32_t)(SYS_TMR_TickCountGet() - pHttpCon->httpTick) > 0)
-        {   // A timeout has occurred
-            pHttpCon->flags.discardRxBuff = 1;
-            pHttpCon->closeEvent = TCPIP_HTTP_NET_EVENT_CLOSE_TIMEOUT;
-            return TCPIP_HTTP_CONN_STATE_ERROR;
+        else if((pParams = strchr(pParams, ';')) != 0)
+        {
+            pParams++;
         }
-        // wait some more
-        *pWait = true;
-        return TCPIP_HTTP_CONN_STATE_PARSE_REQUEST;
     }
 
-    // Reset the watchdog timer
-    pHttpCon->httpTick = SYS_TMR_TickCountGet() + TCPIP_HTTP_NET_TIMEOUT * SYS_TMR_TickCounterFrequencyGet();
-
-    // Determine the request method
-    lenA = _HTTP_ConnectionCharFind(pHttpCon, ' ', 0, 0);
-    if(lenA > 5u)
-    {
-        lenA = 5;
+    if(boundLen == 0 || boundLen > TCPIP_HTTP_FORM_BOUNDARY_MAX_LEN)
+    {   // no valid boundary: the parts cannot be delimited
+        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_BAD_REQUEST;
+        pHttpCon->flags.pipeBreak = 1;
+        return false;
     }
-    NET_PRES_SocketRead(pHttpCon->socket, pHttpCon->httpData, lenA + 1);
 
-    if ( memcmp(pHttpCon->httpData, (const void*)"GET", 3) == 0)
+    if((pForm = _HTTP_FormAlloc(pHttpCon, TCPIP_HTTP_FORM_STATE_PREAMBLE)) == 0)
     {
-        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_GET;
+        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_INTERNAL_SERVER_ERROR;
+        pHttpCon->flags.pipeBreak = 1;
+        return false;
     }
-#if defined(TCPIP_HTTP_NET_USE_POST)
-    else if ( memcmp(pHttpCon->httpData, (const void*)"POST", 4) == 0)
+
+    strcpy(pForm->delim, "\r\n--");
+    strncat(pForm->delim, pBoundary, boundLen);
+    pForm->delimLen = boundLen + 4;
+    pHttpCon->flags.formMultipart = 1;
+    return true;
+}
+#endif  // (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+// parses the "Upgrade:" header of a request
+// only a request for a WebSocket endpoint is upgraded
+static bool _HTTP_HeaderParseUpgrade(TCPIP_HTTP_NET_CONN* pHttpCon, char* value)
+{
+    if(pHttpCon->wsDcpt != 0)
     {
-        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_POST;
-    }
-#endif
-    else
-    {   // Unrecognized method, so return not implemented
-        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_NOT_IMPLEMENTED;
-        pHttpCon->flags.requestError = 1;
-        return TCPIP_HTTP_CONN_STATE_PARSE_HEADERS;
+        value[strcspn(value, " ,")] = 0;
+        pHttpCon->wsDcpt->upgrade = stricmp(value, "websocket") == 0 ? 1 : 0;
     }
+    return true;
+}
+
+// parses the "Sec-WebSocket-Key:" header of a request
+// calculates the Sec-WebSocket-Accept value: base64(SHA-1(key + GUID))
+static bool _HTTP_HeaderParseWsKey(TCPIP_HTTP_NET_CONN* pHttpCon, char* value)
+{
+    uint8_t keyBuff[TCPIP_HTTP_WS_KEY_LEN + sizeof(TCPIP_HTTP_WS_GUID) - 1];
+    uint8_t digest[TCPIP_HTTP_WS_SHA1_LEN];
+    uint16_t acceptLen;
 
-    // Find end of filename
-    lenA = _HTTP_ConnectionCharFind(pHttpCon, ' ', 0, 0);
-    lenB = _HTTP_ConnectionCharFind(pHttpCon, '?', 0, lenA);
-    lenA = mMIN(lenA, lenB);
+    if(pHttpCon->wsDcpt == 0)
+    {   // not a WebSocket endpoint; ignore
+        return true;
+    }
 
-    // If the file name is too long, then reject the request
-    if(lenA > httpConnDataSize - TCPIP_HTTP_NET_DEFAULT_LEN - 1)
+    value[strcspn(value, " ")] = 0;
+    if(strlen(value) != TCPIP_HTTP_WS_KEY_LEN)
     {
-        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_OVERFLOW;
-        pHttpCon->flags.requestError = 1;
-        return TCPIP_HTTP_CONN_STATE_PARSE_HEADERS;
+        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_BAD_REQUEST;
+        return false;
     }
 
-    // Read in the filename and decode
-    lenB = NET_PRES_SocketRead(pHttpCon->socket, pHttpCon->httpData, lenA);
-    pHttpCon->httpData[lenB] = '\0';
-    TCPIP_HTTP_NET_URLDecode(pHttpCon->httpData);
+    memcpy(keyBuff, value, TCPIP_HTTP_WS_KEY_LEN);
+    memcpy(keyBuff + TCPIP_HTTP_WS_KEY_LEN, TCPIP_HTTP_WS_GUID, sizeof(TCPIP_HTTP_WS_GUID) - 1);
+    _HTTP_Sha1(keyBuff, sizeof(keyBuff), digest);
 
-    return TCPIP_HTTP_CONN_STATE_PARSE_REQUEST + 1; // advance 
+    acceptLen = TCPIP_Helper_Base64Encode(digest, sizeof(digest), (uint8_t*)pHttpCon->wsDcpt->acceptKey, TCPIP_HTTP_WS_ACCEPT_LEN);
+    pHttpCon->wsDcpt->acceptKey[acceptLen] = 0;
+    return true;
 }
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
 
-// parse HTTP file upload state: TCPIP_HTTP_CONN_STATE_PARSE_FILE_UPLOAD
-// returns the next connection state
-// also signals if waiting for resources
-// Uses the file name in pHttpCon->httpData!
-static TCPIP_HTTP_NET_CONN_STATE _HTTP_ParseFileUpload(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+#if (_TCPIP_HTTP_NET_DEFLATE != 0)
+// parses the "Accept-Encoding:" header of a request
+// the deflate coding is used if listed without a 0 quality value
+static bool _HTTP_HeaderParseAcceptEncoding(TCPIP_HTTP_NET_CONN* pHttpCon, char* value)
 {
-    // Check if this is an FS Upload
-#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
-    if(memcmp(&pHttpCon->httpData[1], TCPIP_HTTP_NET_FILE_UPLOAD_NAME, sizeof(TCPIP_HTTP_NET_FILE_UPLOAD_NAME)) == 0)
-    {   // Read remainder of line, and bypass all file opening, etc.
-        if(strlen((char*)pHttpCon->httpData + 1) > sizeof(pHttpCon->fileName))
-        {
-            _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_NAME_SIZE_ERROR, pHttpCon->httpData + 1);
-        }
-        strncpy(pHttpCon->fileName, (char*)pHttpCon->httpData + 1, sizeof(pHttpCon->fileName) - 1);
-        pHttpCon->fileName[sizeof(pHttpCon->fileName) -  1] = 0;
+    char *coding, *qValue;
+    char sep;
+    size_t codingLen;
 
-#if defined(TCPIP_HTTP_NET_USE_AUTHENTICATION)
-        if(httpUserCback && httpUserCback->fileAuthenticate)
-        {
-            pHttpCon->isAuthorized = (*httpUserCback->fileAuthenticate)(pHttpCon, pHttpCon->fileName, httpUserCback);
-        }
-        else
+    while(true)
+    {
+        codingLen = strcspn(value, ",");
+        sep = value[codingLen];
+        value[codingLen] = 0;
+
+        coding = value + strspn(value, " ");
+        qValue = strchr(coding, ';');
+        if(qValue != 0)
         {
-            pHttpCon->isAuthorized = 0;
+            *qValue++ = 0;
+            qValue += strspn(qValue, " ");
         }
-#endif
-        if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_GET)
-        {
-            pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_FORM;
+        coding[strcspn(coding, " ")] = 0;
+
+        if(stricmp(coding, "deflate") == 0)
+        {   // "q=0", "q=0.0", etc. means not acceptable
+            pHttpCon->flags.acceptDeflate = 1;
+            if(qValue != 0 && strncmp(qValue, "q=", 2) == 0)
+            {
+                qValue += 2;
+                qValue += strspn(qValue, "0.");
+                if(*qValue == 0 || *qValue == ' ')
+                {
+                    pHttpCon->flags.acceptDeflate = 0;
+                }
+            }
         }
-        else
+
+        if(sep == 0)
         {
-            pHttpCon->flags.uploadPhase = 0;
-            pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_STARTED;
+            break;
         }
-
-        return TCPIP_HTTP_CONN_STATE_PARSE_HEADERS;
+        value += codingLen + 1;
     }
-#endif
-    return TCPIP_HTTP_CONN_STATE_PARSE_FILE_UPLOAD + 1;
+
+    return true;
 }
+#endif  // (_TCPIP_HTTP_NET_DEFLATE != 0)
 
-// parse HTTP file open state: TCPIP_HTTP_CONN_STATE_PARSE_FILE_OPEN
-// returns the next connection state
-// also signals if waiting for resources
-// Uses the file name in pHttpCon->httpData!
-static TCPIP_HTTP_NET_CONN_STATE _HTTP_ParseFileOpen(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
-{
-    int ix;
-    char *ext;
-    uint16_t lenB;
+/*****************************************************************************
+  Function:
+    static bool _HTTP_HeaderParseIfNoneMatch(TCPIP_HTTP_NET_CONN* pHttpCon, char* value)
 
-    // Decode may have changed the string length - update it here
-    lenB = strlen((char*)pHttpCon->httpData);
+  Summary:
+    Parses the "If-None-Match:" header for a request.
 
-    // If the last character is a not a directory delimiter, then try to open the file
-    // String starts at 2nd character, because the first is always a '/'
-    if(pHttpCon->httpData[lenB-1] != '/')
-    {
-        pHttpCon->file = (*httpFileShell->fileOpen)(httpFileShell, (char *)&pHttpCon->httpData[1], SYS_FS_FILE_OPEN_READ);
-    }
+  Description:
+    Checks if the entity tag of the requested file is in the list of
+    entity tags the client has cached, or if the whole value is "*".
+    The list is comma separated; the tags are compared exactly,
+    the weak comparison is used: a "W/" prefix is ignored.
+    The result is stored in pHttpCon->flags.condMatch.
+    When present, this header takes precedence over the "If-Modified-Since:".
 
-    // If the open fails, then add our default name and try again
-    if(pHttpCon->file == SYS_FS_HANDLE_INVALID)
-    {
-        if(pHttpCon->httpData[lenB-1] != '/')
-        {   // Add the directory delimiter if needed
-            pHttpCon->httpData[lenB++] = '/';
-        }
+  Precondition:
+    The requested file has been opened.
 
-        // Add our default file name
-        strncpy((char*)pHttpCon->httpData + lenB, TCPIP_HTTP_NET_DEFAULT_FILE, httpConnDataSize - lenB);
-        lenB += strlen(TCPIP_HTTP_NET_DEFAULT_FILE);
+  Parameters:
+    pHttpCon - connection pointer
+    value - the header value, leading spaces removed
 
-        // Try to open again
-        pHttpCon->file = (*httpFileShell->fileOpen)(httpFileShell, (char *)&pHttpCon->httpData[1], SYS_FS_FILE_OPEN_READ);
-    }
+  Returns:
+    true - always, a mismatch just serves the file
 
-    if(pHttpCon->file == SYS_FS_HANDLE_INVALID)
-    {   // failed
-        _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_OPEN_ERROR, pHttpCon->httpData + 1);
-        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_NOT_FOUND;
-        pHttpCon->flags.requestError = 1;
-        return TCPIP_HTTP_CONN_STATE_PARSE_HEADERS;
+  Remarks:
+    This function is ony available when TCPIP_HTTP_NET_USE_CONDITIONAL_GET is defined.
+  ***************************************************************************/
+#if defined(TCPIP_HTTP_NET_USE_CONDITIONAL_GET)
+static bool _HTTP_HeaderParseIfNoneMatch(TCPIP_HTTP_NET_CONN* pHttpCon, char* value)
+{
+    char eTag[20];
+    int tagLen;
+    size_t valLen;
+    char* pEnd;
+
+    pHttpCon->flags.condNoneMatch = 1;
+    pHttpCon->flags.condMatch = 0;
+    if(pHttpCon->flags.fileCacheable == 0)
+    {   // nothing to match
+        return true;
     }
 
-    _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_OPEN, pHttpCon->httpData + 1);
-    if(strlen((char*)pHttpCon->httpData + 1) > sizeof(pHttpCon->fileName))
+    valLen = strlen(value);
+    while(valLen != 0 && (value[valLen - 1] == ' ' || value[valLen - 1] == '\t'))
     {
-        _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_NAME_SIZE_ERROR, pHttpCon->httpData + 1);
+        valLen--;
+    }
+    if(valLen == 1 && *value == '*')
+    {   // "*" matches any tag, but only as the whole value
+        pHttpCon->flags.condMatch = 1;
+        return true;
     }
-    strncpy(pHttpCon->fileName, (char*)pHttpCon->httpData + 1, sizeof(pHttpCon->fileName) - 1);
-    pHttpCon->fileName[sizeof(pHttpCon->fileName) - 1] = 0;
 
-    // Find the extension in the filename
-    ext = strrchr(pHttpCon->fileName, TCPIP_HTTP_FILE_EXT_SEP);
+    tagLen = _HTTP_FileETagPrint(pHttpCon, eTag);
+    while(*value != 0)
+    {
+        // next list entry, without the surrounding spaces
+        while(*value == ' ' || *value == '\t' || *value == ',')
+        {
+            value++;
+        }
+        pEnd = strchr(value, ',');
+        valLen = pEnd != 0 ? pEnd - value : strlen(value);
+        while(valLen != 0 && (value[valLen - 1] == ' ' || value[valLen - 1] == '\t'))
+        {
+            valLen--;
+        }
 
-    if(ext)
-    {   // Compare to known extensions to determine Content-Type
-        ext++;
-        for(ix = 0; ix < sizeof(httpFileExtensions) / sizeof(*httpFileExtensions); ix++)
+        if(valLen > 2 && value[0] == 'W' && value[1] == '/')
+        {   // weak comparison
+            value += 2;
+            valLen -= 2;
+        }
+
+        if(valLen == tagLen && strncmp(value, eTag, tagLen) == 0)
         {
-            if(strcmp(ext, httpFileExtensions[ix]) == 0)
-            {
-                break;
-            }
+            pHttpCon->flags.condMatch = 1;
+            break;
         }
-        pHttpCon->fileType = (TCPIP_HTTP_NET_FILE_TYPE)ix;  // TCPIP_HTTP_NET_FILE_TYPE_UNKNOWN if not found
-    }
-    else
-    {
-        pHttpCon->fileType = TCPIP_HTTP_NET_FILE_TYPE_UNKNOWN; 
-    }
 
-    // Perform first round authentication (pass file name only)
-#if defined(TCPIP_HTTP_NET_USE_AUTHENTICATION)
-    if(httpUserCback && httpUserCback->fileAuthenticate)
-    {
-        pHttpCon->isAuthorized = (*httpUserCback->fileAuthenticate)(pHttpCon, pHttpCon->fileName, httpUserCback);
-    }
-    else
-    {
-        pHttpCon->isAuthorized = 0;
+        if(pEnd == 0)
+        {
+            break;
+        }
+        value = pEnd + 1;
     }
-#endif
-
-    return TCPIP_HTTP_CONN_STATE_PARSE_FILE_OPEN + 1;   // advance
 
+    return true;
 }
 
-// parse HTTP GET arguments: TCPIP_HTTP_CONN_STATE_PARSE_GET_ARGS
-// returns the next connection state
-// also signals if waiting for resources
-// Uses the file name in pHttpCon->httpData!
-static TCPIP_HTTP_NET_CONN_STATE _HTTP_ParseGetArgs(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
-{
-    uint16_t lenA;
-    uint8_t c;
+/*****************************************************************************
+  Function:
+    static bool _HTTP_HeaderParseIfModifiedSince(TCPIP_HTTP_NET_CONN* pHttpCon, char* value)
 
-    // Read GET args, up to buffer size - 1
-    lenA = _HTTP_ConnectionCharFind(pHttpCon, ' ', 0, 0);
-    if(lenA != 0)
-    {
-        pHttpCon->hasArgs = 1;
+  Summary:
+    Parses the "If-Modified-Since:" header for a request.
 
-        // Trash the '?'
-        NET_PRES_SocketRead(pHttpCon->socket, &c, 1);
+  Description:
+    Compares the date sent by the client with the "Last-Modified:" date
+    of the requested file.
+    The file is not modified if the dates are identical.
+    The result is stored in pHttpCon->flags.condMatch.
 
-        // Verify there's enough space
-        lenA--;
-        if(lenA >= httpConnDataSize - 2)
-        {
-            pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_OVERFLOW;
-            pHttpCon->flags.requestError = 1;
-            return TCPIP_HTTP_CONN_STATE_PARSE_HEADERS;
-        }
+  Precondition:
+    The requested file has been opened.
 
-        // Read in the arguments and '&'-terminate in anticipation of cookies
-        pHttpCon->ptrData += NET_PRES_SocketRead(pHttpCon->socket, pHttpCon->httpData, lenA);
-        *(pHttpCon->ptrData++) = '&';
+  Parameters:
+    pHttpCon - connection pointer
+    value - the header value, leading spaces removed
+
+  Returns:
+    true - always, a mismatch just serves the file
+
+  Remarks:
+    This function is ony available when TCPIP_HTTP_NET_USE_CONDITIONAL_GET is defined.
+
+    The date is a validator previously sent by the server
+    so an exact match is used, not a date comparison.
+  ***************************************************************************/
+static bool _HTTP_HeaderParseIfModifiedSince(TCPIP_HTTP_NET_CONN* pHttpCon, char* value)
+{
+    uint16_t dateLen;
+    char fileDate[32];
+
+    if(pHttpCon->flags.condNoneMatch != 0 || pHttpCon->flags.fileCacheable == 0)
+    {   // If-None-Match takes precedence or nothing to match
+        return true;
     }
 
-    // Clear the rest of the line
-    lenA = _HTTP_ConnectionCharFind(pHttpCon, TCPIP_HTTP_NET_LINE_END, 0, 0);
-    _HTTP_ConnectionDiscard(pHttpCon, lenA + 1);
+    if((dateLen = _HTTP_FileDatePrint(pHttpCon, fileDate)) == 0)
+    {   // no valid file date
+        return true;
+    }
 
-    // Move to parsing the headers
-    return TCPIP_HTTP_CONN_STATE_PARSE_GET_ARGS + 1;    // advance
+    // ignore any attributes following the date 
+    pHttpCon->flags.condMatch = strncmp(value, fileDate, dateLen) == 0;
 
+    return true;
 }
+#endif  // defined(TCPIP_HTTP_NET_USE_CONDITIONAL_GET)
 
-    
-// parse HTTP headers state: TCPIP_HTTP_CONN_STATE_PARSE_HEADERS 
-// returns the next connection state
-// also signals if waiting for resources
-// if requestError == 1, it eats up the header fields only
-// it can set requestError by itself
-static TCPIP_HTTP_NET_CONN_STATE _HTTP_ParseHeaders(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
-{
-    bool clearLine;
-    int ix;
-    uint16_t lenA, lenB;
-    bool parseFail;
-    uint8_t buffer[TCPIP_HTTP_NET_MAX_HEADER_LEN + 1];
+/*****************************************************************************
+  Function:
+    static bool _HTTP_HeaderParseRange(TCPIP_HTTP_NET_CONN* pHttpCon, char* value)
 
-    // Loop over all the headers
-    while(1)
-    {
-        // Make sure entire line is in the FIFO
-        lenA = _HTTP_ConnectionCharFind(pHttpCon, TCPIP_HTTP_NET_LINE_END, 0, 0);
-        if(lenA == 0xffff)
-        {   // If not, make sure we can receive more data
-            if(_HTTP_SktFifoRxFree(pHttpCon->socket) == 0)
-            {   // Overflow
-                pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_OVERFLOW;
-                pHttpCon->flags.discardRxBuff = 1;
-                pHttpCon->flags.requestError = 1;
-                return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
-            }
+  Summary:
+    Parses the "Range:" header for a request.
 
-            if((int32_t)(SYS_TMR_TickCountGet() - pHttpCon->httpTick) > 0)
-            {   // A timeout has occured
-                pHttpCon->flags.discardRxBuff = 1;
-                pHttpCon->closeEvent = TCPIP_HTTP_NET_EVENT_CLOSE_TIMEOUT;
-                return TCPIP_HTTP_CONN_STATE_ERROR;
-            }
+  Description:
+    Parses a single byte range request: "bytes=first-last", "bytes=first-"
+    or "bytes=-suffixLength" and stores the result in pHttpCon->rangeStart,
+    pHttpCon->rangeEnd.
+    Sets pHttpCon->flags.rangeReq for a valid range, 
+    pHttpCon->flags.rangeBad for a range that cannot be satisfied.
+    Multiple ranges or an invalid syntax are ignored and the whole file is sent.
 
-            // wait some more
-            *pWait = true;
-            return TCPIP_HTTP_CONN_STATE_PARSE_HEADERS;
-        }
+  Precondition:
+    The requested file has been opened.
 
-        // Reset the watchdog timer
-        pHttpCon->httpTick = SYS_TMR_TickCountGet() + TCPIP_HTTP_NET_TIMEOUT * SYS_TMR_TickCounterFrequencyGet();
+  Parameters:
+    pHttpCon - connection pointer
+    value - the header value, leading spaces removed
 
-        // If a CRLF is immediate, then headers are done
-        if(lenA == 1u)
-        {   // Remove the CRLF and move to next state
-            _HTTP_ConnectionDiscard(pHttpCon, 2);
-            return (pHttpCon->flags.requestError == 1) ? TCPIP_HTTP_CONN_STATE_SERVE_HEADERS : TCPIP_HTTP_CONN_STATE_PARSE_HEADERS + 1; // advance
-        }
+  Returns:
+    true - always, an ignored range just serves the whole file
 
-        if(pHttpCon->flags.requestError == 1)
-        {   // in error mode just discard the line
-            _HTTP_ConnectionDiscard(pHttpCon, lenA + 1);
-            continue;
-        }
+  Remarks:
+    This function is ony available when TCPIP_HTTP_NET_USE_RANGES is defined.
+  ***************************************************************************/
+#if defined(TCPIP_HTTP_NET_USE_RANGES)
+static bool _HTTP_HeaderParseRange(TCPIP_HTTP_NET_CONN* pHttpCon, char* value)
+{
+    char *pRange, *pEnd;
+    uint32_t first, last;
 
-        // Find the header name, and use needWait as a flag to indicate a match
-        lenB = _HTTP_ConnectionCharFind(pHttpCon, ':', 0, lenA) + 2;
+    if(pHttpCon->flags.fileCacheable == 0 || pHttpCon->fileSize == 0)
+    {   // ranges apply only to static files
+        return true;
+    }
 
-        // If name is too long or this line isn't a header, ignore it
-        if(lenB > sizeof(buffer))
+    pRange = value;
+    if(strncmp(pRange, "bytes=", 6) != 0 || strchr(pRange, ',') != 0)
+    {   // unknown unit or multiple ranges: ignore
+        return true;
+    }
+    pRange += 6;
+
+    if(*pRange == '-')
+    {   // suffix range: the last bytes of the file
+        last = strtoul(pRange + 1, &pEnd, 10);
+        if(pEnd == pRange + 1)
+        {   // invalid
+            return true;
+        }
+        if(last == 0)
         {
-            _HTTP_ConnectionDiscard(pHttpCon, lenA + 1);
-            continue;
+            pHttpCon->flags.rangeBad = 1;
+            return true;
+        }
+        first = last >= pHttpCon->fileSize ? 0 : pHttpCon->fileSize - last;
+        last = pHttpCon->fileSize - 1;
+    }
+    else
+    {
+        first = strtoul(pRange, &pEnd, 10);
+        if(pEnd == pRange || *pEnd != '-')
+        {   // invalid
+            return true;
+        }
+        pRange = pEnd + 1;
+        last = strtoul(pRange, &pEnd, 10);
+        if(pEnd == pRange)
+        {   // open range: up to the end of file
+            last = pHttpCon->fileSize - 1;
+        }
+        else if(last < first)
+        {   // invalid
+            return true;
         }
 
-        // Read in the header name
-        NET_PRES_SocketRead(pHttpCon->socket, buffer, lenB);
-        buffer[lenB-1] = '\0';
-        lenA -= lenB;
-
-        clearLine = false;
-        // Compare header read to ones we're interested in
-        parseFail = false;
-        for(ix = 0; ix < sizeof(HTTPRequestHeaders)/sizeof(HTTPRequestHeaders[0]); ix++)
+        if(first >= pHttpCon->fileSize)
         {
-            if(stricmp((char*)buffer, (const char *)HTTPRequestHeaders[ix]) == 0)
-            {   // Parse the header and stop the loop
-                parseFail = _HTTP_HeaderParseLookup(pHttpCon, ix) == false;
-                clearLine = true;
-                break;
-            }
+            pHttpCon->flags.rangeBad = 1;
+            return true;
         }
 
-        // Clear the rest of the line, and call the loop again
-        if(clearLine)
-        {   // We already know how much to remove unless a header was found
-            lenA = _HTTP_ConnectionCharFind(pHttpCon, TCPIP_HTTP_NET_LINE_END, 0, 0);
+        if(last >= pHttpCon->fileSize)
+        {
+            last = pHttpCon->fileSize - 1;
         }
-        _HTTP_ConnectionDiscard(pHttpCon, lenA + 1);
-        if(parseFail)
-        {   // signal the error
-            pHttpCon->flags.requestError = 1;
-        } 
     }
 
+    pHttpCon->rangeStart = first;
+    pHttpCon->rangeEnd = last;
+    pHttpCon->flags.rangeReq = 1;
+    return true;
 }
 
+/*****************************************************************************
+  Function:
+    static bool _HTTP_HeaderParseIfRange(TCPIP_HTTP_NET_CONN* pHttpCon, char* value)
 
-// process the authenticate state: TCPIP_HTTP_CONN_STATE_AUTHENTICATE
-// returns the next connection state:
-// also signals if waiting for resources
-static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessAuthenticate(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
-{
-    uint8_t hasArgs;
+  Summary:
+    Parses the "If-Range:" header for a request.
 
-#if defined(TCPIP_HTTP_NET_USE_AUTHENTICATION)
-    // Check current authorization state
-    if(pHttpCon->isAuthorized < 0x80)
-    {   // 401 error
-        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UNAUTHORIZED;
-        return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
-    }
-#endif
+  Description:
+    Checks the entity tag or the date in the header against the file validators.
+    If they don't match, pHttpCon->flags.rangeIfFail is set
+    and the whole file will be sent.
 
-    // Parse the args string
-    *pHttpCon->ptrData = '\0';
-    pHttpCon->ptrData = TCPIP_HTTP_NET_URLDecode(pHttpCon->httpData);
+  Precondition:
+    The requested file has been opened.
 
-    // If this is an upload form request, bypass to headers
-#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
-    if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_UPLOAD_FORM)
+  Parameters:
+    pHttpCon - connection pointer
+    value - the header value, leading spaces removed
+
+  Returns:
+    true - always
+
+  Remarks:
+    This function is ony available when TCPIP_HTTP_NET_USE_RANGES is defined.
+  ***************************************************************************/
+static bool _HTTP_HeaderParseIfRange(TCPIP_HTTP_NET_CONN* pHttpCon, char* value)
+{
+    char validator[32];
+    int valLen;
+
+    pHttpCon->flags.rangeIfFail = 1;
+    if(pHttpCon->flags.fileCacheable == 0)
     {
-        return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
+        return true;
     }
-#endif
 
-    hasArgs = pHttpCon->hasArgs;
-    pHttpCon->hasArgs = 0;
+    // either a strong entity tag or a date
+    valLen = (*value == '"') ? _HTTP_FileETagPrint(pHttpCon, validator) : _HTTP_FileDatePrint(pHttpCon, validator);
+    if(valLen != 0 && strncmp(value, validator, valLen) == 0)
+    {
+        pHttpCon->flags.rangeIfFail = 0;
+    }
 
-    // Move on to GET args, unless there are none
-    return (hasArgs != 0) ? TCPIP_HTTP_CONN_STATE_PROCESS_GET : TCPIP_HTTP_CONN_STATE_PROCESS_POST;
+    return true;
 }
+#endif  // defined(TCPIP_HTTP_NET_USE_RANGES)
 
-
-
-// process the GET state: TCPIP_HTTP_CONN_STATE_PROCESS_GET
-// returns the next connection state:
+// process HTTP idle state: TCPIP_HTTP_CONN_STATE_IDLE
+// returns the next connection state
 // also signals if waiting for resources
-static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessGet(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessIdle(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
 {
-    // Run the application callback TCPIP_HTTP_NET_ConnectionGetExecute()
-    if(httpUserCback && httpUserCback->getExecute)
-    {
-        if((*httpUserCback->getExecute)(pHttpCon, httpUserCback) == TCPIP_HTTP_NET_IO_RES_WAITING)
-        {   // If waiting for asynchronous process, return to main app
-            *pWait = true;
-            return TCPIP_HTTP_CONN_STATE_PROCESS_GET;   // stay  here
-        }
+    uint16_t lenA;
+
+#if (_TCPIP_HTTP_NET_PIPELINE != 0)
+    if(pHttpCon->bodySkip != 0 && _HTTP_BodySkip(pHttpCon, 0) != 0)
+    {   // the rest of the previous request body is not here yet
+        *pWait = true;
+        return TCPIP_HTTP_CONN_STATE_IDLE;
     }
+#endif  // (_TCPIP_HTTP_NET_PIPELINE != 0)
 
-    // Move on to POST data
-    return TCPIP_HTTP_CONN_STATE_PROCESS_GET + 1;    // advance
+    // Check how much data is waiting
+    lenA = NET_PRES_SocketReadIsReady(pHttpCon->socket);
+    if(lenA == 0)
+    {   // no data; wait some more
+        *pWait = true;
+        return TCPIP_HTTP_CONN_STATE_IDLE;
+    }
 
-}
+    // process the request
+    // Clear out state info and move to next state
+    pHttpCon->ptrData = pHttpCon->httpData;
+    pHttpCon->isAuthorized = 0xff;
+    pHttpCon->hasArgs = 0;
+    pHttpCon->httpTick = SYS_TMR_TickCountGet() + TCPIP_HTTP_NET_TIMEOUT * SYS_TMR_TickCounterFrequencyGet();
+    pHttpCon->callbackPos = 0xffffffff;
+    pHttpCon->byteCount = 0;
+    pHttpCon->smPost = 0x00;
+    pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_GET; // show no error condition
+    pHttpCon->closeEvent = 0;
+    if(pHttpCon->flags.sktIsConnected == 0)
+    {   // report it once
+        _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_OPEN, 0);
+    }
+    pHttpCon->flags.val = 0;
+    pHttpCon->flags.sktIsConnected = 1;
+    pHttpCon->lineLen = 0;
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+    pHttpCon->queryHash = 0;
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+#if (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+    pHttpCon->evChannel = 0;
+#endif  // (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+#if (_TCPIP_HTTP_NET_ROUTER != 0)
+    pHttpCon->routeIx = 0;
+#endif  // (_TCPIP_HTTP_NET_ROUTER != 0)
+#if (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+    pHttpCon->sessionEntry = 0;
+    pHttpCon->authCred[0] = 0;
+#endif  // (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+#if (_TCPIP_HTTP_NET_SCHED != 0)
+    pHttpCon->schedDeficit = 0;
+    pHttpCon->schedClass = TCPIP_HTTP_NET_SCHED_CLASS_INTERACTIVE;
+#endif  // (_TCPIP_HTTP_NET_SCHED != 0)
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+    if(pHttpCon->logAccept == 0)
+    {   // not stamped when the socket was accepted: a following request on a persistent connection
+        pHttpCon->logAccept = SYS_TIME_CounterGet();
+    }
+    memset(pHttpCon->logStamps, 0, sizeof(pHttpCon->logStamps));
+    pHttpCon->logBytes = 0;
+    pHttpCon->flags.logPending = 1;
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
 
+    return TCPIP_HTTP_CONN_STATE_IDLE + 1;
 
-// process the POST state: TCPIP_HTTP_CONN_STATE_PROCESS_POST
-// returns the next connection state:
-// also signals if waiting for resources
-static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessPost(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+}
+
+// assembles the next request line in pHttpCon->lineBuff
+// the socket data is copied only once, into the line buffer, and scanned there:
+//  - the bytes up to and including the line end are then skipped in the socket, without a copy
+//  - the bytes copied past the line end are the socket data that follows;
+//    they are kept in the buffer (aheadLen) and used for the next line instead of copying them again
+// a partial line is kept in lineBuff across calls, no rescanning of the socket buffer
+// the line buffer is held only while a line is being assembled:
+// a connection waiting between lines returns it to the pool
+// returns the line length, with the CRLF stripped and the line '\0' terminated
+// or a TCPIP_HTTP_LINE_RES value if the line is not complete or it is too long
+static int _HTTP_LineGet(TCPIP_HTTP_NET_CONN* pHttpCon)
 {
+    uint16_t avlblBytes, scanLen;
+    char* pScan;
+    char* pEnd;
+    int lineLen;
+    TCPIP_HTTP_LINE_BUFF_DCPT* lineBuffDcpt;
 
-#if defined(TCPIP_HTTP_NET_USE_POST)
-    TCPIP_HTTP_NET_IO_RESULT    ioRes;
+    if((avlblBytes = NET_PRES_SocketReadIsReady(pHttpCon->socket)) == 0)
+    {   // nothing new
+        if(pHttpCon->lineLen == 0 && pHttpCon->flags.lineSkip == 0)
+        {   // no partial line to keep
+            _HTTP_LineBuffRelease(pHttpCon);
+        }
+        return TCPIP_HTTP_LINE_RES_WAIT;
+    }
 
-    // See if we have any new data
-    if(NET_PRES_SocketReadIsReady(pHttpCon->socket) == pHttpCon->callbackPos)
+    if(pHttpCon->lineBuff == 0 && !_HTTP_LineBuffGet(pHttpCon))
+    {   // wait for a line buffer
+        return TCPIP_HTTP_LINE_RES_WAIT;
+    }
+
+    lineBuffDcpt = pHttpCon->lineBuffDcpt;
+    if(lineBuffDcpt->aheadLen > avlblBytes)
+    {   // should not happen: the socket data was read by someone else
+        lineBuffDcpt->aheadLen = 0;
+    }
+
+    while(true)
     {
-        if((int32_t)(SYS_TMR_TickCountGet() - pHttpCon->httpTick) > 0)
-        {   // If a timeout has occured, disconnect
-            pHttpCon->closeEvent = TCPIP_HTTP_NET_EVENT_CLOSE_TIMEOUT;
-            return TCPIP_HTTP_CONN_STATE_ERROR;
+        if(pHttpCon->lineLen == 0)
+        {   // a new line starts with the data already copied, if any
+            pHttpCon->lineBuff = lineBuffDcpt->aheadLen != 0 ? lineBuffDcpt->lineBuff + lineBuffDcpt->aheadOffset : lineBuffDcpt->lineBuff;
         }
-    }
 
-#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
-    if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_POST || (pHttpCon->httpStatus >= TCPIP_HTTP_NET_STAT_UPLOAD_STARTED && pHttpCon->httpStatus <= TCPIP_HTTP_NET_STAT_UPLOAD_ERROR))
-#else
-        if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_POST)
-#endif
-        {
-            // Run the application callback TCPIP_HTTP_NET_ConnectionPostExecute()
-#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
-            if(pHttpCon->httpStatus >= TCPIP_HTTP_NET_STAT_UPLOAD_STARTED && pHttpCon->httpStatus <= TCPIP_HTTP_NET_STAT_UPLOAD_ERROR)
+        if(lineBuffDcpt->aheadLen == 0)
+        {   // copy the socket data that follows the partial line
+            if((avlblBytes = NET_PRES_SocketReadIsReady(pHttpCon->socket)) == 0)
             {
-                ioRes = TCPIP_HTTP_NET_FSUpload(pHttpCon);
+                break;
             }
-            else
-#endif  // defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+            pScan = pHttpCon->lineBuff + pHttpCon->lineLen;
+            scanLen = NET_PRES_SocketPeek(pHttpCon->socket, pScan, mMIN(lineBuffDcpt->lineBuff + TCPIP_HTTP_NET_MAX_LINE_LEN - pScan, avlblBytes));
+            if(scanLen == 0)
             {
-                if(httpUserCback && httpUserCback->postExecute)
-                {
-                    ioRes = (*httpUserCback->postExecute)(pHttpCon, httpUserCback);
+                break;
+            }
+        }
+        else
+        {
+            pScan = lineBuffDcpt->lineBuff + lineBuffDcpt->aheadOffset;
+            scanLen = lineBuffDcpt->aheadLen;
+        }
+
+        pEnd = memchr(pScan, TCPIP_HTTP_NET_LINE_END, scanLen);
+        if(pEnd == 0)
+        {   // partial line: the data is consumed and kept
+            NET_PRES_SocketRead(pHttpCon->socket, 0, scanLen);
+            lineBuffDcpt->aheadLen = 0;
+            if(pHttpCon->flags.lineSkip != 0)
+            {   // dropping a line that's too long: the buffer is just scratch
+                pHttpCon->lineLen = 0;
+                continue;
+            }
+
+            pHttpCon->lineLen += scanLen;
+            if(pHttpCon->lineBuff + pHttpCon->lineLen == lineBuffDcpt->lineBuff + TCPIP_HTTP_NET_MAX_LINE_LEN)
+            {   // buffer end reached
+                if(pHttpCon->lineBuff != lineBuffDcpt->lineBuff)
+                {   // make room for the rest of it
+                    memmove(lineBuffDcpt->lineBuff, pHttpCon->lineBuff, pHttpCon->lineLen);
+                    pHttpCon->lineBuff = lineBuffDcpt->lineBuff;
                 }
                 else
-                {
-                    ioRes = TCPIP_HTTP_NET_IO_RES_DONE;
+                {   // no room for the rest of it
+                    pHttpCon->flags.lineSkip = 1;
+                    pHttpCon->lineLen = 0;
                 }
             }
+            continue;
+        }
 
-            // If waiting for asynchronous process, return to main app
-            if(ioRes == TCPIP_HTTP_NET_IO_RES_WAITING)
-            {   // return to main app and make sure we don't get stuck by the watchdog
-                pHttpCon->callbackPos = NET_PRES_SocketReadIsReady(pHttpCon->socket) - 1;
-                *pWait = true;
-                return TCPIP_HTTP_CONN_STATE_PROCESS_POST;  // wait
-            }
-            else if(ioRes == TCPIP_HTTP_NET_IO_RES_NEED_DATA)
-            {   // If waiting for more data
-                pHttpCon->callbackPos = NET_PRES_SocketReadIsReady(pHttpCon->socket);
-                pHttpCon->httpTick = SYS_TMR_TickCountGet() + TCPIP_HTTP_NET_TIMEOUT * SYS_TMR_TickCounterFrequencyGet();
-
-                // If more is expected and space is available, return to main app
-                if(pHttpCon->byteCount > pHttpCon->callbackPos && _HTTP_SktFifoRxFree(pHttpCon->socket) != 0)
-                {
-                    *pWait = true;
-                    return TCPIP_HTTP_CONN_STATE_PROCESS_POST;  // wait
-                }
+        // line complete: consume it, keep what follows
+        NET_PRES_SocketRead(pHttpCon->socket, 0, pEnd - pScan + 1);
+        lineBuffDcpt->aheadOffset = pEnd + 1 - lineBuffDcpt->lineBuff;
+        lineBuffDcpt->aheadLen = scanLen - (pEnd - pScan + 1);
 
-                // Handle cases where application ran out of data or buffer space
-                pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_INTERNAL_SERVER_ERROR;
-                return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;  // error
-            }
-            else if(ioRes == TCPIP_HTTP_NET_IO_RES_ERROR)
-            {   // some error, abort
-                pHttpCon->closeEvent = TCPIP_HTTP_NET_EVENT_CLOSE_POST_ERROR;
-                return TCPIP_HTTP_CONN_STATE_ERROR;
-            }
+        if(pHttpCon->flags.lineSkip != 0)
+        {
+            pHttpCon->flags.lineSkip = 0;
+            pHttpCon->lineLen = 0;
+            return TCPIP_HTTP_LINE_RES_LONG;
+        }
 
-            // else TCPIP_HTTP_NET_IO_RES_DONE and move on; discard whatever the buffer may contain
-            NET_PRES_SocketDiscard(pHttpCon->socket);
-            return TCPIP_HTTP_CONN_STATE_PROCESS_POST + 1;  // advance
+        lineLen = pEnd - pHttpCon->lineBuff;
+        if(lineLen != 0 && pHttpCon->lineBuff[lineLen - 1] == '\r')
+        {
+            lineLen--;
         }
-#endif
-    // We're done with POST
-    return TCPIP_HTTP_CONN_STATE_PROCESS_POST + 1;  // advance
+        pHttpCon->lineBuff[lineLen] = '\0';
+        pHttpCon->lineLen = 0;
+        return lineLen;
+    }
+
+    return TCPIP_HTTP_LINE_RES_WAIT;
 }
 
+// borrows a line buffer from the pool, for the request parsing
+// returns false if the pool is empty
+static bool _HTTP_LineBuffGet(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    TCPIP_HTTP_LINE_BUFF_DCPT* lineBuffDcpt = (TCPIP_HTTP_LINE_BUFF_DCPT*)TCPIP_Helper_SingleListHeadRemove(&httpLineBuffers);
+    if(lineBuffDcpt == 0)
+    {
+        httpLineBuffEmpty++;
+        return false;
+    }
 
-// process the serve connection headers state: TCPIP_HTTP_CONN_STATE_SERVE_HEADERS
-// returns the next connection state:
-// also signals if waiting for resources
-// Note: all the previous parsing states should branch here after parsing the headers
-// when an error detected // (except timeouts/file errors that go to TCPIP_HTTP_CONN_STATE_ERROR)!
-// Processing should get here with all headers processed!
-//
-static TCPIP_HTTP_NET_CONN_STATE _HTTP_ServeHeaders(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+    lineBuffDcpt->aheadLen = 0;
+    pHttpCon->lineBuffDcpt = lineBuffDcpt;
+    pHttpCon->lineBuff = lineBuffDcpt->lineBuff;
+    pHttpCon->lineLen = 0;
+    return true;
+}
+
+// returns the line buffer to the pool
+static void _HTTP_LineBuffRelease(TCPIP_HTTP_NET_CONN* pHttpCon)
 {
-    bool isConnDone;
-    bool fileGzipped;
-    int  headerLen, responseLen, contentLen;
-    SYS_FS_FSTAT fs_attr = {0};
-    char contentLenBuffer[40];
-    char responseBuffer[TCPIP_HTTP_NET_RESPONSE_BUFFER_SIZE];
+    if(pHttpCon->lineBuffDcpt != 0)
+    {
+        TCPIP_Helper_SingleListTailAdd(&httpLineBuffers, (SGL_LIST_NODE*)pHttpCon->lineBuffDcpt);
+        pHttpCon->lineBuffDcpt = 0;
+        pHttpCon->lineBuff = 0;
+        pHttpCon->lineLen = 0;
+    }
+}
 
+// sets the name of the file served by the connection
+// the name storage is shared with the other connections serving the same file
+// returns false if out of memory
+static bool _HTTP_FileNameSet(TCPIP_HTTP_NET_CONN* pHttpCon, const char* fName)
+{
+    TCPIP_HTTP_FILE_NAME* pName;
+    size_t nameLen = strlen(fName);
+    uint32_t nameHash = fnv_32_hash(fName, nameLen);
 
-    if(pHttpCon->flags.procPhase == 0)
-    {   // output headers now; Send header corresponding to the current state
-        headerLen = sprintf(responseBuffer, TCPIP_HTTP_NET_HEADER_PREFIX "%s", HTTPResponseHeaders[pHttpCon->httpStatus]);
-        if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_REDIRECT)
-        {   // special case here, this header message takes arguments; 
-            headerLen += sprintf(responseBuffer + headerLen, "%s \r\n", (char*)pHttpCon->httpData);
-        }
+    _HTTP_FileNameRelease(pHttpCon);
 
-        if(httpNonPersistentConn)
-        {
-            headerLen += sprintf(responseBuffer + headerLen, "Connection: close\r\n");
+    for(pName = (TCPIP_HTTP_FILE_NAME*)httpFileNames.head; pName != 0; pName = pName->next)
+    {
+        if(pName->nameHash == nameHash && strcmp(pName->name, fName) == 0)
+        {   // already there
+            break;
         }
+    }
 
-        if(!_HTTP_DataTryOutput(pHttpCon, responseBuffer, headerLen, 0))
-        {   //  not enough room to send data; wait some more
-            *pWait = true;
-            return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
+    if(pName == 0)
+    {
+        pName = (TCPIP_HTTP_FILE_NAME*)(*http_malloc_fnc)(sizeof(*pName) + nameLen + 1);
+        if(pName == 0)
+        {
+            return false;
         }
-        // success
-        pHttpCon->flags.procPhase = 1;
+        pName->nameHash = nameHash;
+        pName->refCount = 0;
+        strcpy(pName->name, fName);
+        TCPIP_Helper_SingleListHeadAdd(&httpFileNames, (SGL_LIST_NODE*)pName);
+        httpFileNameBytes += sizeof(*pName) + nameLen + 1;
     }
 
-    if(pHttpCon->flags.procPhase == 1)
-    {   // output content length now;
-        responseLen = 0;
-        // if error or not GET or POST, we're done and we don't output any message body
-        isConnDone = pHttpCon->flags.requestError != 0 || (pHttpCon->httpStatus != TCPIP_HTTP_NET_STAT_GET && pHttpCon->httpStatus != TCPIP_HTTP_NET_STAT_POST);
-        
-        if(HTTPResponseFunctions[pHttpCon->httpStatus] != 0)
+    pName->refCount++;
+    pHttpCon->pFileName = pName;
+    pHttpCon->fileName = pName->name;
+    return true;
+}
+
+// releases the file name of the connection
+// the name storage is freed when no other connection uses it
+static void _HTTP_FileNameRelease(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    TCPIP_HTTP_FILE_NAME* pName = pHttpCon->pFileName;
+
+    if(pName != 0)
+    {
+        if(--pName->refCount == 0)
         {
-            responseLen = (*HTTPResponseFunctions[pHttpCon->httpStatus])(pHttpCon, responseBuffer, sizeof(responseBuffer));
-            if(responseLen != 0)
-            {
-                contentLen = sprintf(contentLenBuffer, "Content-Length: %d\r\n", responseLen);
-                if(!_HTTP_DataTryOutput(pHttpCon, contentLenBuffer, contentLen, contentLen + responseLen + isConnDone ? TCPIP_HTTP_NET_CRLF_LEN : 0))
-                {   // not enough room to send data; wait some more
-                    *pWait = true;
-                    return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
-                }
-                // this should succeed now
-                _HTTP_DataTryOutput(pHttpCon, responseBuffer, responseLen, 0);
-                if(isConnDone)
-                {
-                    _HTTP_DataTryOutput(pHttpCon, TCPIP_HTTP_NET_CRLF, TCPIP_HTTP_NET_CRLF_LEN, 0);
-                }
-                pHttpCon->flags.procPhase = 2;
-            }
+            TCPIP_Helper_SingleListNodeRemove(&httpFileNames, (SGL_LIST_NODE*)pName);
+            httpFileNameBytes -= sizeof(*pName) + strlen(pName->name) + 1;
+            (*http_free_fnc)(pName);
         }
+        pHttpCon->pFileName = 0;
+    }
+    pHttpCon->fileName = "";
+}
 
-        if(isConnDone)
-        {   // no message body; we're done;
-            pHttpCon->flags.procPhase = 0;    // clear our traces
-            return TCPIP_HTTP_CONN_STATE_DONE;
-        }
-        // continue
-        pHttpCon->flags.procPhase = 2;
+// parse HTTP request state: TCPIP_HTTP_CONN_STATE_PARSE_REQUEST
+// returns the next connection state
+// also signals if waiting for resources
+// Retrieves the file name in pHttpCon->httpData!
+// Leaves the query string in pHttpCon->lineBuff
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ParseRequest(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+{
+    int lineLen;
+    uint16_t uriLen, queryLen;
+    char* pUri;
+    char* pQuery;
+
+    // check that there is some registered HTTP app
+    if(httpUserCback == 0)
+    {
+        pHttpCon->flags.discardRxBuff = 1;
+        return TCPIP_HTTP_CONN_STATE_ERROR;
     }
 
+    // Get the first line
+    lineLen = _HTTP_LineGet(pHttpCon);
+    if(lineLen == TCPIP_HTTP_LINE_RES_WAIT)
+    {   // First line isn't here yet
+        if((int32_t)(SYS_TMR_TickCountGet() - pHttpCon->httpTick) > 0)
+        {   // A timeout has occurred
+            pHttpCon->flags.discardRxBuff = 1;
+            pHttpCon->closeEvent = TCPIP_HTTP_NET_EVENT_CLOSE_TIMEOUT;
+            return TCPIP_HTTP_CONN_STATE_ERROR;
+        }
+        // wait some more
+        *pWait = true;
+        return TCPIP_HTTP_CONN_STATE_PARSE_REQUEST;
+    }
 
-    // pHttpCon->flags.procPhase == 2;
+    if(lineLen == TCPIP_HTTP_LINE_RES_LONG)
+    {   // the request line doesn't fit, we overflowed
+        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_OVERFLOW;
+        pHttpCon->flags.discardRxBuff = 1;
+        pHttpCon->flags.requestError = 1;
+        pHttpCon->flags.pipeBreak = 1;
+        return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
+    }
 
-    // process a GET or POST - something that will have a message body
+    // Reset the watchdog timer
+    pHttpCon->httpTick = SYS_TMR_TickCountGet() + TCPIP_HTTP_NET_TIMEOUT * SYS_TMR_TickCounterFrequencyGet();
 
-    responseLen = 0;
-    // Output the content type, if known
-    if(pHttpCon->fileType != TCPIP_HTTP_NET_FILE_TYPE_UNKNOWN)
+    // Determine the request method
+    pUri = strchr(pHttpCon->lineBuff, ' ');
+    if(pUri != 0)
     {
-        responseLen = sprintf(responseBuffer,  "Content-Type: %s\r\n", httpContentTypes[pHttpCon->fileType]);
+        *pUri++ = '\0';
     }
-
-    // Output the gzip encoding header if needed
-    fileGzipped = 0;
-    if((*httpFileShell->fileStat)(httpFileShell, (const char *)&pHttpCon->fileName, &fs_attr) != SYS_FS_HANDLE_INVALID)
+    else
     {
-        if (fs_attr.fattrib == SYS_FS_ATTR_ZIP_COMPRESSED)
-        {
-            responseLen += sprintf(responseBuffer + responseLen,  "Content-Encoding: gzip\r\n");
-            fileGzipped = 1;
-        }
+        pUri = pHttpCon->lineBuff + lineLen;
     }
 
-    // Output the cache-control
-    if((pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_POST) || (fileGzipped == 0 && _HTTP_FileTypeIsDynamic(pHttpCon->fileName)))
-    {   // This is a dynamic page or a POST request, so no cache
-        responseLen += sprintf(responseBuffer + responseLen,  "Cache-Control: no-cache\r\n");
+    if (strcmp(pHttpCon->lineBuff, "GET") == 0)
+    {
+        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_GET;
     }
-    else
+#if defined(TCPIP_HTTP_NET_USE_POST)
+    else if (strcmp(pHttpCon->lineBuff, "POST") == 0)
     {
-        responseLen += sprintf(responseBuffer + responseLen,  "Cache-Control: max-age=" TCPIP_HTTP_NET_CACHE_LEN TCPIP_HTTP_NET_CRLF);
+        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_POST;
+    }
+#endif
+    else
+    {   // Unrecognized method, so return not implemented
+        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_NOT_IMPLEMENTED;
+        pHttpCon->flags.requestError = 1;
+        pHttpCon->flags.pipeBreak = 1;  // the headers are not parsed; a body length is not known
+        return TCPIP_HTTP_CONN_STATE_PARSE_HEADERS;
     }
 
+    // Find end of filename and the query string
+    uriLen = strcspn(pUri, " ?");
+    pQuery = pUri + uriLen;
+    queryLen = 0;
+    if(*pQuery == '?')
+    {
+        pQuery++;
+        queryLen = strcspn(pQuery, " ");
+    }
 
-    if(!_HTTP_DataTryOutput(pHttpCon, responseBuffer, responseLen, 0))
-    {   // not enough room to send data; wait some more
-        *pWait = true;
-        return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
+    // If the file name is too long, then reject the request
+    if(uriLen > httpConnDataSize - TCPIP_HTTP_NET_DEFAULT_LEN - 1)
+    {
+        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_OVERFLOW;
+        pHttpCon->flags.requestError = 1;
+        pHttpCon->flags.pipeBreak = 1;
+        return TCPIP_HTTP_CONN_STATE_PARSE_HEADERS;
     }
 
+    // Copy the filename and decode
+    memcpy(pHttpCon->httpData, pUri, uriLen);
+    pHttpCon->httpData[uriLen] = '\0';
+    TCPIP_HTTP_NET_URLDecode(pHttpCon->httpData);
 
-    // Check if we should output cookies
-    return (pHttpCon->hasArgs != 0) ? TCPIP_HTTP_CONN_STATE_SERVE_HEADERS + 1 : TCPIP_HTTP_CONN_STATE_SERVE_BODY_INIT;
+    // keep the query string for the GET arguments
+    memmove(pHttpCon->lineBuff, pQuery, queryLen);
+    pHttpCon->lineBuff[queryLen] = '\0';
 
+    return TCPIP_HTTP_CONN_STATE_PARSE_REQUEST + 1; // advance 
 }
 
-
-// serve connection cookies state: TCPIP_HTTP_CONN_STATE_SERVE_COOKIES
-// returns the next connection state:
+// parse HTTP file upload state: TCPIP_HTTP_CONN_STATE_PARSE_FILE_UPLOAD
+// returns the next connection state
 // also signals if waiting for resources
-static TCPIP_HTTP_NET_CONN_STATE _HTTP_ServeCookies(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+// Uses the file name in pHttpCon->httpData!
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ParseFileUpload(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
 {
-#if defined(TCPIP_HTTP_NET_USE_COOKIES)
-    uint8_t c;
-    char*   pBuff;
-    char    cookieBuffer[TCPIP_HTTP_NET_COOKIE_BUFFER_SIZE];
-    
-
-    // Write cookies one at a time as space permits
-    for(pHttpCon->ptrRead = pHttpCon->httpData; pHttpCon->hasArgs != 0; pHttpCon->hasArgs--)
-    {
-        // Write the header
-        strcpy(cookieBuffer, "Set-Cookie: ");
-        pBuff = cookieBuffer + strlen(cookieBuffer);
-
-        // Write the name, URL encoded, one character at a time
-        while((c = *(pHttpCon->ptrRead++)))
+    // Check if this is an FS Upload
+#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+    if(memcmp(&pHttpCon->httpData[1], TCPIP_HTTP_NET_FILE_UPLOAD_NAME, sizeof(TCPIP_HTTP_NET_FILE_UPLOAD_NAME)) == 0)
+    {   // Read remainder of line, and bypass all file opening, etc.
+        if(strlen((char*)pHttpCon->httpData + 1) > SYS_FS_FILE_NAME_LEN)
         {
-            if(c == ' ')
-            {
-                *pBuff++ = '+';
-            }
-            else if(c < '0' || (c > '9' && c < 'A') || (c > 'Z' && c < 'a') || c > 'z')
-            {
-                *pBuff++ = '%';
-                *pBuff++ = btohexa_high(c);
-                *pBuff++ = btohexa_low(c);
-            }
-            else
-            {
-                *pBuff++ = c;
-            }
+            _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_NAME_SIZE_ERROR, pHttpCon->httpData + 1);
+        }
+        if(!_HTTP_FileNameSet(pHttpCon, (char*)pHttpCon->httpData + 1))
+        {   // out of memory
+            pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_INTERNAL_SERVER_ERROR;
+            pHttpCon->flags.requestError = 1;
+            return TCPIP_HTTP_CONN_STATE_PARSE_HEADERS;
         }
 
-        *pBuff++ = '=';
-
-        // Write the value, URL encoded, one character at a time
-        while((c = *(pHttpCon->ptrRead++)))
+#if defined(TCPIP_HTTP_NET_USE_AUTHENTICATION)
+        if(httpUserCback && httpUserCback->fileAuthenticate)
         {
-            if(c == ' ')
-            {
-                *pBuff++ = '+';
-            }
-            else if(c < '0' || (c > '9' && c < 'A') || (c > 'Z' && c < 'a') || c > 'z')
-            {
-                *pBuff++ = '%';
-                *pBuff++ = btohexa_high(c);
-                *pBuff++ = btohexa_low(c);
-            }
-            else
-            {
-                *pBuff++ = c;
-            }
+            pHttpCon->isAuthorized = (*httpUserCback->fileAuthenticate)(pHttpCon, pHttpCon->fileName, httpUserCback);
         }
-
-        // Finish the line
-        *pBuff++ = '\r';
-        *pBuff++ = '\n';
-
-        if(!_HTTP_DataTryOutput(pHttpCon, cookieBuffer, pBuff - cookieBuffer, 0))
-        {   //  not enough room to send data; wait some more
-            *pWait = true;
-            return TCPIP_HTTP_CONN_STATE_SERVE_COOKIES;
+        else
+        {
+            pHttpCon->isAuthorized = 0;
         }
-    }
 #endif
+        if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_GET)
+        {
+            pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_FORM;
+        }
+        else
+        {
+            pHttpCon->flags.uploadPhase = 0;
+            pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_STARTED;
+        }
 
-    return TCPIP_HTTP_CONN_STATE_SERVE_COOKIES + 1;   // done, advance
+        return TCPIP_HTTP_CONN_STATE_PARSE_HEADERS;
+    }
+#endif
+    return TCPIP_HTTP_CONN_STATE_PARSE_FILE_UPLOAD + 1;
 }
 
-// process HTTP body init state: TCPIP_HTTP_CONN_STATE_SERVE_BODY_INIT
-// returns the next connection state:
-// also signals if waiting for resources
-static TCPIP_HTTP_NET_CONN_STATE _HTTP_ServeBodyInit(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+// adds the TCPIP_HTTP_NET_DEFAULT_FILE to the directory name in pHttpCon->httpData
+// nameLen is the current length of the name
+static void _HTTP_DefaultFileAdd(TCPIP_HTTP_NET_CONN* pHttpCon, uint16_t nameLen)
 {
-    int  encodeLen;
-    char encodingBuffer[40];
-
-    // Set up the dynamic substitutions
-    pHttpCon->byteCount = 0;
-
-    if(httpNonPersistentConn == false)
-    {   // output encoding and end of headers
-        encodeLen = sprintf(encodingBuffer, "Transfer-Encoding: chunked\r\n\r\n");
-    }
-    else
-    {   // just terminate the headers
-        encodeLen = sprintf(encodingBuffer, "\r\n");
-
-    }
-
-    if(!_HTTP_DataTryOutput(pHttpCon, encodingBuffer, encodeLen, 0))
-    {   // not enough room to send data; wait some more
-        *pWait = true;
-        return TCPIP_HTTP_CONN_STATE_SERVE_BODY_INIT;
+    if(pHttpCon->httpData[nameLen-1] != '/')
+    {   // Add the directory delimiter if needed
+        pHttpCon->httpData[nameLen++] = '/';
     }
 
-    return TCPIP_HTTP_CONN_STATE_SERVE_BODY_INIT + 1;   // advance
+    // Add our default file name
+    strncpy((char*)pHttpCon->httpData + nameLen, TCPIP_HTTP_NET_DEFAULT_FILE, httpConnDataSize - nameLen);
 }
 
-// process HTTP serve body state: TCPIP_HTTP_CONN_STATE_SERVE_BODY
-// returns the next connection state:
-// also signals if waiting for resources
-static TCPIP_HTTP_NET_CONN_STATE _HTTP_ServeBody(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+#if (_TCPIP_HTTP_NET_EVENT_STREAM != 0) || (_TCPIP_HTTP_NET_WEBSOCKET != 0) || (_TCPIP_HTTP_NET_ACCESS_LOG_DUMP != 0) || (_TCPIP_HTTP_NET_ROUTER != 0)
+// a request for a name that is served without a file: event channel, WebSocket endpoint, access log, virtual route
+// sets the connection file name and authenticates it
+// returns the next connection state
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ParseNoFile(TCPIP_HTTP_NET_CONN* pHttpCon)
 {
-    TCPIP_HTTP_CHUNK_RES chunkRes;
-
-    chunkRes = _HTTP_AddFileChunk(pHttpCon, pHttpCon->file, pHttpCon->fileName, 0);
-    if(chunkRes == TCPIP_HTTP_CHUNK_RES_WAIT)
-    {   // need a break; stay here
-        *pWait = true;
-        return TCPIP_HTTP_CONN_STATE_SERVE_BODY;
+    if(!_HTTP_FileNameSet(pHttpCon, (char*)pHttpCon->httpData + 1))
+    {   // out of memory
+        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_INTERNAL_SERVER_ERROR;
+        pHttpCon->flags.requestError = 1;
+        return TCPIP_HTTP_CONN_STATE_PARSE_HEADERS;
     }
 
-    // else continue processing
-    pHttpCon->file = SYS_FS_HANDLE_INVALID; // it will be closed when its chunk is processed 
-    return TCPIP_HTTP_CONN_STATE_SERVE_BODY + 1;    // advance
+#if defined(TCPIP_HTTP_NET_USE_AUTHENTICATION)
+    if(httpUserCback && httpUserCback->fileAuthenticate)
+    {
+        pHttpCon->isAuthorized = (*httpUserCback->fileAuthenticate)(pHttpCon, pHttpCon->fileName, httpUserCback);
+    }
+    else
+    {
+        pHttpCon->isAuthorized = 0;
+    }
+#endif
+    return TCPIP_HTTP_CONN_STATE_PARSE_FILE_OPEN + 1;
 }
+#endif  // (_TCPIP_HTTP_NET_EVENT_STREAM != 0) || (_TCPIP_HTTP_NET_WEBSOCKET != 0) || (_TCPIP_HTTP_NET_ACCESS_LOG_DUMP != 0) || (_TCPIP_HTTP_NET_ROUTER != 0)
 
-// process HTTP serve chunks state: TCPIP_HTTP_CONN_STATE_SERVE_CHUNKS
-// returns the next connection state:
+// parse HTTP file open state: TCPIP_HTTP_CONN_STATE_PARSE_FILE_OPEN
+// returns the next connection state
 // also signals if waiting for resources
-static TCPIP_HTTP_NET_CONN_STATE _HTTP_ServeChunks(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+// Uses the file name in pHttpCon->httpData!
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ParseFileOpen(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
 {
-    TCPIP_HTTP_CHUNK_RES chunkRes;
+    uint16_t lenB;
+    bool isOpen = false;
+    bool isResolved = false;
+#if (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+    uint16_t uriLen;
+    uint32_t uriHash;
+    TCPIP_HTTP_PATH_ENTRY* pPath;
+#endif  // (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+#if (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+    int chIx;
+
+    if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_GET && (chIx = _HTTP_EventChannelFind((char*)pHttpCon->httpData + 1)) >= 0)
+    {   // event channel subscription: there's no file to open
+        pHttpCon->evChannel = chIx + 1;
+        return _HTTP_ParseNoFile(pHttpCon);
+    }
+#endif  // (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+    int epIx;
+
+    if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_GET && (epIx = _HTTP_WsEndpointFind((char*)pHttpCon->httpData + 1)) >= 0)
+    {   // WebSocket endpoint: there's no file to open; the handshake headers follow
+        if((pHttpCon->wsDcpt = (TCPIP_HTTP_WS_DCPT*)(*http_malloc_fnc)(sizeof(TCPIP_HTTP_WS_DCPT))) == 0)
+        {   // out of memory
+            pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_INTERNAL_SERVER_ERROR;
+            pHttpCon->flags.requestError = 1;
+            return TCPIP_HTTP_CONN_STATE_PARSE_HEADERS;
+        }
+        memset(pHttpCon->wsDcpt, 0, sizeof(*pHttpCon->wsDcpt));
+        pHttpCon->wsDcpt->epIx = (uint8_t)epIx;
+        return _HTTP_ParseNoFile(pHttpCon);
+    }
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+#if (_TCPIP_HTTP_NET_ACCESS_LOG_DUMP != 0)
+    if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_GET && strcmp((char*)pHttpCon->httpData + 1, TCPIP_HTTP_NET_ACCESS_LOG_URI) == 0)
+    {   // access log dump: there's no file to open
+        pHttpCon->flags.logDump = 1;
+        return _HTTP_ParseNoFile(pHttpCon);
+    }
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG_DUMP != 0)
+#if (_TCPIP_HTTP_NET_ROUTER != 0)
+    _HTTP_RouteResolve(pHttpCon, (char*)pHttpCon->httpData + 1);
+    if(pHttpCon->routeIx != 0 && (httpRoutes[pHttpCon->routeIx - 1].routeFlags & TCPIP_HTTP_NET_ROUTE_FLAG_VIRTUAL) != 0)
+    {   // virtual route: there's no file to open
+        return _HTTP_ParseNoFile(pHttpCon);
+    }
+#endif  // (_TCPIP_HTTP_NET_ROUTER != 0)
 
-    chunkRes = _HTTP_ProcessChunks(pHttpCon);
+    // Decode may have changed the string length - update it here
+    lenB = strlen((char*)pHttpCon->httpData);
 
-    if(chunkRes == TCPIP_HTTP_CHUNK_RES_WAIT)
-    {   // need a break; wait here
-        *pWait = true;
-        return TCPIP_HTTP_CONN_STATE_SERVE_CHUNKS;
-    }
+#if (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+    // check for a previous resolution of this URI
+    uriLen = lenB - 1;
+    uriHash = fnv_32_hash(pHttpCon->httpData + 1, uriLen);
+    pPath = _HTTP_PathCacheFind((char*)pHttpCon->httpData + 1, uriLen, uriHash);
+    if(pPath != 0)
+    {
+        httpPathCacheHits++;
+        if((pPath->pathFlags & TCPIP_HTTP_PATH_FLAG_NOT_FOUND) != 0)
+        {   // no need to search the file system again
+            isResolved = true;
+        }
+        else
+        {
+            if((pPath->pathFlags & TCPIP_HTTP_PATH_FLAG_DEFAULT) != 0)
+            {
+                _HTTP_DefaultFileAdd(pHttpCon, lenB);
+            }
 
-    if(chunkRes == TCPIP_HTTP_CHUNK_RES_OK || chunkRes < 0)
-    {   // either continue or some error occurred; try another chunk
-        return TCPIP_HTTP_CONN_STATE_SERVE_CHUNKS;
+            if((isOpen = _HTTP_ConnFileOpen(pHttpCon, (char *)&pHttpCon->httpData[1])))
+            {
+                isResolved = true;
+            }
+            else
+            {   // the file is gone; resolve the URI again
+                pPath->uriLen = 0;
+                pHttpCon->httpData[lenB] = 0;
+            }
+        }
     }
+#endif  // (_TCPIP_HTTP_NET_PATH_CACHE != 0)
 
-    // done processing chunks
-    return TCPIP_HTTP_CONN_STATE_SERVE_CHUNKS + 1;
-}
-
+    if(!isResolved)
+    {
+        // If the last character is a not a directory delimiter, then try to open the file
+        // String starts at 2nd character, because the first is always a '/'
+        if(pHttpCon->httpData[lenB-1] != '/')
+        {
+            isOpen = _HTTP_ConnFileOpen(pHttpCon, (char *)&pHttpCon->httpData[1]);
+        }
 
-// process HTTP disconnect state: TCPIP_HTTP_CONN_STATE_DONE
-// returns the next connection state:
-// also signals if waiting for resources
-static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessDone(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
-{
-    if(httpNonPersistentConn == false)
-    {  // keep connection open; Make sure any opened files are closed
-        if(pHttpCon->file != SYS_FS_HANDLE_INVALID)
+#if (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+        httpPathCacheMisses++;
+        if(isOpen)
         {
-            (*httpFileShell->fileClose)(httpFileShell, pHttpCon->file);
-            _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_CLOSE, pHttpCon->fileName);
-            pHttpCon->file = SYS_FS_HANDLE_INVALID;
+            _HTTP_PathCacheAdd((char*)pHttpCon->httpData + 1, uriLen, uriHash, 0);
         }
-        *pWait = true;
-        return TCPIP_HTTP_CONN_STATE_IDLE;
-    }
+#endif  // (_TCPIP_HTTP_NET_PATH_CACHE != 0)
 
-    // else nonpersistent: disconnect
-    pHttpCon->closeEvent = TCPIP_HTTP_NET_EVENT_CLOSE_DONE;
-    return TCPIP_HTTP_CONN_STATE_DISCONNECT;
-}
+        // If the open fails, then add our default name and try again
+        if(!isOpen)
+        {
+            _HTTP_DefaultFileAdd(pHttpCon, lenB);
 
+            // Try to open again
+            isOpen = _HTTP_ConnFileOpen(pHttpCon, (char *)&pHttpCon->httpData[1]);
+#if (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+            // the URI chars are not changed by the default name addition
+            _HTTP_PathCacheAdd((char*)pHttpCon->httpData + 1, uriLen, uriHash, isOpen ? TCPIP_HTTP_PATH_FLAG_DEFAULT : TCPIP_HTTP_PATH_FLAG_NOT_FOUND);
+#endif  // (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+        }
+    }
 
-// clean ups the connection data and disconnects the socket
-// it also discards the socket RX data as instructed by discardType:
-//     - TCPIP_HTTP_DISCARD_NOT         - no discard done
-//     - TCPIP_HTTP_DISCARD_WAIT_DISCON - discard if disconnect successful
-//     - TCPIP_HTTP_DISCARD_WAIT_NOT    - discard anyway
-// returns the disconnect operation result
-static bool _HTTP_ConnCleanDisconnect(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_DISCARD_TYPE discardType)
-{
-    // Make sure any opened files are closed
-    if(pHttpCon->file != SYS_FS_HANDLE_INVALID)
-    {
-        (*httpFileShell->fileClose)(httpFileShell, pHttpCon->file);
-        _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_CLOSE, pHttpCon->fileName);
-        pHttpCon->file = SYS_FS_HANDLE_INVALID;
+    if(!isOpen)
+    {   // failed
+        _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_OPEN_ERROR, pHttpCon->httpData + 1);
+        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_NOT_FOUND;
+        pHttpCon->flags.requestError = 1;
+        return TCPIP_HTTP_CONN_STATE_PARSE_HEADERS;
     }
 
-    // purge all pending chunks
-    TCPIP_HTTP_CHUNK_DCPT* pChDcpt;
-    while((pChDcpt = (TCPIP_HTTP_CHUNK_DCPT*)pHttpCon->chunkList.head) != 0)
+    _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_OPEN, pHttpCon->httpData + 1);
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+    _HTTP_LogStamp(pHttpCon, TCPIP_HTTP_NET_LOG_STAGE_FILE_OPEN);
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+    if(strlen((char*)pHttpCon->httpData + 1) > SYS_FS_FILE_NAME_LEN)
     {
-        _HTTP_FreeChunk(pHttpCon, pChDcpt);
-    } 
+        _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_NAME_SIZE_ERROR, pHttpCon->httpData + 1);
+    }
+    if(!_HTTP_FileNameSet(pHttpCon, (char*)pHttpCon->httpData + 1))
+    {   // out of memory; the file is closed when the request is done
+        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_INTERNAL_SERVER_ERROR;
+        pHttpCon->flags.requestError = 1;
+        return TCPIP_HTTP_CONN_STATE_PARSE_HEADERS;
+    }
 
-    bool disconRes;
-    if((disconRes = NET_PRES_SocketDisconnect(pHttpCon->socket)) == true)
-    {
-        pHttpCon->flags.sktLocalReset = 1;
-        pHttpCon->flags.sktIsConnected = 0;
+#if (_TCPIP_HTTP_NET_ROUTER != 0)
+    if(strlen(pHttpCon->fileName) != lenB - 1)
+    {   // the default file was added; the route is by the file name
+        _HTTP_RouteResolve(pHttpCon, pHttpCon->fileName);
     }
+#endif  // (_TCPIP_HTTP_NET_ROUTER != 0)
 
-    if(discardType != TCPIP_HTTP_DISCARD_NOT)
-    {
-        if(disconRes == true || discardType == TCPIP_HTTP_DISCARD_WAIT_NOT)
-        {
-            NET_PRES_SocketDiscard(pHttpCon->socket);
-        }
+#if (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
+    pHttpCon->fileHash = fnv_32_hash(pHttpCon->fileName, strlen(pHttpCon->fileName));
+    if(!_HTTP_HeaderCacheLoad(pHttpCon))
+    {   // first time the file is opened: get the file info and build its header block
+        _HTTP_FileInfoGet(pHttpCon);
+        _HTTP_HeaderCacheAdd(pHttpCon);
     }
+#else
+    _HTTP_FileInfoGet(pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
 
-    return disconRes;
-}
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+    if(pHttpCon->file != SYS_FS_HANDLE_INVALID && pHttpCon->flags.fileDynamic == 0)
+    {   // keep a small static file in RAM for the next requests
+        _HTTP_FileCacheAdd(pHttpCon);
+    }
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
 
-// process HTTP error state: TCPIP_HTTP_CONN_STATE_ERROR
-// returns the next connection state:
-// also signals if waiting for resources
-static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessError(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
-{
+    // Perform first round authentication (pass file name only)
+#if defined(TCPIP_HTTP_NET_USE_AUTHENTICATION)
+    if(httpUserCback && httpUserCback->fileAuthenticate)
+    {
+        pHttpCon->isAuthorized = (*httpUserCback->fileAuthenticate)(pHttpCon, pHttpCon->fileName, httpUserCback);
+    }
+    else
+    {
+        pHttpCon->isAuthorized = 0;
+    }
+#endif
 
-    _HTTP_ConnCleanDisconnect(pHttpCon, pHttpCon->flags.discardRxBuff != 0 ? TCPIP_HTTP_DISCARD_WAIT_NOT : TCPIP_HTTP_DISCARD_NOT);
-    _HTTP_Report_ConnectionEvent(pHttpCon, (TCPIP_HTTP_NET_EVENT_TYPE)pHttpCon->closeEvent, 0);
+    return TCPIP_HTTP_CONN_STATE_PARSE_FILE_OPEN + 1;   // advance
 
-    *pWait = true;
-    return TCPIP_HTTP_CONN_STATE_IDLE;
 }
 
-// process non-persistent HTTP disconnect state: TCPIP_HTTP_CONN_STATE_DISCONNECT
-// persistent connection gets here only if timeout
-// returns the next connection state: TCPIP_HTTP_CONN_STATE_IDLE
+// parse HTTP GET arguments: TCPIP_HTTP_CONN_STATE_PARSE_GET_ARGS
+// returns the next connection state
 // also signals if waiting for resources
-static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessDisconnect(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+// Uses the file name in pHttpCon->httpData!
+// Uses the query string left in pHttpCon->lineBuff
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ParseGetArgs(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
 {
-    *pWait = true;
+    uint16_t lenA;
 
-    bool disconRes = _HTTP_ConnCleanDisconnect(pHttpCon, TCPIP_HTTP_DISCARD_WAIT_DISCON);
-
-    if(disconRes)
+    // Copy GET args, up to buffer size - 1
+    lenA = strlen(pHttpCon->lineBuff);
+    if(lenA != 0)
     {
-        _HTTP_Report_ConnectionEvent(pHttpCon, (TCPIP_HTTP_NET_EVENT_TYPE)pHttpCon->closeEvent, 0);
-        return TCPIP_HTTP_CONN_STATE_IDLE;
+        pHttpCon->hasArgs = 1;
+
+        // Verify there's enough space
+        if(lenA >= httpConnDataSize - 2)
+        {
+            pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_OVERFLOW;
+            pHttpCon->flags.requestError = 1;
+            return TCPIP_HTTP_CONN_STATE_PARSE_HEADERS;
+        }
+
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+        // the rendered snapshots are per query string
+        pHttpCon->queryHash = fnv_32_hash(pHttpCon->lineBuff, lenA);
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+
+        // Copy the arguments and '&'-terminate in anticipation of cookies
+        memcpy(pHttpCon->ptrData, pHttpCon->lineBuff, lenA);
+        pHttpCon->ptrData += lenA;
+        *(pHttpCon->ptrData++) = '&';
     }
 
-    // else retry next time
-    return TCPIP_HTTP_CONN_STATE_DISCONNECT;
+    // Move to parsing the headers
+    return TCPIP_HTTP_CONN_STATE_PARSE_GET_ARGS + 1;    // advance
+
 }
 
-static int _HTTP_HeaderMsg_Print(char* buffer, size_t bufferSize, const char* fmt, ...)
+    
+// parse HTTP headers state: TCPIP_HTTP_CONN_STATE_PARSE_HEADERS 
+// returns the next connection state
+// also signals if waiting for resources
+// if requestError == 1, it eats up the header fields only
+// it can set requestError by itself
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ParseHeaders(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
 {
-    int nChars;
-    va_list args = {0};
+    int ix, lineLen;
+    char* pValue;
+    char valStart;
+    bool parseFail;
 
-    va_start( args, fmt );
-    nChars = vsnprintf(buffer, bufferSize, fmt, args);
-    va_end( args );
+    // Loop over all the headers
+    while(1)
+    {
+        // Get the next line
+        lineLen = _HTTP_LineGet(pHttpCon);
+        if(lineLen == TCPIP_HTTP_LINE_RES_WAIT)
+        {   // not here yet
+            if((int32_t)(SYS_TMR_TickCountGet() - pHttpCon->httpTick) > 0)
+            {   // A timeout has occured
+                pHttpCon->flags.discardRxBuff = 1;
+                pHttpCon->closeEvent = TCPIP_HTTP_NET_EVENT_CLOSE_TIMEOUT;
+                return TCPIP_HTTP_CONN_STATE_ERROR;
+            }
 
-    if(nChars >= 0)
-    {   // successful
-        if(nChars >= bufferSize)
-        {   // exceeded
-            nChars = bufferSize - 1;
+            // wait some more
+            *pWait = true;
+            return TCPIP_HTTP_CONN_STATE_PARSE_HEADERS;
         }
-        return nChars;
-    }
 
-    return 0;
-}
+        // Reset the watchdog timer
+        pHttpCon->httpTick = SYS_TMR_TickCountGet() + TCPIP_HTTP_NET_TIMEOUT * SYS_TMR_TickCounterFrequencyGet();
 
+        // If the line is empty, then headers are done
+        if(lineLen == 0)
+        {   // move to next state; the line buffer is no longer needed
+            _HTTP_LineBuffRelease(pHttpCon);
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+            _HTTP_LogStamp(pHttpCon, TCPIP_HTTP_NET_LOG_STAGE_HEADERS);
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+            return (pHttpCon->flags.requestError == 1) ? TCPIP_HTTP_CONN_STATE_SERVE_HEADERS : TCPIP_HTTP_CONN_STATE_PARSE_HEADERS + 1; // advance
+        }
 
+        if(pHttpCon->flags.requestError == 1)
+        {   // in error mode: the line is already discarded
+            continue;
+        }
 
+        if(lineLen == TCPIP_HTTP_LINE_RES_LONG)
+        {   // header line too long, already discarded; it could be one that's needed
+            // the rest of the headers is read, then the error is sent
+            pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_BAD_REQUEST;
+            pHttpCon->flags.requestError = 1;
+            pHttpCon->flags.pipeBreak = 1;
+            continue;
+        }
 
-// outputs a response message from the HTTPResponseMessages
-// used for messages without parameters
-static int _HTTP_HeaderMsg_Generic(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer, size_t bufferSize)
-{
+        // Find the header name
+        pValue = strchr(pHttpCon->lineBuff, ':');
 
-    const char* msg = HTTPResponseMessages[pHttpCon->httpStatus];
+        // If name is too long or this line isn't a header, ignore it
+        if(pValue == 0 || pValue - pHttpCon->lineBuff + 1 > TCPIP_HTTP_NET_MAX_HEADER_LEN)
+        {
+            continue;
+        }
 
-    return msg ? _HTTP_HeaderMsg_Print(buffer, bufferSize, msg) : 0;
-}
+        // terminate the name, including the ':'
+        pValue++;
+        valStart = *pValue;
+        *pValue = '\0';
 
-static int _HTTP_HeaderMsg_NotFound(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer, size_t bufferSize)
-{
-    const char* msg;
+        // Compare header read to ones we're interested in
+        parseFail = false;
+        for(ix = 0; ix < sizeof(HTTPRequestHeaders)/sizeof(HTTPRequestHeaders[0]); ix++)
+        {
+            if(stricmp(pHttpCon->lineBuff, (const char *)HTTPRequestHeaders[ix]) == 0)
+            {   // Parse the header and stop the loop
+                *pValue = valStart;
+                parseFail = _HTTP_HeaderParseLookup(pHttpCon, ix, pValue + strspn(pValue, " ")) == false;
+                break;
+            }
+        }
 
-#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
-    msg = "\r\n404: File not found<br>Use <a href=\"/" TCPIP_HTTP_NET_FILE_UPLOAD_NAME "\">MPFS Upload</a> to program web pages\r\n";
-    return _HTTP_HeaderMsg_Print(buffer, bufferSize, msg);
-#else       
-    msg = "\r\n404: File: %s not found\r\n";
-    return _HTTP_HeaderMsg_Print(buffer, bufferSize, msg, pHttpCon->fileName);
-#endif
+        if(parseFail)
+        {   // signal the error
+            pHttpCon->flags.requestError = 1;
+        } 
+    }
 
 }
 
-static int _HTTP_HeaderMsg_Redirect(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer, size_t bufferSize)
-{
-    const char* msg = "\r\n304 Redirect: %s\r\n";
-    return _HTTP_HeaderMsg_Print(buffer, bufferSize, msg, (char*)pHttpCon->httpData);
-}
 
-#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
-static int _HTTP_HeaderMsg_UploadForm(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer, size_t bufferSize)
+// process the authenticate state: TCPIP_HTTP_CONN_STATE_AUTHENTICATE
+// returns the next connection state:
+// also signals if waiting for resources
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessAuthenticate(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
 {
-    const char* msg = "\r\n<html><body style=\"margin:100px\"><form method=post action=\"/%s\" enctype=\"multipart/form-data\"><b>FS Image Upload</b><p><input type=file name=i size=40> &nbsp; <input type=submit value=\"Upload\"></form></body></html>";
-    return _HTTP_HeaderMsg_Print(buffer, bufferSize, msg, pHttpCon->fileName);
-}
+    uint8_t hasArgs;
 
-static int _HTTP_HeaderMsg_UploadError(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer, size_t bufferSize)
-{
-    // TCPIP_HTTP_NET_STAT_UPLOAD_ERROR
-    const char* msg;
-    if(pHttpCon->flags.uploadMemError)
-    {
-        msg = "\r\n<html><body style=\"margin:100px\"><b>Upload Memory Allocation Error</b><p><a href=\"/%s \">Try again?</a></body></html>";
-    }
-    else
-    {
-        msg = "\r\n<html><body style=\"margin:100px\"><b>FS Image Corrupt or Wrong Version</b><p><a href=\"/%s \">Try again?</a></body></html>";
+#if defined(TCPIP_HTTP_NET_USE_AUTHENTICATION)
+#if (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+    if(pHttpCon->isAuthorized < 0x80 && pHttpCon->authCred[0] != 0)
+    {   // no session matched: check the credentials
+        _HTTP_AuthCredentialsCheck(pHttpCon, pHttpCon->authCred);
     }
-    return _HTTP_HeaderMsg_Print(buffer, bufferSize, msg, pHttpCon->fileName);
-}
+#endif  // (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
 
+    // Check current authorization state
+    if(pHttpCon->isAuthorized < 0x80)
+    {   // 401 error
+        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UNAUTHORIZED;
+        return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
+    }
 #endif
 
-uint8_t* TCPIP_HTTP_NET_URLDecode(uint8_t* cData)
-{
-    uint8_t *pRead, *pWrite;
-    uint16_t wLen;
-    uint8_t c;
-    uint16_t hex;
-
-    // Determine length of input
-    wLen = strlen((char*)cData);
-
-    // Read all characters in the string
-    for(pRead = pWrite = cData; wLen != 0u; )
-    {
-        c = *pRead++;
-        wLen--;
+    // Parse the args string
+    *pHttpCon->ptrData = '\0';
+    pHttpCon->ptrData = TCPIP_HTTP_NET_URLDecode(pHttpCon->httpData);
 
-        if(c == '=' || c == '&')
-        {
-            *pWrite++ = '\0';
-        }
-        else if(c == '+')
-        {
-            *pWrite++ = ' ';
-        }
-        else if(c == '%')
-        {
-            if(wLen < 2u)
-            {
-                wLen = 0;
-            }
-            else
-            {
-                ((uint8_t*)&hex)[1] = *pRead++;
-                ((uint8_t*)&hex)[0] = *pRead++;
-                wLen--;
-                wLen--;
-                *pWrite++ = hexatob(hex);
-            }
-        }
-        else
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+    if(pHttpCon->wsDcpt != 0)
+    {   // WebSocket endpoint: a valid handshake is needed; no GET processing
+        if(pHttpCon->wsDcpt->upgrade == 0 || pHttpCon->wsDcpt->acceptKey[0] == 0)
         {
-            *pWrite++ = c;
+            pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_BAD_REQUEST;
+            pHttpCon->flags.requestError = 1;
         }
+        pHttpCon->hasArgs = 0;
+        return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
     }
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
 
-    // Double null terminate the last value
-    *pWrite++ = '\0';
-    *pWrite = '\0';
+    // If this is an upload form request, bypass to headers
+#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+    if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_UPLOAD_FORM)
+    {
+        return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
+    }
+#endif
 
-    return pWrite;
-}
+    hasArgs = pHttpCon->hasArgs;
+    pHttpCon->hasArgs = 0;
 
-const uint8_t* TCPIP_HTTP_NET_ArgGet(const uint8_t* cData, const uint8_t* cArg)
-{
-    // Search through the array while bytes remain
-    while(*cData != '\0')
-    { 
-        // Look for arg at current position
-        if(!strcmp((const char*)cArg, (const char*)cData))
-        {   // Found it, so return parameter
-            return cData + strlen((const char*)cArg) + 1;
-        }
+#if defined(TCPIP_HTTP_NET_USE_CONDITIONAL_GET)
+    // a plain GET of a file that the client already has: skip the file processing
+    if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_GET && hasArgs == 0 && pHttpCon->flags.condMatch != 0)
+    {
+        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_NOT_MODIFIED;
+        return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
+    }
+#endif  // defined(TCPIP_HTTP_NET_USE_CONDITIONAL_GET)
 
-        // Skip past two strings (NUL bytes)
-        cData += strlen((const char*)cData) + 1;
-        cData += strlen((const char*)cData) + 1;
+#if defined(TCPIP_HTTP_NET_USE_RANGES)
+    // a byte range applies only to a plain GET with a matching If-Range, if any
+    if(pHttpCon->httpStatus != TCPIP_HTTP_NET_STAT_GET || hasArgs != 0 || pHttpCon->flags.rangeIfFail != 0)
+    {   // send the whole file
+        pHttpCon->flags.rangeReq = 0;
+        pHttpCon->flags.rangeBad = 0;
+    }
+    else if(pHttpCon->flags.rangeBad != 0)
+    {
+        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_RANGE_NOT_SATISFIABLE;
+        return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
     }
+#endif  // defined(TCPIP_HTTP_NET_USE_RANGES)
 
-    // Return NULL if not found
-    return NULL;
+#if (_TCPIP_HTTP_NET_ROUTER != 0)
+    if(pHttpCon->routeIx != 0 && pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_GET)
+    {   // a GET route handler is called even without arguments
+        return TCPIP_HTTP_CONN_STATE_PROCESS_GET;
+    }
+#endif  // (_TCPIP_HTTP_NET_ROUTER != 0)
+
+    // Move on to GET args, unless there are none
+    return (hasArgs != 0) ? TCPIP_HTTP_CONN_STATE_PROCESS_GET : TCPIP_HTTP_CONN_STATE_PROCESS_POST;
 }
 
 
-#if defined(TCPIP_HTTP_NET_USE_POST)
-TCPIP_HTTP_NET_READ_STATUS TCPIP_HTTP_NET_ConnectionPostNameRead(TCPIP_HTTP_NET_CONN_HANDLE connHandle, uint8_t* cData, uint16_t wLen)
-{
-    TCPIP_HTTP_NET_READ_STATUS status;
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
 
-    status = _HTTP_ReadTo(pHttpCon, '=', cData, wLen);
+// process the GET state: TCPIP_HTTP_CONN_STATE_PROCESS_GET
+// returns the next connection state:
+// also signals if waiting for resources
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessGet(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+{
+    TCPIP_HTTP_NET_IO_RESULT ioRes = TCPIP_HTTP_NET_IO_RES_DONE;
 
-    // Decode the data (if not reading to null or blank) and return
-    if(cData && *cData)
+#if (_TCPIP_HTTP_NET_ROUTER != 0)
+    if(pHttpCon->routeIx != 0 && pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_GET)
+    {   // the route resolved when the file was opened
+        TCPIP_HTTP_ROUTE_ENTRY* pRoute = httpRoutes + pHttpCon->routeIx - 1;
+        ioRes = (*pRoute->handler)(pHttpCon, pRoute->routeParam);
+    }
+    else
+#endif  // (_TCPIP_HTTP_NET_ROUTER != 0)
+    // Run the application callback TCPIP_HTTP_NET_ConnectionGetExecute()
+    if(httpUserCback && httpUserCback->getExecute)
     {
-        TCPIP_HTTP_NET_URLDecode(cData);
+        ioRes = (*httpUserCback->getExecute)(pHttpCon, httpUserCback);
     }
-    return status;
-}   
-#endif
 
-#if defined(TCPIP_HTTP_NET_USE_POST)
-TCPIP_HTTP_NET_READ_STATUS TCPIP_HTTP_NET_ConnectionPostValueRead(TCPIP_HTTP_NET_CONN_HANDLE connHandle, uint8_t* cData, uint16_t wLen)
-{
-    TCPIP_HTTP_NET_READ_STATUS status;
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    if(ioRes == TCPIP_HTTP_NET_IO_RES_WAITING)
+    {   // If waiting for asynchronous process, return to main app
+        *pWait = true;
+        return TCPIP_HTTP_CONN_STATE_PROCESS_GET;   // stay  here
+    }
 
-    // Try to read the value
-    status = _HTTP_ReadTo(pHttpCon, '&', cData, wLen);
+    // Move on to POST data
+    return TCPIP_HTTP_CONN_STATE_PROCESS_GET + 1;    // advance
 
-    // If read was incomplete, check if we're at the end
-    if(status == TCPIP_HTTP_NET_READ_INCOMPLETE)
-    {
-        // If all data has arrived, read all remaining data
-        if(pHttpCon->byteCount == NET_PRES_SocketReadIsReady(pHttpCon->socket))
-        {
-            status = _HTTP_ReadTo(pHttpCon, '\0', cData, wLen);
-        }
-    }
+}
 
-    // Decode the data (if not reading to null or blank) and return
-    if(cData && *cData)
+
+// process the POST state: TCPIP_HTTP_CONN_STATE_PROCESS_POST
+// returns the next connection state:
+// also signals if waiting for resources
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessPost(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+{
+
+#if defined(TCPIP_HTTP_NET_USE_POST)
+    TCPIP_HTTP_NET_IO_RESULT    ioRes;
+
+    // See if we have any new data
+    if(NET_PRES_SocketReadIsReady(pHttpCon->socket) == pHttpCon->callbackPos)
     {
-        TCPIP_HTTP_NET_URLDecode(cData);
+        if((int32_t)(SYS_TMR_TickCountGet() - pHttpCon->httpTick) > 0)
+        {   // If a timeout has occured, disconnect
+            pHttpCon->closeEvent = TCPIP_HTTP_NET_EVENT_CLOSE_TIMEOUT;
+            return TCPIP_HTTP_CONN_STATE_ERROR;
+        }
     }
-    return status;
-}   
-#endif
 
-/*****************************************************************************
-  Function:
-    static TCPIP_HTTP_NET_READ_STATUS _HTTP_ReadTo(TCPIP_HTTP_NET_CONN* pHttpCon, uint8_t cDelim, uint8_t* cData, uint16_t wLen)
+#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+    if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_POST || (pHttpCon->httpStatus >= TCPIP_HTTP_NET_STAT_UPLOAD_STARTED && pHttpCon->httpStatus <= TCPIP_HTTP_NET_STAT_UPLOAD_BUSY))
+#else
+        if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_POST)
+#endif
+        {
+            // Run the application callback TCPIP_HTTP_NET_ConnectionPostExecute()
+#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+            if(pHttpCon->httpStatus >= TCPIP_HTTP_NET_STAT_UPLOAD_STARTED && pHttpCon->httpStatus <= TCPIP_HTTP_NET_STAT_UPLOAD_BUSY)
+            {
+                ioRes = TCPIP_HTTP_NET_FSUpload(pHttpCon);
+            }
+            else
+#endif  // defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+            {
+#if (_TCPIP_HTTP_NET_ROUTER != 0)
+                if(pHttpCon->routeIx != 0)
+                {   // the route resolved when the file was opened
+                    TCPIP_HTTP_ROUTE_ENTRY* pRoute = httpRoutes + pHttpCon->routeIx - 1;
+                    ioRes = (*pRoute->handler)(pHttpCon, pRoute->routeParam);
+                }
+                else
+#endif  // (_TCPIP_HTTP_NET_ROUTER != 0)
+                if(httpUserCback && httpUserCback->postExecute)
+                {
+                    ioRes = (*httpUserCback->postExecute)(pHttpCon, httpUserCback);
+                }
+                else
+                {
+                    ioRes = TCPIP_HTTP_NET_IO_RES_DONE;
+                }
+            }
 
-  Summary:
-    Reads to a buffer until a specified delimiter character.
+            // If waiting for asynchronous process, return to main app
+            if(ioRes == TCPIP_HTTP_NET_IO_RES_WAITING)
+            {   // return to main app and make sure we don't get stuck by the watchdog
+                pHttpCon->callbackPos = NET_PRES_SocketReadIsReady(pHttpCon->socket) - 1;
+                *pWait = true;
+                return TCPIP_HTTP_CONN_STATE_PROCESS_POST;  // wait
+            }
+            else if(ioRes == TCPIP_HTTP_NET_IO_RES_NEED_DATA)
+            {   // If waiting for more data
+                pHttpCon->callbackPos = NET_PRES_SocketReadIsReady(pHttpCon->socket);
+                pHttpCon->httpTick = SYS_TMR_TickCountGet() + TCPIP_HTTP_NET_TIMEOUT * SYS_TMR_TickCounterFrequencyGet();
 
-  Description:
-    Reads from the TCP buffer to cData until either cDelim is reached, or
-    until wLen - 2 bytes have been read.  The value read is saved to cData and 
-    null terminated.  (wLen - 2 is used so that the value can be passed to
-    TCPIP_HTTP_NET_URLDecode later, which requires a null terminator plus one extra free
-    byte.)
-    
-    The delimiter character is removed from the buffer, but not saved to 
-    cData. If all data cannot fit into cData, it will still be removed from 
-    the buffer but will not be saved anywhere.
+                // If more is expected and space is available, return to main app
+                if(pHttpCon->byteCount > pHttpCon->callbackPos && _HTTP_SktFifoRxFree(pHttpCon->socket) != 0)
+                {
+                    *pWait = true;
+                    return TCPIP_HTTP_CONN_STATE_PROCESS_POST;  // wait
+                }
 
-    This function properly updates pHttpCon->byteCount by decrementing it
-    by the number of bytes read. 
+                // Handle cases where application ran out of data or buffer space
+                pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_INTERNAL_SERVER_ERROR;
+                return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;  // error
+            }
+            else if(ioRes == TCPIP_HTTP_NET_IO_RES_ERROR)
+            {   // some error, abort
+                pHttpCon->closeEvent = TCPIP_HTTP_NET_EVENT_CLOSE_POST_ERROR;
+                return TCPIP_HTTP_CONN_STATE_ERROR;
+            }
 
-  Precondition:
-    None
+            // else TCPIP_HTTP_NET_IO_RES_DONE and move on; discard whatever the buffer may contain
+#if (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+            _HTTP_FormRelease(pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+#if (_TCPIP_HTTP_NET_PIPELINE != 0)
+            // only the rest of this body: a pipelined request may follow
+            _HTTP_BodySkip(pHttpCon, pHttpCon->byteCount);
+            pHttpCon->byteCount = 0;
+#else
+            NET_PRES_SocketDiscard(pHttpCon->socket);
+#endif  // (_TCPIP_HTTP_NET_PIPELINE != 0)
+            return TCPIP_HTTP_CONN_STATE_PROCESS_POST + 1;  // advance
+        }
+#endif
+    // We're done with POST
+    return TCPIP_HTTP_CONN_STATE_PROCESS_POST + 1;  // advance
+}
 
-  Parameters:
-    cDelim - the character at which to stop reading, or NULL to read to
-             the end of the buffer
-    cData - where to store the data being read
-    wLen - how many bytes can be written to cData
 
-  Return Values:
-    TCPIP_HTTP_NET_READ_OK - data was successfully read
-    TCPIP_HTTP_NET_READ_TRUNCTATED - entire data could not fit in the buffer, so the
-                            data was truncated and data has been lost
-    TCPIP_HTTP_NET_READ_INCOMPLETE - delimiter character was not found
-  ***************************************************************************/
-#if defined(TCPIP_HTTP_NET_USE_POST)
-static TCPIP_HTTP_NET_READ_STATUS _HTTP_ReadTo(TCPIP_HTTP_NET_CONN* pHttpCon, uint8_t cDelim, uint8_t* cData, uint16_t wLen)
+// process the serve connection headers state: TCPIP_HTTP_CONN_STATE_SERVE_HEADERS
+// returns the next connection state:
+// also signals if waiting for resources
+// Note: all the previous parsing states should branch here after parsing the headers
+// when an error detected // (except timeouts/file errors that go to TCPIP_HTTP_CONN_STATE_ERROR)!
+// Processing should get here with all headers processed!
+//
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ServeHeaders(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
 {
-    TCPIP_HTTP_NET_READ_STATUS status;
-    uint16_t wPos;
+    bool isConnDone;
+    int  headerLen, responseLen, contentLen;
+    const char* hdrBlock;
+    char contentLenBuffer[40];
+    char responseBuffer[TCPIP_HTTP_NET_RESPONSE_BUFFER_SIZE];
 
-    // Either look for delimiter, or read all available data
-    if(cDelim)
-    {
-        wPos = _HTTP_ConnectionCharFind(pHttpCon, cDelim, 0, 0);
+
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+    if(pHttpCon->wsDcpt != 0 && pHttpCon->flags.requestError == 0 && pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_GET)
+    {   // WebSocket handshake: the connection switches protocols
+        headerLen = sprintf(responseBuffer, TCPIP_HTTP_WS_HANDSHAKE "%s\r\n\r\n", pHttpCon->wsDcpt->acceptKey);
+        if(!_HTTP_DataTryOutput(pHttpCon, responseBuffer, headerLen, 0))
+        {   // not enough room to send data; wait some more
+            *pWait = true;
+            return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
+        }
+        NET_PRES_SocketFlush(pHttpCon->socket);
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+        _HTTP_LogStamp(pHttpCon, TCPIP_HTTP_NET_LOG_STAGE_FIRST_BYTE);
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+
+        pHttpCon->wsDcpt->isOpen = 1;
+        if(httpWsEndpoints[pHttpCon->wsDcpt->epIx].handler != 0)
+        {
+            (*httpWsEndpoints[pHttpCon->wsDcpt->epIx].handler)(pHttpCon, TCPIP_HTTP_NET_WS_EVENT_OPEN, 0, 0);
+        }
+        // process the frames that may be already here
+        return TCPIP_HTTP_CONN_STATE_WEBSOCKET;
     }
-    else
-    {
-        wPos = NET_PRES_SocketReadIsReady(pHttpCon->socket);
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+
+    if(pHttpCon->flags.procPhase == 0)
+    {   // output headers now; Send header corresponding to the current state
+#if (_TCPIP_HTTP_NET_ROUTER != 0)
+        if(pHttpCon->routeIx != 0 && (httpRoutes[pHttpCon->routeIx - 1].routeFlags & TCPIP_HTTP_NET_ROUTE_FLAG_VIRTUAL) != 0 && pHttpCon->flags.requestError == 0)
+        {   // a virtual route has no message body
+            if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_GET || pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_POST)
+            {
+                pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_NO_CONTENT;
+            }
+        }
+#endif  // (_TCPIP_HTTP_NET_ROUTER != 0)
+#if defined(TCPIP_HTTP_NET_USE_RANGES)
+        if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_GET && pHttpCon->flags.rangeReq != 0)
+        {   // partial content: the status line and the range sent
+            headerLen = sprintf(responseBuffer, TCPIP_HTTP_NET_HEADER_PREFIX "206 Partial Content\r\nContent-Range: bytes %lu-%lu/%lu\r\n",
+                    (unsigned long)pHttpCon->rangeStart, (unsigned long)pHttpCon->rangeEnd, (unsigned long)pHttpCon->fileSize);
+        }
+        else
+#endif  // defined(TCPIP_HTTP_NET_USE_RANGES)
+        {
+            headerLen = sprintf(responseBuffer, TCPIP_HTTP_NET_HEADER_PREFIX "%s", HTTPResponseHeaders[pHttpCon->httpStatus]);
+        }
+        if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_REDIRECT)
+        {   // special case here, this header message takes arguments; 
+            headerLen += sprintf(responseBuffer + headerLen, "%s \r\n", (char*)pHttpCon->httpData);
+        }
+#if defined(TCPIP_HTTP_NET_USE_RANGES)
+        else if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_RANGE_NOT_SATISFIABLE)
+        {   // the current length of the file
+            headerLen += sprintf(responseBuffer + headerLen, "Content-Range: bytes */%lu\r\n", (unsigned long)pHttpCon->fileSize);
+        }
+#endif  // defined(TCPIP_HTTP_NET_USE_RANGES)
+
+        if(httpNonPersistentConn)
+        {
+            headerLen += sprintf(responseBuffer + headerLen, "Connection: close\r\n");
+        }
+#if (_TCPIP_HTTP_NET_PIPELINE != 0)
+        else if(pHttpCon->flags.pipeBreak != 0)
+        {   // closed after this response
+            headerLen += sprintf(responseBuffer + headerLen, "Connection: close\r\n");
+        }
+#endif  // (_TCPIP_HTTP_NET_PIPELINE != 0)
+
+#if (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+        if(pHttpCon->flags.sessionNew != 0 && pHttpCon->flags.requestError == 0)
+        {   // the next requests use the session token
+            headerLen += _HTTP_SessionIssue(pHttpCon, responseBuffer + headerLen);
+            pHttpCon->flags.sessionNew = 0;
+        }
+#endif  // (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+
+#if defined(TCPIP_HTTP_NET_USE_CONDITIONAL_GET)
+        if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_NOT_MODIFIED)
+        {   // no message body: the validators and the cache policy end the response
+            headerLen += _HTTP_FileValidatorsPrint(pHttpCon, responseBuffer + headerLen);
+            headerLen += sprintf(responseBuffer + headerLen, "Cache-Control: max-age=" TCPIP_HTTP_NET_CACHE_LEN TCPIP_HTTP_NET_CRLF TCPIP_HTTP_NET_CRLF);
+        }
+#endif  // defined(TCPIP_HTTP_NET_USE_CONDITIONAL_GET)
+        if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_NO_CONTENT)
+        {   // no message body: end the headers
+            headerLen += sprintf(responseBuffer + headerLen, TCPIP_HTTP_NET_CRLF);
+        }
+
+        if(!_HTTP_DataTryOutput(pHttpCon, responseBuffer, headerLen, 0))
+        {   //  not enough room to send data; wait some more
+            *pWait = true;
+            return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
+        }
+        // success
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+        _HTTP_LogStamp(pHttpCon, TCPIP_HTTP_NET_LOG_STAGE_FIRST_BYTE);
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+        pHttpCon->flags.procPhase = 1;
     }
 
-    // If not found, return incomplete
-    if(wPos == 0xffff)
-    {
-        return TCPIP_HTTP_NET_READ_INCOMPLETE;
+    if(pHttpCon->flags.procPhase == 1)
+    {   // output content length now;
+        responseLen = 0;
+        // if error or not GET or POST, we're done and we don't output any message body
+        isConnDone = pHttpCon->flags.requestError != 0 || (pHttpCon->httpStatus != TCPIP_HTTP_NET_STAT_GET && pHttpCon->httpStatus != TCPIP_HTTP_NET_STAT_POST);
+        
+        if(HTTPResponseFunctions[pHttpCon->httpStatus] != 0)
+        {
+            responseLen = (*HTTPResponseFunctions[pHttpCon->httpStatus])(pHttpCon, responseBuffer, sizeof(responseBuffer));
+            if(responseLen != 0)
+            {
+                contentLen = sprintf(contentLenBuffer, "Content-Length: %d\r\n", responseLen);
+                if(!_HTTP_DataTryOutput(pHttpCon, contentLenBuffer, contentLen, contentLen + responseLen + isConnDone ? TCPIP_HTTP_NET_CRLF_LEN : 0))
+                {   // not enough room to send data; wait some more
+                    *pWait = true;
+                    return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
+                }
+                // this should succeed now
+                _HTTP_DataTryOutput(pHttpCon, responseBuffer, responseLen, 0);
+                if(isConnDone)
+                {
+                    _HTTP_DataTryOutput(pHttpCon, TCPIP_HTTP_NET_CRLF, TCPIP_HTTP_NET_CRLF_LEN, 0);
+                }
+                pHttpCon->flags.procPhase = 2;
+            }
+        }
+
+        if(isConnDone)
+        {   // no message body; we're done;
+#if (_TCPIP_HTTP_NET_PIPELINE != 0)
+            // the request body that was not processed
+            _HTTP_BodySkip(pHttpCon, pHttpCon->byteCount);
+            pHttpCon->byteCount = 0;
+#endif  // (_TCPIP_HTTP_NET_PIPELINE != 0)
+            pHttpCon->flags.procPhase = 0;    // clear our traces
+            return TCPIP_HTTP_CONN_STATE_DONE;
+        }
+        // continue
+        pHttpCon->flags.procPhase = 2;
     }
 
-    // Read the value
-    if(wLen < 2u && cData != NULL)
-    {   // Buffer is too small, so read to NULL instead
-        pHttpCon->byteCount -= _HTTP_ConnectionDiscard(pHttpCon, wPos);
-        status = TCPIP_HTTP_NET_READ_TRUNCATED;
+
+    // pHttpCon->flags.procPhase == 2;
+
+#if (_TCPIP_HTTP_NET_ACCESS_LOG_DUMP != 0)
+    if(pHttpCon->flags.logDump != 0)
+    {   // the log records are the message body
+        return _HTTP_LogDump(pHttpCon, pWait);
     }
-    else if(cData == NULL)
-    {   // Just remove the data
-        pHttpCon->byteCount -= _HTTP_ConnectionDiscard(pHttpCon, wPos);
-        status = TCPIP_HTTP_NET_READ_OK;
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG_DUMP != 0)
+
+#if (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+    if(pHttpCon->evChannel != 0)
+    {   // the events follow, until the client closes the connection
+        if(!_HTTP_DataTryOutput(pHttpCon, TCPIP_HTTP_EVENT_STREAM_HEADERS, sizeof(TCPIP_HTTP_EVENT_STREAM_HEADERS) - 1, 0))
+        {   // not enough room to send data; wait some more
+            *pWait = true;
+            return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
+        }
+        NET_PRES_SocketFlush(pHttpCon->socket);
+        pHttpCon->flags.procPhase = 0;
+        *pWait = true;
+        return TCPIP_HTTP_CONN_STATE_EVENT_STREAM;
     }
-    else if(wPos > wLen - 2)
-    {   // Read data, but truncate at max length
-        pHttpCon->byteCount -= NET_PRES_SocketRead(pHttpCon->socket, cData, wLen - 2);
-        pHttpCon->byteCount -= _HTTP_ConnectionDiscard(pHttpCon, wPos - (wLen - 2));
-        cData[wLen - 2] = '\0';
-        status = TCPIP_HTTP_NET_READ_TRUNCATED;
+#endif  // (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+
+    // process a GET or POST - something that will have a message body
+
+    // Output the content type, encoding, cache control and validators
+    hdrBlock = responseBuffer;
+#if (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
+    TCPIP_HTTP_HDR_ENTRY* pHdr = 0;
+    if(pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_GET)
+    {
+        uint32_t fStamp = 0;
+#if (_TCPIP_HTTP_NET_FILE_STAMP != 0)
+        // the validators of the block have to be those of the file being served
+        fStamp = pHttpCon->fileStamp;
+#endif  // (_TCPIP_HTTP_NET_FILE_STAMP != 0)
+        pHdr = _HTTP_HeaderCacheFind(pHttpCon, fStamp);
+    }
+
+    if(pHdr != 0)
+    {   // already built
+        hdrBlock = pHdr->hdrBlock;
+        responseLen = pHdr->hdrLen;
     }
     else
-    {   // Read the data normally
-        pHttpCon->byteCount -= NET_PRES_SocketRead(pHttpCon->socket, cData, wPos);
-        cData[wPos] = '\0';
-        status = TCPIP_HTTP_NET_READ_OK;
+#endif  // (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
+    {
+        responseLen = _HTTP_HeaderBlockPrint(pHttpCon, responseBuffer, pHttpCon->httpStatus == TCPIP_HTTP_NET_STAT_POST);
+    }
+
+    if(!_HTTP_DataTryOutput(pHttpCon, hdrBlock, responseLen, 0))
+    {   // not enough room to send data; wait some more
+        *pWait = true;
+        return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
+    }
+
+
+    // Check if we should output cookies
+    return (pHttpCon->hasArgs != 0) ? TCPIP_HTTP_CONN_STATE_SERVE_HEADERS + 1 : TCPIP_HTTP_CONN_STATE_SERVE_BODY_INIT;
+
+}
+
+
+// serve connection cookies state: TCPIP_HTTP_CONN_STATE_SERVE_COOKIES
+// returns the next connection state:
+// also signals if waiting for resources
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ServeCookies(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+{
+#if defined(TCPIP_HTTP_NET_USE_COOKIES)
+    uint8_t c;
+    char*   pBuff;
+    char    cookieBuffer[TCPIP_HTTP_NET_COOKIE_BUFFER_SIZE];
+    
+
+    // Write cookies one at a time as space permits
+    for(pHttpCon->ptrRead = pHttpCon->httpData; pHttpCon->hasArgs != 0; pHttpCon->hasArgs--)
+    {
+        // Write the header
+        strcpy(cookieBuffer, "Set-Cookie: ");
+        pBuff = cookieBuffer + strlen(cookieBuffer);
+
+        // Write the name, URL encoded, one character at a time
+        while((c = *(pHttpCon->ptrRead++)))
+        {
+            if(c == ' ')
+            {
+                *pBuff++ = '+';
+            }
+            else if(c < '0' || (c > '9' && c < 'A') || (c > 'Z' && c < 'a') || c > 'z')
+            {
+                *pBuff++ = '%';
+                *pBuff++ = btohexa_high(c);
+                *pBuff++ = btohexa_low(c);
+            }
+            else
+            {
+                *pBuff++ = c;
+            }
+        }
+
+        *pBuff++ = '=';
+
+        // Write the value, URL encoded, one character at a time
+        while((c = *(pHttpCon->ptrRead++)))
+        {
+            if(c == ' ')
+            {
+                *pBuff++ = '+';
+            }
+            else if(c < '0' || (c > '9' && c < 'A') || (c > 'Z' && c < 'a') || c > 'z')
+            {
+                *pBuff++ = '%';
+                *pBuff++ = btohexa_high(c);
+                *pBuff++ = btohexa_low(c);
+            }
+            else
+            {
+                *pBuff++ = c;
+            }
+        }
+
+        // Finish the line
+        *pBuff++ = '\r';
+        *pBuff++ = '\n';
+
+        if(!_HTTP_DataTryOutput(pHttpCon, cookieBuffer, pBuff - cookieBuffer, 0))
+        {   //  not enough room to send data; wait some more
+            *pWait = true;
+            return TCPIP_HTTP_CONN_STATE_SERVE_COOKIES;
+        }
+    }
+#endif
+
+    return TCPIP_HTTP_CONN_STATE_SERVE_COOKIES + 1;   // done, advance
+}
+
+// process HTTP body init state: TCPIP_HTTP_CONN_STATE_SERVE_BODY_INIT
+// returns the next connection state:
+// also signals if waiting for resources
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ServeBodyInit(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+{
+    int  encodeLen;
+    int32_t bodyLen;
+    const char* contentCoding;
+    char encodingBuffer[100];
+
+#if (_TCPIP_HTTP_NET_PIPELINE != 0)
+    // a body sent with a GET request is not read
+    _HTTP_BodySkip(pHttpCon, pHttpCon->byteCount);
+#endif  // (_TCPIP_HTTP_NET_PIPELINE != 0)
+    // Set up the dynamic substitutions
+    pHttpCon->byteCount = 0;
+
+    bodyLen = -1;
+    if(pHttpCon->flags.fileDynamic == 0 || _HTTP_DbgKillDynFiles())
+    {   // a static file is sent as it is: the length is known
+        bodyLen = _HTTP_ConnFileSize(pHttpCon);
+#if defined(TCPIP_HTTP_NET_USE_RANGES)
+        if(pHttpCon->flags.rangeReq != 0)
+        {
+            bodyLen = pHttpCon->rangeEnd - pHttpCon->rangeStart + 1;
+        }
+#endif  // defined(TCPIP_HTTP_NET_USE_RANGES)
+    }
+
+#if (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+    if(bodyLen < 0 && pHttpCon->bodyBuff == 0)
+    {   // dynamic file: collect the output into larger chunks
+        // if no memory, the output is sent as it is generated
+        pHttpCon->bodyBuff = (char*)(*http_malloc_fnc)(TCPIP_HTTP_CHUNK_HEADER_LEN + TCPIP_HTTP_NET_CHUNK_COALESCE_SIZE + TCPIP_HTTP_CHUNK_FINAL_TRAILER_LEN);
+        pHttpCon->bodyBuffSize = TCPIP_HTTP_NET_CHUNK_COALESCE_SIZE;
+        pHttpCon->bodyLen = 0;
+#if (_TCPIP_HTTP_NET_DEFLATE != 0)
+        if(pHttpCon->bodyBuff != 0 && pHttpCon->flags.acceptDeflate != 0)
+        {   // the collected output can be compressed
+            _HTTP_DeflateStart(pHttpCon);
+        }
+#endif  // (_TCPIP_HTTP_NET_DEFLATE != 0)
+    }
+#endif  // (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+
+    contentCoding = pHttpCon->flags.bodyDeflate != 0 ? "Content-Encoding: deflate\r\nVary: Accept-Encoding\r\n" : "";
+    if(httpNonPersistentConn == false && bodyLen > 0)
+    {   // identity encoding: output the length and end of headers
+        encodeLen = sprintf(encodingBuffer, "Content-Length: %ld\r\n\r\n", (long)bodyLen);
+        pHttpCon->flags.bodyIdentity = 1;
+    }
+    else if(httpNonPersistentConn == false)
+    {   // output encoding and end of headers
+        encodeLen = sprintf(encodingBuffer, "%sTransfer-Encoding: chunked\r\n\r\n", contentCoding);
+    }
+    else
+    {   // just terminate the headers
+        encodeLen = sprintf(encodingBuffer, "%s\r\n", contentCoding);
+
+    }
+
+    if(!_HTTP_DataTryOutput(pHttpCon, encodingBuffer, encodeLen, 0))
+    {   // not enough room to send data; wait some more
+        *pWait = true;
+        return TCPIP_HTTP_CONN_STATE_SERVE_BODY_INIT;
+    }
+
+#if (_TCPIP_HTTP_NET_SCHED != 0)
+    _HTTP_SchedClassSet(pHttpCon, bodyLen);
+#endif  // (_TCPIP_HTTP_NET_SCHED != 0)
+
+    return TCPIP_HTTP_CONN_STATE_SERVE_BODY_INIT + 1;   // advance
+}
+
+// process HTTP serve body state: TCPIP_HTTP_CONN_STATE_SERVE_BODY
+// returns the next connection state:
+// also signals if waiting for resources
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ServeBody(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+{
+    TCPIP_HTTP_CHUNK_RES chunkRes;
+
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+    if(pHttpCon->flags.fileDynamic != 0 && pHttpCon->flags.snapHit == 0 && pHttpCon->snapEntry == 0)
+    {
+        TCPIP_HTTP_SNAP_RES snapRes = _HTTP_SnapshotGet(pHttpCon);
+        if(snapRes == TCPIP_HTTP_SNAP_RES_WAIT)
+        {   // another connection is rendering the file
+            *pWait = true;
+            return TCPIP_HTTP_CONN_STATE_SERVE_BODY;
+        }
+        pHttpCon->flags.snapHit = (snapRes == TCPIP_HTTP_SNAP_RES_HIT);
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+        if(pHttpCon->flags.snapHit != 0)
+        {
+            pHttpCon->logBytes += pHttpCon->bodyLen;
+        }
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+    }
+
+    if(pHttpCon->flags.snapHit != 0)
+    {   // the rendered output is in the bodyBuff; the file is closed when done
+        if(!_HTTP_BodyFlush(pHttpCon, true))
+        {   // the output and the last chunk may not fit the socket at once: send what fits
+            _HTTP_BodyFlush(pHttpCon, false);
+            *pWait = true;
+            return TCPIP_HTTP_CONN_STATE_SERVE_BODY;
+        }
+        return TCPIP_HTTP_CONN_STATE_SERVE_CHUNKS + 1;
+    }
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+    if(pHttpCon->fileCache != 0)
+    {   // served from RAM; close the file if the application opened it
+        if(pHttpCon->file != SYS_FS_HANDLE_INVALID)
+        {
+            (*httpFileShell->fileClose)(httpFileShell, pHttpCon->file);
+            pHttpCon->file = SYS_FS_HANDLE_INVALID;
+        }
+        chunkRes = _HTTP_AddCacheFileChunk(pHttpCon, pHttpCon->fileCache, 0);
+        if(chunkRes != TCPIP_HTTP_CHUNK_RES_WAIT)
+        {   // the chunk owns the entry now or it was released
+            pHttpCon->fileCache = 0;
+        }
+    }
+    else
+    {
+        chunkRes = _HTTP_AddFileChunk(pHttpCon, pHttpCon->file, pHttpCon->fileName, 0);
+    }
+#else
+    chunkRes = _HTTP_AddFileChunk(pHttpCon, pHttpCon->file, pHttpCon->fileName, 0);
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+    if(chunkRes == TCPIP_HTTP_CHUNK_RES_WAIT)
+    {   // need a break; stay here
+        *pWait = true;
+        return TCPIP_HTTP_CONN_STATE_SERVE_BODY;
+    }
+
+#if defined(TCPIP_HTTP_NET_USE_RANGES)
+    if(chunkRes == TCPIP_HTTP_CHUNK_RES_OK && pHttpCon->flags.rangeReq != 0)
+    {   // send only the requested window of the file
+        TCPIP_HTTP_CHUNK_DCPT* pChDcpt = (TCPIP_HTTP_CHUNK_DCPT*)pHttpCon->chunkList.head;
+        // a file cached in RAM has no handle; its data is accessed directly
+        if(pChDcpt->fileChDcpt.fHandle == SYS_FS_HANDLE_INVALID || (*httpFileShell->fileSeek)(httpFileShell, pChDcpt->fileChDcpt.fHandle, pHttpCon->rangeStart, SYS_FS_SEEK_SET) != -1)
+        {
+            pChDcpt->fileChDcpt.fOffset = pHttpCon->rangeStart;
+            pChDcpt->fileChDcpt.fSize = pHttpCon->rangeEnd + 1;
+        }
+        else
+        {   // the file chunk processing will signal the read error
+            pChDcpt->flags |= TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_ERROR;
+        }
+    }
+#endif  // defined(TCPIP_HTTP_NET_USE_RANGES)
+
+    // else continue processing
+    pHttpCon->file = SYS_FS_HANDLE_INVALID; // it will be closed when its chunk is processed 
+    return TCPIP_HTTP_CONN_STATE_SERVE_BODY + 1;    // advance
+}
+
+// process HTTP serve chunks state: TCPIP_HTTP_CONN_STATE_SERVE_CHUNKS
+// returns the next connection state:
+// also signals if waiting for resources
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ServeChunks(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+{
+    TCPIP_HTTP_CHUNK_RES chunkRes;
+
+    chunkRes = _HTTP_ProcessChunks(pHttpCon);
+
+    if(chunkRes == TCPIP_HTTP_CHUNK_RES_WAIT)
+    {   // need a break; wait here
+#if (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+        if(pHttpCon->bodyBuff != 0)
+        {   // send what's been collected so far, as the socket allows
+            _HTTP_BodyFlush(pHttpCon, false);
+        }
+#endif  // (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+#if (_TCPIP_HTTP_NET_SCHED != 0)
+        if(pHttpCon->flags.schedYield != 0)
+        {   // TX space may still be available and no socket signal will come: run again after the others
+            pHttpCon->flags.schedYield = 0;
+            _HTTP_ConnReadyAdd(pHttpCon);
+            _TCPIPStackModuleSignalRequest(TCPIP_THIS_MODULE_ID, TCPIP_MODULE_SIGNAL_RX_PENDING, true); 
+        }
+#endif  // (_TCPIP_HTTP_NET_SCHED != 0)
+        *pWait = true;
+        return TCPIP_HTTP_CONN_STATE_SERVE_CHUNKS;
+    }
+
+    if(chunkRes == TCPIP_HTTP_CHUNK_RES_OK || chunkRes < 0)
+    {   // either continue or some error occurred; try another chunk
+        return TCPIP_HTTP_CONN_STATE_SERVE_CHUNKS;
+    }
+
+    // done processing chunks
+    return TCPIP_HTTP_CONN_STATE_SERVE_CHUNKS + 1;
+}
+
+
+// process HTTP disconnect state: TCPIP_HTTP_CONN_STATE_DONE
+// returns the next connection state:
+// also signals if waiting for resources
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessDone(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+{
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+    _HTTP_LogRecord(pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+
+#if (_TCPIP_HTTP_NET_PIPELINE != 0)
+    if(pHttpCon->flags.pipeBreak != 0 && httpNonPersistentConn == false)
+    {   // the start of the next request is not known: close the connection
+        httpPipeBreaks++;
+        pHttpCon->closeEvent = TCPIP_HTTP_NET_EVENT_CLOSE_DONE;
+        return TCPIP_HTTP_CONN_STATE_DISCONNECT;
+    }
+#endif  // (_TCPIP_HTTP_NET_PIPELINE != 0)
+
+    if(httpNonPersistentConn == false)
+    {  // keep connection open; Make sure any opened files are closed
+        if(pHttpCon->file != SYS_FS_HANDLE_INVALID)
+        {
+            (*httpFileShell->fileClose)(httpFileShell, pHttpCon->file);
+            _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_CLOSE, pHttpCon->fileName);
+            pHttpCon->file = SYS_FS_HANDLE_INVALID;
+        }
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+        if(pHttpCon->fileCache != 0)
+        {
+            _HTTP_FileCacheRelease(pHttpCon->fileCache);
+            pHttpCon->fileCache = 0;
+        }
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+#if (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+        _HTTP_BodyBuffRelease(pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+        _HTTP_LineBuffRelease(pHttpCon);
+        _HTTP_FileNameRelease(pHttpCon);
+#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+        _HTTP_UploadRelease(pHttpCon);
+#endif  // defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+#if (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+        _HTTP_FormRelease(pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+        _HTTP_SnapshotEnd(pHttpCon, TCPIP_HTTP_SNAP_STATE_FREE);
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+        _HTTP_WsRelease(pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+#if (_TCPIP_HTTP_NET_PIPELINE != 0)
+        if(++pHttpCon->pipeCount < TCPIP_HTTP_NET_PIPELINE_DEPTH && NET_PRES_SocketReadIsReady(pHttpCon->socket) != 0)
+        {   // the next request is already in the socket: answer it in this turn
+            // the requests of a connection are served one at a time, the responses keep their order
+            httpPipelined++;
+            return TCPIP_HTTP_CONN_STATE_IDLE;
+        }
+#endif  // (_TCPIP_HTTP_NET_PIPELINE != 0)
+        *pWait = true;
+        return TCPIP_HTTP_CONN_STATE_IDLE;
+    }
+
+    // else nonpersistent: disconnect
+    pHttpCon->closeEvent = TCPIP_HTTP_NET_EVENT_CLOSE_DONE;
+    return TCPIP_HTTP_CONN_STATE_DISCONNECT;
+}
+
+
+// clean ups the connection data and disconnects the socket
+// it also discards the socket RX data as instructed by discardType:
+//     - TCPIP_HTTP_DISCARD_NOT         - no discard done
+//     - TCPIP_HTTP_DISCARD_WAIT_DISCON - discard if disconnect successful
+//     - TCPIP_HTTP_DISCARD_WAIT_NOT    - discard anyway
+// returns the disconnect operation result
+static bool _HTTP_ConnCleanDisconnect(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_DISCARD_TYPE discardType)
+{
+    // Make sure any opened files are closed
+    if(pHttpCon->file != SYS_FS_HANDLE_INVALID)
+    {
+        (*httpFileShell->fileClose)(httpFileShell, pHttpCon->file);
+        _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_CLOSE, pHttpCon->fileName);
+        pHttpCon->file = SYS_FS_HANDLE_INVALID;
+    }
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+    if(pHttpCon->fileCache != 0)
+    {
+        _HTTP_FileCacheRelease(pHttpCon->fileCache);
+        pHttpCon->fileCache = 0;
+    }
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+
+    // purge all pending chunks
+    TCPIP_HTTP_CHUNK_DCPT* pChDcpt;
+    while((pChDcpt = (TCPIP_HTTP_CHUNK_DCPT*)pHttpCon->chunkList.head) != 0)
+    {
+        _HTTP_FreeChunk(pHttpCon, pChDcpt);
+    } 
+#if (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+    _HTTP_BodyBuffRelease(pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+    _HTTP_LineBuffRelease(pHttpCon);
+    _HTTP_FileNameRelease(pHttpCon);
+#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+    _HTTP_UploadRelease(pHttpCon);
+#endif  // defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+#if (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+    _HTTP_FormRelease(pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+    _HTTP_SnapshotEnd(pHttpCon, TCPIP_HTTP_SNAP_STATE_FREE);
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+    _HTTP_WsRelease(pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+#if (_TCPIP_HTTP_NET_PIPELINE != 0)
+    pHttpCon->bodySkip = 0;
+#endif  // (_TCPIP_HTTP_NET_PIPELINE != 0)
+
+    bool disconRes;
+    if((disconRes = NET_PRES_SocketDisconnect(pHttpCon->socket)) == true)
+    {
+        pHttpCon->flags.sktLocalReset = 1;
+        pHttpCon->flags.sktIsConnected = 0;
+    }
+
+    if(discardType != TCPIP_HTTP_DISCARD_NOT)
+    {
+        if(disconRes == true || discardType == TCPIP_HTTP_DISCARD_WAIT_NOT)
+        {
+            NET_PRES_SocketDiscard(pHttpCon->socket);
+        }
+    }
+
+    return disconRes;
+}
+
+// process HTTP error state: TCPIP_HTTP_CONN_STATE_ERROR
+// returns the next connection state:
+// also signals if waiting for resources
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessError(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+{
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+    _HTTP_LogRecord(pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+
+    _HTTP_ConnCleanDisconnect(pHttpCon, pHttpCon->flags.discardRxBuff != 0 ? TCPIP_HTTP_DISCARD_WAIT_NOT : TCPIP_HTTP_DISCARD_NOT);
+    _HTTP_Report_ConnectionEvent(pHttpCon, (TCPIP_HTTP_NET_EVENT_TYPE)pHttpCon->closeEvent, 0);
+
+    *pWait = true;
+    return TCPIP_HTTP_CONN_STATE_IDLE;
+}
+
+// process non-persistent HTTP disconnect state: TCPIP_HTTP_CONN_STATE_DISCONNECT
+// persistent connection gets here only if timeout
+// returns the next connection state: TCPIP_HTTP_CONN_STATE_IDLE
+// also signals if waiting for resources
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessDisconnect(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+{
+    *pWait = true;
+
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+    // WebSocket close; a non persistent connection is already recorded
+    _HTTP_LogRecord(pHttpCon);
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+
+    bool disconRes = _HTTP_ConnCleanDisconnect(pHttpCon, TCPIP_HTTP_DISCARD_WAIT_DISCON);
+
+    if(disconRes)
+    {
+        _HTTP_Report_ConnectionEvent(pHttpCon, (TCPIP_HTTP_NET_EVENT_TYPE)pHttpCon->closeEvent, 0);
+        return TCPIP_HTTP_CONN_STATE_IDLE;
+    }
+
+    // else retry next time
+    return TCPIP_HTTP_CONN_STATE_DISCONNECT;
+}
+
+// process a connection parked on an event channel: TCPIP_HTTP_CONN_STATE_EVENT_STREAM
+// the events are written by TCPIP_HTTP_NET_EventPublish
+// the connection is not run by the periodic processing and holds no file;
+// _HTTP_ConnCheckReset detects the client closing it
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessEventStream(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+{
+    // the client is not supposed to send anything else
+    NET_PRES_SocketDiscard(pHttpCon->socket);
+
+    *pWait = true;
+    return TCPIP_HTTP_CONN_STATE_EVENT_STREAM;
+}
+
+// process a connection that switched to the WebSocket protocol: TCPIP_HTTP_CONN_STATE_WEBSOCKET
+// the frames are parsed in the socket RX buffer and
+// a frame is read only when it is all there
+// the connection is not run by the periodic processing, only on RX signals
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_ProcessWebSocket(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
+{
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+    TCPIP_HTTP_WS_DCPT* pWs = pHttpCon->wsDcpt;
+    uint8_t frameHdr[TCPIP_HTTP_WS_FRAME_HDR_MAX];
+    uint8_t ctrlBuff[TCPIP_HTTP_WS_CTRL_MAX];
+    uint8_t *pMask, *pPayload;
+    uint8_t opCode;
+    uint16_t avlblBytes, hdrLen, closeCode;
+    uint32_t payloadLen, ix;
+    TCPIP_HTTP_NET_WS_HANDLER wsHandler;
+
+    while(true)
+    {
+        avlblBytes = NET_PRES_SocketReadIsReady(pHttpCon->socket);
+        if(avlblBytes < 2)
+        {   // wait for a frame
+            break;
+        }
+
+        NET_PRES_SocketPeek(pHttpCon->socket, frameHdr, mMIN(avlblBytes, sizeof(frameHdr)));
+        opCode = frameHdr[0] & 0x0f;
+        payloadLen = frameHdr[1] & 0x7f;
+        hdrLen = payloadLen == 126 ? 4 : payloadLen == 127 ? 10 : 2;
+        if((frameHdr[1] & 0x80) != 0)
+        {   // masking key
+            hdrLen += 4;
+        }
+        if(avlblBytes < hdrLen)
+        {   // wait for the whole header
+            break;
+        }
+
+        if(payloadLen == 126)
+        {
+            payloadLen = ((uint32_t)frameHdr[2] << 8) | frameHdr[3];
+        }
+        else if(payloadLen == 127)
+        {   // 64 bit length; anything over 32 bits is too big anyway
+            payloadLen = (frameHdr[2] | frameHdr[3] | frameHdr[4] | frameHdr[5]) != 0 ? 0xffffffff :
+                ((uint32_t)frameHdr[6] << 24) | ((uint32_t)frameHdr[7] << 16) | ((uint32_t)frameHdr[8] << 8) | frameHdr[9];
+        }
+
+        // check the frame
+        if((frameHdr[1] & 0x80) == 0 || (frameHdr[0] & 0x70) != 0)
+        {   // the client frames are masked and there are no extensions
+            closeCode = TCPIP_HTTP_WS_CLOSE_PROTOCOL;
+        }
+        else if(opCode >= TCPIP_HTTP_WS_OPCODE_CLOSE)
+        {   // control frames are not fragmented and are short
+            closeCode = ((frameHdr[0] & 0x80) == 0 || payloadLen > TCPIP_HTTP_WS_CTRL_MAX || opCode > TCPIP_HTTP_WS_OPCODE_PONG) ? TCPIP_HTTP_WS_CLOSE_PROTOCOL : 0;
+        }
+        else if(opCode > TCPIP_HTTP_WS_OPCODE_BINARY || (opCode == TCPIP_HTTP_WS_OPCODE_CONT) != (pWs->msgOpCode != 0))
+        {   // unknown opcode or a continuation that doesn't match the message state
+            closeCode = TCPIP_HTTP_WS_CLOSE_PROTOCOL;
+        }
+        else
+        {   // no additions: a hostile 64 bit length must not wrap around
+            closeCode = payloadLen > sizeof(pWs->msgBuff) - pWs->msgLen ? TCPIP_HTTP_WS_CLOSE_TOO_BIG : 0;
+        }
+
+        if(closeCode != 0)
+        {   // fail the connection
+            _HTTP_WsCloseSend(pHttpCon, closeCode);
+            NET_PRES_SocketDiscard(pHttpCon->socket);
+            pHttpCon->closeEvent = TCPIP_HTTP_NET_EVENT_CLOSE_DONE;
+            return TCPIP_HTTP_CONN_STATE_DISCONNECT;
+        }
+
+        if(payloadLen > (uint32_t)(avlblBytes - hdrLen))
+        {   // wait for the whole frame
+            break;
+        }
+
+        // read the frame and unmask the payload
+        NET_PRES_SocketRead(pHttpCon->socket, 0, hdrLen);
+        pPayload = opCode >= TCPIP_HTTP_WS_OPCODE_CLOSE ? ctrlBuff : pWs->msgBuff + pWs->msgLen;
+        NET_PRES_SocketRead(pHttpCon->socket, pPayload, payloadLen);
+        pMask = frameHdr + hdrLen - 4;
+        for(ix = 0; ix < payloadLen; ix++)
+        {
+            pPayload[ix] ^= pMask[ix & 3];
+        }
+
+        if(opCode == TCPIP_HTTP_WS_OPCODE_PING)
+        {   // if there's no room for the pong, the client will ping again
+            _HTTP_WsFrameWrite(pHttpCon->socket, TCPIP_HTTP_WS_OPCODE_PONG, ctrlBuff, payloadLen);
+        }
+        else if(opCode == TCPIP_HTTP_WS_OPCODE_CLOSE)
+        {   // echo the status code, if not already closing; then disconnect
+            if(pWs->closeSent == 0)
+            {
+                _HTTP_WsFrameWrite(pHttpCon->socket, TCPIP_HTTP_WS_OPCODE_CLOSE, ctrlBuff, payloadLen >= 2 ? 2 : 0);
+            }
+            pHttpCon->closeEvent = TCPIP_HTTP_NET_EVENT_CLOSE_DONE;
+            return TCPIP_HTTP_CONN_STATE_DISCONNECT;
+        }
+        else if(opCode != TCPIP_HTTP_WS_OPCODE_PONG)
+        {   // message data
+            if(opCode != TCPIP_HTTP_WS_OPCODE_CONT)
+            {
+                pWs->msgOpCode = opCode;
+            }
+            pWs->msgLen += payloadLen;
+
+            if((frameHdr[0] & 0x80) != 0)
+            {   // final fragment: the message is complete
+                httpWsMessages++;
+                wsHandler = httpWsEndpoints[pWs->epIx].handler;
+                if(wsHandler != 0)
+                {
+                    (*wsHandler)(pHttpCon, pWs->msgOpCode == TCPIP_HTTP_WS_OPCODE_TEXT ? TCPIP_HTTP_NET_WS_EVENT_TEXT : TCPIP_HTTP_NET_WS_EVENT_BINARY, pWs->msgBuff, pWs->msgLen);
+                }
+                pWs->msgOpCode = 0;
+                pWs->msgLen = 0;
+            }
+        }
+    }
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+
+    *pWait = true;
+    return TCPIP_HTTP_CONN_STATE_WEBSOCKET;
+}
+
+static int _HTTP_HeaderMsg_Print(char* buffer, size_t bufferSize, const char* fmt, ...)
+{
+    int nChars;
+    va_list args = {0};
+
+    va_start( args, fmt );
+    nChars = vsnprintf(buffer, bufferSize, fmt, args);
+    va_end( args );
+
+    if(nChars >= 0)
+    {   // successful
+        if(nChars >= bufferSize)
+        {   // exceeded
+            nChars = bufferSize - 1;
+        }
+        return nChars;
+    }
+
+    return 0;
+}
+
+
+
+
+// outputs a response message from the HTTPResponseMessages
+// used for messages without parameters
+static int _HTTP_HeaderMsg_Generic(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer, size_t bufferSize)
+{
+
+    const char* msg = HTTPResponseMessages[pHttpCon->httpStatus];
+
+    return msg ? _HTTP_HeaderMsg_Print(buffer, bufferSize, msg) : 0;
+}
+
+static int _HTTP_HeaderMsg_NotFound(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer, size_t bufferSize)
+{
+    const char* msg;
+
+#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+    msg = "\r\n404: File not found<br>Use <a href=\"/" TCPIP_HTTP_NET_FILE_UPLOAD_NAME "\">MPFS Upload</a> to program web pages\r\n";
+    return _HTTP_HeaderMsg_Print(buffer, bufferSize, msg);
+#else       
+    msg = "\r\n404: File: %s not found\r\n";
+    return _HTTP_HeaderMsg_Print(buffer, bufferSize, msg, pHttpCon->fileName);
+#endif
+
+}
+
+static int _HTTP_HeaderMsg_Redirect(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer, size_t bufferSize)
+{
+    const char* msg = "\r\n304 Redirect: %s\r\n";
+    return _HTTP_HeaderMsg_Print(buffer, bufferSize, msg, (char*)pHttpCon->httpData);
+}
+
+#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+static int _HTTP_HeaderMsg_UploadForm(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer, size_t bufferSize)
+{
+    const char* msg = "\r\n<html><body style=\"margin:100px\"><form method=post action=\"/%s\" enctype=\"multipart/form-data\"><b>FS Image Upload</b><p><input type=file name=i size=40> &nbsp; <input type=submit value=\"Upload\"></form></body></html>";
+    return _HTTP_HeaderMsg_Print(buffer, bufferSize, msg, pHttpCon->fileName);
+}
+
+static int _HTTP_HeaderMsg_UploadError(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer, size_t bufferSize)
+{
+    // TCPIP_HTTP_NET_STAT_UPLOAD_ERROR
+    const char* msg;
+    if(pHttpCon->flags.uploadMemError)
+    {
+        msg = "\r\n<html><body style=\"margin:100px\"><b>Upload Memory Allocation Error</b><p><a href=\"/%s \">Try again?</a></body></html>";
+    }
+    else
+    {
+        msg = "\r\n<html><body style=\"margin:100px\"><b>FS Image Corrupt or Wrong Version</b><p><a href=\"/%s \">Try again?</a></body></html>";
+    }
+    return _HTTP_HeaderMsg_Print(buffer, bufferSize, msg, pHttpCon->fileName);
+}
+
+#endif
+
+#if (_TCPIP_HTTP_NET_FILE_VALIDATORS != 0)
+// prints the entity tag of the file being served: "stamp-size"
+// the buffer needs to be at least 20 characters
+// returns the number of characters printed
+static int _HTTP_FileETagPrint(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer)
+{
+    return sprintf(buffer, "\"%08lx%08lx\"", (unsigned long)pHttpCon->fileStamp, (unsigned long)pHttpCon->fileSize);
+}
+
+// prints the HTTP date of the file being served
+// the file system reports the date/time in the FAT format
+// the buffer needs to be at least 30 characters
+// returns the number of characters printed, 0 if the file date is not valid
+static int _HTTP_FileDatePrint(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer)
+{
+    static const char* const wDays[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    static const char* const months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    static const uint8_t monthOffs[] = {0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4};
+
+    uint16_t fDate = (uint16_t)(pHttpCon->fileStamp >> 16);
+    uint16_t fTime = (uint16_t)pHttpCon->fileStamp;
+    int year = 1980 + (fDate >> 9);
+    int month = (fDate >> 5) & 0x0f;
+    int day = fDate & 0x1f;
+    int hour = fTime >> 11;
+    int min = (fTime >> 5) & 0x3f;
+    int sec = (fTime & 0x1f) * 2;
+
+    if(month < 1 || month > 12 || day < 1 || hour > 23 || min > 59 || sec > 59)
+    {
+        return 0;
+    }
+
+    // day of the week
+    int y = month < 3 ? year - 1 : year;
+    int wDay = (y + y / 4 - y / 100 + y / 400 + monthOffs[month - 1] + day) % 7;
+
+    return sprintf(buffer, "%s, %02d %s %04d %02d:%02d:%02d GMT", wDays[wDay], day, months[month - 1], year, hour, min, sec);
+}
+
+// prints the validators header fields for the file being served
+// ETag and Last-Modified, if the file date is valid
+// returns the number of characters printed
+static int _HTTP_FileValidatorsPrint(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer)
+{
+    int len = sprintf(buffer, "ETag: ");
+    len += _HTTP_FileETagPrint(pHttpCon, buffer + len);
+    len += sprintf(buffer + len, TCPIP_HTTP_NET_CRLF);
+
+    int dateLen = sprintf(buffer + len, "Last-Modified: ");
+    int fDateLen = _HTTP_FileDatePrint(pHttpCon, buffer + len + dateLen);
+    if(fDateLen != 0)
+    {
+        len += dateLen + fDateLen;
+        len += sprintf(buffer + len, TCPIP_HTTP_NET_CRLF);
+    }
+
+    return len;
+}
+#endif  // (_TCPIP_HTTP_NET_FILE_VALIDATORS != 0)
+
+// gets the info of the file being served:
+// Content-Type, encoding, dynamic processing and validators
+static void _HTTP_FileInfoGet(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    int ix;
+    char *ext;
+    bool statOk;
+    SYS_FS_FSTAT fs_attr = {0};
+
+    // Find the extension in the filename
+    ext = strrchr(pHttpCon->fileName, TCPIP_HTTP_FILE_EXT_SEP);
+
+    if(ext)
+    {   // Compare to known extensions to determine Content-Type
+        ext++;
+        for(ix = 0; ix < sizeof(httpFileExtensions) / sizeof(*httpFileExtensions); ix++)
+        {
+            if(strcmp(ext, httpFileExtensions[ix]) == 0)
+            {
+                break;
+            }
+        }
+        pHttpCon->fileType = (TCPIP_HTTP_NET_FILE_TYPE)ix;  // TCPIP_HTTP_NET_FILE_TYPE_UNKNOWN if not found
+    }
+    else
+    {
+        pHttpCon->fileType = TCPIP_HTTP_NET_FILE_TYPE_UNKNOWN; 
+    }
+
+    statOk = (*httpFileShell->fileStat)(httpFileShell, pHttpCon->fileName, &fs_attr) != SYS_FS_HANDLE_INVALID;
+    pHttpCon->flags.fileGzipped = (statOk && fs_attr.fattrib == SYS_FS_ATTR_ZIP_COMPRESSED) ? 1 : 0;
+    pHttpCon->flags.fileDynamic = (pHttpCon->flags.fileGzipped == 0 && _HTTP_FileTypeIsDynamic(pHttpCon->fileName)) ? 1 : 0;
+
+#if (_TCPIP_HTTP_NET_FILE_STAMP != 0)
+    pHttpCon->fileStamp = statOk ? ((uint32_t)fs_attr.fdate << 16) | fs_attr.ftime : 0;
+#endif  // (_TCPIP_HTTP_NET_FILE_STAMP != 0)
+#if (_TCPIP_HTTP_NET_FILE_VALIDATORS != 0)
+    // only static files can be cached
+    if(statOk && pHttpCon->flags.fileDynamic == 0)
+    {
+        pHttpCon->fileSize = fs_attr.fsize;
+        pHttpCon->flags.fileCacheable = 1;
+    }
+#endif  // (_TCPIP_HTTP_NET_FILE_VALIDATORS != 0)
+}
+
+// prints the response header fields that describe the file being served:
+// Content-Type, Content-Encoding, Cache-Control and the validators
+// returns the number of characters printed
+static int _HTTP_HeaderBlockPrint(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer, bool isPost)
+{
+    int len = 0;
+
+    // Output the content type, if known
+    if(pHttpCon->fileType != TCPIP_HTTP_NET_FILE_TYPE_UNKNOWN)
+    {
+        len = sprintf(buffer, "Content-Type: %s\r\n", httpContentTypes[pHttpCon->fileType]);
+    }
+
+    // Output the gzip encoding header if needed
+    if(pHttpCon->flags.fileGzipped != 0)
+    {
+        len += sprintf(buffer + len, "Content-Encoding: gzip\r\n");
+    }
+
+    // Output the cache-control
+    if(isPost || pHttpCon->flags.fileDynamic != 0)
+    {   // This is a dynamic page or a POST request, so no cache
+        len += sprintf(buffer + len, "Cache-Control: no-cache\r\n");
+    }
+    else
+    {
+        len += sprintf(buffer + len, "Cache-Control: max-age=" TCPIP_HTTP_NET_CACHE_LEN TCPIP_HTTP_NET_CRLF);
+#if (_TCPIP_HTTP_NET_FILE_VALIDATORS != 0)
+        if(pHttpCon->flags.fileCacheable != 0)
+        {   // output the validators, to be used for the next conditional/range GET
+            len += _HTTP_FileValidatorsPrint(pHttpCon, buffer + len);
+#if defined(TCPIP_HTTP_NET_USE_RANGES)
+            len += sprintf(buffer + len, "Accept-Ranges: bytes\r\n");
+#endif  // defined(TCPIP_HTTP_NET_USE_RANGES)
+        }
+#endif  // (_TCPIP_HTTP_NET_FILE_VALIDATORS != 0)
+    }
+
+    return len;
+}
+
+#if (_TCPIP_HTTP_NET_HEADER_CACHE != 0) || (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+// checks that a changed file path designates a cached file name:
+// the path ends with the file name, as a whole path component
+static bool _HTTP_FileNameMatch(const char* path, size_t pathLen, const char* fName)
+{
+    size_t nameLen = strlen(fName);
+
+    if(nameLen > pathLen || strcmp(path + pathLen - nameLen, fName) != 0)
+    {   // not this one
+        return false;
+    }
+
+    // else partial name match if not at a separator
+    return nameLen == pathLen || path[pathLen - nameLen - 1] == TCPIP_HTTP_FILE_PATH_SEP;
+}
+#endif  // (_TCPIP_HTTP_NET_HEADER_CACHE != 0) || (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+
+#if (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
+// finds the cached header block of the file being served
+// the entry matches the file name, the current file size
+// and the file date/time, if known: fStamp != 0
+// returns 0 if not found
+static TCPIP_HTTP_HDR_ENTRY* _HTTP_HeaderCacheFind(TCPIP_HTTP_NET_CONN* pHttpCon, uint32_t fStamp)
+{
+    int ix;
+    TCPIP_HTTP_HDR_ENTRY* pHdr;
+    int32_t fSize = _HTTP_ConnFileSize(pHttpCon);
+
+    for(ix = 0, pHdr = httpHdrCache; ix < sizeof(httpHdrCache) / sizeof(*httpHdrCache); ix++, pHdr++)
+    {
+        if(pHdr->hdrLen != 0 && pHdr->fHash == pHttpCon->fileHash && strcmp(pHdr->fName, pHttpCon->fileName) == 0)
+        {
+            if(pHdr->fSize != fSize || (fStamp != 0 && pHdr->fileStamp != fStamp))
+            {   // the file was changed
+                return 0;
+            }
+            return pHdr;
+        }
+    }
+
+    return 0;
+}
+
+// loads the info of the file being served from the header cache
+// returns true if the file was found in the cache
+static bool _HTTP_HeaderCacheLoad(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    TCPIP_HTTP_HDR_ENTRY* pHdr;
+    uint32_t fStamp = 0;
+
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+    if(pHttpCon->fileCache != 0)
+    {   // the date/time of the file when loaded in RAM
+        fStamp = pHttpCon->fileCache->fStamp;
+    }
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+
+    if((pHdr = _HTTP_HeaderCacheFind(pHttpCon, fStamp)) == 0)
+    {
+        return false;
+    }
+
+    pHttpCon->fileType = pHdr->fileType;
+    pHttpCon->flags.fileGzipped = (pHdr->hdrFlags & TCPIP_HTTP_HDR_FLAG_GZIPPED) != 0 ? 1 : 0;
+    pHttpCon->flags.fileDynamic = (pHdr->hdrFlags & TCPIP_HTTP_HDR_FLAG_DYNAMIC) != 0 ? 1 : 0;
+#if (_TCPIP_HTTP_NET_FILE_STAMP != 0)
+    pHttpCon->fileStamp = pHdr->fileStamp;
+#endif  // (_TCPIP_HTTP_NET_FILE_STAMP != 0)
+#if (_TCPIP_HTTP_NET_FILE_VALIDATORS != 0)
+    if((pHdr->hdrFlags & TCPIP_HTTP_HDR_FLAG_CACHEABLE) != 0)
+    {
+        pHttpCon->fileSize = (uint32_t)pHdr->fSize;
+        pHttpCon->flags.fileCacheable = 1;
+    }
+#endif  // (_TCPIP_HTTP_NET_FILE_VALIDATORS != 0)
+    pHdr->lastUse = ++httpHdrStamp;
+
+    return true;
+}
+
+// builds the GET header block of the file being served and adds it to the cache
+// the old entry of a changed file, an unused or the least recently used entry is replaced
+// a block that does not fit is not cached; it is built at each request
+static void _HTTP_HeaderCacheAdd(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    int ix, hdrLen;
+    size_t nameLen;
+    TCPIP_HTTP_HDR_ENTRY *pHdr, *pSel, *pFree;
+    char hdrBuffer[TCPIP_HTTP_NET_RESPONSE_BUFFER_SIZE];
+
+    hdrLen = _HTTP_HeaderBlockPrint(pHttpCon, hdrBuffer, false);
+    if(hdrLen == 0 || hdrLen > sizeof(pSel->hdrBlock))
+    {
+        return;
+    }
+
+    pSel = httpHdrCache;
+    pFree = 0;
+    for(ix = 0, pHdr = httpHdrCache; ix < sizeof(httpHdrCache) / sizeof(*httpHdrCache); ix++, pHdr++)
+    {
+        if(pHdr->hdrLen == 0)
+        {   // free slot
+            if(pFree == 0)
+            {
+                pFree = pHdr;
+            }
+            continue;
+        }
+        if(pHdr->fHash == pHttpCon->fileHash && strcmp(pHdr->fName, pHttpCon->fileName) == 0)
+        {   // the old block of this file
+            pFree = pHdr;
+            break;
+        }
+        if(pHdr->lastUse < pSel->lastUse)
+        {
+            pSel = pHdr;
+        }
+    }
+
+    if(pFree != 0)
+    {
+        pSel = pFree;
+    }
+    _HTTP_HeaderCacheDelete(pSel);
+
+    nameLen = strlen(pHttpCon->fileName);
+    if((pSel->fName = (char*)(*http_malloc_fnc)(nameLen + 1)) == 0)
+    {   // out of memory; the block is built at each request
+        return;
+    }
+    memcpy(pSel->fName, pHttpCon->fileName, nameLen + 1);
+
+    pSel->fHash = pHttpCon->fileHash;
+    pSel->fSize = _HTTP_ConnFileSize(pHttpCon);
+    pSel->fileStamp = 0;
+#if (_TCPIP_HTTP_NET_FILE_STAMP != 0)
+    pSel->fileStamp = pHttpCon->fileStamp;
+#endif  // (_TCPIP_HTTP_NET_FILE_STAMP != 0)
+    pSel->fileType = pHttpCon->fileType;
+    pSel->hdrFlags = 0;
+    if(pHttpCon->flags.fileGzipped != 0)
+    {
+        pSel->hdrFlags |= TCPIP_HTTP_HDR_FLAG_GZIPPED;
+    }
+    if(pHttpCon->flags.fileDynamic != 0)
+    {
+        pSel->hdrFlags |= TCPIP_HTTP_HDR_FLAG_DYNAMIC;
+    }
+#if (_TCPIP_HTTP_NET_FILE_VALIDATORS != 0)
+    if(pHttpCon->flags.fileCacheable != 0)
+    {
+        pSel->hdrFlags |= TCPIP_HTTP_HDR_FLAG_CACHEABLE;
+    }
+#endif  // (_TCPIP_HTTP_NET_FILE_VALIDATORS != 0)
+    pSel->lastUse = ++httpHdrStamp;
+    memcpy(pSel->hdrBlock, hdrBuffer, hdrLen);
+    pSel->hdrLen = (uint16_t)hdrLen;
+}
+
+// deletes a cached header block; the entry becomes free
+static void _HTTP_HeaderCacheDelete(TCPIP_HTTP_HDR_ENTRY* pHdr)
+{
+    if(pHdr->fName != 0)
+    {
+        (*http_free_fnc)(pHdr->fName);
+    }
+    memset(pHdr, 0, sizeof(*pHdr));
+}
+
+// purges the cached header blocks
+// fName == 0 purges all the blocks
+// else only the blocks of the file that was changed
+static void _HTTP_HeaderCachePurge(const char* fName)
+{
+    int ix;
+    size_t nameLen;
+    TCPIP_HTTP_HDR_ENTRY* pHdr;
+
+    nameLen = fName == 0 ? 0 : strlen(fName);
+    for(ix = 0, pHdr = httpHdrCache; ix < sizeof(httpHdrCache) / sizeof(*httpHdrCache); ix++, pHdr++)
+    {
+        if(pHdr->hdrLen != 0 && (fName == 0 || _HTTP_FileNameMatch(fName, nameLen, pHdr->fName)))
+        {
+            _HTTP_HeaderCacheDelete(pHdr);
+        }
+    }
+
+    if(fName == 0)
+    {
+        httpHdrStamp = 0;
+    }
+}
+#endif  // (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
+
+// opens the requested file for the connection
+// a file in the RAM cache is used without opening it in the file system
+// returns true if success
+static bool _HTTP_ConnFileOpen(TCPIP_HTTP_NET_CONN* pHttpCon, const char* fName)
+{
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+    if((pHttpCon->fileCache = _HTTP_FileCacheGet(fName)) != 0)
+    {
+        return true;
+    }
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+
+    pHttpCon->file = (*httpFileShell->fileOpen)(httpFileShell, fName, SYS_FS_FILE_OPEN_READ);
+    if(pHttpCon->file == SYS_FS_HANDLE_INVALID)
+    {
+        return false;
+    }
+
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+    httpFileCacheMisses++;
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+    return true;
+}
+
+// returns the size of the file being served
+static int32_t _HTTP_ConnFileSize(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+    if(pHttpCon->fileCache != 0)
+    {
+        return pHttpCon->fileCache->fSize;
+    }
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+
+    return (*httpFileShell->fileSize)(httpFileShell, pHttpCon->file);
+}
+
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+// returns the RAM copy of a file
+// the entry is referenced and has to be released when done
+// returns 0 if the file is not cached
+static TCPIP_HTTP_FILE_CACHE_ENTRY* _HTTP_FileCacheGet(const char* fName)
+{
+    int ix;
+    TCPIP_HTTP_FILE_CACHE_ENTRY* pEntry;
+    uint32_t fHash = fnv_32_hash(fName, strlen(fName));
+
+    for(ix = 0; ix < sizeof(httpFileCache) / sizeof(*httpFileCache); ix++)
+    {
+        pEntry = httpFileCache[ix];
+        if(pEntry != 0 && pEntry->stale == 0 && pEntry->fHash == fHash && strcmp(pEntry->fName, fName) == 0)
+        {   // found it
+            pEntry->refCount++;
+            pEntry->lastUse = ++httpFileStamp;
+            httpFileCacheHits++;
+            return pEntry;
+        }
+    }
+
+    return 0;
+}
+
+// reads a small file into the RAM cache
+// the least recently used files that are not in use are evicted to make room
+// fStamp is the file date/time, as already known by the caller; 0 if not known
+// returns the referenced entry, 0 if the file cannot be cached
+// the file handle is not closed
+static TCPIP_HTTP_FILE_CACHE_ENTRY* _HTTP_FileCacheLoad(SYS_FS_HANDLE fH, const char* fName, bool fileDynamic, uint32_t fStamp)
+{
+    int ix;
+    int32_t fSize;
+    size_t nameLen;
+    TCPIP_HTTP_FILE_CACHE_ENTRY* pEntry;
+    TCPIP_HTTP_FILE_CACHE_ENTRY** pFreeSlot;
+    TCPIP_HTTP_FILE_CACHE_ENTRY** pLruSlot;
+
+    fSize = (*httpFileShell->fileSize)(httpFileShell, fH);
+    if(fSize <= 0 || fSize > TCPIP_HTTP_NET_FILE_CACHE_MAX_FILE || fSize > TCPIP_HTTP_NET_FILE_CACHE_SIZE)
+    {   // too large
+        return 0;
+    }
+
+    while(true)
+    {
+        pFreeSlot = pLruSlot = 0;
+        for(ix = 0; ix < sizeof(httpFileCache) / sizeof(*httpFileCache); ix++)
+        {
+            if((pEntry = httpFileCache[ix]) == 0)
+            {
+                if(pFreeSlot == 0)
+                {
+                    pFreeSlot = httpFileCache + ix;
+                }
+            }
+            else if(pEntry->refCount == 0 && (pLruSlot == 0 || pEntry->lastUse < (*pLruSlot)->lastUse))
+            {   // candidate for replacement
+                pLruSlot = httpFileCache + ix;
+            }
+        }
+
+        if(pFreeSlot != 0 && httpFileCacheBytes + fSize <= TCPIP_HTTP_NET_FILE_CACHE_SIZE)
+        {   // there's room
+            break;
+        }
+
+        if(pLruSlot == 0)
+        {   // all files in use
+            return 0;
+        }
+        _HTTP_FileCacheDelete(pLruSlot);
+    }
+
+    nameLen = strlen(fName);
+    pEntry = (TCPIP_HTTP_FILE_CACHE_ENTRY*)(*http_malloc_fnc)(sizeof(*pEntry) + fSize + nameLen + 1);
+    if(pEntry == 0)
+    {
+        return 0;
+    }
+
+    if((*httpFileShell->fileRead)(httpFileShell, fH, pEntry->fData, fSize) != fSize)
+    {   // failed; serve it from the file system
+        (*httpFileShell->fileSeek)(httpFileShell, fH, 0, SYS_FS_SEEK_SET);
+        (*http_free_fnc)(pEntry);
+        return 0;
+    }
+
+    pEntry->fHash = fnv_32_hash(fName, nameLen);
+    pEntry->fSize = fSize;
+    pEntry->fStamp = fStamp;
+    pEntry->lastUse = ++httpFileStamp;
+    pEntry->refCount = 1;
+    pEntry->stale = 0;
+    pEntry->fileDynamic = fileDynamic ? 1 : 0;
+    pEntry->fName = (char*)pEntry->fData + fSize;
+    strcpy(pEntry->fName, fName);
+    *pFreeSlot = pEntry;
+    httpFileCacheBytes += fSize;
+
+    return pEntry;
+}
+
+// reads the small static file opened by the connection into the RAM cache
+// on success the file is closed and the connection uses the cached copy
+static void _HTTP_FileCacheAdd(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    TCPIP_HTTP_FILE_CACHE_ENTRY* pEntry;
+    uint32_t fStamp = 0;
+
+#if (_TCPIP_HTTP_NET_FILE_STAMP != 0)
+    fStamp = pHttpCon->fileStamp;
+#endif  // (_TCPIP_HTTP_NET_FILE_STAMP != 0)
+    if((pEntry = _HTTP_FileCacheLoad(pHttpCon->file, pHttpCon->fileName, false, fStamp)) == 0)
+    {
+        return;
+    }
+
+    // the file is no longer needed
+    (*httpFileShell->fileClose)(httpFileShell, pHttpCon->file);
+    _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_CLOSE, pHttpCon->fileName);
+    pHttpCon->file = SYS_FS_HANDLE_INVALID;
+    pHttpCon->fileCache = pEntry;
+}
+
+// releases a cached file used by a connection or a file chunk
+// a stale entry is deleted once not used anymore
+static void _HTTP_FileCacheRelease(TCPIP_HTTP_FILE_CACHE_ENTRY* pEntry)
+{
+    int ix;
+
+    _HTTPAssertCond(pEntry->refCount != 0, __func__, __LINE__);
+
+    if(--pEntry->refCount == 0 && pEntry->stale != 0)
+    {
+        for(ix = 0; ix < sizeof(httpFileCache) / sizeof(*httpFileCache); ix++)
+        {
+            if(httpFileCache[ix] == pEntry)
+            {
+                _HTTP_FileCacheDelete(httpFileCache + ix);
+                break;
+            }
+        }
+    }
+}
+
+// deletes a cache entry and frees its slot
+static void _HTTP_FileCacheDelete(TCPIP_HTTP_FILE_CACHE_ENTRY** pSlot)
+{
+    httpFileCacheBytes -= (*pSlot)->fSize;
+    (*http_free_fnc)(*pSlot);
+    *pSlot = 0;
+}
+
+// purges the cached files matching the name
+// fName can be a path, ending with the cached file name
+// if fName == 0, all the files are purged
+// files currently in use are marked stale and deleted when released
+static void _HTTP_FileCachePurge(const char* fName)
+{
+    int ix;
+    size_t nameLen;
+    TCPIP_HTTP_FILE_CACHE_ENTRY* pEntry;
+
+    nameLen = fName == 0 ? 0 : strlen(fName);
+    for(ix = 0; ix < sizeof(httpFileCache) / sizeof(*httpFileCache); ix++)
+    {
+        if((pEntry = httpFileCache[ix]) == 0)
+        {
+            continue;
+        }
+
+        if(fName != 0 && !_HTTP_FileNameMatch(fName, nameLen, pEntry->fName))
+        {   // not this one
+            continue;
+        }
+
+        if(pEntry->refCount == 0)
+        {
+            _HTTP_FileCacheDelete(httpFileCache + ix);
+        }
+        else
+        {   // cannot match anymore
+            pEntry->stale = 1;
+        }
+    }
+}
+
+// adds a file chunk for a file served from the RAM cache
+// pOwnDcpt == 0 for the root file, else the chunk including the file
+// a binary file is sent directly from the cache entry, like a memory mapped file
+// a dynamic file is parsed from the cache entry, using a file buffer
+// on success the chunk owns the entry reference
+// the reference is kept for a retry if waiting for resources, released if error
+static TCPIP_HTTP_CHUNK_RES _HTTP_AddCacheFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_FILE_CACHE_ENTRY* pEntry, TCPIP_HTTP_CHUNK_DCPT* pOwnDcpt)
+{
+    TCPIP_HTTP_NET_EVENT_TYPE evType = TCPIP_HTTP_NET_EVENT_NONE;
+    TCPIP_HTTP_CHUNK_FLAGS chunkFlags;
+    TCPIP_HTTP_CHUNK_DCPT* pChDcpt = 0;
+    const char* fName;
+
+    chunkFlags = (pOwnDcpt == 0) ? (TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE | TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_ROOT) : TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE;
+    if(pEntry->fileDynamic != 0 && !_HTTP_DbgKillDynFiles())
+    {
+        chunkFlags |= TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_DYN;
+    }
+    else
+    {
+        chunkFlags |= TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_MAPPED;
+    }
+
+    if(TCPIP_Helper_SingleListCount(&pHttpCon->chunkList) >= httpChunksDepth)
+    {   // already at max depth
+        evType = TCPIP_HTTP_NET_EVENT_DEPTH_ERROR;
+    }
+    else
+    {
+        pChDcpt = _HTTP_AllocChunk(pHttpCon, chunkFlags, (pOwnDcpt == 0), &evType);
+    }
+
+    if(pChDcpt == 0)
+    {
+        _HTTP_Report_ConnectionEvent(pHttpCon, evType, pEntry->fName);
+        if(evType >= 0)
+        {
+            return TCPIP_HTTP_CHUNK_RES_WAIT;
+        }
+        _HTTP_FileCacheRelease(pEntry);
+        return (evType == TCPIP_HTTP_NET_EVENT_DEPTH_ERROR) ? TCPIP_HTTP_CHUNK_RES_DEPTH_ERR : TCPIP_HTTP_CHUNK_RES_RETRY_ERR;
+    }
+
+    pChDcpt->pRootDcpt = (pOwnDcpt == 0) ? pChDcpt : pOwnDcpt->pRootDcpt;
+    pChDcpt->fileChDcpt.fSize = pEntry->fSize;
+    pChDcpt->fileChDcpt.fMapped = pEntry->fData;
+    pChDcpt->fileChDcpt.pCache = pEntry;
+
+    fName = strrchr(pEntry->fName, TCPIP_HTTP_FILE_PATH_SEP);
+    fName = fName != 0 ? fName + 1 : pEntry->fName;
+    strncpy(pChDcpt->chunkFName, fName, sizeof(pChDcpt->chunkFName) - 1);
+    pChDcpt->chunkFName[sizeof(pChDcpt->chunkFName) - 1] = 0;
+
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+    if((chunkFlags & TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_DYN) != 0)
+    {   // use a compiled template, if possible
+        pChDcpt->fileChDcpt.pTmpl = _HTTP_TemplateGet(pChDcpt, pEntry->fHash, pEntry->fStamp);
+    }
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+
+    _HTTP_FileDbgCreate(pChDcpt->chunkFName, pChDcpt->fileChDcpt.fSize, "ram", pHttpCon->connIx);
+    return TCPIP_HTTP_CHUNK_RES_OK;
+}
+
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+
+#if (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+// returns the cached resolution of a URI
+// returns 0 if the URI was not resolved before
+static TCPIP_HTTP_PATH_ENTRY* _HTTP_PathCacheFind(const char* uri, uint16_t uriLen, uint32_t uriHash)
+{
+    int ix;
+    TCPIP_HTTP_PATH_ENTRY* pEntry = httpPathCache;
+
+    for(ix = 0; ix < sizeof(httpPathCache) / sizeof(*httpPathCache); ix++, pEntry++)
+    {
+        if(pEntry->uriLen == uriLen && pEntry->uriHash == uriHash && memcmp(pEntry->uri, uri, uriLen) == 0)
+        {
+            pEntry->lastUse = ++httpPathStamp;
+            return pEntry;
+        }
+    }
+
+    return 0;
+}
+
+// stores the resolution of a URI
+// replaces the least recently used entry
+// URIs longer than TCPIP_HTTP_NET_PATH_CACHE_URI_LEN are not cached
+static void _HTTP_PathCacheAdd(const char* uri, uint16_t uriLen, uint32_t uriHash, uint16_t pathFlags)
+{
+    int ix;
+    TCPIP_HTTP_PATH_ENTRY* pEntry;
+    TCPIP_HTTP_PATH_ENTRY* pVictim;
+
+    if(uriLen == 0 || uriLen > sizeof(pEntry->uri))
+    {
+        return;
+    }
+
+    pVictim = httpPathCache;
+    for(ix = 0, pEntry = httpPathCache; ix < sizeof(httpPathCache) / sizeof(*httpPathCache); ix++, pEntry++)
+    {
+        if(pEntry->uriLen == 0)
+        {   // free slot
+            pVictim = pEntry;
+            break;
+        }
+        if(pEntry->lastUse < pVictim->lastUse)
+        {
+            pVictim = pEntry;
+        }
+    }
+
+    pVictim->uriHash = uriHash;
+    pVictim->lastUse = ++httpPathStamp;
+    pVictim->uriLen = uriLen;
+    pVictim->pathFlags = pathFlags;
+    memcpy(pVictim->uri, uri, uriLen);
+}
+
+// discards all the URI resolutions
+// a file system change can make any URI resolve differently
+static void _HTTP_PathCachePurge(void)
+{
+    memset(httpPathCache, 0, sizeof(httpPathCache));
+    httpPathStamp = 0;
+}
+#endif  // (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+// looks up the rendered snapshot of the dynamic file being served
+// the file has to be registered with TCPIP_HTTP_NET_SnapshotFileRegister
+// a deflate compressed response uses the compressed snapshot, ready to be sent
+// returns:
+//      TCPIP_HTTP_SNAP_RES_HIT: the output was copied to the bodyBuff
+//      TCPIP_HTTP_SNAP_RES_WAIT: another connection is rendering the file
+//      TCPIP_HTTP_SNAP_RES_RENDER: the file is rendered;
+//          the output is captured if pHttpCon->snapEntry was set
+static TCPIP_HTTP_SNAP_RES _HTTP_SnapshotGet(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    int ix;
+    uint32_t fHash, freshTicks, currTick;
+    TCPIP_HTTP_SNAP_FILE* pFile;
+    TCPIP_HTTP_SNAP_ENTRY *pEntry, *pVictim;
+
+    if(pHttpCon->bodyBuff == 0 || pHttpCon->httpStatus != TCPIP_HTTP_NET_STAT_GET)
+    {   // no coalescing buffer or not a plain GET
+        return TCPIP_HTTP_SNAP_RES_RENDER;
+    }
+
+    fHash = fnv_32_hash(pHttpCon->fileName, strlen(pHttpCon->fileName));
+    freshTicks = 0;
+    for(ix = 0, pFile = httpSnapFiles; ix < sizeof(httpSnapFiles) / sizeof(*httpSnapFiles); ix++, pFile++)
+    {
+        if(pFile->fHash == fHash)
+        {
+            freshTicks = pFile->freshTicks;
+            break;
+        }
+    }
+
+    if(freshTicks == 0)
+    {   // not registered
+        return TCPIP_HTTP_SNAP_RES_RENDER;
+    }
+
+    currTick = SYS_TMR_TickCountGet();
+    pVictim = 0;
+    for(ix = 0, pEntry = httpSnapCache; ix < sizeof(httpSnapCache) / sizeof(*httpSnapCache); ix++, pEntry++)
+    {
+        if(pEntry->state != TCPIP_HTTP_SNAP_STATE_FREE && pEntry->stale == 0 && pEntry->fHash == fHash && pEntry->qHash == pHttpCon->queryHash && pEntry->deflated == pHttpCon->flags.bodyDeflate)
+        {   // found it
+            break;
+        }
+
+        // replace a free entry or the oldest one that's not being rendered
+        if(pEntry->state == TCPIP_HTTP_SNAP_STATE_FREE)
+        {
+            if(pVictim == 0 || pVictim->state != TCPIP_HTTP_SNAP_STATE_FREE)
+            {
+                pVictim = pEntry;
+            }
+        }
+        else if(pEntry->state != TCPIP_HTTP_SNAP_STATE_RENDER)
+        {
+            if(pVictim == 0 || (pVictim->state != TCPIP_HTTP_SNAP_STATE_FREE && (int32_t)(pEntry->renderTick - pVictim->renderTick) < 0))
+            {
+                pVictim = pEntry;
+            }
+        }
+    }
+
+    if(ix != sizeof(httpSnapCache) / sizeof(*httpSnapCache))
+    {
+        if(currTick - pEntry->renderTick < pEntry->freshTicks)
+        {   // still fresh
+            if(pEntry->state == TCPIP_HTTP_SNAP_STATE_VALID)
+            {
+                memcpy(pHttpCon->bodyBuff + TCPIP_HTTP_CHUNK_HEADER_LEN, pEntry->data, pEntry->dataLen);
+                pHttpCon->bodyLen = pEntry->dataLen;
+                httpSnapHits++;
+                return TCPIP_HTTP_SNAP_RES_HIT;
+            }
+
+            return pEntry->state == TCPIP_HTTP_SNAP_STATE_RENDER ? TCPIP_HTTP_SNAP_RES_WAIT : TCPIP_HTTP_SNAP_RES_RENDER;
+        }
+
+        if(pEntry->state == TCPIP_HTTP_SNAP_STATE_RENDER)
+        {   // the rendering takes longer than the window; don't wait for it
+            return TCPIP_HTTP_SNAP_RES_RENDER;
+        }
+
+        // expired: render it again
+        pVictim = pEntry;
+    }
+
+    if(pVictim == 0)
+    {   // all entries are being rendered
+        return TCPIP_HTTP_SNAP_RES_RENDER;
+    }
+
+    if(pVictim->data == 0)
+    {
+        pVictim->data = (uint8_t*)(*http_malloc_fnc)(TCPIP_HTTP_SNAPSHOT_MAX_SIZE);
+        if(pVictim->data == 0)
+        {   // out of memory; just render it
+            return TCPIP_HTTP_SNAP_RES_RENDER;
+        }
+    }
+
+    pVictim->fHash = fHash;
+    pVictim->qHash = pHttpCon->queryHash;
+    pVictim->deflated = pHttpCon->flags.bodyDeflate;
+    pVictim->renderTick = currTick;
+    pVictim->freshTicks = freshTicks;
+    pVictim->dataLen = 0;
+    pVictim->state = TCPIP_HTTP_SNAP_STATE_RENDER;
+    pVictim->stale = 0;
+    pHttpCon->snapEntry = pVictim;
+    httpSnapMisses++;
+
+    return TCPIP_HTTP_SNAP_RES_RENDER;
+}
+
+// appends rendered output to the connection snapshot entry
+static void _HTTP_SnapshotCapture(TCPIP_HTTP_NET_CONN* pHttpCon, const void* data, uint16_t dataLen)
+{
+    TCPIP_HTTP_SNAP_ENTRY* pEntry = pHttpCon->snapEntry;
+
+    if(pEntry->dataLen + dataLen > TCPIP_HTTP_SNAPSHOT_MAX_SIZE)
+    {   // too large to be kept
+        _HTTP_SnapshotEnd(pHttpCon, TCPIP_HTTP_SNAP_STATE_VOLATILE);
+        return;
+    }
+
+    memcpy(pEntry->data + pEntry->dataLen, data, dataLen);
+    pEntry->dataLen += dataLen;
+}
+
+// ends the output capture of a connection
+// endState: TCPIP_HTTP_SNAP_STATE_VALID if the whole output was captured
+//           TCPIP_HTTP_SNAP_STATE_VOLATILE if the output cannot be shared
+//           TCPIP_HTTP_SNAP_STATE_FREE if the rendering was aborted
+static void _HTTP_SnapshotEnd(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_SNAP_STATE endState)
+{
+    TCPIP_HTTP_SNAP_ENTRY* pEntry = pHttpCon->snapEntry;
+
+    if(pEntry != 0)
+    {
+        pEntry->state = pEntry->stale != 0 ? TCPIP_HTTP_SNAP_STATE_FREE : endState;
+        pEntry->stale = 0;
+        pHttpCon->snapEntry = 0;
+    }
+}
+
+// discards all the rendered snapshots
+// the entries being rendered are discarded when the rendering ends
+// freeData: the snapshot buffers are freed too; no rendering should be in progress
+static void _HTTP_SnapshotPurge(bool freeData)
+{
+    int ix;
+    TCPIP_HTTP_SNAP_ENTRY* pEntry = httpSnapCache;
+
+    for(ix = 0; ix < sizeof(httpSnapCache) / sizeof(*httpSnapCache); ix++, pEntry++)
+    {
+        if(freeData)
+        {
+            if(pEntry->data != 0)
+            {
+                (*http_free_fnc)(pEntry->data);
+            }
+            memset(pEntry, 0, sizeof(*pEntry));
+        }
+        else if(pEntry->state == TCPIP_HTTP_SNAP_STATE_RENDER)
+        {
+            pEntry->stale = 1;
+        }
+        else
+        {
+            pEntry->state = TCPIP_HTTP_SNAP_STATE_FREE;
+        }
+    }
+}
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+
+void TCPIP_HTTP_NET_FileCacheInvalidate(const char* fileName)
+{
+#if (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
+    if(fileName != 0)
+    {   // the header block carries the file validators
+        _HTTP_HeaderCachePurge(fileName);
+    }
+#endif  // (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
+
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+    if(fileName != 0)
+    {
+        _HTTP_FileCachePurge(fileName);
+    }
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+
+#if (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+    // a new file may satisfy a URI that was not found
+    _HTTP_PathCachePurge();
+#endif  // (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+    // the file may be included by a rendered page
+    _HTTP_SnapshotPurge(false);
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+}
+
+uint8_t* TCPIP_HTTP_NET_URLDecode(uint8_t* cData)
+{
+    uint8_t *pRead, *pWrite;
+    uint16_t wLen;
+    uint8_t c;
+    uint16_t hex;
+
+    // Determine length of input
+    wLen = strlen((char*)cData);
+
+    // Read all characters in the string
+    for(pRead = pWrite = cData; wLen != 0u; )
+    {
+        c = *pRead++;
+        wLen--;
+
+        if(c == '=' || c == '&')
+        {
+            *pWrite++ = '\0';
+        }
+        else if(c == '+')
+        {
+            *pWrite++ = ' ';
+        }
+        else if(c == '%')
+        {
+            if(wLen < 2u)
+            {
+                wLen = 0;
+            }
+            else
+            {
+                ((uint8_t*)&hex)[1] = *pRead++;
+                ((uint8_t*)&hex)[0] = *pRead++;
+                wLen--;
+                wLen--;
+                *pWrite++ = hexatob(hex);
+            }
+        }
+        else
+        {
+            *pWrite++ = c;
+        }
+    }
+
+    // Double null terminate the last value
+    *pWrite++ = '\0';
+    *pWrite = '\0';
+
+    return pWrite;
+}
+
+const uint8_t* TCPIP_HTTP_NET_ArgGet(const uint8_t* cData, const uint8_t* cArg)
+{
+    // Search through the array while bytes remain
+    while(*cData != '\0')
+    { 
+        // Look for arg at current position
+        if(!strcmp((const char*)cArg, (const char*)cData))
+        {   // Found it, so return parameter
+            return cData + strlen((const char*)cArg) + 1;
+        }
+
+        // Skip past two strings (NUL bytes)
+        cData += strlen((const char*)cData) + 1;
+        cData += strlen((const char*)cData) + 1;
+    }
+
+    // Return NULL if not found
+    return NULL;
+}
+
+
+#if defined(TCPIP_HTTP_NET_USE_POST)
+TCPIP_HTTP_NET_READ_STATUS TCPIP_HTTP_NET_ConnectionPostNameRead(TCPIP_HTTP_NET_CONN_HANDLE connHandle, uint8_t* cData, uint16_t wLen)
+{
+    TCPIP_HTTP_NET_READ_STATUS status;
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+
+    status = _HTTP_ReadTo(pHttpCon, '=', cData, wLen);
+
+    // Decode the data (if not reading to null or blank) and return
+    if(cData && *cData)
+    {
+        TCPIP_HTTP_NET_URLDecode(cData);
+    }
+    return status;
+}   
+#endif
+
+#if defined(TCPIP_HTTP_NET_USE_POST)
+TCPIP_HTTP_NET_READ_STATUS TCPIP_HTTP_NET_ConnectionPostValueRead(TCPIP_HTTP_NET_CONN_HANDLE connHandle, uint8_t* cData, uint16_t wLen)
+{
+    TCPIP_HTTP_NET_READ_STATUS status;
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+
+    // Try to read the value
+    status = _HTTP_ReadTo(pHttpCon, '&', cData, wLen);
+
+    // If read was incomplete, check if we're at the end
+    if(status == TCPIP_HTTP_NET_READ_INCOMPLETE)
+    {
+        // If all data has arrived, read all remaining data
+        if(pHttpCon->byteCount == NET_PRES_SocketReadIsReady(pHttpCon->socket))
+        {
+            status = _HTTP_ReadTo(pHttpCon, '\0', cData, wLen);
+        }
+    }
+
+    // Decode the data (if not reading to null or blank) and return
+    if(cData && *cData)
+    {
+        TCPIP_HTTP_NET_URLDecode(cData);
+    }
+    return status;
+}   
+#endif
+
+/*****************************************************************************
+  Function:
+    static TCPIP_HTTP_NET_READ_STATUS _HTTP_ReadTo(TCPIP_HTTP_NET_CONN* pHttpCon, uint8_t cDelim, uint8_t* cData, uint16_t wLen)
+
+  Summary:
+    Reads to a buffer until a specified delimiter character.
+
+  Description:
+    Reads from the TCP buffer to cData until either cDelim is reached, or
+    until wLen - 2 bytes have been read.  The value read is saved to cData and 
+    null terminated.  (wLen - 2 is used so that the value can be passed to
+    TCPIP_HTTP_NET_URLDecode later, which requires a null terminator plus one extra free
+    byte.)
+    
+    The delimiter character is removed from the buffer, but not saved to 
+    cData. If all data cannot fit into cData, it will still be removed from 
+    the buffer but will not be saved anywhere.
+
+    This function properly updates pHttpCon->byteCount by decrementing it
+    by the number of bytes read. 
+
+  Precondition:
+    None
+
+  Parameters:
+    cDelim - the character at which to stop reading, or NULL to read to
+             the end of the buffer
+    cData - where to store the data being read
+    wLen - how many bytes can be written to cData
+
+  Return Values:
+    TCPIP_HTTP_NET_READ_OK - data was successfully read
+    TCPIP_HTTP_NET_READ_TRUNCTATED - entire data could not fit in the buffer, so the
+                            data was truncated and data has been lost
+    TCPIP_HTTP_NET_READ_INCOMPLETE - delimiter character was not found
+  ***************************************************************************/
+#if defined(TCPIP_HTTP_NET_USE_POST)
+static TCPIP_HTTP_NET_READ_STATUS _HTTP_ReadTo(TCPIP_HTTP_NET_CONN* pHttpCon, uint8_t cDelim, uint8_t* cData, uint16_t wLen)
+{
+    TCPIP_HTTP_NET_READ_STATUS status;
+    uint16_t wPos;
+
+    // Either look for delimiter, or read all available data
+    if(cDelim)
+    {
+        wPos = _HTTP_ConnectionCharFind(pHttpCon, cDelim, 0, 0);
+    }
+    else
+    {
+        wPos = NET_PRES_SocketReadIsReady(pHttpCon->socket);
+    }
+
+    // If not found, return incomplete
+    if(wPos == 0xffff)
+    {
+        return TCPIP_HTTP_NET_READ_INCOMPLETE;
+    }
+
+    // Read the value
+    if(wLen < 2u && cData != NULL)
+    {   // Buffer is too small, so read to NULL instead
+        pHttpCon->byteCount -= _HTTP_ConnectionDiscard(pHttpCon, wPos);
+        status = TCPIP_HTTP_NET_READ_TRUNCATED;
+    }
+    else if(cData == NULL)
+    {   // Just remove the data
+        pHttpCon->byteCount -= _HTTP_ConnectionDiscard(pHttpCon, wPos);
+        status = TCPIP_HTTP_NET_READ_OK;
+    }
+    else if(wPos > wLen - 2)
+    {   // Read data, but truncate at max length
+        pHttpCon->byteCount -= NET_PRES_SocketRead(pHttpCon->socket, cData, wLen - 2);
+        pHttpCon->byteCount -= _HTTP_ConnectionDiscard(pHttpCon, wPos - (wLen - 2));
+        cData[wLen - 2] = '\0';
+        status = TCPIP_HTTP_NET_READ_TRUNCATED;
+    }
+    else
+    {   // Read the data normally
+        pHttpCon->byteCount -= NET_PRES_SocketRead(pHttpCon->socket, cData, wPos);
+        cData[wPos] = '\0';
+        status = TCPIP_HTTP_NET_READ_OK;
+    }
+
+    // Remove the delimiter
+    if(cDelim)
+    {
+        pHttpCon->byteCount -= _HTTP_ConnectionDiscard(pHttpCon, 1);
+    }
+
+    return status;
+}   
+#endif
+
+#if (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+TCPIP_HTTP_NET_IO_RESULT TCPIP_HTTP_NET_ConnectionFormParse(TCPIP_HTTP_NET_CONN_HANDLE connHandle, TCPIP_HTTP_NET_FORM_CALLBACK formCback, const void* param)
+{
+    uint16_t avlblBytes, readBytes;
+    bool parseOk;
+    TCPIP_HTTP_NET_IO_RESULT ioRes;
+    TCPIP_HTTP_FORM_DCPT* pForm;
+    uint8_t readBuff[TCPIP_HTTP_FORM_READ_SIZE];
+    uint8_t endDelim = '&';
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+
+    if((pForm = pHttpCon->formDcpt) == 0)
+    {   // first call for this request; the multipart state is allocated with the request headers
+        if(pHttpCon->flags.formMultipart != 0 || (pForm = _HTTP_FormAlloc(pHttpCon, TCPIP_HTTP_FORM_STATE_NAME)) == 0)
+        {
+            return TCPIP_HTTP_NET_IO_RES_ERROR;
+        }
+    }
+
+    // consume all the available POST data, in one pass
+    parseOk = true;
+    while(parseOk && pHttpCon->byteCount != 0)
+    {
+        avlblBytes = NET_PRES_SocketReadIsReady(pHttpCon->socket);
+        if(avlblBytes > pHttpCon->byteCount)
+        {   // don't touch a pipelined request
+            avlblBytes = pHttpCon->byteCount;
+        }
+        if(avlblBytes > sizeof(readBuff))
+        {
+            avlblBytes = sizeof(readBuff);
+        }
+
+        if(avlblBytes == 0 || (readBytes = NET_PRES_SocketRead(pHttpCon->socket, readBuff, avlblBytes)) == 0)
+        {   // wait for more data
+            break;
+        }
+        pHttpCon->byteCount -= readBytes;
+
+        if(pHttpCon->flags.formMultipart != 0)
+        {
+            parseOk = _HTTP_FormMultipartParse(pHttpCon, pForm, readBuff, readBytes, formCback, param);
+        }
+        else
+        {
+            parseOk = _HTTP_FormUrlParse(pHttpCon, pForm, readBuff, readBytes, formCback, param);
+        }
+    }
+
+    if(!parseOk)
+    {
+        ioRes = TCPIP_HTTP_NET_IO_RES_ERROR;
+    }
+    else if(pHttpCon->byteCount != 0)
+    {
+        return TCPIP_HTTP_NET_IO_RES_NEED_DATA;
+    }
+    else if(pHttpCon->flags.formMultipart != 0)
+    {   // all data received; a multipart body should end with the close delimiter
+        ioRes = (pForm->state == TCPIP_HTTP_FORM_STATE_EPILOGUE) ? TCPIP_HTTP_NET_IO_RES_DONE : TCPIP_HTTP_NET_IO_RES_ERROR;
+    }
+    else
+    {   // all data received; complete the last field
+        ioRes = TCPIP_HTTP_NET_IO_RES_DONE;
+        if(pForm->state == TCPIP_HTTP_FORM_STATE_VALUE || pForm->nameLen != 0)
+        {
+            if(!_HTTP_FormUrlParse(pHttpCon, pForm, &endDelim, 1, formCback, param))
+            {
+                ioRes = TCPIP_HTTP_NET_IO_RES_ERROR;
+            }
+        }
+    }
+
+    _HTTP_FormRelease(pHttpCon);
+    return ioRes;
+}
+
+// reports a form event to the user
+static bool _HTTP_FormEvent(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_FORM_DCPT* pForm, TCPIP_HTTP_NET_FORM_EVENT event, const uint8_t* data, uint16_t dataLen,
+                            TCPIP_HTTP_NET_FORM_CALLBACK formCback, const void* param)
+{
+    bool cbackRes = (*formCback)(pHttpCon, event, &pForm->field, data, dataLen, param);
+
+    if(event == TCPIP_HTTP_NET_FORM_EVENT_VALUE)
+    {
+        pForm->field.valueOffset += dataLen;
+    }
+    else if(event == TCPIP_HTTP_NET_FORM_EVENT_END)
+    {
+        pForm->field.valueOffset = 0;
+    }
+
+    if(!cbackRes)
+    {
+        pForm->state = TCPIP_HTTP_FORM_STATE_ERROR;
+    }
+    return cbackRes;
+}
+
+// parses a block of application/x-www-form-urlencoded data
+// the value is decoded in place, in the read buffer
+static bool _HTTP_FormUrlParse(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_FORM_DCPT* pForm, uint8_t* buff, uint16_t buffLen,
+                               TCPIP_HTTP_NET_FORM_CALLBACK formCback, const void* param)
+{
+    uint8_t c;
+    uint8_t* pSrc = buff;
+    uint8_t* pEnd = buff + buffLen;
+    uint8_t* pRun = buff;           // start of the decoded value run
+    uint8_t* pDst = buff;           // end of the decoded value run
+
+    while(pSrc != pEnd)
+    {
+        c = *pSrc++;
+
+        if(pForm->state == TCPIP_HTTP_FORM_STATE_NAME)
+        {
+            if(c == '=' || c == '&')
+            {   // name complete
+                pForm->name[pForm->nameLen] = 0;
+                TCPIP_HTTP_NET_URLDecode((uint8_t*)pForm->name);
+                pForm->nameLen = 0;
+                if(!_HTTP_FormEvent(pHttpCon, pForm, TCPIP_HTTP_NET_FORM_EVENT_NAME, 0, 0, formCback, param))
+                {
+                    return false;
+                }
+
+                if(c == '&')
+                {   // field with no value
+                    if(!_HTTP_FormEvent(pHttpCon, pForm, TCPIP_HTTP_NET_FORM_EVENT_END, 0, 0, formCback, param))
+                    {
+                        return false;
+                    }
+                }
+                else
+                {
+                    pForm->state = TCPIP_HTTP_FORM_STATE_VALUE;
+                    pForm->hexLen = 0;
+                    pRun = pDst = pSrc;
+                }
+            }
+            else if(pForm->nameLen < TCPIP_HTTP_NET_FORM_NAME_LEN)
+            {   // longer names are truncated
+                pForm->name[pForm->nameLen++] = c;
+            }
+            continue;
+        }
+
+        // TCPIP_HTTP_FORM_STATE_VALUE
+        if(c == '&')
+        {   // value complete
+            if(pDst != pRun && !_HTTP_FormEvent(pHttpCon, pForm, TCPIP_HTTP_NET_FORM_EVENT_VALUE, pRun, pDst - pRun, formCback, param))
+            {
+                return false;
+            }
+            if(!_HTTP_FormEvent(pHttpCon, pForm, TCPIP_HTTP_NET_FORM_EVENT_END, 0, 0, formCback, param))
+            {
+                return false;
+            }
+            pForm->state = TCPIP_HTTP_FORM_STATE_NAME;
+        }
+        else if(pForm->hexLen != 0)
+        {   // %XX sequence, possibly split across reads
+            pForm->hexChars[pForm->hexLen - 1] = c;
+            if(++pForm->hexLen == 3)
+            {
+                *pDst++ = hexatob(((uint16_t)pForm->hexChars[0] << 8) | pForm->hexChars[1]);
+                pForm->hexLen = 0;
+            }
+        }
+        else if(c == '%')
+        {
+            pForm->hexLen = 1;
+        }
+        else
+        {
+            *pDst++ = (c == '+') ? ' ' : c;
+        }
+    }
+
+    if(pForm->state == TCPIP_HTTP_FORM_STATE_VALUE && pDst != pRun)
+    {
+        return _HTTP_FormEvent(pHttpCon, pForm, TCPIP_HTTP_NET_FORM_EVENT_VALUE, pRun, pDst - pRun, formCback, param);
+    }
+
+    return true;
+}
+
+// parses a block of multipart/form-data
+// the part data is reported directly from the read buffer;
+// the bytes that could start a delimiter are held back until the match fails
+static bool _HTTP_FormMultipartParse(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_FORM_DCPT* pForm, uint8_t* buff, uint16_t buffLen,
+                                     TCPIP_HTTP_NET_FORM_CALLBACK formCback, const void* param)
+{
+    uint8_t c;
+    size_t lineLen;
+    uint8_t* pRun;
+    uint8_t* pSrc = buff;
+    uint8_t* pEnd = buff + buffLen;
+
+    while(pSrc != pEnd)
+    {
+        switch(pForm->state)
+        {
+            case TCPIP_HTTP_FORM_STATE_PREAMBLE:
+            case TCPIP_HTTP_FORM_STATE_PART_HEADER:
+                c = *pSrc++;
+                if(c != '\n')
+                {   // longer lines are truncated
+                    if(pForm->hdrLen < TCPIP_HTTP_NET_FORM_HEADER_LEN)
+                    {
+                        pForm->hdrLine[pForm->hdrLen++] = c;
+                    }
+                    break;
+                }
+
+                // line complete
+                lineLen = pForm->hdrLen;
+                if(lineLen != 0 && pForm->hdrLine[lineLen - 1] == '\r')
+                {
+                    lineLen--;
+                }
+                pForm->hdrLine[lineLen] = 0;
+                pForm->hdrLen = 0;
+
+                if(pForm->state == TCPIP_HTTP_FORM_STATE_PREAMBLE)
+                {   // only the "--" boundary line starts the first part; other lines are ignored
+                    if(strncmp(pForm->hdrLine, pForm->delim + 2, pForm->delimLen - 2) == 0)
+                    {
+                        pRun = (uint8_t*)pForm->hdrLine + pForm->delimLen - 2;
+                        if(strcmp((char*)pRun, "--") == 0)
+                        {   // close delimiter: no parts
+                            pForm->state = TCPIP_HTTP_FORM_STATE_EPILOGUE;
+                        }
+                        else if(pRun[strspn((char*)pRun, " \t")] == 0)
+                        {   // transport padding allowed
+                            pForm->name[0] = pForm->fileName[0] = 0;
+                            pForm->state = TCPIP_HTTP_FORM_STATE_PART_HEADER;
+                        }
+                    }
+                }
+                else if(lineLen == 0)
+                {   // part headers done
+                    if(!_HTTP_FormEvent(pHttpCon, pForm, TCPIP_HTTP_NET_FORM_EVENT_NAME, 0, 0, formCback, param))
+                    {
+                        return false;
+                    }
+                    pForm->delimMatch = 0;
+                    pForm->state = TCPIP_HTTP_FORM_STATE_PART_DATA;
+                }
+                else
+                {
+                    _HTTP_FormPartHeaderParse(pForm);
+                }
+                break;
+
+            case TCPIP_HTTP_FORM_STATE_PART_DATA:
+                pRun = pSrc;
+                while(pSrc != pEnd)
+                {
+                    c = *pSrc;
+                    if(c == (uint8_t)pForm->delim[pForm->delimMatch])
+                    {
+                        if(pForm->delimMatch == 0 && pSrc != pRun)
+                        {   // report the data before a possible delimiter
+                            if(!_HTTP_FormEvent(pHttpCon, pForm, TCPIP_HTTP_NET_FORM_EVENT_VALUE, pRun, pSrc - pRun, formCback, param))
+                            {
+                                return false;
+                            }
+                        }
+                        pRun = ++pSrc;
+                        if(++pForm->delimMatch == pForm->delimLen)
+                        {   // part complete
+                            if(!_HTTP_FormEvent(pHttpCon, pForm, TCPIP_HTTP_NET_FORM_EVENT_END, 0, 0, formCback, param))
+                            {
+                                return false;
+                            }
+                            pForm->state = TCPIP_HTTP_FORM_STATE_DELIM_END;
+                            break;
+                        }
+                    }
+                    else if(pForm->delimMatch != 0)
+                    {   // not a delimiter: the held back bytes are part data
+                        // the delimiter has a single '\r', so the current byte is checked again from the start
+                        if(!_HTTP_FormEvent(pHttpCon, pForm, TCPIP_HTTP_NET_FORM_EVENT_VALUE, (const uint8_t*)pForm->delim, pForm->delimMatch, formCback, param))
+                        {
+                            return false;
+                        }
+                        pForm->delimMatch = 0;
+                    }
+                    else
+                    {
+                        pSrc++;
+                    }
+                }
+
+                if(pForm->state == TCPIP_HTTP_FORM_STATE_PART_DATA && pSrc != pRun)
+                {
+                    if(!_HTTP_FormEvent(pHttpCon, pForm, TCPIP_HTTP_NET_FORM_EVENT_VALUE, pRun, pSrc - pRun, formCback, param))
+                    {
+                        return false;
+                    }
+                }
+                break;
+
+            case TCPIP_HTTP_FORM_STATE_DELIM_END:
+                c = *pSrc++;
+                if(c == '-')
+                {   // close delimiter
+                    pForm->state = TCPIP_HTTP_FORM_STATE_EPILOGUE;
+                }
+                else if(c == '\n')
+                {   // a new part follows
+                    pForm->name[0] = pForm->fileName[0] = 0;
+                    pForm->state = TCPIP_HTTP_FORM_STATE_PART_HEADER;
+                }
+                // else transport padding; ignored
+                break;
+
+            case TCPIP_HTTP_FORM_STATE_EPILOGUE:
+                pSrc = pEnd;
+                break;
+
+            default:
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// parses a multipart part header line
+// only the Content-Disposition name and filename parameters are used
+static void _HTTP_FormPartHeaderParse(TCPIP_HTTP_FORM_DCPT* pForm)
+{
+    char* pParam;
+    char* pValue = strchr(pForm->hdrLine, ':');
+
+    if(pValue == 0)
+    {
+        return;
+    }
+
+    *pValue++ = 0;
+    if(stricmp(pForm->hdrLine, "Content-Disposition") != 0)
+    {
+        return;
+    }
+
+    for(pParam = strchr(pValue, ';'); pParam != 0; pParam = strchr(pParam, ';'))
+    {
+        pParam++;
+        pParam += strspn(pParam, " ");
+        if(strncmp(pParam, "name=", 5) == 0)
+        {
+            _HTTP_FormParamCopy(pForm->name, pParam + 5);
+        }
+        else if(strncmp(pParam, "filename=", 9) == 0)
+        {
+            _HTTP_FormParamCopy(pForm->fileName, pParam + 9);
+        }
+    }
+}
+
+// copies a (quoted) header parameter value
+// the value is truncated to TCPIP_HTTP_NET_FORM_NAME_LEN characters
+static void _HTTP_FormParamCopy(char* dest, const char* value)
+{
+    int len;
+    char endChar = ';';
+
+    if(*value == '"')
+    {
+        endChar = '"';
+        value++;
+    }
+
+    for(len = 0; *value != 0 && *value != endChar && len < TCPIP_HTTP_NET_FORM_NAME_LEN; len++)
+    {
+        *dest++ = *value++;
+    }
+    *dest = 0;
+}
+
+// allocates the form parser state of a connection, starting in the state
+static TCPIP_HTTP_FORM_DCPT* _HTTP_FormAlloc(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_FORM_STATE state)
+{
+    TCPIP_HTTP_FORM_DCPT* pForm = (TCPIP_HTTP_FORM_DCPT*)(*http_malloc_fnc)(sizeof(*pForm));
+
+    if(pForm != 0)
+    {
+        memset(pForm, 0, sizeof(*pForm));
+        pForm->field.name = pForm->name;
+        pForm->field.fileName = pForm->fileName;
+        pForm->state = (uint8_t)state;
+        pHttpCon->formDcpt = pForm;
+    }
+    return pForm;
+}
+
+// releases the form parser state of a connection
+static void _HTTP_FormRelease(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    if(pHttpCon->formDcpt != 0)
+    {
+        (*http_free_fnc)(pHttpCon->formDcpt);
+        pHttpCon->formDcpt = 0;
+    }
+}
+#endif  // (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+
+/*****************************************************************************
+  Function:
+    static TCPIP_HTTP_NET_IO_RESULT TCPIP_HTTP_NET_FSUpload(TCPIP_HTTP_NET_CONN* pHttpCon)
+
+  Summary:
+    Saves a file uploaded via POST as the new image in EEPROM or 
+    external Flash.
+
+  Description:
+    Allows the FS image in EEPROM or external Flash to be updated via a 
+    web page by accepting a file upload and storing it to the external memory.
+    The image is received in MPFS_UPLOAD_WRITE_BUFFERS buffers: the socket
+    fills one buffer while the media writes another one, so the receive
+    window is not closed by the media erase/write operations.
+    The old image is invalidated first and the image first sector is written
+    last, only after the image read back from the media matches the CRC
+    of the received data.
+
+  Precondition:
+    None
+
+  Parameters:
+    None
+
+  Return Values:
+    TCPIP_HTTP_NET_IO_RES_DONE - on success
+    TCPIP_HTTP_NET_IO_RES_NEED_DATA - if more data is still expected
+
+  Remarks:
+    This function is only available when FS uploads are enabled and
+    the FS image could be stored (EEPROM, flash, etc.)
+
+  ***************************************************************************/
+#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+#define     SYS_FS_MEDIA_SECTOR_SIZE        512     
+static TCPIP_HTTP_NET_IO_RESULT TCPIP_HTTP_NET_FSUpload(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    uint8_t mpfsBuffer[sizeof(MPFS_SIGNATURE) - 1];  // large enough to hold the MPFS signature
+    uint16_t lenA;
+    int cmdRes;
+    TCPIP_HTTP_UPLOAD_DCPT* pUpload;
+
+    switch(pHttpCon->httpStatus)
+    {
+        // New upload, so look for the CRLFCRLF
+        case TCPIP_HTTP_NET_STAT_UPLOAD_STARTED:
+            if(pHttpCon->flags.uploadPhase == 0)
+            {   // just starting
+                uint32_t peekRes = _HTTP_ConnectionStringFind(pHttpCon, "\r\n\r\n", 0, 0);
+
+                if((uint16_t)peekRes == 0xffff)
+                {   // End of line not found, remove as much as possible
+                    lenA = peekRes >> 16;   // get the # of bytes safe to remove
+                    if(lenA > 4)
+                    {
+                        lenA = _HTTP_ConnectionDiscard(pHttpCon, lenA - 4);
+                        pHttpCon->byteCount -= lenA;
+                    }
+                    break;
+                }
+
+                // Found end of line, so remove all data up to and including
+                lenA = _HTTP_ConnectionDiscard(pHttpCon, (uint16_t)peekRes + 4);
+                pHttpCon->byteCount -= (lenA + 4);
+
+                pHttpCon->flags.uploadPhase = 1;
+                break;
+            }
+            // waiting for the signature
+            // Make sure first 6 bytes are also in
+            if(NET_PRES_SocketReadIsReady(pHttpCon->socket) < sizeof(MPFS_SIGNATURE) - 1 )
+            {
+                return TCPIP_HTTP_NET_IO_RES_NEED_DATA;
+            }
+
+            // reset the phase, we're done
+            pHttpCon->flags.uploadPhase = 0;
+
+            lenA = NET_PRES_SocketRead(pHttpCon->socket, mpfsBuffer, sizeof(MPFS_SIGNATURE) - 1);
+            pHttpCon->byteCount -= lenA;
+            if(memcmp(mpfsBuffer, (const void*)MPFS_SIGNATURE, sizeof(MPFS_SIGNATURE) - 1) != 0)
+            {   // wrong signature
+                pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_ERROR;
+                return TCPIP_HTTP_NET_IO_RES_WAITING;
+            }
+
+            // proper file version
+            // one upload at a time; the buffers of an aborted upload are released once the media is idle
+            if(httpUploadDcpt != 0)
+            {   // the client can retry later
+                pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_BUSY;
+                return TCPIP_HTTP_NET_IO_RES_WAITING;
+            }
+
+            if((pUpload = _HTTP_UploadAlloc(pHttpCon)) != 0)
+            {
+                memcpy(pUpload->fillPtr, MPFS_SIGNATURE, sizeof(MPFS_SIGNATURE) - 1);
+                _HTTP_UploadAdvance(pUpload, sizeof(MPFS_SIGNATURE) - 1);
+
+                SYS_FS_Unmount(MPFS_UPLOAD_MOUNT_PATH);
+
+                // invalidate the old image first, so that a partial upload cannot be mounted
+                if(!_HTTP_UploadWrite(pUpload, TCPIP_HTTP_UPLOAD_CMD_HEAD, 0, pUpload->headSector, 1))
+                {
+                    _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FS_WRITE_ERROR, pHttpCon->fileName);
+                    pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_ERROR;
+                    return TCPIP_HTTP_NET_IO_RES_WAITING;
+                }
+
+                pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_WRITE;
+                return TCPIP_HTTP_NET_IO_RES_WAITING;
+            }
+
+            // memory allocation failed
+            pHttpCon->flags.uploadMemError = 1; // signal out of memory
+            _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_UPLOAD_ALLOC_ERROR, pHttpCon->fileName);
+            pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_ERROR;
+            return TCPIP_HTTP_NET_IO_RES_WAITING;
+
+        case TCPIP_HTTP_NET_STAT_UPLOAD_WRITE:
+            // receive while the media writes the previous buffers
+            pUpload = httpUploadDcpt;
+            if((cmdRes = _HTTP_UploadCmdCheck(pUpload)) < 0 || (cmdRes > 0 && !_HTTP_UploadWriteNext(pUpload)))
+            {
+                _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FS_WRITE_ERROR, pHttpCon->fileName);
+                pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_ERROR;
+                return TCPIP_HTTP_NET_IO_RES_WAITING;
+            }
+
+            while(pUpload->nFull < pUpload->nBuffers && pHttpCon->byteCount != 0)
+            {
+                lenA = NET_PRES_SocketReadIsReady(pHttpCon->socket);
+                if(lenA > pUpload->buffStart + (pUpload->fillIx + 1) * pUpload->buffSize - pUpload->fillPtr)
+                {
+                    lenA = pUpload->buffStart + (pUpload->fillIx + 1) * pUpload->buffSize - pUpload->fillPtr;
+                }
+
+                if(lenA > pHttpCon->byteCount)
+                {
+                    lenA = pHttpCon->byteCount;
+                }
+
+                if(lenA == 0 || (lenA = NET_PRES_SocketRead(pHttpCon->socket, pUpload->fillPtr, lenA)) == 0)
+                {
+                    break;
+                }
+                pHttpCon->byteCount -= lenA;
+                _HTTP_UploadAdvance(pUpload, lenA);
+            }
+
+            if(pHttpCon->byteCount != 0)
+            {
+                return TCPIP_HTTP_NET_IO_RES_WAITING;
+            }
+
+            // all data received; queue the last, partial, buffer
+            if(pUpload->fillPtr != pUpload->buffStart + pUpload->fillIx * pUpload->buffSize)
+            {
+                memset(pUpload->fillPtr, 0xff, pUpload->buffStart + (pUpload->fillIx + 1) * pUpload->buffSize - pUpload->fillPtr);
+                pUpload->nFull++;
+            }
+            pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_WRITE_WAIT;
+            return TCPIP_HTTP_NET_IO_RES_WAITING;
+
+        case TCPIP_HTTP_NET_STAT_UPLOAD_WRITE_WAIT:
+            // flush the buffers, verify the image, then commit it
+            pUpload = httpUploadDcpt;
+            if((cmdRes = _HTTP_UploadCmdCheck(pUpload)) < 0)
+            {
+                _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FS_WRITE_ERROR, pHttpCon->fileName);
+                pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_ERROR;
+                return TCPIP_HTTP_NET_IO_RES_WAITING;
+            }
+            else if(cmdRes == 0)
+            {   // media busy
+                return TCPIP_HTTP_NET_IO_RES_WAITING;
+            }
+
+            if(pUpload->phase == TCPIP_HTTP_UPLOAD_PHASE_WRITE)
+            {
+                if(pUpload->nFull != 0)
+                {
+                    if(!_HTTP_UploadWriteNext(pUpload))
+                    {
+                        _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FS_WRITE_ERROR, pHttpCon->fileName);
+                        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_ERROR;
+                    }
+                    return TCPIP_HTTP_NET_IO_RES_WAITING;
+                }
+
+                // all written; the first sector is verified from RAM
+                pUpload->verifySize = pUpload->imageSize < SYS_FS_MEDIA_SECTOR_SIZE ? pUpload->imageSize : SYS_FS_MEDIA_SECTOR_SIZE;
+                pUpload->verifyCrc = _HTTP_Crc32(0, pUpload->headSector, pUpload->verifySize);
+                pUpload->phase = TCPIP_HTTP_UPLOAD_PHASE_VERIFY;
+            }
+
+            if(pUpload->phase == TCPIP_HTTP_UPLOAD_PHASE_VERIFY)
+            {
+                if(pUpload->verifySize < pUpload->imageSize && !_HTTP_DbgKillFlashWrite())
+                {   // read back the next block
+                    if(!_HTTP_UploadReadNext(pUpload))
+                    {
+                        _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FS_VERIFY_ERROR, pHttpCon->fileName);
+                        pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_ERROR;
+                    }
+                    return TCPIP_HTTP_NET_IO_RES_WAITING;
+                }
+
+                if(pUpload->verifyCrc != pUpload->imageCrc && !_HTTP_DbgKillFlashWrite())
+                {   // the old image stays invalidated
+                    _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FS_VERIFY_ERROR, pHttpCon->fileName);
+                    pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_ERROR;
+                    return TCPIP_HTTP_NET_IO_RES_WAITING;
+                }
+
+                // image verified; the first sector commits it
+                if(!_HTTP_UploadWrite(pUpload, TCPIP_HTTP_UPLOAD_CMD_HEAD, 0, pUpload->headSector, 1))
+                {
+                    _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FS_WRITE_ERROR, pHttpCon->fileName);
+                    pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_ERROR;
+                    return TCPIP_HTTP_NET_IO_RES_WAITING;
+                }
+                pUpload->phase = TCPIP_HTTP_UPLOAD_PHASE_COMMIT;
+                return TCPIP_HTTP_NET_IO_RES_WAITING;
+            }
+
+            // committed; we're done
+            _HTTP_UploadRelease(pHttpCon);
+
+            if(SYS_FS_Mount(MPFS_UPLOAD_NVM_VOL, MPFS_UPLOAD_MOUNT_PATH, MPFS2, 0, NULL)  != SYS_FS_RES_FAILURE)
+            {
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+                // new image: the compiled templates are no longer valid
+                _HTTP_TemplateCachePurge();
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+#if (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
+                // the cached header blocks belong to the old image
+                _HTTP_HeaderCachePurge(0);
+#endif  // (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+                // and so do the cached files
+                _HTTP_FileCachePurge(0);
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+#if (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+                // and the URI resolutions
+                _HTTP_PathCachePurge();
+#endif  // (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+                // and the rendered pages
+                _HTTP_SnapshotPurge(false);
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+                _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FS_UPLOAD_COMPLETE, pHttpCon->fileName);
+                pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_OK;
+                return TCPIP_HTTP_NET_IO_RES_DONE;
+            }
+            else
+            {
+                _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FS_MOUNT_ERROR, pHttpCon->fileName);
+                pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_ERROR;
+                return TCPIP_HTTP_NET_IO_RES_ERROR;
+            }
+
+        case TCPIP_HTTP_NET_STAT_UPLOAD_ERROR:
+        case TCPIP_HTTP_NET_STAT_UPLOAD_BUSY:
+            _HTTP_UploadRelease(pHttpCon);
+#if (_TCPIP_HTTP_NET_PIPELINE != 0)
+            pHttpCon->flags.pipeBreak = 1;  // all the RX data is dropped
+#endif  // (_TCPIP_HTTP_NET_PIPELINE != 0)
+            pHttpCon->byteCount -= NET_PRES_SocketReadIsReady(pHttpCon->socket);
+            NET_PRES_SocketDiscard(pHttpCon->socket);
+            if(pHttpCon->byteCount < 100u || pHttpCon->byteCount > 0x80000000u)
+            {   // If almost all data was read, or if we overflowed, then return
+                return TCPIP_HTTP_NET_IO_RES_DONE;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return TCPIP_HTTP_NET_IO_RES_NEED_DATA;
+}
+
+// allocates the upload descriptor and its buffers
+static TCPIP_HTTP_UPLOAD_DCPT* _HTTP_UploadAlloc(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    TCPIP_HTTP_UPLOAD_DCPT* pUpload;
+    // the buffer size as a multiple of sector size
+    uint32_t buffSize = ((MPFS_UPLOAD_WRITE_BUFFER_SIZE + (SYS_FS_MEDIA_SECTOR_SIZE - 1)) / SYS_FS_MEDIA_SECTOR_SIZE) * SYS_FS_MEDIA_SECTOR_SIZE;
+
+    pUpload = (TCPIP_HTTP_UPLOAD_DCPT*)(*http_malloc_fnc)(sizeof(*pUpload) + MPFS_UPLOAD_WRITE_BUFFERS * buffSize + SYS_FS_MEDIA_SECTOR_SIZE);
+    if(pUpload != 0)
+    {
+        memset(pUpload, 0, sizeof(*pUpload));
+        pUpload->owner = pHttpCon;
+        pUpload->buffStart = (uint8_t*)(pUpload + 1);
+        pUpload->headSector = pUpload->buffStart + MPFS_UPLOAD_WRITE_BUFFERS * buffSize;
+        pUpload->fillPtr = pUpload->buffStart;
+        pUpload->buffSize = buffSize;
+        pUpload->nBuffers = MPFS_UPLOAD_WRITE_BUFFERS;
+        pUpload->cmdHandle = SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID;
+        // the head sector is blank until the image is committed
+        memset(pUpload->headSector, 0xff, SYS_FS_MEDIA_SECTOR_SIZE);
+        httpUploadDcpt = pUpload;
+    }
+
+    return pUpload;
+}
+
+// releases the upload of a connection
+// if a media command is still in progress, the buffers are freed later, by _HTTP_UploadPurge
+static void _HTTP_UploadRelease(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    if(httpUploadDcpt != 0 && httpUploadDcpt->owner == pHttpCon)
+    {
+        httpUploadDcpt->owner = 0;
+        _HTTP_UploadPurge();
+    }
+}
+
+// frees an aborted upload once the media is idle
+static void _HTTP_UploadPurge(void)
+{
+    TCPIP_HTTP_UPLOAD_DCPT* pUpload = httpUploadDcpt;
+
+    if(pUpload != 0 && pUpload->owner == 0)
+    {
+        if(pUpload->cmd == TCPIP_HTTP_UPLOAD_CMD_NONE || _HTTP_UploadCmdCheck(pUpload) != 0)
+        {
+            (*http_free_fnc)(pUpload);
+            httpUploadDcpt = 0;
+        }
+    }
+}
+
+// accounts for the data just copied to the buffer being filled
+// a full buffer is queued for writing
+static void _HTTP_UploadAdvance(TCPIP_HTTP_UPLOAD_DCPT* pUpload, uint16_t len)
+{
+    pUpload->imageCrc = _HTTP_Crc32(pUpload->imageCrc, pUpload->fillPtr, len);
+    pUpload->imageSize += len;
+    pUpload->fillPtr += len;
+
+    if(pUpload->fillPtr == pUpload->buffStart + (pUpload->fillIx + 1) * pUpload->buffSize)
+    {
+        pUpload->nFull++;
+        if(++pUpload->fillIx == pUpload->nBuffers)
+        {
+            pUpload->fillIx = 0;
+        }
+        pUpload->fillPtr = pUpload->buffStart + pUpload->fillIx * pUpload->buffSize;
+    }
+}
+
+// checks the media command in progress
+// returns: > 0 if the media is idle, 0 if the command is in progress, < 0 if the command failed
+static int _HTTP_UploadCmdCheck(TCPIP_HTTP_UPLOAD_DCPT* pUpload)
+{
+    SYS_FS_MEDIA_COMMAND_STATUS cmdStat;
+    uint32_t readLen;
+
+    if(pUpload->cmd == TCPIP_HTTP_UPLOAD_CMD_NONE)
+    {
+        return 1;
+    }
+
+    if(pUpload->cmdHandle != SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID)
+    {
+        cmdStat = SYS_FS_MEDIA_MANAGER_CommandStatusGet(MPFS_UPLOAD_DISK_NO, pUpload->cmdHandle);
+        if(cmdStat == SYS_FS_MEDIA_COMMAND_IN_PROGRESS || cmdStat == SYS_FS_MEDIA_COMMAND_QUEUED)
+        {
+            return 0;
+        }
+        else if(cmdStat != SYS_FS_MEDIA_COMMAND_COMPLETED)
+        {
+            pUpload->cmd = TCPIP_HTTP_UPLOAD_CMD_NONE;
+            return -1;
+        }
+    }
+    // else the write was skipped
+
+    if(pUpload->cmd == TCPIP_HTTP_UPLOAD_CMD_BUFFER)
+    {   // the buffer is free
+        pUpload->nFull--;
+        if(++pUpload->writeIx == pUpload->nBuffers)
+        {
+            pUpload->writeIx = 0;
+        }
+        pUpload->writeOffset += pUpload->buffSize;
+    }
+    else if(pUpload->cmd == TCPIP_HTTP_UPLOAD_CMD_READ)
+    {   // the padding beyond the image end is not part of the CRC
+        readLen = pUpload->imageSize - pUpload->verifySize;
+        if(readLen > pUpload->cmdLen)
+        {
+            readLen = pUpload->cmdLen;
+        }
+        pUpload->verifyCrc = _HTTP_Crc32(pUpload->verifyCrc, pUpload->buffStart, readLen);
+        pUpload->verifySize += readLen;
+    }
+
+    pUpload->cmd = TCPIP_HTTP_UPLOAD_CMD_NONE;
+    return 1;
+}
+
+// starts a media write
+static bool _HTTP_UploadWrite(TCPIP_HTTP_UPLOAD_DCPT* pUpload, TCPIP_HTTP_UPLOAD_CMD cmd, uint32_t sectNo, uint8_t* pData, uint32_t nSectors)
+{
+    if(!_HTTP_DbgKillFlashWrite() && nSectors != 0)
+    {   // try to perform the write
+        pUpload->cmdHandle = SYS_FS_MEDIA_MANAGER_SectorWrite(MPFS_UPLOAD_DISK_NO, sectNo, pData, nSectors);
+        if(pUpload->cmdHandle == SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID)
+        {
+            return false;
+        }
+    }
+    else
+    {   // advance without performing the write
+        pUpload->cmdHandle = SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID;
+    }
+
+    pUpload->cmd = cmd;
+    return true;
+}
+
+// starts writing the next full buffer, if any
+// the image first sector is kept in RAM and written at the commit
+static bool _HTTP_UploadWriteNext(TCPIP_HTTP_UPLOAD_DCPT* pUpload)
+{
+    uint8_t* pData;
+    uint32_t sectNo, nSectors, writeLen;
+
+    if(pUpload->nFull == 0)
+    {
+        return true;
+    }
+
+    pData = pUpload->buffStart + pUpload->writeIx * pUpload->buffSize;
+    writeLen = pUpload->imageSize - pUpload->writeOffset;
+    if(writeLen > pUpload->buffSize)
+    {
+        writeLen = pUpload->buffSize;
+    }
+    sectNo = pUpload->writeOffset / SYS_FS_MEDIA_SECTOR_SIZE;
+    nSectors = (writeLen + SYS_FS_MEDIA_SECTOR_SIZE - 1) / SYS_FS_MEDIA_SECTOR_SIZE;
+
+    if(pUpload->writeOffset == 0)
+    {   // hold back the first sector
+        memcpy(pUpload->headSector, pData, SYS_FS_MEDIA_SECTOR_SIZE);
+        pData += SYS_FS_MEDIA_SECTOR_SIZE;
+        sectNo++;
+        nSectors--;
+    }
+
+    return _HTTP_UploadWrite(pUpload, TCPIP_HTTP_UPLOAD_CMD_BUFFER, sectNo, pData, nSectors);
+}
+
+// starts reading back the next image block, in the first buffer
+static bool _HTTP_UploadReadNext(TCPIP_HTTP_UPLOAD_DCPT* pUpload)
+{
+    uint32_t readLen = pUpload->imageSize - pUpload->verifySize;
+    uint32_t nSectors;
+
+    if(readLen > pUpload->buffSize)
+    {
+        readLen = pUpload->buffSize;
+    }
+    nSectors = (readLen + SYS_FS_MEDIA_SECTOR_SIZE - 1) / SYS_FS_MEDIA_SECTOR_SIZE;
+
+    pUpload->cmdHandle = SYS_FS_MEDIA_MANAGER_SectorRead(MPFS_UPLOAD_DISK_NO, pUpload->buffStart, pUpload->verifySize / SYS_FS_MEDIA_SECTOR_SIZE, nSectors);
+    if(pUpload->cmdHandle == SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID)
+    {
+        return false;
+    }
+
+    pUpload->cmdLen = nSectors * SYS_FS_MEDIA_SECTOR_SIZE;
+    pUpload->cmd = TCPIP_HTTP_UPLOAD_CMD_READ;
+    return true;
+}
+
+// CRC-32 (IEEE 802.3), 4 bits at a time
+static uint32_t _HTTP_Crc32(uint32_t crc, const uint8_t* pData, uint32_t len)
+{
+    static const uint32_t crcTbl[16] =
+    {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+    };
+
+    crc = ~crc;
+    while(len--)
+    {
+        crc ^= *pData++;
+        crc = (crc >> 4) ^ crcTbl[crc & 0x0f];
+        crc = (crc >> 4) ^ crcTbl[crc & 0x0f];
+    }
+
+    return ~crc;
+}
+
+#endif //defined (TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+
+// the default file include dynamic variable HTTP operation
+static TCPIP_HTTP_DYN_PRINT_RES TCPIP_HTTP_NET_DefaultIncludeFile(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const TCPIP_HTTP_DYN_VAR_DCPT* varDcpt, const struct _tag_TCPIP_HTTP_NET_USER_CALLBACK* pCBack)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon;
+    const char* fName;
+    TCPIP_HTTP_DYN_ARG_DCPT* pArgDcpt;
+    TCPIP_HTTP_CHUNK_DCPT* pChDcpt = (TCPIP_HTTP_CHUNK_DCPT*)varDcpt->dynContext;
+
+    pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+
+    // some basic sanity check
+    pArgDcpt = varDcpt->dynArgs;
+    if(pArgDcpt->argType == TCPIP_HTTP_DYN_ARG_TYPE_STRING)
+    {
+        fName = pArgDcpt->argStr;
+    }
+    else
+    {
+        fName = 0;
+    }
+
+    _HTTP_IncludeFile(pHttpCon, pChDcpt, fName);
+
+    // one way or another we're done
+    return TCPIP_HTTP_DYN_PRINT_RES_DONE;
+}
+
+// includes a file in the chunk being processed
+// a small included file is kept in the RAM file cache:
+// the next pages include it without opening it again
+static TCPIP_HTTP_CHUNK_RES _HTTP_IncludeFile(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK_DCPT* pChDcpt, const char* fName)
+{
+    SYS_FS_HANDLE fp;
+    TCPIP_HTTP_CHUNK_RES chunkRes;
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+    TCPIP_HTTP_FILE_CACHE_ENTRY* pEntry;
+    bool fileDynamic;
+    uint32_t fStamp = 0;
+
+    if(fName != 0 && (pEntry = _HTTP_FileCacheGet(fName)) != 0)
+    {   // already in RAM
+        _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_OPEN, fName);
+        chunkRes = _HTTP_AddCacheFileChunk(pHttpCon, pEntry, pChDcpt);
+        if(chunkRes == TCPIP_HTTP_CHUNK_RES_WAIT)
+        {   // the entry is looked up again on retry
+            _HTTP_FileCacheRelease(pEntry);
+        }
+        return chunkRes;
+    }
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+
+    // avoid creating a new chunk for a file that cannot be opened
+    if(fName == 0 || (fp = (*httpFileShell->fileOpen)(httpFileShell, fName, SYS_FS_FILE_OPEN_READ)) == SYS_FS_HANDLE_INVALID)
+    {   // File not found, so abort
+        _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_OPEN_ERROR, fName);
+        return TCPIP_HTTP_CHUNK_RES_FILE_ERR;
+    }
+
+    _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_OPEN, fName);
+
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+    fileDynamic = _HTTP_IncludeIsDynamic(fName, &fStamp);
+    if((pEntry = _HTTP_FileCacheLoad(fp, fName, fileDynamic, fStamp)) != 0)
+    {   // the file is no longer needed
+        (*httpFileShell->fileClose)(httpFileShell, fp);
+        _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_CLOSE, fName);
+        chunkRes = _HTTP_AddCacheFileChunk(pHttpCon, pEntry, pChDcpt);
+        if(chunkRes == TCPIP_HTTP_CHUNK_RES_WAIT)
+        {
+            _HTTP_FileCacheRelease(pEntry);
+        }
+        return chunkRes;
+    }
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+
+    // add valid file for processing
+    chunkRes = _HTTP_AddFileChunk(pHttpCon, fp, fName, pChDcpt);
+    if(chunkRes == TCPIP_HTTP_CHUNK_RES_WAIT)
+    {   // don't hold the file while waiting; it's opened again on retry
+        (*httpFileShell->fileClose)(httpFileShell, fp);
+        _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_CLOSE, fName);
+    }
+    return chunkRes;
+}
+
+
+SYS_FS_HANDLE TCPIP_HTTP_NET_ConnectionFileGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+    if(pHttpCon->file == SYS_FS_HANDLE_INVALID && pHttpCon->fileCache != 0)
+    {   // the file is served from RAM; open it only when the application needs it
+        pHttpCon->file = (*httpFileShell->fileOpen)(httpFileShell, pHttpCon->fileName, SYS_FS_FILE_OPEN_READ);
+    }
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+    return pHttpCon->file;
+}
+
+uint16_t TCPIP_HTTP_NET_ConnectionPostSmGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    return pHttpCon->smPost;
+}
+
+void TCPIP_HTTP_NET_ConnectionPostSmSet(TCPIP_HTTP_NET_CONN_HANDLE connHandle, uint16_t stat)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    pHttpCon->smPost = stat;
+}
+
+uint8_t* TCPIP_HTTP_NET_ConnectionDataBufferGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    return pHttpCon->httpData;
+}
+
+uint16_t TCPIP_HTTP_NET_ConnectionDataBufferSizeGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+{
+    return httpConnDataSize;
+}
+
+uint32_t TCPIP_HTTP_NET_ConnectionCallbackPosGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    return pHttpCon->callbackPos;
+}
+
+void TCPIP_HTTP_NET_ConnectionCallbackPosSet(TCPIP_HTTP_NET_CONN_HANDLE connHandle, uint32_t pos)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    pHttpCon->callbackPos = pos;
+}
+
+void TCPIP_HTTP_NET_ConnectionStatusSet(TCPIP_HTTP_NET_CONN_HANDLE connHandle, TCPIP_HTTP_NET_STATUS stat)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    pHttpCon->httpStatus = stat;
+}
+
+TCPIP_HTTP_NET_STATUS TCPIP_HTTP_NET_ConnectionStatusGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    return pHttpCon->httpStatus;
+}
+
+
+
+void TCPIP_HTTP_NET_ConnectionHasArgsSet(TCPIP_HTTP_NET_CONN_HANDLE connHandle, uint8_t args)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    pHttpCon->hasArgs = args;
+}
+
+uint8_t TCPIP_HTTP_NET_ConnectionHasArgsGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    return pHttpCon->hasArgs;
+}
+
+uint32_t TCPIP_HTTP_NET_ConnectionByteCountGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    return pHttpCon->byteCount;
+}
+
+void TCPIP_HTTP_NET_ConnectionByteCountSet(TCPIP_HTTP_NET_CONN_HANDLE connHandle, uint32_t byteCount)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    pHttpCon->byteCount = byteCount;
+}
+
+void TCPIP_HTTP_NET_ConnectionByteCountDec(TCPIP_HTTP_NET_CONN_HANDLE connHandle, uint32_t byteCount)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    pHttpCon->byteCount -= byteCount;
+}
+
+NET_PRES_SKT_HANDLE_T TCPIP_HTTP_NET_ConnectionSocketGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    return pHttpCon->socket;
+}
+
+uint8_t TCPIP_HTTP_NET_ConnectionIsAuthorizedGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    return pHttpCon->isAuthorized;
+}
+
+void TCPIP_HTTP_NET_ConnectionIsAuthorizedSet(TCPIP_HTTP_NET_CONN_HANDLE connHandle, uint8_t auth)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    pHttpCon->isAuthorized = auth;
+}
+
+bool TCPIP_HTTP_NET_ConnectionSessionEnd(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+{
+#if (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    pHttpCon->flags.sessionNew = 0;
+    if(pHttpCon->sessionEntry != 0)
+    {
+        memset(pHttpCon->sessionEntry, 0, sizeof(*pHttpCon->sessionEntry));
+        pHttpCon->sessionEntry = 0;
+        return true;
+    }
+#endif  // (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+    return false;
+}
+
+void TCPIP_HTTP_NET_ConnectionUserDataSet(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* uData)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    pHttpCon->userData = uData;
+}
+
+const void* TCPIP_HTTP_NET_ConnectionUserDataGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    return pHttpCon->userData;
+}
+
+int TCPIP_HTTP_NET_ConnectionIndexGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    return pHttpCon->connIx;
+}
+
+TCPIP_HTTP_NET_CONN_HANDLE TCPIP_HTTP_NET_ConnectionHandleGet(int connIx)
+{
+    if(connIx < httpConnNo)
+    {
+        return httpConnCtrl + connIx;
+    }
+
+    return 0;
+}
+
+int TCPIP_HTTP_NET_ActiveConnectionCountGet(int* pOpenCount)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon;
+    int connIx;
+    int activeCount, openCount;
+
+    activeCount = openCount = 0;
+
+    pHttpCon = httpConnCtrl + 0;
+    for(connIx = 0; connIx < httpConnNo; connIx++, pHttpCon++)
+    {
+        if(pHttpCon->socket != NET_PRES_INVALID_SOCKET)
+        {
+            openCount++;
+            if(NET_PRES_SocketIsConnected(pHttpCon->socket))
+            {
+                activeCount++;
+            }
+        }
+    }
+
+    if(pOpenCount)
+    {
+        *pOpenCount = openCount;
+    }
+
+    return activeCount;
+}
+
+uint16_t TCPIP_HTTP_NET_ConnectionStringFind(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const char* str, uint16_t startOffs, uint16_t searchLen)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    return (uint16_t)_HTTP_ConnectionStringFind(pHttpCon, str, startOffs, searchLen);
+}
+
+
+bool TCPIP_HTTP_NET_DynamicFileInclude(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const TCPIP_HTTP_DYN_VAR_DCPT* varDcpt, const char* fileName)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    TCPIP_HTTP_CHUNK_DCPT* pChDcpt = (TCPIP_HTTP_CHUNK_DCPT*)varDcpt->dynContext;
+    TCPIP_HTTP_CHUNK_RES chunkRes = _HTTP_IncludeFile(pHttpCon, pChDcpt, fileName);
+
+    return chunkRes == TCPIP_HTTP_CHUNK_RES_OK; 
+}
+
+
+uint16_t TCPIP_HTTP_NET_ConnectionFlush(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    return NET_PRES_SocketFlush(pHttpCon->socket);
+}
+
+uint16_t TCPIP_HTTP_NET_ConnectionReadIsReady(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    return NET_PRES_SocketReadIsReady(pHttpCon->socket);
+}
+
+uint16_t TCPIP_HTTP_NET_ConnectionRead(TCPIP_HTTP_NET_CONN_HANDLE connHandle, void * buffer, uint16_t size)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    return NET_PRES_SocketRead(pHttpCon->socket, buffer, size);
+}
+
+uint16_t TCPIP_HTTP_NET_ConnectionPeek(TCPIP_HTTP_NET_CONN_HANDLE connHandle,  void * buffer, uint16_t size)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    return NET_PRES_SocketPeek(pHttpCon->socket, buffer, size);
+}
+
+uint16_t TCPIP_HTTP_NET_ConnectionDiscard(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+{
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    return NET_PRES_SocketDiscard(pHttpCon->socket);
+}
+
+uint16_t TCPIP_HTTP_NET_ConnectionReadBufferSize(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+{
+    uint16_t sktRxSize;
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+
+    if(NET_PRES_SocketOptionsGet(pHttpCon->socket, TCP_OPTION_RX_BUFF, &sktRxSize))
+    {
+        return sktRxSize;
     }
 
-    // Remove the delimiter
-    if(cDelim)
+    return 0;
+}
+
+TCPIP_NET_HANDLE TCPIP_HTTP_NET_ConnectionNetHandle(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+{
+    TCP_SOCKET_INFO sktInfo;
+    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+
+    if(NET_PRES_SocketInfoGet(pHttpCon->socket, &sktInfo))
     {
-        pHttpCon->byteCount -= _HTTP_ConnectionDiscard(pHttpCon, 1);
+        return sktInfo.hNet;
     }
 
-    return status;
-}   
-#endif
+    return 0;
+}
 
-/*****************************************************************************
-  Function:
-    static TCPIP_HTTP_NET_IO_RESULT TCPIP_HTTP_NET_FSUpload(TCPIP_HTTP_NET_CONN* pHttpCon)
 
-  Summary:
-    Saves a file uploaded via POST as the new image in EEPROM or 
-    external Flash.
+static uint16_t _HTTP_SktFifoRxFree(NET_PRES_SKT_HANDLE_T skt)
+{
+    uint16_t sktRxSize;
+    uint16_t sktReadySize;
 
-  Description:
-    Allows the FS image in EEPROM or external Flash to be updated via a 
-    web page by accepting a file upload and storing it to the external memory.
+    if(NET_PRES_SocketOptionsGet(skt, TCP_OPTION_RX_BUFF, &sktRxSize))
+    {
+        sktReadySize = NET_PRES_SocketReadIsReady(skt);
+        return sktRxSize - sktReadySize;
+    }
 
-  Precondition:
-    None
+    return 0;
+}
 
-  Parameters:
-    None
 
-  Return Values:
-    TCPIP_HTTP_NET_IO_RES_DONE - on success
-    TCPIP_HTTP_NET_IO_RES_NEED_DATA - if more data is still expected
+// tries to output the data to the transport socket
+// it checks first for available space and starts the operation
+// only if there's enough space
+// checkLen is the size to check for; could be different than dataLen
+// if data == 0; then nothing is written
+static bool _HTTP_DataTryOutput(TCPIP_HTTP_NET_CONN* pHttpCon, const char* data, uint16_t dataLen, uint16_t checkLen)
+{
+    uint16_t socketSpace;
 
-  Remarks:
-    This function is only available when FS uploads are enabled and
-    the FS image could be stored (EEPROM, flash, etc.)
+    if(checkLen == 0 || checkLen < dataLen)
+    {
+        checkLen = dataLen;
+    }
+    socketSpace = NET_PRES_SocketWriteIsReady(pHttpCon->socket, checkLen, 0);
+    if(socketSpace >= checkLen)
+    {
+        if(data)
+        {
+            NET_PRES_SocketWrite(pHttpCon->socket, (const uint8_t*)data, dataLen);
+        }
+        return true;
+    }
 
-  ***************************************************************************/
-#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
-#define     SYS_FS_MEDIA_SECTOR_SIZE        512     
-static TCPIP_HTTP_NET_IO_RESULT TCPIP_HTTP_NET_FSUpload(TCPIP_HTTP_NET_CONN* pHttpCon)
+    return false;
+}
+
+
+// Note that the search will fail if there's more data in the TCP socket than could be read at once.
+// returns a 32 bit word:
+//      - hi 16 bits hold the peeked at data, i.e. the number of bytes to safely remove, if needed
+//      - low 16 bits is 0xffff if not found or offset where the string was found
+static uint32_t _HTTP_ConnectionStringFind(TCPIP_HTTP_NET_CONN* pHttpCon, const char* str, uint16_t startOffs, uint16_t searchLen)
 {
-    uint8_t mpfsBuffer[sizeof(MPFS_SIGNATURE) - 1];  // large enough to hold the MPFS signature
-    uint16_t lenA, lenB;
-    uint32_t nSectors;
-    uint32_t mpfsAllocSize;
+    uint16_t    peekOffs, peekReqLen, peekSize, avlblBytes;
+    char*   queryStr;
 
-    switch(pHttpCon->httpStatus)
+    char* srchBuff = (char*)(*http_malloc_fnc)(httpPeekBufferSize + 1);
+    if(srchBuff == 0)
     {
-        // New upload, so look for the CRLFCRLF
-        case TCPIP_HTTP_NET_STAT_UPLOAD_STARTED:
-            if(pHttpCon->flags.uploadPhase == 0)
-            {   // just starting
-                pHttpCon->uploadSectNo = 0;
-                uint32_t peekRes = _HTTP_ConnectionStringFind(pHttpCon, "\r\n\r\n", 0, 0);
+        char eventBuff[16];
+        sprintf(eventBuff, "%d", httpPeekBufferSize + 1);
+        _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_PEEK_ALLOC_BUFFER_ERROR, eventBuff);
+        return 0xffff;
+    }
 
-                if((uint16_t)peekRes == 0xffff)
-                {   // End of line not found, remove as much as possible
-                    lenA = peekRes >> 16;   // get the # of bytes safe to remove
-                    if(lenA > 4)
-                    {
-                        lenA = _HTTP_ConnectionDiscard(pHttpCon, lenA - 4);
-                        pHttpCon->byteCount -= lenA;
-                    }
-                    break;
-                }
+    const char* findStr = (const char*)str;
 
-                // Found end of line, so remove all data up to and including
-                lenA = _HTTP_ConnectionDiscard(pHttpCon, (uint16_t)peekRes + 4);
-                pHttpCon->byteCount -= (lenA + 4);
+    size_t findLen = strlen(findStr);
 
-                pHttpCon->flags.uploadPhase = 1;
-                break;
-            }
-            // waiting for the signature
-            // Make sure first 6 bytes are also in
-            if(NET_PRES_SocketReadIsReady(pHttpCon->socket) < sizeof(MPFS_SIGNATURE) - 1 )
-            {
-                return TCPIP_HTTP_NET_IO_RES_NEED_DATA;
+    // peek sanity check
+    if((avlblBytes = NET_PRES_SocketReadIsReady(pHttpCon->socket)) > httpPeekBufferSize)
+    {   // peek buffer too small!
+        sprintf(srchBuff, "%d", (int)(avlblBytes - (httpPeekBufferSize)));
+        _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_PEEK_BUFFER_SIZE_EXCEEDED, srchBuff);
+    }
+
+    uint16_t retCode = 0xffff;
+    peekSize = 0;
+    // sanity check
+    if(findLen < httpPeekBufferSize)
+    {   // make sure enough room to find such string
+        if(searchLen == 0 || searchLen >= findLen)
+        {
+            peekOffs = startOffs;
+            peekReqLen = searchLen == 0 ? httpPeekBufferSize : searchLen;
+            peekSize =  NET_PRES_SocketPeek(pHttpCon->socket, srchBuff, peekReqLen);
+            if(peekSize >= findLen)
+            {   // enough data present
+                srchBuff[peekSize] = 0;     // end string properly
+                queryStr = strstr(srchBuff, findStr);
+                if(queryStr != 0)
+                {
+                    retCode = peekOffs + queryStr - srchBuff;
+                }
             }
+        }
+    }
 
-            // reset the phase, we're done
-            pHttpCon->flags.uploadPhase = 0;
 
-            lenA = NET_PRES_SocketRead(pHttpCon->socket, mpfsBuffer, sizeof(MPFS_SIGNATURE) - 1);
-            pHttpCon->byteCount -= lenA;
-            if(memcmp(mpfsBuffer, (const void*)MPFS_SIGNATURE, sizeof(MPFS_SIGNATURE) - 1) != 0)
-            {   // wrong signature
-                pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_ERROR;
-                return TCPIP_HTTP_NET_IO_RES_WAITING;
-            }
+    (*http_free_fnc)(srchBuff);
+    return ((uint32_t)peekSize << 16) | retCode;
+}
 
-            // proper file version
-            // allocate the buffer size as a multiple of sector size
-            pHttpCon->uploadBufferStart = 0;
-            mpfsAllocSize = ((MPFS_UPLOAD_WRITE_BUFFER_SIZE + (SYS_FS_MEDIA_SECTOR_SIZE - 1)) / SYS_FS_MEDIA_SECTOR_SIZE) * SYS_FS_MEDIA_SECTOR_SIZE;
-            if((pHttpCon->uploadBufferStart = (uint8_t*)(*http_malloc_fnc)(mpfsAllocSize)) != 0)
-            {
-                pHttpCon->uploadBufferEnd = pHttpCon->uploadBufferStart + mpfsAllocSize;
-                memcpy(pHttpCon->uploadBufferStart, MPFS_SIGNATURE, sizeof(MPFS_SIGNATURE) - 1);
-                pHttpCon->uploadBufferCurr = pHttpCon->uploadBufferStart + sizeof(MPFS_SIGNATURE) - 1;
+static uint16_t _HTTP_ConnectionCharFind(TCPIP_HTTP_NET_CONN* pHttpCon, uint8_t cFind, uint16_t wStart, uint16_t wSearchLen)
+{
+    char srchBuff[2];
+    srchBuff[0] = cFind;
+    srchBuff[1] = 0;
 
-                SYS_FS_Unmount(MPFS_UPLOAD_MOUNT_PATH);
-                pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_WRITE;
-                return TCPIP_HTTP_NET_IO_RES_WAITING;
-            }
+    return (uint16_t)_HTTP_ConnectionStringFind(pHttpCon, srchBuff, wStart, wSearchLen);
+}
 
-            // memory allocation failed
-            pHttpCon->flags.uploadMemError = 1; // signal out of memory
-            _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_UPLOAD_ALLOC_ERROR, pHttpCon->fileName);
-            pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_ERROR;
-            return TCPIP_HTTP_NET_IO_RES_WAITING;
 
-        case TCPIP_HTTP_NET_STAT_UPLOAD_WRITE:
-            lenA = NET_PRES_SocketReadIsReady(pHttpCon->socket);
-            if(lenA > pHttpCon->uploadBufferEnd - pHttpCon->uploadBufferCurr)
-            {
-                lenA = pHttpCon->uploadBufferEnd - pHttpCon->uploadBufferCurr;
-            }
+TCPIP_HTTP_NET_USER_HANDLE TCPIP_HTTP_NET_UserHandlerRegister(const TCPIP_HTTP_NET_USER_CALLBACK* userCallback)
+{
+    if(httpConnCtrl)
+    {   // we're up and running; allow only one registration for now
+        if(userCallback && httpUserCback == 0)
+        {
+            httpRegistry = *userCallback;
+            httpUserCback = &httpRegistry;
+            return (TCPIP_HTTP_NET_USER_HANDLE)httpUserCback;
+        }
+    }
 
-            if(lenA > pHttpCon->byteCount)
-            {
-                lenA = pHttpCon->byteCount;
-            }
+    return 0;
 
-            if(lenA == 0 )
-            {
-                return TCPIP_HTTP_NET_IO_RES_WAITING;
-            }
+}
 
-            lenB = NET_PRES_SocketRead(pHttpCon->socket, pHttpCon->uploadBufferCurr, lenA);
-            pHttpCon->uploadBufferCurr += lenB;
-            pHttpCon->byteCount -= lenB;
+bool TCPIP_HTTP_NET_UserHandlerDeregister(TCPIP_HTTP_NET_USER_HANDLE hHttp)
+{
+    if(httpConnCtrl == 0 || hHttp == 0 || hHttp != httpUserCback)
+    {   // minimal sanity check
+        return false;
+    }
 
-            // check that upload buffer is full
-            if(pHttpCon->uploadBufferCurr != pHttpCon->uploadBufferEnd && pHttpCon->byteCount != 0)
-            {
-                return TCPIP_HTTP_NET_IO_RES_WAITING;
-            }
+    // we're up and running
+    // abort all connections
+    int connIx;
+    TCPIP_HTTP_NET_CONN* pHttpCon = httpConnCtrl;
+    for(connIx = 0; connIx < httpConnNo; connIx++, pHttpCon++)
+    {
+        if(pHttpCon->socket != NET_PRES_INVALID_SOCKET)
+        {
+            TCP_SOCKET tcp_skt = NET_PRES_SocketGetTransportHandle(pHttpCon->socket);
+            TCPIP_TCP_Abort(tcp_skt, false);
+        }
+    }
+    httpUserCback = 0;
+#if (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0)
+    _HTTP_DynVarNamesRemove();
+#endif  // (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0)
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+    memset(httpSnapFiles, 0, sizeof(httpSnapFiles));
+    _HTTP_SnapshotPurge(false);
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+#if (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+    memset(httpEvChannels, 0, sizeof(httpEvChannels));
+#endif  // (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+    memset(httpWsEndpoints, 0, sizeof(httpWsEndpoints));
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+#if (_TCPIP_HTTP_NET_SCHED != 0)
+    memset(httpSchedRules, 0, sizeof(httpSchedRules));
+#endif  // (_TCPIP_HTTP_NET_SCHED != 0)
+#if (_TCPIP_HTTP_NET_ROUTER != 0)
+    _HTTP_RoutesRemove();
+#endif  // (_TCPIP_HTTP_NET_ROUTER != 0)
+    return true;
+}
 
-            nSectors = ((pHttpCon->uploadBufferCurr - pHttpCon->uploadBufferStart) + SYS_FS_MEDIA_SECTOR_SIZE - 1) / (SYS_FS_MEDIA_SECTOR_SIZE);
+bool TCPIP_HTTP_NET_DynVarNamesRegister(TCPIP_HTTP_NET_USER_HANDLE hHttp, const char* const* varNames, uint16_t nNames)
+{
+#if (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0)
+    uint16_t    nameIx;
+    uint32_t    hashIx, hashSize;
+    uint16_t*   pNewHash;
 
-            if(!_HTTP_DbgKillFlashWrite())
-            {   // try to perform the write
-                pHttpCon->uploadBuffHandle = SYS_FS_MEDIA_MANAGER_SectorWrite(MPFS_UPLOAD_DISK_NO, pHttpCon->uploadSectNo , pHttpCon->uploadBufferStart,
-                        nSectors);
-                if(pHttpCon->uploadBuffHandle == SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID)
-                {
-                    pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_ERROR;
-                    _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FS_WRITE_ERROR, pHttpCon->fileName);
-                    return TCPIP_HTTP_NET_IO_RES_WAITING;
-                }
-            }
-            else
-            {   // advance without performing the write
-                pHttpCon->uploadBuffHandle = SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID;
-            }
+    if(httpConnCtrl == 0 || hHttp == 0 || hHttp != httpUserCback)
+    {   // minimal sanity check
+        return false;
+    }
 
-            // everything fine
-            pHttpCon->uploadSectNo += nSectors;
-            pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_WRITE_WAIT;
-            return TCPIP_HTTP_NET_IO_RES_WAITING;
+    pNewHash = 0;
+    hashSize = 0;
+    if(varNames != 0)
+    {
+        if(nNames == 0 || nNames >= TCPIP_HTTP_NET_DYN_VAR_ID_INVALID)
+        {
+            return false;
+        }
 
-        case TCPIP_HTTP_NET_STAT_UPLOAD_WRITE_WAIT:
-            if(pHttpCon->uploadBuffHandle != SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID)
-            {
-                if(SYS_FS_MEDIA_MANAGER_CommandStatusGet(MPFS_UPLOAD_DISK_NO, pHttpCon->uploadBuffHandle) != SYS_FS_MEDIA_COMMAND_COMPLETED)
-                {
-                    return TCPIP_HTTP_NET_IO_RES_WAITING;
-                }
-            }
+        // keep the hash index at most half full
+        for(hashSize = 8; hashSize < 2 * (uint32_t)nNames; hashSize <<= 1);
 
-            pHttpCon->uploadBufferCurr = pHttpCon->uploadBufferStart;
+        pNewHash = (uint16_t*)(*http_malloc_fnc)(hashSize * sizeof(*pNewHash));
+        if(pNewHash == 0)
+        {   // out of memory
+            return false;
+        }
+        memset(pNewHash, 0xff, hashSize * sizeof(*pNewHash));   // TCPIP_HTTP_NET_DYN_VAR_ID_INVALID
 
-            if(pHttpCon->byteCount == 0u)
-            {   // we're done
-                (*http_free_fnc)(pHttpCon->uploadBufferStart);
-                pHttpCon->uploadBufferStart = 0;
+        for(nameIx = 0; nameIx < nNames; nameIx++)
+        {
+            if(varNames[nameIx] == 0)
+            {   // ignore empty slots
+                continue;
+            }
 
-                if(SYS_FS_Mount(MPFS_UPLOAD_NVM_VOL, MPFS_UPLOAD_MOUNT_PATH, MPFS2, 0, NULL)  != SYS_FS_RES_FAILURE)
-                {
-                    _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FS_UPLOAD_COMPLETE, pHttpCon->fileName);
-                    pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_OK;
-                    return TCPIP_HTTP_NET_IO_RES_DONE;
-                }
-                else
-                {
-                    _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FS_MOUNT_ERROR, pHttpCon->fileName);
-                    pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_ERROR;
-                    return TCPIP_HTTP_NET_IO_RES_ERROR;
+            hashIx = fnv_32a_hash(varNames[nameIx], strlen(varNames[nameIx])) & (hashSize - 1);
+            while(pNewHash[hashIx] != TCPIP_HTTP_NET_DYN_VAR_ID_INVALID)
+            {
+                if(strcmp(varNames[pNewHash[hashIx]], varNames[nameIx]) == 0)
+                {   // duplicate name; keep the first one
+                    break;
                 }
+                hashIx = (hashIx + 1) & (hashSize - 1);
             }
 
-            // else, more data to come
-            pHttpCon->httpStatus = TCPIP_HTTP_NET_STAT_UPLOAD_WRITE;
-            return TCPIP_HTTP_NET_IO_RES_WAITING;
-
-        case TCPIP_HTTP_NET_STAT_UPLOAD_ERROR:
-            if(pHttpCon->uploadBufferStart != 0)
+            if(pNewHash[hashIx] == TCPIP_HTTP_NET_DYN_VAR_ID_INVALID)
             {
-                (*http_free_fnc)(pHttpCon->uploadBufferStart);
-                pHttpCon->uploadBufferStart = 0;
-            }
-            pHttpCon->byteCount -= NET_PRES_SocketReadIsReady(pHttpCon->socket);
-            NET_PRES_SocketDiscard(pHttpCon->socket);
-            if(pHttpCon->byteCount < 100u || pHttpCon->byteCount > 0x80000000u)
-            {   // If almost all data was read, or if we overflowed, then return
-                return TCPIP_HTTP_NET_IO_RES_DONE;
+                pNewHash[hashIx] = nameIx;
             }
-            break;
-
-        default:
-            break;
+        }
     }
 
-    return TCPIP_HTTP_NET_IO_RES_NEED_DATA;
-}
+    _HTTP_DynVarNamesRemove();
+    httpDynVarNames = varNames;
+    httpDynVarHash = pNewHash;
+    httpDynVarHashMask = hashSize - 1;
 
-#endif //defined (TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+    return true;
+#else
+    return false;
+#endif  // (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0)
+}
 
-// the default file include dynamic variable HTTP operation
-static TCPIP_HTTP_DYN_PRINT_RES TCPIP_HTTP_NET_DefaultIncludeFile(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const TCPIP_HTTP_DYN_VAR_DCPT* varDcpt, const struct _tag_TCPIP_HTTP_NET_USER_CALLBACK* pCBack)
+bool TCPIP_HTTP_NET_SnapshotFileRegister(TCPIP_HTTP_NET_USER_HANDLE hHttp, const char* fileName, uint16_t freshMs)
 {
-    TCPIP_HTTP_NET_CONN* pHttpCon;
-    const char* fName;
-    TCPIP_HTTP_DYN_ARG_DCPT* pArgDcpt;
-    TCPIP_HTTP_CHUNK_DCPT* pChDcpt = (TCPIP_HTTP_CHUNK_DCPT*)varDcpt->dynContext;
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+    int ix;
+    uint32_t fHash;
+    TCPIP_HTTP_SNAP_FILE *pFile, *pFree;
 
-    pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    if(httpConnCtrl == 0 || hHttp == 0 || hHttp != httpUserCback || fileName == 0)
+    {   // minimal sanity check
+        return false;
+    }
 
-    // some basic sanity check
-    pArgDcpt = varDcpt->dynArgs;
-    if(pArgDcpt->argType == TCPIP_HTTP_DYN_ARG_TYPE_STRING)
+    if(*fileName == TCPIP_HTTP_FILE_PATH_SEP)
+    {   // the served file names have no leading separator
+        fileName++;
+    }
+    if(*fileName == 0)
     {
-        fName = pArgDcpt->argStr;
+        return false;
     }
-    else
+
+    if(freshMs == 0)
     {
-        fName = 0;
+        freshMs = TCPIP_HTTP_NET_SNAPSHOT_FRESH_MS;
     }
 
-    _HTTP_IncludeFile(pHttpCon, pChDcpt, fName);
+    fHash = fnv_32_hash(fileName, strlen(fileName));
+    pFree = 0;
+    for(ix = 0, pFile = httpSnapFiles; ix < sizeof(httpSnapFiles) / sizeof(*httpSnapFiles); ix++, pFile++)
+    {
+        if(pFile->fHash == fHash)
+        {   // update the window
+            pFree = pFile;
+            break;
+        }
+        if(pFile->fHash == 0 && pFree == 0)
+        {
+            pFree = pFile;
+        }
+    }
 
-    // one way or another we're done
-    return TCPIP_HTTP_DYN_PRINT_RES_DONE;
+    if(pFree == 0)
+    {   // no more room
+        return false;
+    }
+
+    pFree->fHash = fHash;
+    pFree->freshTicks = ((uint32_t)freshMs * SYS_TMR_TickCounterFrequencyGet() + 999) / 1000;
+    return true;
+#else
+    return false;
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
 }
 
-static TCPIP_HTTP_CHUNK_RES _HTTP_IncludeFile(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK_DCPT* pChDcpt, const char* fName)
+bool TCPIP_HTTP_NET_EventChannelRegister(TCPIP_HTTP_NET_USER_HANDLE hHttp, const char* chName)
 {
-    SYS_FS_HANDLE fp;
+#if (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+    int ix;
 
+    if(httpConnCtrl == 0 || hHttp == 0 || hHttp != httpUserCback || chName == 0)
+    {   // minimal sanity check
+        return false;
+    }
 
-    // avoid creating a new chunk for a file that cannot be opened
-    if(fName == 0 || (fp = (*httpFileShell->fileOpen)(httpFileShell, fName, SYS_FS_FILE_OPEN_READ)) == SYS_FS_HANDLE_INVALID)
-    {   // File not found, so abort
-        _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_OPEN_ERROR, fName);
-        return TCPIP_HTTP_CHUNK_RES_FILE_ERR;
+    if(*chName == TCPIP_HTTP_FILE_PATH_SEP)
+    {   // the requested names have no leading separator
+        chName++;
+    }
+    if(*chName == 0)
+    {
+        return false;
     }
 
-    _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_FILE_OPEN, fName);
-    // add valid file for processing
-    return _HTTP_AddFileChunk(pHttpCon, fp, fName, pChDcpt);
-}
+    if(_HTTP_EventChannelFind(chName) >= 0)
+    {   // already there
+        return true;
+    }
 
+    for(ix = 0; ix < sizeof(httpEvChannels) / sizeof(*httpEvChannels); ix++)
+    {
+        if(httpEvChannels[ix] == 0)
+        {
+            httpEvChannels[ix] = chName;
+            return true;
+        }
+    }
 
-SYS_FS_HANDLE TCPIP_HTTP_NET_ConnectionFileGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
-{
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    return pHttpCon->file;
+    // no more room
+    return false;
+#else
+    return false;
+#endif  // (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
 }
 
-uint16_t TCPIP_HTTP_NET_ConnectionPostSmGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+int TCPIP_HTTP_NET_EventPublish(const char* chName, const char* evName, const char* evData)
 {
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    return pHttpCon->smPost;
-}
+#if (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+    int chIx, connIx, nConns;
+    uint16_t evLen;
+    const char *pLine, *pEnd;
+    TCPIP_HTTP_NET_CONN* pHttpCon;
 
-void TCPIP_HTTP_NET_ConnectionPostSmSet(TCPIP_HTTP_NET_CONN_HANDLE connHandle, uint16_t stat)
-{
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    pHttpCon->smPost = stat;
-}
+    if(httpConnCtrl == 0 || chName == 0 || evData == 0)
+    {
+        return -1;
+    }
 
-uint8_t* TCPIP_HTTP_NET_ConnectionDataBufferGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
-{
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    return pHttpCon->httpData;
-}
+    if(*chName == TCPIP_HTTP_FILE_PATH_SEP)
+    {
+        chName++;
+    }
+    if((chIx = _HTTP_EventChannelFind(chName)) < 0)
+    {   // no such channel
+        return -1;
+    }
 
-uint16_t TCPIP_HTTP_NET_ConnectionDataBufferSizeGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
-{
-    return httpConnDataSize;
-}
+    // size of the event: the optional name, the data lines and the end of the event
+    evLen = evName != 0 ? sizeof(TCPIP_HTTP_EVENT_NAME_FIELD) - 1 + strlen(evName) + 1 : 0;
+    for(pLine = evData; ; pLine = pEnd + 1)
+    {
+        pEnd = strchr(pLine, '\n');
+        evLen += sizeof(TCPIP_HTTP_EVENT_DATA_FIELD) - 1 + (pEnd != 0 ? pEnd - pLine : strlen(pLine)) + 1;
+        if(pEnd == 0)
+        {
+            break;
+        }
+    }
+    evLen++;
 
-uint32_t TCPIP_HTTP_NET_ConnectionCallbackPosGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
-{
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    return pHttpCon->callbackPos;
-}
+    nConns = 0;
+    for(connIx = 0, pHttpCon = httpConnCtrl; connIx < httpConnNo; connIx++, pHttpCon++)
+    {
+        if(pHttpCon->socket == NET_PRES_INVALID_SOCKET || pHttpCon->connState != TCPIP_HTTP_CONN_STATE_EVENT_STREAM || pHttpCon->evChannel != chIx + 1)
+        {
+            continue;
+        }
 
-void TCPIP_HTTP_NET_ConnectionCallbackPosSet(TCPIP_HTTP_NET_CONN_HANDLE connHandle, uint32_t pos)
-{
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    pHttpCon->callbackPos = pos;
+        if(NET_PRES_SocketWriteIsReady(pHttpCon->socket, evLen, 0) < evLen)
+        {   // a slow client; an event is never sent partially
+            httpEvDropped++;
+            continue;
+        }
+
+        _HTTP_EventWrite(pHttpCon->socket, evName, evData);
+        NET_PRES_SocketFlush(pHttpCon->socket);
+        httpEvPublished++;
+        nConns++;
+    }
+
+    return nConns;
+#else
+    return -1;
+#endif  // (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
 }
 
-void TCPIP_HTTP_NET_ConnectionStatusSet(TCPIP_HTTP_NET_CONN_HANDLE connHandle, TCPIP_HTTP_NET_STATUS stat)
+#if (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+// returns the index of a registered event channel
+// or -1 if not found
+static int _HTTP_EventChannelFind(const char* chName)
 {
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    pHttpCon->httpStatus = stat;
+    int ix;
+
+    for(ix = 0; ix < sizeof(httpEvChannels) / sizeof(*httpEvChannels); ix++)
+    {
+        if(httpEvChannels[ix] != 0 && strcmp(httpEvChannels[ix], chName) == 0)
+        {
+            return ix;
+        }
+    }
+
+    return -1;
 }
 
-TCPIP_HTTP_NET_STATUS TCPIP_HTTP_NET_ConnectionStatusGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+// writes an event to a socket in the text/event-stream format
+// each line of the data is sent as a separate data field
+// the socket TX space is already checked
+static void _HTTP_EventWrite(NET_PRES_SKT_HANDLE_T skt, const char* evName, const char* evData)
 {
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    return pHttpCon->httpStatus;
-}
+    const char *pLine, *pEnd;
 
+    if(evName != 0)
+    {
+        NET_PRES_SocketWrite(skt, TCPIP_HTTP_EVENT_NAME_FIELD, sizeof(TCPIP_HTTP_EVENT_NAME_FIELD) - 1);
+        NET_PRES_SocketWrite(skt, evName, strlen(evName));
+        NET_PRES_SocketWrite(skt, "\n", 1);
+    }
 
+    for(pLine = evData; ; pLine = pEnd + 1)
+    {
+        pEnd = strchr(pLine, '\n');
+        NET_PRES_SocketWrite(skt, TCPIP_HTTP_EVENT_DATA_FIELD, sizeof(TCPIP_HTTP_EVENT_DATA_FIELD) - 1);
+        NET_PRES_SocketWrite(skt, pLine, pEnd != 0 ? pEnd - pLine : strlen(pLine));
+        NET_PRES_SocketWrite(skt, "\n", 1);
+        if(pEnd == 0)
+        {
+            break;
+        }
+    }
 
-void TCPIP_HTTP_NET_ConnectionHasArgsSet(TCPIP_HTTP_NET_CONN_HANDLE connHandle, uint8_t args)
-{
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    pHttpCon->hasArgs = args;
+    // an empty line dispatches the event
+    NET_PRES_SocketWrite(skt, "\n", 1);
 }
+#endif  // (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
 
-uint8_t TCPIP_HTTP_NET_ConnectionHasArgsGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+bool TCPIP_HTTP_NET_WebSocketRegister(TCPIP_HTTP_NET_USER_HANDLE hHttp, const char* uri, TCPIP_HTTP_NET_WS_HANDLER handler)
 {
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    return pHttpCon->hasArgs;
-}
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+    int ix;
 
-uint32_t TCPIP_HTTP_NET_ConnectionByteCountGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
-{
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    return pHttpCon->byteCount;
-}
+    if(httpConnCtrl == 0 || hHttp == 0 || hHttp != httpUserCback || uri == 0 || handler == 0)
+    {   // minimal sanity check
+        return false;
+    }
 
-void TCPIP_HTTP_NET_ConnectionByteCountSet(TCPIP_HTTP_NET_CONN_HANDLE connHandle, uint32_t byteCount)
-{
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    pHttpCon->byteCount = byteCount;
-}
+    if(*uri == TCPIP_HTTP_FILE_PATH_SEP)
+    {   // the requested names have no leading separator
+        uri++;
+    }
+    if(*uri == 0)
+    {
+        return false;
+    }
 
-void TCPIP_HTTP_NET_ConnectionByteCountDec(TCPIP_HTTP_NET_CONN_HANDLE connHandle, uint32_t byteCount)
-{
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    pHttpCon->byteCount -= byteCount;
-}
+    if((ix = _HTTP_WsEndpointFind(uri)) >= 0)
+    {   // already there; update the handler
+        httpWsEndpoints[ix].handler = handler;
+        return true;
+    }
 
-NET_PRES_SKT_HANDLE_T TCPIP_HTTP_NET_ConnectionSocketGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
-{
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    return pHttpCon->socket;
-}
+    for(ix = 0; ix < sizeof(httpWsEndpoints) / sizeof(*httpWsEndpoints); ix++)
+    {
+        if(httpWsEndpoints[ix].uri == 0)
+        {
+            httpWsEndpoints[ix].uri = uri;
+            httpWsEndpoints[ix].handler = handler;
+            return true;
+        }
+    }
 
-uint8_t TCPIP_HTTP_NET_ConnectionIsAuthorizedGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
-{
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    return pHttpCon->isAuthorized;
+    // no more room
+    return false;
+#else
+    return false;
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
 }
 
-void TCPIP_HTTP_NET_ConnectionIsAuthorizedSet(TCPIP_HTTP_NET_CONN_HANDLE connHandle, uint8_t auth)
+bool TCPIP_HTTP_NET_WebSocketSend(TCPIP_HTTP_NET_CONN_HANDLE connHandle, bool isText, const void* data, uint16_t dataLen)
 {
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
     TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    pHttpCon->isAuthorized = auth;
+
+    if(pHttpCon == 0 || pHttpCon->wsDcpt == 0 || pHttpCon->wsDcpt->isOpen == 0 || pHttpCon->wsDcpt->closeSent != 0)
+    {
+        return false;
+    }
+
+    return _HTTP_WsFrameWrite(pHttpCon->socket, isText ? TCPIP_HTTP_WS_OPCODE_TEXT : TCPIP_HTTP_WS_OPCODE_BINARY, data, dataLen);
+#else
+    return false;
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
 }
 
-void TCPIP_HTTP_NET_ConnectionUserDataSet(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* uData)
+bool TCPIP_HTTP_NET_WebSocketClose(TCPIP_HTTP_NET_CONN_HANDLE connHandle, uint16_t closeCode)
 {
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
     TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    pHttpCon->userData = uData;
+
+    if(pHttpCon == 0 || pHttpCon->wsDcpt == 0 || pHttpCon->wsDcpt->isOpen == 0 || pHttpCon->wsDcpt->closeSent != 0)
+    {
+        return false;
+    }
+
+    return _HTTP_WsCloseSend(pHttpCon, closeCode != 0 ? closeCode : TCPIP_HTTP_WS_CLOSE_NORMAL);
+#else
+    return false;
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
 }
 
-const void* TCPIP_HTTP_NET_ConnectionUserDataGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+// returns the index of a registered WebSocket endpoint
+// or -1 if not found
+static int _HTTP_WsEndpointFind(const char* uri)
 {
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    return pHttpCon->userData;
+    int ix;
+
+    for(ix = 0; ix < sizeof(httpWsEndpoints) / sizeof(*httpWsEndpoints); ix++)
+    {
+        if(httpWsEndpoints[ix].uri != 0 && strcmp(httpWsEndpoints[ix].uri, uri) == 0)
+        {
+            return ix;
+        }
+    }
+
+    return -1;
 }
 
-int TCPIP_HTTP_NET_ConnectionIndexGet(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+// writes a final, unmasked, frame to the socket
+// returns false if there's not enough TX space for the whole frame
+static bool _HTTP_WsFrameWrite(NET_PRES_SKT_HANDLE_T skt, uint8_t opCode, const void* data, uint16_t dataLen)
 {
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    return pHttpCon->connIx;
+    uint8_t frameHdr[4];
+    uint16_t hdrLen;
+
+    frameHdr[0] = 0x80 | opCode;
+    if(dataLen < 126)
+    {
+        frameHdr[1] = (uint8_t)dataLen;
+        hdrLen = 2;
+    }
+    else
+    {   // 16 bit extended length
+        frameHdr[1] = 126;
+        frameHdr[2] = (uint8_t)(dataLen >> 8);
+        frameHdr[3] = (uint8_t)dataLen;
+        hdrLen = 4;
+    }
+
+    if(NET_PRES_SocketWriteIsReady(skt, hdrLen + dataLen, 0) < hdrLen + dataLen)
+    {
+        return false;
+    }
+
+    NET_PRES_SocketWrite(skt, frameHdr, hdrLen);
+    if(dataLen != 0)
+    {
+        NET_PRES_SocketWrite(skt, data, dataLen);
+    }
+    NET_PRES_SocketFlush(skt);
+    return true;
 }
 
-TCPIP_HTTP_NET_CONN_HANDLE TCPIP_HTTP_NET_ConnectionHandleGet(int connIx)
+// sends a close frame with the closeCode status
+static bool _HTTP_WsCloseSend(TCPIP_HTTP_NET_CONN* pHttpCon, uint16_t closeCode)
 {
-    if(connIx < httpConnNo)
+    uint8_t closeData[2];
+
+    closeData[0] = (uint8_t)(closeCode >> 8);
+    closeData[1] = (uint8_t)closeCode;
+    if(_HTTP_WsFrameWrite(pHttpCon->socket, TCPIP_HTTP_WS_OPCODE_CLOSE, closeData, sizeof(closeData)))
     {
-        return httpConnCtrl + connIx;
+        pHttpCon->wsDcpt->closeSent = 1;
+        return true;
     }
 
-    return 0;
+    return false;
 }
 
-int TCPIP_HTTP_NET_ActiveConnectionCountGet(int* pOpenCount)
+// releases the WebSocket state of a connection
+// reports the CLOSE event if the connection was open
+static void _HTTP_WsRelease(TCPIP_HTTP_NET_CONN* pHttpCon)
 {
-    TCPIP_HTTP_NET_CONN* pHttpCon;
-    int connIx;
-    int activeCount, openCount;
-
-    activeCount = openCount = 0;
+    TCPIP_HTTP_WS_DCPT* pWs = pHttpCon->wsDcpt;
 
-    pHttpCon = httpConnCtrl + 0;
-    for(connIx = 0; connIx < httpConnNo; connIx++, pHttpCon++)
+    if(pWs != 0)
     {
-        if(pHttpCon->socket != NET_PRES_INVALID_SOCKET)
+        pHttpCon->wsDcpt = 0;
+        if(pWs->isOpen != 0 && httpWsEndpoints[pWs->epIx].handler != 0)
         {
-            openCount++;
-            if(NET_PRES_SocketIsConnected(pHttpCon->socket))
-            {
-                activeCount++;
-            }
+            (*httpWsEndpoints[pWs->epIx].handler)(pHttpCon, TCPIP_HTTP_NET_WS_EVENT_CLOSE, 0, 0);
         }
+        (*http_free_fnc)(pWs);
     }
+}
 
-    if(pOpenCount)
+// rotates left a 32 bit value
+#define _HTTP_SHA1_ROL(x, n)    (((x) << (n)) | ((x) >> (32 - (n))))
+
+// processes a 64 bytes SHA-1 block
+static void _HTTP_Sha1Block(uint32_t* hash, const uint8_t* block)
+{
+    uint32_t w[16];
+    uint32_t a, b, c, d, e, f, k, temp;
+    int ix;
+
+    for(ix = 0; ix < 16; ix++)
     {
-        *pOpenCount = openCount;
+        w[ix] = ((uint32_t)block[4 * ix] << 24) | ((uint32_t)block[4 * ix + 1] << 16) | ((uint32_t)block[4 * ix + 2] << 8) | block[4 * ix + 3];
     }
 
-    return activeCount;
-}
+    a = hash[0];
+    b = hash[1];
+    c = hash[2];
+    d = hash[3];
+    e = hash[4];
 
-uint16_t TCPIP_HTTP_NET_ConnectionStringFind(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const char* str, uint16_t startOffs, uint16_t searchLen)
-{
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    return (uint16_t)_HTTP_ConnectionStringFind(pHttpCon, str, startOffs, searchLen);
-}
+    for(ix = 0; ix < 80; ix++)
+    {
+        if(ix >= 16)
+        {   // message schedule, in place
+            temp = w[(ix + 13) & 15] ^ w[(ix + 8) & 15] ^ w[(ix + 2) & 15] ^ w[ix & 15];
+            w[ix & 15] = _HTTP_SHA1_ROL(temp, 1);
+        }
 
+        if(ix < 20)
+        {
+            f = (b & c) | (~b & d);
+            k = 0x5a827999;
+        }
+        else if(ix < 40)
+        {
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1;
+        }
+        else if(ix < 60)
+        {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8f1bbcdc;
+        }
+        else
+        {
+            f = b ^ c ^ d;
+            k = 0xca62c1d6;
+        }
 
-bool TCPIP_HTTP_NET_DynamicFileInclude(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const TCPIP_HTTP_DYN_VAR_DCPT* varDcpt, const char* fileName)
-{
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    TCPIP_HTTP_CHUNK_DCPT* pChDcpt = (TCPIP_HTTP_CHUNK_DCPT*)varDcpt->dynContext;
-    TCPIP_HTTP_CHUNK_RES chunkRes = _HTTP_IncludeFile(pHttpCon, pChDcpt, fileName);
+        temp = _HTTP_SHA1_ROL(a, 5) + f + e + k + w[ix & 15];
+        e = d;
+        d = c;
+        c = _HTTP_SHA1_ROL(b, 30);
+        b = a;
+        a = temp;
+    }
 
-    return chunkRes == TCPIP_HTTP_CHUNK_RES_OK; 
+    hash[0] += a;
+    hash[1] += b;
+    hash[2] += c;
+    hash[3] += d;
+    hash[4] += e;
 }
 
-
-uint16_t TCPIP_HTTP_NET_ConnectionFlush(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+// calculates the SHA-1 digest of a short message, FIPS 180-4
+// used only for the WebSocket handshake
+static void _HTTP_Sha1(const uint8_t* data, uint16_t dataLen, uint8_t* digest)
 {
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    return NET_PRES_SocketFlush(pHttpCon->socket);
-}
+    uint32_t hash[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+    uint8_t block[64];
+    uint32_t bitLen = (uint32_t)dataLen << 3;
+    uint16_t left;
+    int ix;
 
-uint16_t TCPIP_HTTP_NET_ConnectionReadIsReady(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
-{
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    return NET_PRES_SocketReadIsReady(pHttpCon->socket);
-}
+    for(left = dataLen; left >= sizeof(block); left -= sizeof(block), data += sizeof(block))
+    {
+        _HTTP_Sha1Block(hash, data);
+    }
 
-uint16_t TCPIP_HTTP_NET_ConnectionRead(TCPIP_HTTP_NET_CONN_HANDLE connHandle, void * buffer, uint16_t size)
-{
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    return NET_PRES_SocketRead(pHttpCon->socket, buffer, size);
-}
+    // padding: 0x80, zeros and the 64 bit message length
+    memcpy(block, data, left);
+    block[left++] = 0x80;
+    if(left > sizeof(block) - 8)
+    {   // no room for the length
+        memset(block + left, 0, sizeof(block) - left);
+        _HTTP_Sha1Block(hash, block);
+        left = 0;
+    }
+    memset(block + left, 0, sizeof(block) - 4 - left);
+    block[60] = (uint8_t)(bitLen >> 24);
+    block[61] = (uint8_t)(bitLen >> 16);
+    block[62] = (uint8_t)(bitLen >> 8);
+    block[63] = (uint8_t)bitLen;
+    _HTTP_Sha1Block(hash, block);
 
-uint16_t TCPIP_HTTP_NET_ConnectionPeek(TCPIP_HTTP_NET_CONN_HANDLE connHandle,  void * buffer, uint16_t size)
-{
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    return NET_PRES_SocketPeek(pHttpCon->socket, buffer, size);
+    for(ix = 0; ix < TCPIP_HTTP_WS_SHA1_LEN; ix++)
+    {
+        digest[ix] = (uint8_t)(hash[ix >> 2] >> (24 - 8 * (ix & 3)));
+    }
 }
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
 
-uint16_t TCPIP_HTTP_NET_ConnectionDiscard(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+int TCPIP_HTTP_NET_LogGet(int startIx, TCPIP_HTTP_NET_LOG_ENTRY* pEntries, int nEntries)
 {
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
-    return NET_PRES_SocketDiscard(pHttpCon->socket);
-}
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+    int ix, nCopied, oldestIx;
 
-uint16_t TCPIP_HTTP_NET_ConnectionReadBufferSize(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
-{
-    uint16_t sktRxSize;
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+    if(pEntries == 0)
+    {
+        return httpLogCount;
+    }
 
-    if(NET_PRES_SocketOptionsGet(pHttpCon->socket, TCP_OPTION_RX_BUFF, &sktRxSize))
+    if(startIx < 0)
     {
-        return sktRxSize;
+        startIx = 0;
     }
 
+    oldestIx = (httpLogHead + TCPIP_HTTP_NET_ACCESS_LOG_ENTRIES - httpLogCount) % TCPIP_HTTP_NET_ACCESS_LOG_ENTRIES;
+    nCopied = 0;
+    for(ix = startIx; ix < httpLogCount && nCopied < nEntries; ix++)
+    {
+        pEntries[nCopied++] = httpAccessLog[(oldestIx + ix) % TCPIP_HTTP_NET_ACCESS_LOG_ENTRIES];
+    }
+
+    return nCopied;
+#else
     return 0;
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
 }
 
-TCPIP_NET_HANDLE TCPIP_HTTP_NET_ConnectionNetHandle(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+bool TCPIP_HTTP_NET_LogPercentileGet(TCPIP_HTTP_NET_LOG_STAGE stage, int percent, uint32_t* pTimeUs)
 {
-    TCP_SOCKET_INFO sktInfo;
-    TCPIP_HTTP_NET_CONN* pHttpCon = (TCPIP_HTTP_NET_CONN*)connHandle;
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+    uint32_t stageTimes[TCPIP_HTTP_NET_ACCESS_LOG_ENTRIES];
+    uint32_t stageUs;
+    int ix, jx, nTimes;
 
-    if(NET_PRES_SocketInfoGet(pHttpCon->socket, &sktInfo))
+    if(stage < 0 || stage >= TCPIP_HTTP_NET_LOG_STAGES || percent < 1 || percent > 100 || pTimeUs == 0)
     {
-        return sktInfo.hNet;
+        return false;
     }
 
-    return 0;
-}
-
-
-static uint16_t _HTTP_SktFifoRxFree(NET_PRES_SKT_HANDLE_T skt)
-{
-    uint16_t sktRxSize;
-    uint16_t sktReadySize;
+    // insertion sort of the stage times; the log is small
+    nTimes = 0;
+    for(ix = 0; ix < httpLogCount; ix++)
+    {
+        if((stageUs = httpAccessLog[ix].stageUs[stage]) == TCPIP_HTTP_NET_LOG_TIME_NONE)
+        {
+            continue;
+        }
+        for(jx = nTimes; jx > 0 && stageTimes[jx - 1] > stageUs; jx--)
+        {
+            stageTimes[jx] = stageTimes[jx - 1];
+        }
+        stageTimes[jx] = stageUs;
+        nTimes++;
+    }
 
-    if(NET_PRES_SocketOptionsGet(skt, TCP_OPTION_RX_BUFF, &sktRxSize))
+    if(nTimes == 0)
     {
-        sktReadySize = NET_PRES_SocketReadIsReady(skt);
-        return sktRxSize - sktReadySize;
+        return false;
     }
 
-    return 0;
+    // nearest rank
+    *pTimeUs = stageTimes[(percent * nTimes + 99) / 100 - 1];
+    return true;
+#else
+    return false;
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
 }
 
+void TCPIP_HTTP_NET_LogClear(void)
+{
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+    httpLogHead = httpLogCount = 0;
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+}
 
-// tries to output the data to the transport socket
-// it checks first for available space and starts the operation
-// only if there's enough space
-// checkLen is the size to check for; could be different than dataLen
-// if data == 0; then nothing is written
-static bool _HTTP_DataTryOutput(TCPIP_HTTP_NET_CONN* pHttpCon, const char* data, uint16_t dataLen, uint16_t checkLen)
+bool TCPIP_HTTP_NET_SchedClassRegister(TCPIP_HTTP_NET_USER_HANDLE hHttp, const char* uriPrefix, TCPIP_HTTP_NET_SCHED_CLASS schedClass)
 {
-    uint16_t socketSpace;
+#if (_TCPIP_HTTP_NET_SCHED != 0)
+    int ix;
+    TCPIP_HTTP_SCHED_RULE* pRule;
+    TCPIP_HTTP_SCHED_RULE* pFree;
 
-    if(checkLen == 0 || checkLen < dataLen)
+    if(httpConnCtrl == 0 || hHttp == 0 || hHttp != httpUserCback || uriPrefix == 0 || schedClass < 0 || schedClass >= TCPIP_HTTP_NET_SCHED_CLASSES)
+    {   // minimal sanity check
+        return false;
+    }
+
+    if(*uriPrefix == TCPIP_HTTP_FILE_PATH_SEP)
+    {   // the requested names have no leading separator
+        uriPrefix++;
+    }
+    if(*uriPrefix == 0)
     {
-        checkLen = dataLen;
+        return false;
     }
-    socketSpace = NET_PRES_SocketWriteIsReady(pHttpCon->socket, checkLen, 0);
-    if(socketSpace >= checkLen)
+
+    pFree = 0;
+    pRule = httpSchedRules;
+    for(ix = 0; ix < sizeof(httpSchedRules) / sizeof(*httpSchedRules); ix++, pRule++)
     {
-        if(data)
+        if(pRule->uriPrefix == 0)
         {
-            NET_PRES_SocketWrite(pHttpCon->socket, (const uint8_t*)data, dataLen);
+            if(pFree == 0)
+            {
+                pFree = pRule;
+            }
         }
-        return true;
+        else if(strcmp(pRule->uriPrefix, uriPrefix) == 0)
+        {   // already there; update
+            pRule->schedClass = (uint16_t)schedClass;
+            return true;
+        }
+    }
+
+    if(pFree == 0)
+    {   // no more room
+        return false;
     }
 
+    pFree->uriPrefix = uriPrefix;
+    pFree->prefixLen = (uint16_t)strlen(uriPrefix);
+    pFree->schedClass = (uint16_t)schedClass;
+    return true;
+#else
     return false;
+#endif  // (_TCPIP_HTTP_NET_SCHED != 0)
 }
 
-
-// Note that the search will fail if there's more data in the TCP socket than could be read at once.
-// returns a 32 bit word:
-//      - hi 16 bits hold the peeked at data, i.e. the number of bytes to safely remove, if needed
-//      - low 16 bits is 0xffff if not found or offset where the string was found
-static uint32_t _HTTP_ConnectionStringFind(TCPIP_HTTP_NET_CONN* pHttpCon, const char* str, uint16_t startOffs, uint16_t searchLen)
+bool TCPIP_HTTP_NET_SchedStatGet(TCPIP_HTTP_NET_SCHED_CLASS schedClass, TCPIP_HTTP_NET_SCHED_STAT* pStat)
 {
-    uint16_t    peekOffs, peekReqLen, peekSize, avlblBytes;
-    char*   queryStr;
+#if (_TCPIP_HTTP_NET_SCHED != 0)
+    if(schedClass < 0 || schedClass >= TCPIP_HTTP_NET_SCHED_CLASSES)
+    {
+        return false;
+    }
 
-    char* srchBuff = (char*)(*http_malloc_fnc)(httpPeekBufferSize + 1);
-    if(srchBuff == 0)
+    if(pStat)
     {
-        char eventBuff[16];
-        sprintf(eventBuff, "%d", httpPeekBufferSize + 1);
-        _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_PEEK_ALLOC_BUFFER_ERROR, eventBuff);
-        return 0xffff;
+        *pStat = httpSchedStat[schedClass];
     }
+    return true;
+#else
+    return false;
+#endif  // (_TCPIP_HTTP_NET_SCHED != 0)
+}
 
-    const char* findStr = (const char*)str;
+bool TCPIP_HTTP_NET_RouteRegister(TCPIP_HTTP_NET_USER_HANDLE hHttp, const char* pattern, TCPIP_HTTP_NET_ROUTE_FLAGS routeFlags, TCPIP_HTTP_NET_ROUTE_HANDLER handler, const void* routeParam)
+{
+#if (_TCPIP_HTTP_NET_ROUTER != 0)
+    int routeIx, nodeIx, methodIx, newNodes;
+    uint16_t patternLen;
+    bool isPrefix;
+    uint8_t* pSlots;
 
-    size_t findLen = strlen(findStr);
+    if(httpConnCtrl == 0 || hHttp == 0 || hHttp != httpUserCback || pattern == 0 || handler == 0)
+    {   // minimal sanity check
+        return false;
+    }
 
-    // peek sanity check
-    if((avlblBytes = NET_PRES_SocketReadIsReady(pHttpCon->socket)) > httpPeekBufferSize)
-    {   // peek buffer too small!
-        sprintf(srchBuff, "%d", (int)(avlblBytes - (httpPeekBufferSize)));
-        _HTTP_Report_ConnectionEvent(pHttpCon, TCPIP_HTTP_NET_EVENT_PEEK_BUFFER_SIZE_EXCEEDED, srchBuff);
+    if((routeFlags & (TCPIP_HTTP_NET_ROUTE_FLAG_GET | TCPIP_HTTP_NET_ROUTE_FLAG_POST)) == 0)
+    {   // no method
+        return false;
     }
 
-    uint16_t retCode = 0xffff;
-    peekSize = 0;
-    // sanity check
-    if(findLen < httpPeekBufferSize)
-    {   // make sure enough room to find such string
-        if(searchLen == 0 || searchLen >= findLen)
+    if(*pattern == TCPIP_HTTP_FILE_PATH_SEP)
+    {   // the requested names have no leading separator
+        pattern++;
+    }
+    patternLen = (uint16_t)strlen(pattern);
+    isPrefix = patternLen != 0 && pattern[patternLen - 1] == '*';
+    if(isPrefix)
+    {
+        patternLen--;
+    }
+    else if(patternLen == 0)
+    {
+        return false;
+    }
+
+    for(routeIx = 0; routeIx < sizeof(httpRoutes) / sizeof(*httpRoutes); routeIx++)
+    {
+        if(httpRoutes[routeIx].handler == 0)
         {
-            peekOffs = startOffs;
-            peekReqLen = searchLen == 0 ? httpPeekBufferSize : searchLen;
-            peekSize =  NET_PRES_SocketPeek(pHttpCon->socket, srchBuff, peekReqLen);
-            if(peekSize >= findLen)
-            {   // enough data present
-                srchBuff[peekSize] = 0;     // end string properly
-                queryStr = strstr(srchBuff, findStr);
-                if(queryStr != 0)
-                {
-                    retCode = peekOffs + queryStr - srchBuff;
-                }
+            break;
+        }
+    }
+
+    if(routeIx == sizeof(httpRoutes) / sizeof(*httpRoutes))
+    {   // no more room
+        return false;
+    }
+
+    // the trie is changed only for a route that can be added
+    if((nodeIx = _HTTP_RouteNodeFind(pattern, patternLen, &newNodes)) >= 0)
+    {
+        pSlots = isPrefix ? httpRouteNodes[nodeIx].prefixRoute : httpRouteNodes[nodeIx].exactRoute;
+        for(methodIx = 0; methodIx < TCPIP_HTTP_ROUTE_METHODS; methodIx++)
+        {
+            if((routeFlags & (1 << methodIx)) != 0 && pSlots[methodIx] != 0)
+            {   // already registered
+                return false;
             }
         }
     }
+    else if(httpRouteNodesNo + newNodes > sizeof(httpRouteNodes) / sizeof(*httpRouteNodes) || (nodeIx = _HTTP_RouteNodeAdd(pattern, patternLen)) < 0)
+    {   // no more room
+        return false;
+    }
 
+    pSlots = isPrefix ? httpRouteNodes[nodeIx].prefixRoute : httpRouteNodes[nodeIx].exactRoute;
 
-    (*http_free_fnc)(srchBuff);
-    return ((uint32_t)peekSize << 16) | retCode;
+    for(methodIx = 0; methodIx < TCPIP_HTTP_ROUTE_METHODS; methodIx++)
+    {
+        if((routeFlags & (1 << methodIx)) != 0)
+        {
+            pSlots[methodIx] = (uint8_t)(routeIx + 1);
+        }
+    }
+
+    httpRoutes[routeIx].handler = handler;
+    httpRoutes[routeIx].routeParam = routeParam;
+    httpRoutes[routeIx].routeFlags = (uint16_t)routeFlags;
+    return true;
+#else
+    return false;
+#endif  // (_TCPIP_HTTP_NET_ROUTER != 0)
 }
 
-static uint16_t _HTTP_ConnectionCharFind(TCPIP_HTTP_NET_CONN* pHttpCon, uint8_t cFind, uint16_t wStart, uint16_t wSearchLen)
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+// time stamps a request stage, the first time it's reached
+static void _HTTP_LogStamp(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_NET_LOG_STAGE stage)
 {
-    char srchBuff[2];
-    srchBuff[0] = cFind;
-    srchBuff[1] = 0;
-
-    return (uint16_t)_HTTP_ConnectionStringFind(pHttpCon, srchBuff, wStart, wSearchLen);
+    if(pHttpCon->logStamps[stage] == 0)
+    {
+        pHttpCon->logStamps[stage] = SYS_TIME_CounterGet();
+    }
 }
 
-
-TCPIP_HTTP_NET_USER_HANDLE TCPIP_HTTP_NET_UserHandlerRegister(const TCPIP_HTTP_NET_USER_CALLBACK* userCallback)
-{
-    if(httpConnCtrl)
-    {   // we're up and running; allow only one registration for now
-        if(userCallback && httpUserCback == 0)
-        {
-            httpRegistry = *userCallback;
-            httpUserCback = &httpRegistry;
-            return (TCPIP_HTTP_NET_USER_HANDLE)httpUserCback;
-        }
+// records the current request of a connection in the access log
+// the request ends now; the oldest record is overwritten when the log is full
+static void _HTTP_LogRecord(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    int stage;
+    uint32_t tStamp, tFreq;
+    TCPIP_HTTP_NET_LOG_ENTRY* pEntry;
+
+    if(pHttpCon->flags.logPending == 0)
+    {   // no request or already recorded
+        return;
     }
+    pHttpCon->flags.logPending = 0;
 
-    return 0;
+    tFreq = SYS_TIME_FrequencyGet();
+    pEntry = httpAccessLog + httpLogHead;
+    pEntry->tAccept = pHttpCon->logAccept;
+    for(stage = 0; stage < TCPIP_HTTP_NET_LOG_STAGES; stage++)
+    {
+        tStamp = stage == TCPIP_HTTP_NET_LOG_STAGE_CLOSE ? SYS_TIME_CounterGet() : pHttpCon->logStamps[stage];
+        pEntry->stageUs[stage] = tStamp == 0 ? TCPIP_HTTP_NET_LOG_TIME_NONE : (uint32_t)(((uint64_t)(tStamp - pHttpCon->logAccept) * 1000000) / tFreq);
+    }
+    pEntry->uriHash = (pHttpCon->fileName != 0 && *pHttpCon->fileName != 0) ? fnv_32_hash(pHttpCon->fileName, strlen(pHttpCon->fileName)) : 0;
+    pEntry->bodyBytes = pHttpCon->logBytes;
+    pEntry->httpStatus = pHttpCon->httpStatus;
+    pEntry->connIx = pHttpCon->connIx;
+    pHttpCon->logAccept = 0;
 
+    httpLogHead = (httpLogHead + 1) % TCPIP_HTTP_NET_ACCESS_LOG_ENTRIES;
+    if(httpLogCount < TCPIP_HTTP_NET_ACCESS_LOG_ENTRIES)
+    {
+        httpLogCount++;
+    }
 }
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
 
-bool TCPIP_HTTP_NET_UserHandlerDeregister(TCPIP_HTTP_NET_USER_HANDLE hHttp)
+#if (_TCPIP_HTTP_NET_ACCESS_LOG_DUMP != 0)
+// serves the access log records, the oldest first, as a binary message body
+// procPhase 2: the headers; procPhase 3: the records
+// the number of records is set when the headers are sent: byteCount
+// callbackPos is the number of records sent
+static TCPIP_HTTP_NET_CONN_STATE _HTTP_LogDump(TCPIP_HTTP_NET_CONN* pHttpCon, bool* pWait)
 {
-    if(httpConnCtrl == 0 || hHttp == 0 || hHttp != httpUserCback)
-    {   // minimal sanity check
-        return false;
+    char hdrBuff[100];
+    int hdrLen;
+    TCPIP_HTTP_NET_LOG_ENTRY logEntry;
+
+    if(pHttpCon->flags.procPhase == 2)
+    {
+        hdrLen = sprintf(hdrBuff, "Content-Type: application/octet-stream\r\nCache-Control: no-cache\r\nContent-Length: %u\r\n\r\n",
+                (unsigned int)(httpLogCount * sizeof(logEntry)));
+        if(!_HTTP_DataTryOutput(pHttpCon, hdrBuff, hdrLen, 0))
+        {   // not enough room to send data; wait some more
+            *pWait = true;
+            return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
+        }
+#if (_TCPIP_HTTP_NET_PIPELINE != 0)
+        _HTTP_BodySkip(pHttpCon, pHttpCon->byteCount);
+#endif  // (_TCPIP_HTTP_NET_PIPELINE != 0)
+        pHttpCon->byteCount = httpLogCount;
+        pHttpCon->callbackPos = 0;
+        pHttpCon->flags.procPhase = 3;
     }
 
-    // we're up and running
-    // abort all connections
-    int connIx;
-    TCPIP_HTTP_NET_CONN* pHttpCon = httpConnCtrl;
-    for(connIx = 0; connIx < httpConnNo; connIx++, pHttpCon++)
+    while(pHttpCon->callbackPos < pHttpCon->byteCount)
     {
-        if(pHttpCon->socket != NET_PRES_INVALID_SOCKET)
-        {
-            TCP_SOCKET tcp_skt = NET_PRES_SocketGetTransportHandle(pHttpCon->socket);
-            TCPIP_TCP_Abort(tcp_skt, false);
+        if(!_HTTP_DataTryOutput(pHttpCon, 0, 0, sizeof(logEntry)))
+        {   // wait for TX space
+            *pWait = true;
+            return TCPIP_HTTP_CONN_STATE_SERVE_HEADERS;
         }
+
+        if(TCPIP_HTTP_NET_LogGet(pHttpCon->callbackPos, &logEntry, 1) == 0)
+        {   // the log was cleared meanwhile; keep the announced length
+            memset(&logEntry, 0, sizeof(logEntry));
+        }
+        _HTTP_DataTryOutput(pHttpCon, (const char*)&logEntry, sizeof(logEntry), 0);
+        pHttpCon->logBytes += sizeof(logEntry);
+        pHttpCon->callbackPos++;
     }
-    httpUserCback = 0;
-    return true;
+
+    pHttpCon->flags.procPhase = 0;
+    return TCPIP_HTTP_CONN_STATE_DONE;
 }
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG_DUMP != 0)
 
 
 
@@ -3336,7 +8314,7 @@ bool TCPIP_HTTP_NET_UserHandlerDeregister(TCPIP_HTTP_NET_USER_HANDLE hHttp)
 // Returns: number of bytes needed/written as the chunk header
 //          0 if retry needed
 // the output goes directly to the socket, if possible
-#if (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0)
+#if (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0) || (_TCPIP_HTTP_NET_FILE_MEMORY != 0)
 static uint16_t _HTTP_StartHttpChunk(TCPIP_HTTP_NET_CONN* pHttpCon, uint32_t chunkSize)
 {
     char chunkHdrBuff[TCPIP_HTTP_CHUNK_HEADER_LEN + 1];     
@@ -3345,7 +8323,7 @@ static uint16_t _HTTP_StartHttpChunk(TCPIP_HTTP_NET_CONN* pHttpCon, uint32_t chu
 
     _HTTPAssertCond(hdrLen <= TCPIP_HTTP_CHUNK_HEADER_LEN, __func__, __LINE__);
 
-    if(httpNonPersistentConn == false)
+    if(_HTTP_ChunkFramingNeeded(pHttpCon))
     {   // write to the socket
         uint16_t avlblBytes;
         avlblBytes = NET_PRES_SocketWriteIsReady(pHttpCon->socket, hdrLen, 0);
@@ -3359,7 +8337,7 @@ static uint16_t _HTTP_StartHttpChunk(TCPIP_HTTP_NET_CONN* pHttpCon, uint32_t chu
         _HTTPAssertCond(avlblBytes == hdrLen, __func__, __LINE__);
         return avlblBytes;
     }
-    // else non persistent and fake it
+    // else no framing and fake it
     return hdrLen;
 }
 
@@ -3385,7 +8363,7 @@ static uint16_t _HTTP_EndHttpChunk(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHU
 
     uint16_t trailLen = strlen(endStr);
 
-    if(httpNonPersistentConn == false)
+    if(_HTTP_ChunkFramingNeeded(pHttpCon))
     {
         uint16_t avlblBytes;
         avlblBytes = NET_PRES_SocketWriteIsReady(pHttpCon->socket, trailLen, 0);
@@ -3404,14 +8382,14 @@ static uint16_t _HTTP_EndHttpChunk(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHU
     return trailLen;
 }
 
-#endif // (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0)
+#endif // (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0) || (_TCPIP_HTTP_NET_FILE_MEMORY != 0)
 
 // prepends the start HTTP chunk to the buffer
 // if buffer is null, it just calculates the size
 // returns the size taken by the header
-static uint16_t _HTTP_PrependStartHttpChunk(char* buffer, uint32_t chunkSize)
+static uint16_t _HTTP_PrependStartHttpChunk(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer, uint32_t chunkSize)
 {
-    if(httpNonPersistentConn == true)
+    if(!_HTTP_ChunkFramingNeeded(pHttpCon))
     {   // no chunk header
         return 0;
     }
@@ -3433,9 +8411,9 @@ static uint16_t _HTTP_PrependStartHttpChunk(char* buffer, uint32_t chunkSize)
 // appends the end chunk to the end of buffer
 // if buffer is null, it just calculates the size
 // returns the size taken by the trailer
-static uint16_t _HTTP_AppendEndHttpChunk(char* buffer, TCPIP_HTTP_CHUNK_END_TYPE endType)
+static uint16_t _HTTP_AppendEndHttpChunk(TCPIP_HTTP_NET_CONN* pHttpCon, char* buffer, TCPIP_HTTP_CHUNK_END_TYPE endType)
 {
-    if(httpNonPersistentConn == true)
+    if(!_HTTP_ChunkFramingNeeded(pHttpCon))
     {   // no chunk trailer
         return 0;
     }
@@ -3464,6 +8442,523 @@ static uint16_t _HTTP_AppendEndHttpChunk(char* buffer, TCPIP_HTTP_CHUNK_END_TYPE
     return trailLen;
 }
 
+// returns true if the chunk framing has to be inserted around each piece of output
+// false if there's no framing or the framing is added when the collected output is sent
+static bool _HTTP_ChunkFramingNeeded(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    if(httpNonPersistentConn == true || pHttpCon->flags.bodyIdentity != 0)
+    {
+        return false;
+    }
+
+#if (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+    if(pHttpCon->bodyBuff != 0)
+    {
+        return false;
+    }
+#endif  // (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+
+    return true;
+}
+
+// writes message body data
+// the output of a dynamic file is collected into the connection bodyBuff
+// and sent as chunks sized to the free socket TX space
+// returns the number of bytes taken
+static uint16_t _HTTP_BodyWrite(TCPIP_HTTP_NET_CONN* pHttpCon, const void* data, uint16_t dataLen)
+{
+#if (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+    if(pHttpCon->bodyBuff != 0)
+    {
+        uint16_t copyLen, outLen = 0;
+        const uint8_t* pData = (const uint8_t*)data;
+
+#if (_TCPIP_HTTP_NET_DEFLATE != 0)
+        if(pHttpCon->deflateDcpt != 0)
+        {   // the compressed data goes to the bodyBuff
+            outLen = _HTTP_DeflateWrite(pHttpCon, pData, dataLen);
+            dataLen = 0;
+        }
+#endif  // (_TCPIP_HTTP_NET_DEFLATE != 0)
+
+        while(dataLen != 0)
+        {
+            if(pHttpCon->bodyLen == pHttpCon->bodyBuffSize)
+            {   // full; try to send it
+                if(!_HTTP_BodyFlush(pHttpCon, false) || pHttpCon->bodyLen == pHttpCon->bodyBuffSize)
+                {
+                    break;
+                }
+            }
+
+            copyLen = pHttpCon->bodyBuffSize - pHttpCon->bodyLen;
+            if(copyLen > dataLen)
+            {
+                copyLen = dataLen;
+            }
+            memcpy(pHttpCon->bodyBuff + TCPIP_HTTP_CHUNK_HEADER_LEN + pHttpCon->bodyLen, pData, copyLen);
+            pHttpCon->bodyLen += copyLen;
+            pData += copyLen;
+            dataLen -= copyLen;
+            outLen += copyLen;
+        }
+
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+        if(pHttpCon->snapEntry != 0 && outLen != 0 && pHttpCon->flags.bodyDeflate == 0)
+        {   // the compressed output is captured by _HTTP_DeflateWrite
+            _HTTP_SnapshotCapture(pHttpCon, data, outLen);
+        }
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+        pHttpCon->logBytes += outLen;
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+#if (_TCPIP_HTTP_NET_SCHED != 0)
+        pHttpCon->schedDeficit -= outLen;
+        httpSchedStat[pHttpCon->schedClass].bytes += outLen;
+#endif  // (_TCPIP_HTTP_NET_SCHED != 0)
+
+        return outLen;
+    }
+#endif  // (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+
+    dataLen = NET_PRES_SocketWrite(pHttpCon->socket, data, dataLen);
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+    pHttpCon->logBytes += dataLen;
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+#if (_TCPIP_HTTP_NET_SCHED != 0)
+    pHttpCon->schedDeficit -= dataLen;
+    httpSchedStat[pHttpCon->schedClass].bytes += dataLen;
+#endif  // (_TCPIP_HTTP_NET_SCHED != 0)
+    return dataLen;
+}
+
+#if (TCPIP_HTTP_NET_SSI_PROCESS != 0)
+// returns the space available for writing message body data
+// reqSize is returned if the space is available, 0 otherwise
+static uint16_t _HTTP_BodyWriteIsReady(TCPIP_HTTP_NET_CONN* pHttpCon, uint16_t reqSize)
+{
+#if (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+    if(pHttpCon->bodyBuff != 0)
+    {
+        uint16_t needSize = reqSize;
+#if (_TCPIP_HTTP_NET_DEFLATE != 0)
+        if(pHttpCon->deflateDcpt != 0)
+        {   // fixed Huffman literals take up to 9 bits
+            needSize += reqSize / 8 + TCPIP_HTTP_DEFLATE_SYMBOL_MAX;
+        }
+#endif  // (_TCPIP_HTTP_NET_DEFLATE != 0)
+        if(pHttpCon->bodyBuffSize - pHttpCon->bodyLen < needSize)
+        {   // make room
+            _HTTP_BodyFlush(pHttpCon, false);
+        }
+        return (pHttpCon->bodyBuffSize - pHttpCon->bodyLen < needSize) ? 0 : reqSize;
+    }
+#endif  // (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+
+    return NET_PRES_SocketWriteIsReady(pHttpCon->socket, reqSize, 0) < reqSize ? 0 : reqSize;
+}
+#endif  // (TCPIP_HTTP_NET_SSI_PROCESS != 0)
+
+#if (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+// sends the output collected in the bodyBuff as one chunk
+// if the socket cannot take all the data, a chunk sized to the free TX space is sent
+// but not less than half of the buffer, to avoid small chunks
+// final: the data and the last chunk are sent and the buffer is released
+// returns false if nothing could be sent
+static bool _HTTP_BodyFlush(TCPIP_HTTP_NET_CONN* pHttpCon, bool final)
+{
+    uint16_t hdrLen, trailLen, reqLen, minLen, avlblLen;
+    const char* trailStr;
+    char* pData;
+    char chunkHdrBuff[TCPIP_HTTP_CHUNK_HEADER_LEN + 1];     
+
+    uint16_t chunkLen = pHttpCon->bodyLen;
+    if(chunkLen == 0 && !final)
+    {   // nothing to do
+        return true;
+    }
+
+    if(httpNonPersistentConn == false)
+    {   // chunk framing
+        hdrLen = TCPIP_HTTP_CHUNK_HEADER_LEN;
+        if(final)
+        {
+            trailStr = chunkLen != 0 ? TCPIP_HTTP_NET_CRLF "0" TCPIP_HTTP_NET_CRLF TCPIP_HTTP_NET_CRLF : "0" TCPIP_HTTP_NET_CRLF TCPIP_HTTP_NET_CRLF;
+        }
+        else
+        {
+            trailStr = TCPIP_HTTP_NET_CRLF;
+        }
+    }
+    else
+    {
+        hdrLen = 0;
+        trailStr = "";
+    }
+    trailLen = strlen(trailStr);
+
+    reqLen = hdrLen + chunkLen + trailLen;
+    minLen = final ? 0 : hdrLen + (chunkLen < pHttpCon->bodyBuffSize / 2 ? chunkLen : pHttpCon->bodyBuffSize / 2) + trailLen;
+    avlblLen = NET_PRES_SocketWriteIsReady(pHttpCon->socket, reqLen, minLen);
+    if(avlblLen == 0 || (final && avlblLen < reqLen))
+    {   // wait for space
+        return false;
+    }
+
+    if(avlblLen < reqLen)
+    {   // send what fits
+        chunkLen = avlblLen - hdrLen - trailLen;
+    }
+
+    pData = pHttpCon->bodyBuff + TCPIP_HTTP_CHUNK_HEADER_LEN;
+    if(chunkLen != 0)
+    {
+        if(hdrLen != 0)
+        {
+            hdrLen = sprintf(chunkHdrBuff, "%x\r\n", (unsigned int)chunkLen);
+            memcpy(pData - hdrLen, chunkHdrBuff, hdrLen);
+        }
+        NET_PRES_SocketWrite(pHttpCon->socket, pData - hdrLen, hdrLen + chunkLen);
+    }
+    if(trailLen != 0)
+    {
+        NET_PRES_SocketWrite(pHttpCon->socket, trailStr, trailLen);
+    }
+
+    if((pHttpCon->bodyLen -= chunkLen) != 0)
+    {   // move the rest at the buffer beginning
+        memmove(pData, pData + chunkLen, pHttpCon->bodyLen);
+    }
+
+    if(final)
+    {
+        _HTTP_BodyBuffRelease(pHttpCon);
+    }
+
+    return true;
+}
+
+// releases the buffer collecting the dynamic output
+static void _HTTP_BodyBuffRelease(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    if(pHttpCon->bodyBuff != 0)
+    {
+        (*http_free_fnc)(pHttpCon->bodyBuff);
+        pHttpCon->bodyBuff = 0;
+        pHttpCon->bodyLen = 0;
+    }
+#if (_TCPIP_HTTP_NET_DEFLATE != 0)
+    if(pHttpCon->deflateDcpt != 0)
+    {
+        (*http_free_fnc)(pHttpCon->deflateDcpt);
+        pHttpCon->deflateDcpt = 0;
+    }
+#endif  // (_TCPIP_HTTP_NET_DEFLATE != 0)
+}
+#endif  // (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+
+#if (_TCPIP_HTTP_NET_DEFLATE != 0)
+// deflate compression of the dynamic output: zlib stream, RFC 1950/1951
+// greedy LZ77 matching over a small window, coded with the fixed Huffman tables
+// the output needs no code tables and is written as it is generated
+
+// starts compressing the output of a connection that has a bodyBuff
+// the compression is skipped if the heap is low
+static void _HTTP_DeflateStart(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    TCPIP_HTTP_DEFLATE_DCPT* pDcpt = 0;
+
+    if(TCPIP_HEAP_FreeSize(httpMemH) >= TCPIP_HTTP_NET_DEFLATE_MIN_HEAP)
+    {
+        pDcpt = (TCPIP_HTTP_DEFLATE_DCPT*)(*http_malloc_fnc)(sizeof(TCPIP_HTTP_DEFLATE_DCPT));
+    }
+
+    if(pDcpt == 0)
+    {
+        httpDeflateLowHeap++;
+        return;
+    }
+
+    memset(pDcpt, 0, sizeof(*pDcpt));
+    pDcpt->adlerA = 1;
+    pHttpCon->deflateDcpt = pDcpt;
+    pHttpCon->flags.bodyDeflate = 1;
+    httpDeflateResponses++;
+}
+
+// adds bits to the output, LSB first
+// the complete bytes are written out
+static void _HTTP_DeflateBits(TCPIP_HTTP_DEFLATE_DCPT* pDcpt, uint32_t bits, uint16_t nBits)
+{
+    pDcpt->bitBuff |= bits << pDcpt->bitCount;
+    pDcpt->bitCount += nBits;
+    while(pDcpt->bitCount >= 8)
+    {
+        *pDcpt->pOut++ = (uint8_t)pDcpt->bitBuff;
+        pDcpt->bitBuff >>= 8;
+        pDcpt->bitCount -= 8;
+    }
+}
+
+// adds a Huffman code to the output, MSB first
+static void _HTTP_DeflateCode(TCPIP_HTTP_DEFLATE_DCPT* pDcpt, uint16_t code, uint16_t nBits)
+{
+    uint16_t ix;
+    uint32_t revCode = 0;
+
+    for(ix = 0; ix < nBits; ix++)
+    {
+        revCode = (revCode << 1) | (code & 1);
+        code >>= 1;
+    }
+    _HTTP_DeflateBits(pDcpt, revCode, nBits);
+}
+
+// adds a literal/length symbol, using the fixed Huffman codes
+static void _HTTP_DeflateSymbol(TCPIP_HTTP_DEFLATE_DCPT* pDcpt, uint16_t symbol)
+{
+    if(symbol < 144)
+    {
+        _HTTP_DeflateCode(pDcpt, 0x30 + symbol, 8);
+    }
+    else if(symbol < 256)
+    {
+        _HTTP_DeflateCode(pDcpt, 0x190 + symbol - 144, 9);
+    }
+    else if(symbol < 280)
+    {
+        _HTTP_DeflateCode(pDcpt, symbol - 256, 7);
+    }
+    else
+    {
+        _HTTP_DeflateCode(pDcpt, 0xc0 + symbol - 280, 8);
+    }
+}
+
+// adds a <length, distance> pair
+static void _HTTP_DeflateMatch(TCPIP_HTTP_DEFLATE_DCPT* pDcpt, uint16_t matchLen, uint16_t matchDist)
+{
+    int ix;
+
+    for(ix = sizeof(httpDeflateLenBase) / sizeof(*httpDeflateLenBase) - 1; httpDeflateLenBase[ix] > matchLen; ix--);
+    _HTTP_DeflateSymbol(pDcpt, 257 + ix);
+    _HTTP_DeflateBits(pDcpt, matchLen - httpDeflateLenBase[ix], httpDeflateLenExtra[ix]);
+
+    for(ix = sizeof(httpDeflateDistBase) / sizeof(*httpDeflateDistBase) - 1; httpDeflateDistBase[ix] > matchDist; ix--);
+    _HTTP_DeflateCode(pDcpt, ix, 5);
+    _HTTP_DeflateBits(pDcpt, matchDist - httpDeflateDistBase[ix], httpDeflateDistExtra[ix]);
+}
+
+// hash of the 3 bytes sequence starting at pData
+static __inline__ uint16_t __attribute__((always_inline)) _HTTP_DeflateHash(const uint8_t* pData)
+{
+    uint32_t seq = ((uint32_t)pData[0] << 16) | ((uint32_t)pData[1] << 8) | pData[2];
+    return (uint16_t)((seq * 2654435761u) >> 24) & (TCPIP_HTTP_DEFLATE_HASH_SIZE - 1);
+}
+
+// writes the zlib header and the start of the fixed Huffman block
+static void _HTTP_DeflateHeader(TCPIP_HTTP_DEFLATE_DCPT* pDcpt)
+{
+    *pDcpt->pOut++ = 0x78;      // CM = 8, CINFO = 7
+    *pDcpt->pOut++ = 0x01;      // FLEVEL = 0, FCHECK
+    _HTTP_DeflateBits(pDcpt, 0x2, 3);   // BFINAL = 0, BTYPE = 01
+    pDcpt->started = 1;
+}
+
+// compresses data into the outBuff
+// stops when the outBuff cannot take another symbol
+// a match is searched only in the window and the current data
+// returns the number of input bytes taken; *pOutLen is updated with the output size
+static uint16_t _HTTP_DeflateCompress(TCPIP_HTTP_DEFLATE_DCPT* pDcpt, const uint8_t* data, uint16_t dataLen, uint8_t* outBuff, uint16_t outSize, uint16_t* pOutLen)
+{
+    uint16_t inIx, ix, hash, maxLen, matchLen, matchDist;
+    uint8_t  srcByte;
+    const uint8_t* outEnd = outBuff + outSize;
+
+    pDcpt->pOut = outBuff;
+    if(pDcpt->started == 0)
+    {
+        if(outSize < 2 + TCPIP_HTTP_DEFLATE_SYMBOL_MAX)
+        {
+            *pOutLen = 0;
+            return 0;
+        }
+        _HTTP_DeflateHeader(pDcpt);
+    }
+
+    inIx = 0;
+    while(inIx < dataLen && outEnd - pDcpt->pOut >= TCPIP_HTTP_DEFLATE_SYMBOL_MAX)
+    {
+        matchLen = 0;
+        matchDist = 0;
+        maxLen = dataLen - inIx;
+        if(maxLen > TCPIP_HTTP_DEFLATE_MAX_MATCH)
+        {
+            maxLen = TCPIP_HTTP_DEFLATE_MAX_MATCH;
+        }
+
+        if(maxLen >= TCPIP_HTTP_DEFLATE_MIN_MATCH)
+        {   // check the last sequence with the same hash
+            hash = _HTTP_DeflateHash(data + inIx);
+            matchDist = pDcpt->inPos - pDcpt->hashHead[hash];
+            if(matchDist != 0 && matchDist <= pDcpt->histLen)
+            {   // the source overlaps the current data for matchLen >= matchDist
+                for(matchLen = 0; matchLen < maxLen; matchLen++)
+                {
+                    if(matchLen < matchDist)
+                    {
+                        srcByte = pDcpt->window[(uint16_t)(pDcpt->inPos - matchDist + matchLen) & (TCPIP_HTTP_NET_DEFLATE_WINDOW - 1)];
+                    }
+                    else
+                    {
+                        srcByte = data[inIx + matchLen - matchDist];
+                    }
+                    if(srcByte != data[inIx + matchLen])
+                    {
+                        break;
+                    }
+                }
+            }
+            pDcpt->hashHead[hash] = pDcpt->inPos;
+        }
+
+        if(matchLen >= TCPIP_HTTP_DEFLATE_MIN_MATCH)
+        {
+            _HTTP_DeflateMatch(pDcpt, matchLen, matchDist);
+        }
+        else
+        {
+            _HTTP_DeflateSymbol(pDcpt, data[inIx]);
+            matchLen = 1;
+        }
+
+        // move the data to the window; the sequences inside a match are hashed too
+        for(ix = 0; ix < matchLen; ix++, inIx++)
+        {
+            if(ix != 0 && inIx + TCPIP_HTTP_DEFLATE_MIN_MATCH <= dataLen)
+            {
+                pDcpt->hashHead[_HTTP_DeflateHash(data + inIx)] = pDcpt->inPos;
+            }
+            srcByte = data[inIx];
+            pDcpt->window[pDcpt->inPos & (TCPIP_HTTP_NET_DEFLATE_WINDOW - 1)] = srcByte;
+            pDcpt->inPos++;
+            if((pDcpt->adlerA += srcByte) >= 65521)
+            {
+                pDcpt->adlerA -= 65521;
+            }
+            if((pDcpt->adlerB += pDcpt->adlerA) >= 65521)
+            {
+                pDcpt->adlerB -= 65521;
+            }
+        }
+        if(pDcpt->histLen < TCPIP_HTTP_NET_DEFLATE_WINDOW)
+        {
+            pDcpt->histLen = pDcpt->histLen + matchLen < TCPIP_HTTP_NET_DEFLATE_WINDOW ? pDcpt->histLen + matchLen : TCPIP_HTTP_NET_DEFLATE_WINDOW;
+        }
+    }
+
+    *pOutLen = pDcpt->pOut - outBuff;
+    return inIx;
+}
+
+// ends the compressed stream: end of block, an empty final block and the Adler-32 trailer
+// the outBuff needs TCPIP_HTTP_DEFLATE_END_MAX bytes
+// returns the output size
+static uint16_t _HTTP_DeflateFinish(TCPIP_HTTP_DEFLATE_DCPT* pDcpt, uint8_t* outBuff)
+{
+    pDcpt->pOut = outBuff;
+    if(pDcpt->started == 0)
+    {   // no data
+        _HTTP_DeflateHeader(pDcpt);
+    }
+
+    _HTTP_DeflateSymbol(pDcpt, 256);
+    _HTTP_DeflateBits(pDcpt, 0x3, 3);   // BFINAL = 1, BTYPE = 01
+    _HTTP_DeflateSymbol(pDcpt, 256);
+    if(pDcpt->bitCount != 0)
+    {   // byte align
+        _HTTP_DeflateBits(pDcpt, 0, 8 - pDcpt->bitCount);
+    }
+
+    *pDcpt->pOut++ = (uint8_t)(pDcpt->adlerB >> 8);
+    *pDcpt->pOut++ = (uint8_t)pDcpt->adlerB;
+    *pDcpt->pOut++ = (uint8_t)(pDcpt->adlerA >> 8);
+    *pDcpt->pOut++ = (uint8_t)pDcpt->adlerA;
+    pDcpt->finished = 1;
+
+    return pDcpt->pOut - outBuff;
+}
+
+// compresses the output of a connection into its bodyBuff
+// the bodyBuff is flushed when it cannot take another symbol
+// returns the number of bytes taken
+static uint16_t _HTTP_DeflateWrite(TCPIP_HTTP_NET_CONN* pHttpCon, const uint8_t* data, uint16_t dataLen)
+{
+    uint16_t inLen, outLen;
+    uint16_t takenLen = 0;
+    uint8_t* pOut;
+
+    while(takenLen < dataLen)
+    {
+        if(pHttpCon->bodyBuffSize - pHttpCon->bodyLen < 2 + TCPIP_HTTP_DEFLATE_SYMBOL_MAX)
+        {   // try to make room
+            if(!_HTTP_BodyFlush(pHttpCon, false) || pHttpCon->bodyBuffSize - pHttpCon->bodyLen < 2 + TCPIP_HTTP_DEFLATE_SYMBOL_MAX)
+            {
+                break;
+            }
+        }
+
+        pOut = (uint8_t*)pHttpCon->bodyBuff + TCPIP_HTTP_CHUNK_HEADER_LEN + pHttpCon->bodyLen;
+        inLen = _HTTP_DeflateCompress(pHttpCon->deflateDcpt, data + takenLen, dataLen - takenLen, pOut, pHttpCon->bodyBuffSize - pHttpCon->bodyLen, &outLen);
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+        if(pHttpCon->snapEntry != 0 && outLen != 0)
+        {   // the snapshot holds the compressed output
+            _HTTP_SnapshotCapture(pHttpCon, pOut, outLen);
+        }
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+        pHttpCon->bodyLen += outLen;
+        takenLen += inLen;
+        httpDeflateIn += inLen;
+        httpDeflateOut += outLen;
+    }
+
+    return takenLen;
+}
+
+// writes the end of the compressed stream into the bodyBuff
+// returns false if waiting for room
+static bool _HTTP_DeflateEnd(TCPIP_HTTP_NET_CONN* pHttpCon)
+{
+    uint16_t outLen;
+    uint8_t* pOut;
+    TCPIP_HTTP_DEFLATE_DCPT* pDcpt = pHttpCon->deflateDcpt;
+
+    if(pDcpt->finished == 0)
+    {
+        if(pHttpCon->bodyBuffSize - pHttpCon->bodyLen < TCPIP_HTTP_DEFLATE_END_MAX)
+        {
+            if(!_HTTP_BodyFlush(pHttpCon, false) || pHttpCon->bodyBuffSize - pHttpCon->bodyLen < TCPIP_HTTP_DEFLATE_END_MAX)
+            {
+                return false;
+            }
+        }
+
+        pOut = (uint8_t*)pHttpCon->bodyBuff + TCPIP_HTTP_CHUNK_HEADER_LEN + pHttpCon->bodyLen;
+        outLen = _HTTP_DeflateFinish(pDcpt, pOut);
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+        if(pHttpCon->snapEntry != 0)
+        {
+            _HTTP_SnapshotCapture(pHttpCon, pOut, outLen);
+        }
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+        pHttpCon->bodyLen += outLen;
+        httpDeflateOut += outLen;
+    }
+
+    return true;
+}
+#endif  // (_TCPIP_HTTP_NET_DEFLATE != 0)
+
 
 
 
@@ -3477,6 +8972,13 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_AddFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon, SY
     TCPIP_HTTP_NET_EVENT_TYPE evType = TCPIP_HTTP_NET_EVENT_NONE;
     const void* evInfo = fName;
     TCPIP_HTTP_CHUNK_DCPT* pChDcpt = 0;
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+    uint32_t fHash = 0;
+    uint32_t fStamp = 0;
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+#if (_TCPIP_HTTP_NET_FILE_MAPPED != 0)
+    const void* fMapped = 0;
+#endif  // (_TCPIP_HTTP_NET_FILE_MAPPED != 0)
 
 
     while(true)
@@ -3500,18 +9002,25 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_AddFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon, SY
         chunkFlags = (pOwnDcpt == 0) ? (TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE | TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_ROOT) : TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE;
         if(fName != 0)
         {
-            SYS_FS_FSTAT fs_attr = {0};
-            bool fileGzipped = false;
-
-            if((*httpFileShell->fileStat)(httpFileShell, fName, &fs_attr) != SYS_FS_HANDLE_INVALID)
+            bool fileDynamic;
+
+            if(pOwnDcpt == 0)
+            {   // the root file info is known from the file open
+                fileDynamic = pHttpCon->flags.fileDynamic != 0;
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+                fStamp = pHttpCon->fileStamp;
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+            }
+            else
             {
-                if (fs_attr.fattrib == SYS_FS_ATTR_ZIP_COMPRESSED)
-                {
-                    fileGzipped = true;
-                }
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+                fileDynamic = _HTTP_IncludeIsDynamic(fName, &fStamp);
+#else
+                fileDynamic = _HTTP_IncludeIsDynamic(fName, 0);
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
             }
 
-            if(!fileGzipped && _HTTP_FileTypeIsDynamic(fName))
+            if(fileDynamic)
             {
                 if(!_HTTP_DbgKillDynFiles())
                 {
@@ -3528,6 +9037,16 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_AddFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon, SY
             break;
         }
 
+#if (_TCPIP_HTTP_NET_FILE_MAPPED != 0)
+        if((chunkFlags & TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_DYN) == 0)
+        {   // a binary file is sent directly from the media, if memory mapped
+            if((*httpFileShell->fileMappedAddress)(httpFileShell, fH, &fMapped) == SYS_FS_RES_SUCCESS)
+            {
+                chunkFlags |= TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_MAPPED;
+            }
+        }
+#endif  // (_TCPIP_HTTP_NET_FILE_MAPPED != 0)
+
         // valid file, try to get a chunk
         pChDcpt = _HTTP_AllocChunk(pHttpCon, chunkFlags, (pOwnDcpt == 0), &evType);
 
@@ -3541,8 +9060,17 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_AddFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon, SY
         pChDcpt->pRootDcpt = (pOwnDcpt == 0) ? pChDcpt : pOwnDcpt->pRootDcpt; 
         pChDcpt->fileChDcpt.fSize = fileSize;
         pChDcpt->fileChDcpt.fHandle = fH;
+#if (_TCPIP_HTTP_NET_FILE_MAPPED != 0)
+        pChDcpt->fileChDcpt.fMapped = (const uint8_t*)fMapped;
+#endif  // (_TCPIP_HTTP_NET_FILE_MAPPED != 0)
         if(fName != 0)
         {
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+            if((chunkFlags & TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_DYN) != 0)
+            {   // file identity for the template cache; the date/time is known from the file info
+                fHash = fnv_32_hash(fName, strlen(fName));
+            }
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
             char* path = strrchr(fName, TCPIP_HTTP_FILE_PATH_SEP);
             if(path)
             {   // save a truncated version of the file name, no path 
@@ -3556,6 +9084,13 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_AddFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon, SY
             pChDcpt->chunkFName[0] = 0;
         }
 
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+        if((chunkFlags & TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_DYN) != 0)
+        {   // use a compiled template, if possible
+            pChDcpt->fileChDcpt.pTmpl = _HTTP_TemplateGet(pChDcpt, fHash, fStamp);
+        }
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+
         break;
     }
 
@@ -3599,8 +9134,8 @@ static TCPIP_HTTP_CHUNK_DCPT* _HTTP_AllocChunk(TCPIP_HTTP_NET_CONN* pHttpCon, TC
     TCPIP_HTTP_CHUNK_DCPT* pChDcpt;
     TCPIP_HTTP_FILE_BUFF_DCPT*  fileBuffDcpt = 0;
 
-    if((flags & TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE) != 0)
-    {   // grab a file buffer
+    if((flags & (TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE | TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_MAPPED)) == TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE)
+    {   // grab a file buffer; a memory mapped file doesn't need one
         fileBuffDcpt = (TCPIP_HTTP_FILE_BUFF_DCPT*)TCPIP_Helper_SingleListHeadRemove(&httpFileBuffers);
         if(fileBuffDcpt == 0)
         {   // failed
@@ -3700,6 +9235,22 @@ static void _HTTP_FreeChunk(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK_DCPT
         {
             TCPIP_Helper_SingleListTailAdd(&httpFileBuffers, (SGL_LIST_NODE*)pHead->fileChDcpt.fileBuffDcpt);
         }
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+        if(pHead->fileChDcpt.pTmpl != 0)
+        {
+            _HTTP_TemplateRelease(pHead->fileChDcpt.pTmpl);
+        }
+        if(pHead->fileChDcpt.pBuild != 0)
+        {
+            _HTTP_TemplateBuildEnd(pHead);
+        }
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+        if(pHead->fileChDcpt.pCache != 0)
+        {
+            _HTTP_FileCacheRelease(pHead->fileChDcpt.pCache);
+        }
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
     }
 #if (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0)
     else if((pHead->flags & (TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE | TCPIP_HTTP_CHUNK_FLAG_TYPE_DATA_SSI)) == 0)
@@ -3759,6 +9310,61 @@ static bool _HTTP_FileTypeIsDynamic(const char* fName)
     return false;
 }
 
+// checks if an included file needs processing for dynamic variables/SSI
+// a gzip compressed file is sent as it is
+// the file date/time is returned in pStamp, if not 0: 0 if not known
+static bool _HTTP_IncludeIsDynamic(const char* fName, uint32_t* pStamp)
+{
+    SYS_FS_FSTAT fs_attr = {0};
+
+    if((*httpFileShell->fileStat)(httpFileShell, fName, &fs_attr) != SYS_FS_HANDLE_INVALID)
+    {
+        if(pStamp != 0)
+        {
+            *pStamp = ((uint32_t)fs_attr.fdate << 16) | fs_attr.ftime;
+        }
+        if (fs_attr.fattrib == SYS_FS_ATTR_ZIP_COMPRESSED)
+        {
+            return false;
+        }
+    }
+
+    return _HTTP_FileTypeIsDynamic(fName);
+}
+
+// reads data of a file chunk from the current file position: fOffset
+// a file in the RAM cache has no handle and it's read directly
+static size_t _HTTP_ChunkFileRead(TCPIP_HTTP_FILE_CHUNK_DCPT* pFDcpt, int32_t fOffset, void* buffer, size_t nBytes)
+{
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+    if(pFDcpt->pCache != 0)
+    {
+        if(fOffset + nBytes > pFDcpt->pCache->fSize)
+        {
+            nBytes = pFDcpt->pCache->fSize - fOffset;
+        }
+        memcpy(buffer, pFDcpt->pCache->fData + fOffset, nBytes);
+        return nBytes;
+    }
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+
+    return (*httpFileShell->fileRead)(httpFileShell, pFDcpt->fHandle, buffer, nBytes);
+}
+
+// adjusts the file position of a file chunk
+// nothing to do for a file in the RAM cache: the position is always passed to _HTTP_ChunkFileRead
+static int32_t _HTTP_ChunkFileSeek(TCPIP_HTTP_FILE_CHUNK_DCPT* pFDcpt, int32_t offset, SYS_FS_FILE_SEEK_CONTROL whence)
+{
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+    if(pFDcpt->pCache != 0)
+    {
+        return 0;
+    }
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+
+    return (*httpFileShell->fileSeek)(httpFileShell, pFDcpt->fHandle, offset, whence);
+}
+
 static TCPIP_HTTP_CHUNK_RES _HTTP_ProcessChunks(TCPIP_HTTP_NET_CONN* pHttpCon)
 {
     TCPIP_HTTP_CHUNK_DCPT* pChDcpt;
@@ -3816,6 +9422,12 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_ProcessFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon
     char* chunkBuffer;
     TCPIP_HTTP_CHUNK_END_TYPE trailType;
 
+#if (_TCPIP_HTTP_NET_FILE_MEMORY != 0)
+    if((pChDcpt->flags & TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_MAPPED) != 0)
+    {
+        return _HTTP_ProcessMappedFileChunk(pHttpCon, pChDcpt);
+    }
+#endif  // (_TCPIP_HTTP_NET_FILE_MEMORY != 0)
 
     chunkBuffer = pChDcpt->fileChDcpt.fileBuffDcpt->fileBuffer;
     chunkBufferSize = pChDcpt->fileChDcpt.fileBuffDcpt->fileBufferSize;
@@ -3826,7 +9438,7 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_ProcessFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon
         outSize = pChDcpt->fileChDcpt.chunkEnd - pChDcpt->fileChDcpt.chunkOffset;
         if(outSize)
         {   // data pending in the chunk buffer; send it out
-            outSize = NET_PRES_SocketWrite(pHttpCon->socket, chunkBuffer + pChDcpt->fileChDcpt.chunkOffset, outSize);
+            outSize = _HTTP_BodyWrite(pHttpCon, chunkBuffer + pChDcpt->fileChDcpt.chunkOffset, outSize);
             // global indicator that something went out of this file
             pChDcpt->flags |= TCPIP_HTTP_CHUNK_FLAG_OUT_DATA; 
             
@@ -3842,11 +9454,24 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_ProcessFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon
             break;
         }
 
+#if (_TCPIP_HTTP_NET_SCHED != 0)
+        if(_HTTP_SchedYield(pHttpCon))
+        {   // give way to the other connections; continue in the next turn
+            return TCPIP_HTTP_CHUNK_RES_WAIT;
+        }
+#endif  // (_TCPIP_HTTP_NET_SCHED != 0)
+
         procError = false;
         // if we have a dynStart process it
 #if (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0) || (TCPIP_HTTP_NET_SSI_PROCESS != 0)
         if(pChDcpt->fileChDcpt.dynStart)
         {   // start the dynamic variable processing
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+            if(pChDcpt->fileChDcpt.pBuild != 0)
+            {   // file served for the first time: record the directive
+                _HTTP_TemplateRecord(pChDcpt);
+            }
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
             TCPIP_HTTP_CHUNK_RES dynRes = _HTTP_AddDynChunk(pHttpCon, pChDcpt);
             if(dynRes == TCPIP_HTTP_CHUNK_RES_WAIT)
             {   // wait for resources...
@@ -3880,12 +9505,24 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_ProcessFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon
                     fileBytes = chunkBufferSize;
                 }
 
-                fileReadBytes = (*httpFileShell->fileRead)(httpFileShell, pChDcpt->fileChDcpt.fHandle, fileBuffer, fileBytes);
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+                if(pChDcpt->fileChDcpt.pTmpl != 0)
+                {   // compiled template: read just the literal span, up to the next directive
+                    fileBytes = _HTTP_TemplateSpan(pChDcpt, fileBytes);
+                }
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+
+                fileReadBytes = fileBytes == 0 ? 0 : _HTTP_ChunkFileRead(&pChDcpt->fileChDcpt, pChDcpt->fileChDcpt.fOffset, fileBuffer, fileBytes);
 
                 if(fileReadBytes != fileBytes)
                 {   // one chunk at a time. can abort if error because no new chunk was written!
                     pChDcpt->flags |= TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_ERROR;
                 }
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+                else if(pChDcpt->fileChDcpt.pTmpl != 0)
+                {   // nothing to parse
+                }
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
                 else if((pChDcpt->flags & TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_DYN) != 0)
                 {   // check for dynamic variables
                     endLine = _HTTP_ProcessFileLine(pChDcpt, fileBuffer, fileBytes, &dynStart, (pChDcpt->fileChDcpt.fOffset + fileBytes) == pChDcpt->fileChDcpt.fSize);
@@ -3936,7 +9573,7 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_ProcessFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon
         else if(pChDcpt->status == TCPIP_HTTP_CHUNK_STATE_BEG)
         {   // binary file: if we just started, the start chunk header needs to be inserted
             prependHeader = true;
-            headerLen = pChDcpt->fileChDcpt.fSize;
+            headerLen = pChDcpt->fileChDcpt.fSize - pChDcpt->fileChDcpt.fOffset + fileBytes;
             pChDcpt->status = TCPIP_HTTP_CHUNK_STATE_DATA;
         }
 
@@ -3974,7 +9611,7 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_ProcessFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon
         // header
         if(prependHeader != 0)
         {   // output the chunk data
-            hdrBytes = _HTTP_PrependStartHttpChunk(fileBuffer, headerLen);
+            hdrBytes = _HTTP_PrependStartHttpChunk(pHttpCon, fileBuffer, headerLen);
         }
         else
         {
@@ -3988,7 +9625,7 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_ProcessFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon
         // trailer
         if(appendTrailer)
         {
-            pChDcpt->fileChDcpt.chunkEnd += _HTTP_AppendEndHttpChunk(chunkBuffer + pChDcpt->fileChDcpt.chunkEnd, trailType);
+            pChDcpt->fileChDcpt.chunkEnd += _HTTP_AppendEndHttpChunk(pHttpCon, chunkBuffer + pChDcpt->fileChDcpt.chunkEnd, trailType);
         }
 
         if(endOfFile)
@@ -3999,7 +9636,7 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_ProcessFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon
         // finally update the file offset
         if(fileReadBytes != fileBytes)
         {   // readjust if we read too much
-            (*httpFileShell->fileSeek)(httpFileShell, pChDcpt->fileChDcpt.fHandle, -(fileReadBytes - fileBytes), SYS_FS_SEEK_CUR);
+            _HTTP_ChunkFileSeek(&pChDcpt->fileChDcpt, -(fileReadBytes - fileBytes), SYS_FS_SEEK_CUR);
         }
 
         // continue: either done, or send out data and do more, or process the dynStart
@@ -4008,6 +9645,26 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_ProcessFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon
 
     // once we're here the file is done
 
+#if (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+    if(pHttpCon->bodyBuff != 0 && (pChDcpt->flags & TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_ROOT) != 0)
+    {   // end of the response: send the collected output and the last chunk
+#if (_TCPIP_HTTP_NET_DEFLATE != 0)
+        if(pHttpCon->deflateDcpt != 0 && !_HTTP_DeflateEnd(pHttpCon))
+        {
+            return TCPIP_HTTP_CHUNK_RES_WAIT;
+        }
+#endif  // (_TCPIP_HTTP_NET_DEFLATE != 0)
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+        // the whole output was captured, unless the file had errors
+        _HTTP_SnapshotEnd(pHttpCon, (pChDcpt->flags & TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_ERROR) != 0 ? TCPIP_HTTP_SNAP_STATE_FREE : TCPIP_HTTP_SNAP_STATE_VALID);
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+        if(!_HTTP_BodyFlush(pHttpCon, true))
+        {
+            return TCPIP_HTTP_CHUNK_RES_WAIT;
+        }
+    }
+#endif  // (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+
     if((pChDcpt->flags & TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_ERROR) != 0)
     {
         _HTTP_Report_ConnectionEvent(pHttpCon, (pChDcpt->flags & TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_PARSE_ERROR) != 0 ? TCPIP_HTTP_NET_EVENT_FILE_PARSE_ERROR : TCPIP_HTTP_NET_EVENT_FILE_READ_ERROR, pChDcpt->chunkFName);
@@ -4021,6 +9678,70 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_ProcessFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon
         
 }
 
+#if (_TCPIP_HTTP_NET_FILE_MEMORY != 0)
+// Processes a chunk for a binary file stored on a memory mapped media
+// or in the RAM file cache
+// the file data is written to the socket directly from memory,
+// without being read into a file buffer
+// the file position is not used, the fOffset is the read pointer
+static TCPIP_HTTP_CHUNK_RES _HTTP_ProcessMappedFileChunk(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK_DCPT* pChDcpt)
+{
+    uint16_t outSize;
+    TCPIP_HTTP_CHUNK_END_TYPE trailType;
+
+    if(pChDcpt->status == TCPIP_HTTP_CHUNK_STATE_BEG)
+    {   // start chunk header, for the whole file
+        if(_HTTP_StartHttpChunk(pHttpCon, pChDcpt->fileChDcpt.fSize - pChDcpt->fileChDcpt.fOffset) == 0)
+        {   // wait for space
+            return TCPIP_HTTP_CHUNK_RES_WAIT;
+        }
+        pChDcpt->status = TCPIP_HTTP_CHUNK_STATE_DATA;
+    }
+
+    if(pChDcpt->status == TCPIP_HTTP_CHUNK_STATE_DATA)
+    {
+        if(pChDcpt->fileChDcpt.fOffset != pChDcpt->fileChDcpt.fSize)
+        {
+#if (_TCPIP_HTTP_NET_SCHED != 0)
+            if(_HTTP_SchedYield(pHttpCon))
+            {   // give way to the other connections; continue in the next turn
+                return TCPIP_HTTP_CHUNK_RES_WAIT;
+            }
+#endif  // (_TCPIP_HTTP_NET_SCHED != 0)
+            outSize = _HTTP_BodyWrite(pHttpCon, pChDcpt->fileChDcpt.fMapped + pChDcpt->fileChDcpt.fOffset, pChDcpt->fileChDcpt.fSize - pChDcpt->fileChDcpt.fOffset);
+            if(outSize != 0)
+            {   // global indicator that something went out of this file
+                pChDcpt->flags |= TCPIP_HTTP_CHUNK_FLAG_OUT_DATA; 
+            }
+
+            if((pChDcpt->fileChDcpt.fOffset += outSize) != pChDcpt->fileChDcpt.fSize)
+            {   // more data; wait some more
+                return TCPIP_HTTP_CHUNK_RES_WAIT;
+            }
+        }
+
+        // a binary file sends the end of chunk only when endOfFile
+        trailType = TCPIP_HTTP_CHUNK_END_CURRENT;
+        if((pChDcpt->flags & TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_ROOT) != 0)
+        {
+            trailType += TCPIP_HTTP_CHUNK_END_FINAL;
+        }
+
+        if(_HTTP_EndHttpChunk(pHttpCon, trailType) == 0)
+        {   // wait for space
+            return TCPIP_HTTP_CHUNK_RES_WAIT;
+        }
+        pChDcpt->status = TCPIP_HTTP_CHUNK_STATE_END;
+    }
+
+    // done with this file
+    _HTTP_FileDbgProcess(pChDcpt->chunkFName, pChDcpt->fileChDcpt.fSize, "map", pHttpCon->connIx);
+    _HTTP_FreeChunk(pHttpCon, pChDcpt);
+
+    return TCPIP_HTTP_CHUNK_RES_DONE;
+}
+#endif  // (_TCPIP_HTTP_NET_FILE_MEMORY != 0)
+
 // returns a pointer within the current buffer just past the end of line
 // this pointer reflects the characters that can be processed within this line
 // returns 0 if error, line cannot be processed
@@ -4136,6 +9857,272 @@ static char* _HTTP_FileLineParse(TCPIP_HTTP_CHUNK_DCPT* pChDcpt, char* lineBuff,
     return dynStart;
 }
 
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+// returns the compiled template for a dynamic file
+// the template is searched in the cache, using the file identity: name hash + size + date/time
+// if not found, the recording of the template is started:
+// the directives are recorded while the file is served, no extra file reads needed
+// returns 0 if no template is available; the file will be parsed line by line
+static TCPIP_HTTP_TMPL_ENTRY* _HTTP_TemplateGet(TCPIP_HTTP_CHUNK_DCPT* pChDcpt, uint32_t fHash, uint32_t fStamp)
+{
+    int ix;
+    TCPIP_HTTP_TMPL_ENTRY*  pTmpl;
+    TCPIP_HTTP_TMPL_BUILD*  pBuild;
+
+    for(ix = 0; ix < sizeof(httpTmplCache) / sizeof(*httpTmplCache); ix++)
+    {
+        pTmpl = httpTmplCache[ix];
+        if(pTmpl != 0 && pTmpl->fHash == fHash && pTmpl->fSize == pChDcpt->fileChDcpt.fSize && pTmpl->fStamp == fStamp)
+        {   // found it
+            pTmpl->refCount++;
+            pTmpl->lastUse = ++httpTmplStamp;
+            httpTmplCacheHits++;
+            return pTmpl;
+        }
+    }
+
+    // not cached; record it while the file is parsed
+    httpTmplCacheMisses++;
+    pBuild = (TCPIP_HTTP_TMPL_BUILD*)(*http_malloc_fnc)(sizeof(*pBuild) + TCPIP_HTTP_TMPL_BUILD_DIRECTIVES * sizeof(*pBuild->directives));
+    if(pBuild == 0)
+    {
+        httpTmplCacheFails++;
+        return 0;
+    }
+
+    pBuild->fHash = fHash;
+    pBuild->fStamp = fStamp;
+    pBuild->purgeCount = httpTmplPurges;
+    pBuild->nDirectives = 0;
+    pBuild->maxDirectives = TCPIP_HTTP_TMPL_BUILD_DIRECTIVES;
+    pChDcpt->fileChDcpt.pBuild = pBuild;
+
+    return 0;
+}
+
+// records the directive found by the file parser at the current file offset
+// the recording is abandoned if there are too many directives or out of memory
+static void _HTTP_TemplateRecord(TCPIP_HTTP_CHUNK_DCPT* pChDcpt)
+{
+    uint16_t    maxDirs = 0;
+    TCPIP_HTTP_TMPL_DIRECTIVE*  pDir;
+    TCPIP_HTTP_TMPL_BUILD       *pNewBuild;
+    TCPIP_HTTP_FILE_CHUNK_DCPT* pFDcpt = &pChDcpt->fileChDcpt;
+    TCPIP_HTTP_TMPL_BUILD*      pBuild = pFDcpt->pBuild;
+
+    if(pBuild->nDirectives != 0 && pBuild->directives[pBuild->nDirectives - 1].offset >= (uint32_t)pFDcpt->fOffset)
+    {   // already recorded; the directive processing is resumed
+        return;
+    }
+
+    if(pBuild->nDirectives == pBuild->maxDirectives)
+    {   // make room
+        pNewBuild = 0;
+        if(pBuild->maxDirectives < TCPIP_HTTP_NET_TEMPLATE_MAX_DIRECTIVES)
+        {
+            maxDirs = mMIN(pBuild->maxDirectives * 2, TCPIP_HTTP_NET_TEMPLATE_MAX_DIRECTIVES);
+            pNewBuild = (TCPIP_HTTP_TMPL_BUILD*)(*http_malloc_fnc)(sizeof(*pBuild) + maxDirs * sizeof(*pBuild->directives));
+        }
+
+        if(pNewBuild == 0)
+        {   // too many directives or out of memory
+            (*http_free_fnc)(pBuild);
+            pFDcpt->pBuild = 0;
+            httpTmplCacheFails++;
+            return;
+        }
+
+        memcpy(pNewBuild, pBuild, sizeof(*pBuild) + pBuild->nDirectives * sizeof(*pBuild->directives));
+        pNewBuild->maxDirectives = maxDirs;
+        (*http_free_fnc)(pBuild);
+        pFDcpt->pBuild = pBuild = pNewBuild;
+    }
+
+    pDir = pBuild->directives + pBuild->nDirectives++;
+    pDir->offset = pFDcpt->fOffset;
+    pDir->dirFlags = (pChDcpt->flags & TCPIP_HTTP_CHUNK_FLAG_TYPE_DATA_SSI) != 0 ? TCPIP_HTTP_TMPL_DIR_FLAG_SSI : TCPIP_HTTP_TMPL_DIR_FLAG_DYNVAR;
+    pDir->keyIx = 0;
+    pDir->varId = TCPIP_HTTP_NET_DYN_VAR_ID_INVALID;
+}
+
+// ends the recording of a template, when the file chunk is done
+// the template is cached only if the whole file was parsed without errors
+// and the cache was not purged meanwhile
+static void _HTTP_TemplateBuildEnd(TCPIP_HTTP_CHUNK_DCPT* pChDcpt)
+{
+    int ix;
+    bool    found;
+    TCPIP_HTTP_TMPL_ENTRY*  pTmpl;
+    TCPIP_HTTP_TMPL_ENTRY** pFreeSlot = 0;
+    TCPIP_HTTP_TMPL_ENTRY** pLruSlot = 0;
+    TCPIP_HTTP_FILE_CHUNK_DCPT* pFDcpt = &pChDcpt->fileChDcpt;
+    TCPIP_HTTP_TMPL_BUILD*      pBuild = pFDcpt->pBuild;
+
+    pFDcpt->pBuild = 0;
+    if((pChDcpt->flags & TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_ERROR) != 0 || pFDcpt->fOffset != pFDcpt->fSize || pBuild->purgeCount != httpTmplPurges)
+    {   // incomplete or stale
+        (*http_free_fnc)(pBuild);
+        httpTmplCacheFails++;
+        return;
+    }
+
+    found = false;
+    for(ix = 0; ix < sizeof(httpTmplCache) / sizeof(*httpTmplCache); ix++)
+    {
+        if((pTmpl = httpTmplCache[ix]) == 0)
+        {
+            if(pFreeSlot == 0)
+            {
+                pFreeSlot = httpTmplCache + ix;
+            }
+            continue;
+        }
+
+        if(pTmpl->fHash == pBuild->fHash && pTmpl->fSize == pFDcpt->fSize && pTmpl->fStamp == pBuild->fStamp)
+        {   // recorded by another connection meanwhile
+            found = true;
+            break;
+        }
+
+        if(pTmpl->refCount == 0 && (pLruSlot == 0 || pTmpl->lastUse < (*pLruSlot)->lastUse))
+        {   // candidate for replacement
+            pLruSlot = httpTmplCache + ix;
+        }
+    }
+
+    if(!found)
+    {
+        if(pFreeSlot == 0 && pLruSlot != 0)
+        {   // replace the least recently used
+            (*http_free_fnc)(*pLruSlot);
+            *pLruSlot = 0;
+            pFreeSlot = pLruSlot;
+        }
+
+        pTmpl = 0;
+        if(pFreeSlot != 0)
+        {
+            pTmpl = (TCPIP_HTTP_TMPL_ENTRY*)(*http_malloc_fnc)(sizeof(TCPIP_HTTP_TMPL_ENTRY) + pBuild->nDirectives * sizeof(*pBuild->directives));
+        }
+
+        if(pTmpl != 0)
+        {
+            pTmpl->fHash = pBuild->fHash;
+            pTmpl->fSize = pFDcpt->fSize;
+            pTmpl->fStamp = pBuild->fStamp;
+            pTmpl->lastUse = ++httpTmplStamp;
+            pTmpl->refCount = 0;
+            pTmpl->nDirectives = pBuild->nDirectives;
+            memcpy(pTmpl->directives, pBuild->directives, pBuild->nDirectives * sizeof(*pBuild->directives));
+            *pFreeSlot = pTmpl;
+        }
+        else
+        {   // all templates in use or out of memory
+            httpTmplCacheFails++;
+        }
+    }
+
+    (*http_free_fnc)(pBuild);
+}
+
+// releases a compiled template used by a file chunk
+// a stale template is deleted once not used anymore
+static void _HTTP_TemplateRelease(TCPIP_HTTP_TMPL_ENTRY* pTmpl)
+{
+    int ix;
+
+    _HTTPAssertCond(pTmpl->refCount != 0, __func__, __LINE__);
+
+    if(--pTmpl->refCount == 0 && pTmpl->fSize < 0)
+    {
+        for(ix = 0; ix < sizeof(httpTmplCache) / sizeof(*httpTmplCache); ix++)
+        {
+            if(httpTmplCache[ix] == pTmpl)
+            {
+                httpTmplCache[ix] = 0;
+                break;
+            }
+        }
+        (*http_free_fnc)(pTmpl);
+    }
+}
+
+// purges the compiled templates cache
+// templates currently in use are marked stale and deleted when released
+static void _HTTP_TemplateCachePurge(void)
+{
+    int ix;
+    TCPIP_HTTP_TMPL_ENTRY* pTmpl;
+
+    httpTmplPurges++;
+    for(ix = 0; ix < sizeof(httpTmplCache) / sizeof(*httpTmplCache); ix++)
+    {
+        if((pTmpl = httpTmplCache[ix]) != 0)
+        {
+            if(pTmpl->refCount == 0)
+            {
+                (*http_free_fnc)(pTmpl);
+                httpTmplCache[ix] = 0;
+            }
+            else
+            {   // cannot match anymore
+                pTmpl->fSize = -1;
+            }
+        }
+    }
+}
+
+// calculates the literal span that can be output from the current file offset
+// using the compiled template: the span ends at the next directive
+// if the span is followed by a directive, the dynStart is set
+// and the chunk flags are updated with the directive type
+// returns the number of bytes to read from the file
+static size_t _HTTP_TemplateSpan(TCPIP_HTTP_CHUNK_DCPT* pChDcpt, size_t maxBytes)
+{
+    uint32_t    spanLen;
+    const TCPIP_HTTP_TMPL_DIRECTIVE* pDir = 0;
+    TCPIP_HTTP_FILE_CHUNK_DCPT* pFDcpt = &pChDcpt->fileChDcpt;
+    const TCPIP_HTTP_TMPL_ENTRY* pTmpl = pFDcpt->pTmpl;
+
+    while(pFDcpt->tmplIx < pTmpl->nDirectives)
+    {
+        pDir = pTmpl->directives + pFDcpt->tmplIx;
+        if(pDir->offset >= (uint32_t)pFDcpt->fOffset)
+        {
+            break;
+        }
+        // already passed this one
+        pDir = 0;
+        pFDcpt->tmplIx++;
+    }
+
+    if(pDir == 0)
+    {   // no more directives in this file
+        return maxBytes;
+    }
+
+    spanLen = pDir->offset - (uint32_t)pFDcpt->fOffset;
+    if(spanLen > maxBytes)
+    {   // directive not reached yet
+        return maxBytes;
+    }
+
+    // directive follows the span
+    pFDcpt->tmplIx++;
+    pFDcpt->dynStart = pFDcpt->fileBuffDcpt->fileBuffer;  // just a marker, the directive is extracted from the file
+    if((pDir->dirFlags & TCPIP_HTTP_TMPL_DIR_FLAG_SSI) != 0)
+    {
+        pChDcpt->flags |= TCPIP_HTTP_CHUNK_FLAG_TYPE_DATA_SSI;
+    }
+    else
+    {
+        pChDcpt->flags &= ~TCPIP_HTTP_CHUNK_FLAG_TYPE_DATA_SSI;
+    }
+
+    return spanLen;
+}
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+
 // - parses the dynVarBuff for a valid dynamicVariable: "delim\+ .* delim\+"
 // - dynVarBuff should be properly ended with \0
 // - returns where the dynamic variable name starts
@@ -4222,6 +10209,9 @@ static bool  _HTTP_DynVarExtract(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK
     TCPIP_HTTP_DYN_VAR_FLAGS dynFlags = TCPIP_HTTP_DYN_VAR_FLAG_NONE; 
     TCPIP_HTTP_NET_EVENT_TYPE dynEvent = TCPIP_HTTP_NET_EVENT_NONE;
     TCPIP_HTTP_DYN_ARG_DCPT  dynArgDcpt[TCPIP_HTTP_NET_DYNVAR_ARG_MAX_NUMBER];
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+    TCPIP_HTTP_TMPL_DIRECTIVE* pDir;
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
 
     // NOTE: the buffer belonging to the parent file is used!
     dynVarBuff = pFileChDcpt->fileChDcpt.fileBuffDcpt->fileBuffer;
@@ -4239,7 +10229,7 @@ static bool  _HTTP_DynVarExtract(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK
         {
             len = TCPIP_HTTP_NET_DYNVAR_MAX_LEN;
         }
-        fileLen = (*httpFileShell->fileRead)(httpFileShell, pFileChDcpt->fileChDcpt.fHandle, dynVarBuff, len);
+        fileLen = _HTTP_ChunkFileRead(&pFileChDcpt->fileChDcpt, pFileChDcpt->fileChDcpt.fOffset, dynVarBuff, len);
 
         if(fileLen != len)
         {   // couldn't read data?
@@ -4368,7 +10358,38 @@ static bool  _HTTP_DynVarExtract(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK
         pDynChDcpt->dynChDcpt.pDynAllocDcpt = pAllocDcpt;
     
 
-        pKEntry = _HTTP_SearchDynVarKeyEntry(pDestDcpt->dynName);
+        pDestDcpt->padding = 0;
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+        pDir = 0;
+        if(pFileChDcpt->fileChDcpt.pTmpl != 0 && pFileChDcpt->fileChDcpt.tmplIx != 0)
+        {   // the template directive that's being extracted
+            pDir = pFileChDcpt->fileChDcpt.pTmpl->directives + pFileChDcpt->fileChDcpt.tmplIx - 1;
+            if(pDir->offset != (uint32_t)pFileChDcpt->fileChDcpt.fOffset || (pDir->dirFlags & TCPIP_HTTP_TMPL_DIR_FLAG_SSI) != 0)
+            {   // not matching
+                pDir = 0;
+            }
+        }
+
+        if(pDir != 0 && (pDir->dirFlags & TCPIP_HTTP_TMPL_DIR_FLAG_BOUND) != 0)
+        {   // already resolved when first processed
+            pKEntry = (pDir->keyIx != 0) ? httpDynVarKeywords + pDir->keyIx - 1 : 0;
+            pDestDcpt->varId = pDir->varId;
+        }
+        else
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+        {
+            pKEntry = _HTTP_SearchDynVarKeyEntry(pDestDcpt->dynName);
+            pDestDcpt->varId = _HTTP_DynVarIdGet(pDestDcpt->dynName);
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+            if(pDir != 0)
+            {   // bind it to the template
+                pDir->keyIx = (pKEntry != 0) ? (pKEntry - httpDynVarKeywords) + 1 : 0;
+                pDir->varId = pDestDcpt->varId;
+                pDir->dirFlags |= TCPIP_HTTP_TMPL_DIR_FLAG_BOUND;
+            }
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+        }
+
         if(pKEntry != 0 && (pKEntry->keyFlags & TCPIP_HTTP_CHUNK_FLAG_DYNVAR_DEFAULT_PROCESS) != 0)
         {
             pDynChDcpt->flags |= TCPIP_HTTP_CHUNK_FLAG_DYNVAR_DEFAULT_PROCESS;
@@ -4392,7 +10413,7 @@ static bool  _HTTP_DynVarExtract(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK
     extraLen = fileLen - (endDynName - dynVarBuff);
     if(extraLen)
     {
-        (*httpFileShell->fileSeek)(httpFileShell, pFileChDcpt->fileChDcpt.fHandle, -extraLen, SYS_FS_SEEK_CUR);
+        _HTTP_ChunkFileSeek(&pFileChDcpt->fileChDcpt, -extraLen, SYS_FS_SEEK_CUR);
     }
 
     // adjust the file byte counters with read characters
@@ -4418,6 +10439,48 @@ static const TCPIP_HTTP_DYN_VAR_KEYWORD_ENTRY* _HTTP_SearchDynVarKeyEntry(const
     return 0;
 }
 
+// returns the ID of a dynamic variable
+// i.e. the index of its name in the user registered table
+static uint16_t _HTTP_DynVarIdGet(const char* dynName)
+{
+    uint32_t hashIx;
+    uint16_t varId;
+
+    if(httpDynVarHash == 0)
+    {   // no names registered
+        return TCPIP_HTTP_NET_DYN_VAR_ID_INVALID;
+    }
+
+    hashIx = fnv_32a_hash(dynName, strlen(dynName)) & httpDynVarHashMask;
+    while((varId = httpDynVarHash[hashIx]) != TCPIP_HTTP_NET_DYN_VAR_ID_INVALID)
+    {
+        if(strcmp(httpDynVarNames[varId], dynName) == 0)
+        {
+            return varId;
+        }
+        hashIx = (hashIx + 1) & httpDynVarHashMask;
+    }
+
+    return TCPIP_HTTP_NET_DYN_VAR_ID_INVALID;
+}
+
+// removes the user registered dynamic variable names
+static void _HTTP_DynVarNamesRemove(void)
+{
+    if(httpDynVarHash != 0)
+    {
+        (*http_free_fnc)(httpDynVarHash);
+        httpDynVarHash = 0;
+    }
+    httpDynVarNames = 0;
+    httpDynVarHashMask = 0;
+
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+    // the IDs bound to the compiled templates are no longer valid
+    _HTTP_TemplateCachePurge();
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+}
+
 static TCPIP_HTTP_CHUNK_RES _HTTP_ProcessDynVarChunk(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK_DCPT* pChDcpt)
 {
     TCPIP_HTTP_CHUNK_RES chunkRes;
@@ -4484,6 +10547,7 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_DynVarCallback(TCPIP_HTTP_NET_CONN* pHttpCon,
     if((pChDcpt->flags & TCPIP_HTTP_CHUNK_FLAG_DYNVAR_AGAIN) == 0)
     {   // 1st pass
         pHttpCon->callbackPos = 0;
+        pHttpCon->flags.dynCacheable = 0;
     }
 
     if((pChDcpt->flags & TCPIP_HTTP_CHUNK_FLAG_DYNVAR_DEFAULT_PROCESS) == 0)
@@ -4528,6 +10592,13 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_DynVarCallback(TCPIP_HTTP_NET_CONN* pHttpCon,
         return printRes == TCPIP_HTTP_DYN_PRINT_RES_AGAIN ? TCPIP_HTTP_CHUNK_RES_WAIT : TCPIP_HTTP_CHUNK_RES_OK;
     }
 
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+    if(pHttpCon->snapEntry != 0 && pHttpCon->flags.dynCacheable == 0 && (pChDcpt->flags & TCPIP_HTTP_CHUNK_FLAG_DYNVAR_DEFAULT_PROCESS) == 0)
+    {   // volatile output: the rendered file cannot be shared
+        _HTTP_SnapshotEnd(pHttpCon, TCPIP_HTTP_SNAP_STATE_VOLATILE);
+    }
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+
     // don't need calling again
     return TCPIP_HTTP_CHUNK_RES_DONE;
 }
@@ -4580,7 +10651,7 @@ static bool _HTTP_DynVarProcess(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK_
         writeSize = pDynDcpt->dynBufferSize - pDynDcpt->writeOffset;
         _HTTPDbgCond(writeSize != 0, __func__, __LINE__);
         writeBuff = (uint8_t*)pDynDcpt->dynBuffer + pDynDcpt->writeOffset;
-        outSize = NET_PRES_SocketWrite(pHttpCon->socket, writeBuff, writeSize);
+        outSize = _HTTP_BodyWrite(pHttpCon, writeBuff, writeSize);
         pDynDcpt->writeOffset += outSize;
         if(outSize != writeSize)
         {   // couldn't write all of it; wait some more
@@ -4687,6 +10758,13 @@ bool TCPIP_HTTP_NET_DynamicWriteString(const TCPIP_HTTP_DYN_VAR_DCPT* varDcpt, c
     return str ? TCPIP_HTTP_NET_DynamicWrite(varDcpt, str, strlen(str), needAck) : false;
 }
 
+void TCPIP_HTTP_NET_DynamicCacheable(const TCPIP_HTTP_DYN_VAR_DCPT* varDcpt)
+{
+    TCPIP_HTTP_CHUNK_DCPT* pChDcpt = (TCPIP_HTTP_CHUNK_DCPT*)varDcpt->dynContext;
+
+    pChDcpt->dynChDcpt.pOwnerCon->flags.dynCacheable = 1;
+}
+
 #else
 // dynamic variable API functions
 bool TCPIP_HTTP_NET_DynamicWrite(const TCPIP_HTTP_DYN_VAR_DCPT* varDcpt, const void * buffer, uint16_t size, bool needAck)
@@ -4699,6 +10777,10 @@ bool TCPIP_HTTP_NET_DynamicWriteString(const TCPIP_HTTP_DYN_VAR_DCPT* varDcpt, c
     return false;
 }
 
+void TCPIP_HTTP_NET_DynamicCacheable(const TCPIP_HTTP_DYN_VAR_DCPT* varDcpt)
+{
+}
+
 #endif // (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0)
 
 
@@ -4812,7 +10894,7 @@ static bool  _HTTP_SSIExtract(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK_DC
         {
             len = TCPIP_HTTP_NET_SSI_CMD_MAX_LEN;
         }
-        fileLen = (*httpFileShell->fileRead)(httpFileShell, pFileChDcpt->fileChDcpt.fHandle, ssiBuff, len);
+        fileLen = _HTTP_ChunkFileRead(&pFileChDcpt->fileChDcpt, pFileChDcpt->fileChDcpt.fOffset, ssiBuff, len);
         if(fileLen != len)
         {   // couldn't read data?
             evInfo = pFileChDcpt->chunkFName;
@@ -4955,7 +11037,7 @@ static bool  _HTTP_SSIExtract(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_HTTP_CHUNK_DC
     extraLen = fileLen - (endSsiCmd - ssiBuff);
     if(extraLen)
     {
-        (*httpFileShell->fileSeek)(httpFileShell, pFileChDcpt->fileChDcpt.fHandle, -extraLen, SYS_FS_SEEK_CUR);
+        _HTTP_ChunkFileSeek(&pFileChDcpt->fileChDcpt, -extraLen, SYS_FS_SEEK_CUR);
     }
 
     // adjust the file byte counters with read characters
@@ -4972,6 +11054,13 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_ProcessSSIChunk(TCPIP_HTTP_NET_CONN* pHttpCon,
 
     _HTTPAssertCond(pChDcpt->ssiChDcpt.ssiFnc != 0, __func__, __LINE__);
 
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+    if(pHttpCon->snapEntry != 0 && pChDcpt->ssiChDcpt.ssiFnc != _HTTP_SSIInclude)
+    {   // the SSI output is volatile
+        _HTTP_SnapshotEnd(pHttpCon, TCPIP_HTTP_SNAP_STATE_VOLATILE);
+    }
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+
     // basic sanity check
     if(pChDcpt->ssiChDcpt.nStaticAttribs == 0)
     {   // we should have had at least one attribute pair
@@ -5258,17 +11347,17 @@ static TCPIP_HTTP_CHUNK_RES _HTTP_SSIEcho(TCPIP_HTTP_NET_CONN* pHttpCon, TCPIP_H
             break;
         }
 
-        hdrBytes = _HTTP_PrependStartHttpChunk(pEcho, echoLen);
-        trailBytes = _HTTP_AppendEndHttpChunk(pEcho + echoLen, TCPIP_HTTP_CHUNK_END_CURRENT);
+        hdrBytes = _HTTP_PrependStartHttpChunk(pHttpCon, pEcho, echoLen);
+        trailBytes = _HTTP_AppendEndHttpChunk(pHttpCon, pEcho + echoLen, TCPIP_HTTP_CHUNK_END_CURRENT);
         outBytes = hdrBytes + echoLen + trailBytes;
-        socketBytes = NET_PRES_SocketWriteIsReady(pHttpCon->socket, outBytes, 0);
+        socketBytes = _HTTP_BodyWriteIsReady(pHttpCon, outBytes);
         if(socketBytes < outBytes)
         {
             (*http_free_fnc)(echoBuffer);
             return TCPIP_HTTP_CHUNK_RES_WAIT;
         }
 
-        socketBytes = NET_PRES_SocketWrite(pHttpCon->socket, pEcho - hdrBytes, outBytes);
+        socketBytes = _HTTP_BodyWrite(pHttpCon, pEcho - hdrBytes, outBytes);
         _HTTPAssertCond(socketBytes == outBytes, __func__, __LINE__);
 
         break;
@@ -5729,6 +11818,15 @@ bool TCPIP_HTTP_NET_ChunkInfoGet(int connIx, TCPIP_HTTP_NET_CHUNK_INFO* pChunkIn
 
 bool TCPIP_HTTP_NET_StatGet(TCPIP_HTTP_NET_STAT_INFO* pStatInfo)
 {
+#if (_TCPIP_HTTP_NET_EVENT_STREAM != 0) || (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+    int connIx;
+    TCPIP_HTTP_NET_CONN* pHttpCon;
+#endif  // (_TCPIP_HTTP_NET_EVENT_STREAM != 0) || (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+#if (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+    int sessIx;
+    uint32_t currSec;
+#endif  // (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+
     if(httpConnCtrl != NULL)
     {   // we're up and running
         if(pStatInfo)
@@ -5738,6 +11836,94 @@ bool TCPIP_HTTP_NET_StatGet(TCPIP_HTTP_NET_STAT_INFO* pStatInfo)
             pStatInfo->dynPoolEmpty = httpDynPoolEmpty;
             pStatInfo->maxRecurseDepth = httpMaxRecurseDepth;
             pStatInfo->dynParseRetry = httpDynParseRetry;
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+            pStatInfo->tmplCacheHits = httpTmplCacheHits;
+            pStatInfo->tmplCacheMisses = httpTmplCacheMisses;
+            pStatInfo->tmplCacheFails = httpTmplCacheFails;
+#else
+            pStatInfo->tmplCacheHits = pStatInfo->tmplCacheMisses = pStatInfo->tmplCacheFails = 0;
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+            pStatInfo->fileCacheHits = httpFileCacheHits;
+            pStatInfo->fileCacheMisses = httpFileCacheMisses;
+            pStatInfo->fileCacheBytes = httpFileCacheBytes;
+#else
+            pStatInfo->fileCacheHits = pStatInfo->fileCacheMisses = pStatInfo->fileCacheBytes = 0;
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+#if (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+            pStatInfo->pathCacheHits = httpPathCacheHits;
+            pStatInfo->pathCacheMisses = httpPathCacheMisses;
+#else
+            pStatInfo->pathCacheHits = pStatInfo->pathCacheMisses = 0;
+#endif  // (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+            pStatInfo->snapCacheHits = httpSnapHits;
+            pStatInfo->snapCacheMisses = httpSnapMisses;
+#else
+            pStatInfo->snapCacheHits = pStatInfo->snapCacheMisses = 0;
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+            pStatInfo->evStreams = 0;
+#if (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+            for(connIx = 0, pHttpCon = httpConnCtrl; connIx < httpConnNo; connIx++, pHttpCon++)
+            {
+                if(pHttpCon->connState == TCPIP_HTTP_CONN_STATE_EVENT_STREAM)
+                {
+                    pStatInfo->evStreams++;
+                }
+            }
+            pStatInfo->evPublished = httpEvPublished;
+            pStatInfo->evDropped = httpEvDropped;
+#else
+            pStatInfo->evPublished = pStatInfo->evDropped = 0;
+#endif  // (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+            pStatInfo->wsConns = 0;
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+            for(connIx = 0, pHttpCon = httpConnCtrl; connIx < httpConnNo; connIx++, pHttpCon++)
+            {
+                if(pHttpCon->connState == TCPIP_HTTP_CONN_STATE_WEBSOCKET)
+                {
+                    pStatInfo->wsConns++;
+                }
+            }
+            pStatInfo->wsMessages = httpWsMessages;
+#else
+            pStatInfo->wsMessages = 0;
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+            pStatInfo->authSessions = 0;
+#if (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+            currSec = _TCPIP_SecCountGet();
+            for(sessIx = 0; sessIx < TCPIP_HTTP_NET_AUTH_SESSIONS; sessIx++)
+            {
+                if((int32_t)(httpSessions[sessIx].expireSec - currSec) > 0)
+                {
+                    pStatInfo->authSessions++;
+                }
+            }
+            pStatInfo->authSessionHits = httpSessionHits;
+            pStatInfo->authSessionsIssued = httpSessionsIssued;
+#else
+            pStatInfo->authSessionHits = pStatInfo->authSessionsIssued = 0;
+#endif  // (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+#if (_TCPIP_HTTP_NET_DEFLATE != 0)
+            pStatInfo->deflateResponses = httpDeflateResponses;
+            pStatInfo->deflateLowHeap = httpDeflateLowHeap;
+            pStatInfo->deflateIn = httpDeflateIn;
+            pStatInfo->deflateOut = httpDeflateOut;
+#else
+            pStatInfo->deflateResponses = pStatInfo->deflateLowHeap = pStatInfo->deflateIn = pStatInfo->deflateOut = 0;
+#endif  // (_TCPIP_HTTP_NET_DEFLATE != 0)
+#if (_TCPIP_HTTP_NET_PIPELINE != 0)
+            pStatInfo->pipelined = httpPipelined;
+            pStatInfo->pipeBreaks = httpPipeBreaks;
+#else
+            pStatInfo->pipelined = pStatInfo->pipeBreaks = 0;
+#endif  // (_TCPIP_HTTP_NET_PIPELINE != 0)
+            pStatInfo->connSize = sizeof(TCPIP_HTTP_NET_CONN) + httpConnDataSize;
+            pStatInfo->lineBuffSize = sizeof(TCPIP_HTTP_LINE_BUFF_DCPT);
+            pStatInfo->nLineBuffers = TCPIP_HTTP_NET_LINE_BUFFERS;
+            pStatInfo->lineBuffFree = TCPIP_Helper_SingleListCount(&httpLineBuffers);
+            pStatInfo->lineBuffEmpty = httpLineBuffEmpty;
+            pStatInfo->fileNameBytes = httpFileNameBytes;
         }
         return true;
     }
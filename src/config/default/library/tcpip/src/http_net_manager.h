@@ -142,10 +142,52 @@ typedef struct
     uint32_t    maxRecurseDepth;    // maximum chunk depth counter
     uint32_t    dynParseRetry;      // dynamic variables parsing retries because the parsed line
                                     // didn't fit in the socket buffer
+    uint32_t    tmplCacheHits;      // dynamic files served from a cached compiled template
+    uint32_t    tmplCacheMisses;    // dynamic files served without a cached template: the template is recorded
+    uint32_t    tmplCacheFails;     // templates that could not be recorded or cached
+    uint32_t    fileCacheHits;      // files served from the RAM file cache
+    uint32_t    fileCacheMisses;    // files opened in the file system
+    uint32_t    fileCacheBytes;     // file data currently stored in the RAM file cache
+    uint32_t    pathCacheHits;      // URIs resolved from the path cache, without accessing the file system
+    uint32_t    pathCacheMisses;    // URIs resolved in the file system
+    uint32_t    connSize;           // heap used by each connection: connection control data + data buffer
+    uint32_t    lineBuffSize;       // size of a request line buffer
+    uint16_t    nLineBuffers;       // number of request line buffers in the pool, shared by all connections
+    uint16_t    lineBuffFree;       // request line buffers currently available
+    uint32_t    lineBuffEmpty;      // requests that waited for a line buffer
+    uint32_t    fileNameBytes;      // heap currently used by the interned file names
+    uint32_t    snapCacheHits;      // dynamic files served from a rendered snapshot
+    uint32_t    snapCacheMisses;    // dynamic files rendered into a snapshot
+    uint16_t    evStreams;          // connections currently parked on an event channel
+    uint32_t    evPublished;        // events written to the subscribed connections
+    uint32_t    evDropped;          // events dropped for lack of socket TX space
+    uint16_t    wsConns;            // connections currently open as WebSockets
+    uint32_t    wsMessages;         // WebSocket messages received
+    uint16_t    authSessions;       // authenticated sessions currently valid
+    uint32_t    authSessionHits;    // requests authorized by a session token, without checking the credentials
+    uint32_t    authSessionsIssued; // session tokens issued
+    uint32_t    deflateResponses;   // dynamic responses sent deflate compressed
+    uint32_t    deflateLowHeap;     // responses sent uncompressed because of low heap
+    uint32_t    deflateIn;          // bytes given to the compressor
+    uint32_t    deflateOut;         // compressed bytes
+    uint32_t    pipelined;          // requests answered in the same turn as the previous request on the connection
+    uint32_t    pipeBreaks;         // persistent connections closed because the request body length was not known
 }TCPIP_HTTP_NET_STAT_INFO;
 
 
 
+// counters of a scheduling class
+typedef struct
+{
+    uint32_t    requests;           // message bodies served in this class
+    uint32_t    bytes;              // message body bytes sent
+    uint32_t    yields;             // turns given up to other connections because the deficit was used up
+}TCPIP_HTTP_NET_SCHED_STAT;
+
+// returns the counters of a scheduling class
+// returns false if the scheduling is not enabled or the class is not valid
+bool TCPIP_HTTP_NET_SchedStatGet(TCPIP_HTTP_NET_SCHED_CLASS schedClass, TCPIP_HTTP_NET_SCHED_STAT* pStat);
+
 // return info about a specific connection
 // returns true if conenction ix found and info updated, false if failed
 bool TCPIP_HTTP_NET_InfoGet(int connIx, TCPIP_HTTP_NET_CONN_INFO* pHttpInfo);
@@ -154,6 +196,48 @@ bool TCPIP_HTTP_NET_InfoGet(int connIx, TCPIP_HTTP_NET_CONN_INFO* pHttpInfo);
 // return HTTP statistics
 bool TCPIP_HTTP_NET_StatGet(TCPIP_HTTP_NET_STAT_INFO* pStatInfo);
 
+// request stages time stamped by the access log
+typedef enum
+{
+    TCPIP_HTTP_NET_LOG_STAGE_HEADERS,       // the request headers were parsed
+    TCPIP_HTTP_NET_LOG_STAGE_FILE_OPEN,     // the requested file was opened
+    TCPIP_HTTP_NET_LOG_STAGE_FIRST_BYTE,    // the first response byte was written to the socket
+    TCPIP_HTTP_NET_LOG_STAGE_CLOSE,         // the request is done or the connection closed
+
+    TCPIP_HTTP_NET_LOG_STAGES               // number of stages
+}TCPIP_HTTP_NET_LOG_STAGE;
+
+// stage time of a stage that the request didn't reach
+#define TCPIP_HTTP_NET_LOG_TIME_NONE    0xffffffff
+
+// access log record of a request
+// this is also the binary format of the TCPIP_HTTP_NET_ACCESS_LOG_URI dump, in the CPU byte order
+typedef struct
+{
+    uint32_t    tAccept;            // SYS_TIME_CounterGet() when the request started: when the connection was accepted
+                                    // or, for a following request on a persistent connection, when its data arrived
+    uint32_t    stageUs[TCPIP_HTTP_NET_LOG_STAGES];    // microseconds from tAccept to each TCPIP_HTTP_NET_LOG_STAGE
+                                                        // TCPIP_HTTP_NET_LOG_TIME_NONE if the stage was not reached
+    uint32_t    uriHash;            // FNV-1 hash of the requested file name; 0 if none
+    uint32_t    bodyBytes;          // message body bytes sent
+    uint16_t    httpStatus;         // TCPIP_HTTP_NET_STATUS when the request ended
+    uint16_t    connIx;             // connection that served the request
+}TCPIP_HTTP_NET_LOG_ENTRY;
+
+// copies access log records, the oldest first
+// skips the first startIx records
+// returns the number of records copied in pEntries; 
+// if pEntries == 0, returns the number of records in the log
+int TCPIP_HTTP_NET_LogGet(int startIx, TCPIP_HTTP_NET_LOG_ENTRY* pEntries, int nEntries);
+
+// calculates a latency percentile (1 - 100) for a stage, over the records in the log
+// returns true and the time in microseconds in pTimeUs
+// false if no record reached that stage
+bool TCPIP_HTTP_NET_LogPercentileGet(TCPIP_HTTP_NET_LOG_STAGE stage, int percent, uint32_t* pTimeUs);
+
+// removes all the access log records
+void TCPIP_HTTP_NET_LogClear(void);
+
 // return advanced chunk info about a specific connection
 // pChunkInfo points to an array of TCPIP_HTTP_NET_CHUNK_INFO, nInfos in size;
 // returns true if conenction ix found and info updated, false if failed
@@ -80,6 +80,10 @@ Microchip or any third party.
 // Mac connection timeout, seconds
 #define TCPIP_HTTP_NET_CONN_MAX_TIMEOUT         32767
 
+// socket signals that make a connection ready to run:
+// new data, TX space available (data acknowledged), remote close/reset
+#define TCPIP_HTTP_NET_SKT_SIGNALS      (TCPIP_TCP_SIGNAL_RX_DATA | TCPIP_TCP_SIGNAL_TX_SPACE | TCPIP_TCP_SIGNAL_RX_FIN | TCPIP_TCP_SIGNAL_RX_RST | TCPIP_TCP_SIGNAL_ESTABLISHED)
+
 
 /****************************************************************************
 Section:
@@ -125,8 +129,10 @@ typedef enum
     TCPIP_HTTP_CONN_STATE_SERVE_CHUNKS,                       // chunk processing
     TCPIP_HTTP_CONN_STATE_DONE,                               // job done: closes all files and waits for new connections
     TCPIP_HTTP_CONN_STATE_ERROR,                              // Some error occurred. Disconnec the server and closes all files
-    TCPIP_HTTP_CONN_STATE_DISCONNECT                          // Non persistent connection, end of processing
+    TCPIP_HTTP_CONN_STATE_DISCONNECT,                         // Non persistent connection, end of processing
                                                               // Disconnects the server and closes all files
+    TCPIP_HTTP_CONN_STATE_EVENT_STREAM,                       // parked on an event channel: the published events are written to the socket
+    TCPIP_HTTP_CONN_STATE_WEBSOCKET,                          // the connection switched to the WebSocket protocol: frames are exchanged
 } TCPIP_HTTP_NET_CONN_STATE;
 
 
@@ -163,6 +169,26 @@ typedef struct _tag_TCPIP_HTTP_FILE_BUFF_DCPT
                                     // when a dynamic variable is passed to the user!
 }TCPIP_HTTP_FILE_BUFF_DCPT;
 
+// request line buffer
+// borrowed from the pool only while a request line and its headers are parsed
+typedef struct _tag_TCPIP_HTTP_LINE_BUFF_DCPT
+{
+    struct _tag_TCPIP_HTTP_LINE_BUFF_DCPT*    next;    // valid single list node
+    uint16_t    aheadOffset;        // offset in lineBuff of the socket data copied past the last line end
+    uint16_t    aheadLen;           // bytes of that data: still in the socket, used for the next line
+    char        lineBuff[TCPIP_HTTP_NET_MAX_LINE_LEN + 1];  // request line/header line being assembled
+}TCPIP_HTTP_LINE_BUFF_DCPT;
+
+// interned file name
+// shared by all the connections serving the same file
+typedef struct _tag_TCPIP_HTTP_FILE_NAME
+{
+    struct _tag_TCPIP_HTTP_FILE_NAME*   next;       // valid single list node
+    uint32_t    nameHash;           // hash of the name
+    uint16_t    refCount;           // number of connections using the name
+    char        name[];             // the file name, '\0' terminated
+}TCPIP_HTTP_FILE_NAME;
+
 // 16 bits only
 typedef enum
 {
@@ -180,6 +206,8 @@ typedef enum
     TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_SKIP            = 0x0080,   // dynamic file currently skipping dynamic variables evaluation
     TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_ERROR           = 0x0100,   // error occurred while processing the file
     TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_PARSE_ERROR     = 0x0200,   // error occurred while parsing the file
+    TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_MAPPED          = 0x0400,   // binary file accessed directly in memory: the memory mapped media or the RAM file cache;
+                                                                // no file buffer used
 
     // dyn variable chunk specific flags
     TCPIP_HTTP_CHUNK_FLAG_DYNVAR_VALID              = 0x1000,   // the descriptor is valid, the dynamic variable parameters are updated 
@@ -343,6 +371,528 @@ typedef enum
 }TCPIP_HTTP_CHUNK_END_TYPE;
 
 
+// compiled templates are needed only when dynamic files are processed
+#if (TCPIP_HTTP_NET_TEMPLATE_CACHE_ENTRIES != 0) && ((TCPIP_HTTP_NET_DYNVAR_PROCESS != 0) || (TCPIP_HTTP_NET_SSI_PROCESS != 0))
+#define _TCPIP_HTTP_NET_TEMPLATE_CACHE      1
+#else
+#define _TCPIP_HTTP_NET_TEMPLATE_CACHE      0
+#endif
+
+// the file validators (date, size) are needed by the conditional GET and the byte range requests
+#if defined(TCPIP_HTTP_NET_USE_CONDITIONAL_GET) || defined(TCPIP_HTTP_NET_USE_RANGES)
+#define _TCPIP_HTTP_NET_FILE_VALIDATORS     1
+#else
+#define _TCPIP_HTTP_NET_FILE_VALIDATORS     0
+#endif
+
+// direct access to the binary files stored on a memory mapped media
+#if defined(TCPIP_HTTP_NET_FILE_MAPPED_ACCESS) && (TCPIP_HTTP_NET_FILE_MAPPED_ACCESS != 0)
+#define _TCPIP_HTTP_NET_FILE_MAPPED         1
+#else
+#define _TCPIP_HTTP_NET_FILE_MAPPED         0
+#endif
+
+// collecting the dynamic files output into larger chunks
+#if (TCPIP_HTTP_NET_CHUNK_COALESCE_SIZE != 0) && ((TCPIP_HTTP_NET_DYNVAR_PROCESS != 0) || (TCPIP_HTTP_NET_SSI_PROCESS != 0))
+#define _TCPIP_HTTP_NET_CHUNK_COALESCE      1
+#else
+#define _TCPIP_HTTP_NET_CHUNK_COALESCE      0
+#endif
+
+// rendered output of the polled dynamic files, shared between requests
+// the output is collected in the coalescing buffer
+#if (TCPIP_HTTP_NET_SNAPSHOT_FILES != 0) && (TCPIP_HTTP_NET_SNAPSHOT_ENTRIES != 0) && (TCPIP_HTTP_NET_SNAPSHOT_SIZE != 0) && (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0) && (TCPIP_HTTP_NET_DYNVAR_PROCESS != 0)
+#define _TCPIP_HTTP_NET_SNAPSHOT            1
+#else
+#define _TCPIP_HTTP_NET_SNAPSHOT            0
+#endif
+
+// Server-Sent Events channels
+#if (TCPIP_HTTP_NET_EVENT_CHANNELS != 0)
+#define _TCPIP_HTTP_NET_EVENT_STREAM        1
+#else
+#define _TCPIP_HTTP_NET_EVENT_STREAM        0
+#endif
+
+// WebSocket endpoints, RFC 6455
+#if (TCPIP_HTTP_NET_WEBSOCKET_ENDPOINTS != 0) && (TCPIP_HTTP_NET_WEBSOCKET_MAX_MESSAGE != 0)
+#define _TCPIP_HTTP_NET_WEBSOCKET           1
+#else
+#define _TCPIP_HTTP_NET_WEBSOCKET           0
+#endif
+
+// per request latency access log
+#if (TCPIP_HTTP_NET_ACCESS_LOG_ENTRIES != 0)
+#define _TCPIP_HTTP_NET_ACCESS_LOG          1
+#else
+#define _TCPIP_HTTP_NET_ACCESS_LOG          0
+#endif
+
+// the access log records are served as a binary file
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0) && defined(TCPIP_HTTP_NET_ACCESS_LOG_URI)
+#define _TCPIP_HTTP_NET_ACCESS_LOG_DUMP     1
+#else
+#define _TCPIP_HTTP_NET_ACCESS_LOG_DUMP     0
+#endif
+
+// authenticated sessions: a cookie token replaces the credentials check
+#if defined(TCPIP_HTTP_NET_USE_AUTHENTICATION) && defined(TCPIP_HTTP_NET_USE_COOKIES) && (TCPIP_HTTP_NET_AUTH_SESSIONS != 0)
+#define _TCPIP_HTTP_NET_AUTH_SESSION        1
+#else
+#define _TCPIP_HTTP_NET_AUTH_SESSION        0
+#endif
+
+// deficit round robin scheduling of the connections serving a message body
+#if (TCPIP_HTTP_NET_SCHED_QUANTUM != 0)
+#define _TCPIP_HTTP_NET_SCHED               1
+#else
+#define _TCPIP_HTTP_NET_SCHED               0
+#endif
+
+// deflate compression of the dynamic output, when the client accepts it
+// the compressed data is collected in the coalescing buffer
+#if (TCPIP_HTTP_NET_DEFLATE_WINDOW != 0) && (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+#define _TCPIP_HTTP_NET_DEFLATE             1
+#if ((TCPIP_HTTP_NET_DEFLATE_WINDOW & (TCPIP_HTTP_NET_DEFLATE_WINDOW - 1)) != 0) || (TCPIP_HTTP_NET_DEFLATE_WINDOW > 32768)
+#error "TCPIP_HTTP_NET_DEFLATE_WINDOW should be a power of 2, not larger than 32768"
+#endif
+#else
+#define _TCPIP_HTTP_NET_DEFLATE             0
+#endif
+
+// URL router: handlers resolved by a prefix trie of the request names
+#if (TCPIP_HTTP_NET_ROUTES != 0) && (TCPIP_HTTP_NET_ROUTE_NODES != 0)
+#define _TCPIP_HTTP_NET_ROUTER              1
+#if (TCPIP_HTTP_NET_ROUTES > 255) || (TCPIP_HTTP_NET_ROUTE_NODES > 255)
+#error "TCPIP_HTTP_NET_ROUTES and TCPIP_HTTP_NET_ROUTE_NODES should not be larger than 255"
+#endif
+#else
+#define _TCPIP_HTTP_NET_ROUTER              0
+#endif
+
+// pipelining: the requests already waiting in the socket are answered back to back
+#if (TCPIP_HTTP_NET_PIPELINE_DEPTH > 1)
+#define _TCPIP_HTTP_NET_PIPELINE            1
+#if (TCPIP_HTTP_NET_PIPELINE_DEPTH > 255)
+#error "TCPIP_HTTP_NET_PIPELINE_DEPTH should not be larger than 255"
+#endif
+#else
+#define _TCPIP_HTTP_NET_PIPELINE            0
+#endif
+
+// RAM copies of small static files
+#if (TCPIP_HTTP_NET_FILE_CACHE_ENTRIES != 0) && (TCPIP_HTTP_NET_FILE_CACHE_SIZE != 0)
+#define _TCPIP_HTTP_NET_FILE_CACHE          1
+#else
+#define _TCPIP_HTTP_NET_FILE_CACHE          0
+#endif
+
+// URI to file name resolutions
+#if (TCPIP_HTTP_NET_PATH_CACHE_ENTRIES != 0) && (TCPIP_HTTP_NET_PATH_CACHE_URI_LEN != 0)
+#define _TCPIP_HTTP_NET_PATH_CACHE          1
+#else
+#define _TCPIP_HTTP_NET_PATH_CACHE          0
+#endif
+
+// streaming parser of the POST form data
+#if defined(TCPIP_HTTP_NET_USE_POST) && (TCPIP_HTTP_NET_FORM_NAME_LEN != 0) && (TCPIP_HTTP_NET_FORM_HEADER_LEN != 0)
+#define _TCPIP_HTTP_NET_FORM_PARSE          1
+#else
+#define _TCPIP_HTTP_NET_FORM_PARSE          0
+#endif
+
+// binary files sent directly from memory: a memory mapped media or the RAM file cache
+#if (_TCPIP_HTTP_NET_FILE_MAPPED != 0) || (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+#define _TCPIP_HTTP_NET_FILE_MEMORY         1
+#else
+#define _TCPIP_HTTP_NET_FILE_MEMORY         0
+#endif
+
+// per file response header blocks
+#if (TCPIP_HTTP_NET_HEADER_CACHE_ENTRIES != 0)
+#define _TCPIP_HTTP_NET_HEADER_CACHE        1
+#else
+#define _TCPIP_HTTP_NET_HEADER_CACHE        0
+#endif
+
+// the file date/time is part of the validators and of the compiled template identity
+#if (_TCPIP_HTTP_NET_FILE_VALIDATORS != 0) || (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+#define _TCPIP_HTTP_NET_FILE_STAMP          1
+#else
+#define _TCPIP_HTTP_NET_FILE_STAMP          0
+#endif
+
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+// a snapshot is served from the coalescing buffer: it cannot exceed its size
+#if (TCPIP_HTTP_NET_SNAPSHOT_SIZE > TCPIP_HTTP_NET_CHUNK_COALESCE_SIZE)
+#define TCPIP_HTTP_SNAPSHOT_MAX_SIZE        TCPIP_HTTP_NET_CHUNK_COALESCE_SIZE
+#else
+#define TCPIP_HTTP_SNAPSHOT_MAX_SIZE        TCPIP_HTTP_NET_SNAPSHOT_SIZE
+#endif
+
+// state of a rendered snapshot entry
+typedef enum
+{
+    TCPIP_HTTP_SNAP_STATE_FREE      = 0,    // entry not used
+    TCPIP_HTTP_SNAP_STATE_RENDER,           // a connection is rendering the file into the entry
+    TCPIP_HTTP_SNAP_STATE_VALID,            // the entry holds the rendered output
+    TCPIP_HTTP_SNAP_STATE_VOLATILE,         // the output cannot be shared: volatile or too large
+                                            // the file is rendered for every request until the entry expires
+}TCPIP_HTTP_SNAP_STATE;
+
+// results of a snapshot look up
+typedef enum
+{
+    TCPIP_HTTP_SNAP_RES_RENDER      = 0,    // the file needs to be rendered
+    TCPIP_HTTP_SNAP_RES_HIT,                // the rendered output was copied to the connection bodyBuff
+    TCPIP_HTTP_SNAP_RES_WAIT,               // the file is being rendered by another connection
+}TCPIP_HTTP_SNAP_RES;
+
+// file registered for the snapshot cache
+typedef struct
+{
+    uint32_t                fHash;      // hash of the file name; 0 if the slot is not used
+    uint32_t                freshTicks; // freshness window of the rendered output, in system ticks
+}TCPIP_HTTP_SNAP_FILE;
+
+// rendered output of a dynamic file for a query string and content coding
+typedef struct
+{
+    uint32_t                fHash;      // file identity: hash of the file name
+    uint32_t                qHash;      // hash of the query string; 0 if none
+    uint32_t                renderTick; // system tick when the rendering started
+    uint32_t                freshTicks; // freshness window of the entry
+    uint16_t                dataLen;    // size of the rendered output
+    uint8_t                 state;      // TCPIP_HTTP_SNAP_STATE value
+    uint8_t                 stale;      // purged while rendering; discarded when the rendering ends
+    uint8_t                 deflated;   // the output is the deflate compressed one
+    uint8_t*                data;       // rendered output: TCPIP_HTTP_SNAPSHOT_MAX_SIZE bytes
+}TCPIP_HTTP_SNAP_ENTRY;
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+
+// results of the request line assembly, other than the line length
+typedef enum
+{
+    TCPIP_HTTP_LINE_RES_LONG            = -2,           // the line exceeded TCPIP_HTTP_NET_MAX_LINE_LEN and was discarded
+    TCPIP_HTTP_LINE_RES_WAIT            = -1,           // the line is not complete yet; the partial line is kept
+}TCPIP_HTTP_LINE_RES;
+
+#if (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
+typedef enum
+{
+    TCPIP_HTTP_HDR_FLAG_GZIPPED         = 0x01,         // the file is gzip compressed
+    TCPIP_HTTP_HDR_FLAG_DYNAMIC         = 0x02,         // the file is processed for dynamic variables/SSI
+    TCPIP_HTTP_HDR_FLAG_CACHEABLE       = 0x04,         // the file has validators: fileStamp, fileSize
+}TCPIP_HTTP_HDR_FLAGS;
+
+// cached response header block of a file
+// the static part of the GET response headers: Content-Type, Content-Encoding, Cache-Control, validators
+// built once, when the file is first opened, then sent with a single write
+typedef struct
+{
+    uint32_t                fHash;      // hash of the file name
+    int32_t                 fSize;      // file identity: size of the file
+    uint32_t                fileStamp;  // file identity: date/time, as reported by the file system
+    uint32_t                lastUse;    // stamp of the last use, for the LRU replacement
+    uint16_t                fileType;   // TCPIP_HTTP_NET_FILE_TYPE: file Content-Type
+    uint16_t                hdrFlags;   // TCPIP_HTTP_HDR_FLAGS value
+    uint16_t                hdrLen;     // size of the header block; 0 if the entry is not used
+    char*                   fName;      // file identity: the file name, allocated
+    char                    hdrBlock[TCPIP_HTTP_NET_HEADER_CACHE_BLOCK_SIZE];   // the header block
+}TCPIP_HTTP_HDR_ENTRY;
+#endif  // (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
+
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+// RAM copy of a small file: a static file or an included page fragment
+// a cached file is served without opening it: no file handle is used
+// a static file needs no file buffer either
+typedef struct
+{
+    uint32_t                fHash;      // file identity: hash of the file name
+    int32_t                 fSize;      // size of the file data
+    uint32_t                fStamp;     // file date/time when loaded: (fdate << 16) | ftime; 0 if not known
+    uint32_t                lastUse;    // stamp of the last use, for the LRU replacement
+    uint16_t                refCount;   // number of connections/file chunks currently using the entry
+    uint8_t                 stale;      // the file was changed; the entry is deleted once not used anymore
+    uint8_t                 fileDynamic;// the file is processed for dynamic variables/SSI
+    char*                   fName;      // file name, stored after the file data
+    uint8_t                 fData[];    // file data
+}TCPIP_HTTP_FILE_CACHE_ENTRY;
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+
+#if (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+typedef enum
+{
+    TCPIP_HTTP_PATH_FLAG_NOT_FOUND      = 0x01,         // no file matches the URI
+    TCPIP_HTTP_PATH_FLAG_DEFAULT        = 0x02,         // the URI is a directory: TCPIP_HTTP_NET_DEFAULT_FILE is appended
+}TCPIP_HTTP_PATH_FLAGS;
+
+// cached resolution of a request URI
+// the file type and size come from the header cache, keyed by the resolved file name
+typedef struct
+{
+    uint32_t                uriHash;    // hash of the URI
+    uint32_t                lastUse;    // stamp of the last use, for the LRU replacement
+    uint16_t                uriLen;     // length of the URI; 0 if the entry is not used
+    uint16_t                pathFlags;  // TCPIP_HTTP_PATH_FLAGS value
+    char                    uri[TCPIP_HTTP_NET_PATH_CACHE_URI_LEN];    // the URI, without the leading '/'; not '\0' terminated
+}TCPIP_HTTP_PATH_ENTRY;
+#endif  // (_TCPIP_HTTP_NET_PATH_CACHE != 0)
+
+#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+typedef enum
+{
+    TCPIP_HTTP_UPLOAD_PHASE_WRITE,      // receiving and writing the image
+    TCPIP_HTTP_UPLOAD_PHASE_VERIFY,     // reading back the written image
+    TCPIP_HTTP_UPLOAD_PHASE_COMMIT,     // writing the image first sector
+}TCPIP_HTTP_UPLOAD_PHASE;
+
+typedef enum
+{
+    TCPIP_HTTP_UPLOAD_CMD_NONE,         // no media command in progress
+    TCPIP_HTTP_UPLOAD_CMD_HEAD,         // writing the image first sector
+    TCPIP_HTTP_UPLOAD_CMD_BUFFER,       // writing a full upload buffer
+    TCPIP_HTTP_UPLOAD_CMD_READ,         // reading back the image
+}TCPIP_HTTP_UPLOAD_CMD;
+
+// MPFS image upload in progress
+// the socket fills one buffer while the media writes another
+typedef struct
+{
+    struct _tag_TCPIP_HTTP_NET_CONN* owner; // connection performing the upload; 0 if aborted
+    uint8_t*                buffStart;      // the write buffers, nBuffers * buffSize
+    uint8_t*                headSector;     // the image first sector; it's written last, to commit the image
+    uint8_t*                fillPtr;        // current position in the buffer being filled
+    SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE cmdHandle;    // media command in progress
+    uint32_t                buffSize;       // size of a buffer, multiple of the sector size
+    uint32_t                imageSize;      // image bytes received
+    uint32_t                imageCrc;       // CRC-32 of the received image
+    uint32_t                writeOffset;    // image offset of the next buffer to be written
+    uint32_t                verifyCrc;      // CRC-32 of the image read back
+    uint32_t                verifySize;     // image bytes read back
+    uint32_t                cmdLen;         // bytes transferred by the current read command
+    uint8_t                 nBuffers;       // number of buffers
+    uint8_t                 fillIx;         // buffer being filled
+    uint8_t                 writeIx;        // next buffer to be written
+    uint8_t                 nFull;          // buffers waiting to be written, including the one in progress
+    uint8_t                 cmd;            // TCPIP_HTTP_UPLOAD_CMD value: the media command in progress
+    uint8_t                 phase;          // TCPIP_HTTP_UPLOAD_PHASE value
+}TCPIP_HTTP_UPLOAD_DCPT;
+#endif  // defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+
+#if (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+// maximum length of a multipart boundary, RFC 2046
+#define TCPIP_HTTP_FORM_BOUNDARY_MAX_LEN    70
+
+// size of the buffer used to read the POST data from the socket
+#define TCPIP_HTTP_FORM_READ_SIZE           64
+
+typedef enum
+{
+    TCPIP_HTTP_FORM_STATE_NAME,         // urlencoded: collecting the field name
+    TCPIP_HTTP_FORM_STATE_VALUE,        // urlencoded: decoding the field value
+    TCPIP_HTTP_FORM_STATE_PREAMBLE,     // multipart: waiting for the first delimiter line
+    TCPIP_HTTP_FORM_STATE_PART_HEADER,  // multipart: collecting a part header line
+    TCPIP_HTTP_FORM_STATE_PART_DATA,    // multipart: part data, looking for the delimiter
+    TCPIP_HTTP_FORM_STATE_DELIM_END,    // multipart: after a delimiter; a new part or the close delimiter follows
+    TCPIP_HTTP_FORM_STATE_EPILOGUE,     // multipart: after the close delimiter; the data is discarded
+    TCPIP_HTTP_FORM_STATE_ERROR,        // parsing aborted
+}TCPIP_HTTP_FORM_STATE;
+
+// state of the form parser, allocated while a POST request is parsed
+typedef struct
+{
+    TCPIP_HTTP_NET_FORM_FIELD   field;      // the field reported to the user
+    uint8_t                 state;          // TCPIP_HTTP_FORM_STATE value
+    uint8_t                 nameLen;        // urlencoded: current length of the encoded field name
+    uint8_t                 hexLen;         // urlencoded: number of the %XX hex digits collected
+    uint8_t                 delimLen;       // multipart: delimiter length
+    uint8_t                 delimMatch;     // multipart: number of delimiter characters matched so far
+    uint8_t                 hexChars[2];    // urlencoded: the %XX hex digits
+    uint16_t                hdrLen;         // multipart: current length of the part header line
+    char                    name[TCPIP_HTTP_NET_FORM_NAME_LEN + 2];        // field name; extra byte for TCPIP_HTTP_NET_URLDecode
+    char                    fileName[TCPIP_HTTP_NET_FORM_NAME_LEN + 1];    // multipart: file name
+    char                    delim[TCPIP_HTTP_FORM_BOUNDARY_MAX_LEN + 5];   // multipart: the delimiter: "\r\n--" + boundary
+    char                    hdrLine[TCPIP_HTTP_NET_FORM_HEADER_LEN + 1];   // multipart: the part header line
+}TCPIP_HTTP_FORM_DCPT;
+#endif  // (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+// length of the Sec-WebSocket-Key value: base64 of a 16 bytes nonce
+#define TCPIP_HTTP_WS_KEY_LEN               24
+// length of the Sec-WebSocket-Accept value: base64 of a SHA-1 digest
+#define TCPIP_HTTP_WS_ACCEPT_LEN            28
+// size of a SHA-1 digest
+#define TCPIP_HTTP_WS_SHA1_LEN              20
+// maximum frame header: 2 + 8 bytes extended length + 4 bytes mask
+#define TCPIP_HTTP_WS_FRAME_HDR_MAX         14
+// maximum payload of a control frame
+#define TCPIP_HTTP_WS_CTRL_MAX              125
+
+// frame opcodes
+typedef enum
+{
+    TCPIP_HTTP_WS_OPCODE_CONT       = 0x0,  // continuation of a fragmented message
+    TCPIP_HTTP_WS_OPCODE_TEXT       = 0x1,
+    TCPIP_HTTP_WS_OPCODE_BINARY     = 0x2,
+    TCPIP_HTTP_WS_OPCODE_CLOSE      = 0x8,
+    TCPIP_HTTP_WS_OPCODE_PING       = 0x9,
+    TCPIP_HTTP_WS_OPCODE_PONG       = 0xa,
+}TCPIP_HTTP_WS_OPCODE;
+
+// close status codes
+typedef enum
+{
+    TCPIP_HTTP_WS_CLOSE_NORMAL      = 1000,
+    TCPIP_HTTP_WS_CLOSE_PROTOCOL    = 1002,
+    TCPIP_HTTP_WS_CLOSE_TOO_BIG     = 1009,
+}TCPIP_HTTP_WS_CLOSE_CODE;
+
+// a registered WebSocket endpoint
+typedef struct
+{
+    const char*                 uri;        // name requested by the clients, without the leading '/'
+    TCPIP_HTTP_NET_WS_HANDLER   handler;    // application handler
+}TCPIP_HTTP_WS_ENDPOINT;
+
+// state of a WebSocket connection, allocated when an endpoint is requested
+typedef struct
+{
+    uint8_t                 epIx;           // index of the requested endpoint
+    uint8_t                 upgrade;        // the "Upgrade: websocket" header was present
+    uint8_t                 isOpen;         // the handshake was sent and the OPEN event reported
+    uint8_t                 closeSent;      // a close frame was sent; waiting for the client one
+    uint8_t                 msgOpCode;      // TCPIP_HTTP_WS_OPCODE of the message being received; 0 if none
+    uint16_t                msgLen;         // data of the current message collected in msgBuff
+    char                    acceptKey[TCPIP_HTTP_WS_ACCEPT_LEN + 1];   // Sec-WebSocket-Accept value; "" if no valid key
+    uint8_t                 msgBuff[TCPIP_HTTP_NET_WEBSOCKET_MAX_MESSAGE]; // received message, unmasked
+}TCPIP_HTTP_WS_DCPT;
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+
+#if (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+#define TCPIP_HTTP_SESSION_COOKIE           "HTTPSESSION"   // name of the cookie carrying the session token
+#define TCPIP_HTTP_SESSION_TOKEN_WORDS      4               // 128 bit random token
+#define TCPIP_HTTP_SESSION_TOKEN_LEN        (TCPIP_HTTP_SESSION_TOKEN_WORDS * 8)   // hex characters in the cookie
+#define TCPIP_HTTP_AUTH_CRED_LEN            36              // base64 Basic credentials that are decoded: 27 bytes
+
+// an authenticated session
+// the table is hashed by the first token word; the token is random
+typedef struct
+{
+    uint32_t                token[TCPIP_HTTP_SESSION_TOKEN_WORDS];  // session token; all 0 if the entry is unused
+    uint32_t                expireSec;      // _TCPIP_SecCountGet() when the session expires, if not used
+    uint8_t                 isAuthorized;   // the userAuthenticate result that opened the session: 0x80-0xff
+    uint8_t                 authContext;    // the fileAuthenticate result for that request: the protected area, 0x00-0x7f
+}TCPIP_HTTP_SESSION_ENTRY;
+#endif  // (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+
+#if (_TCPIP_HTTP_NET_SCHED != 0)
+// a scheduling class selected by the URI prefix
+typedef struct
+{
+    const char*             uriPrefix;      // requested name prefix, without the leading '/'; 0 if the rule is unused
+    uint16_t                prefixLen;      // length of the uriPrefix
+    uint16_t                schedClass;     // TCPIP_HTTP_NET_SCHED_CLASS for the matching requests
+}TCPIP_HTTP_SCHED_RULE;
+#endif  // (_TCPIP_HTTP_NET_SCHED != 0)
+
+#if (_TCPIP_HTTP_NET_DEFLATE != 0)
+#define TCPIP_HTTP_DEFLATE_HASH_SIZE        256     // entries in the hash table of the 3 byte sequences
+#define TCPIP_HTTP_DEFLATE_MIN_MATCH        3       // shortest LZ77 match
+#define TCPIP_HTTP_DEFLATE_MAX_MATCH        258     // longest LZ77 match
+#define TCPIP_HTTP_DEFLATE_SYMBOL_MAX       5       // output bytes for a symbol: 31 bits + the pending bits
+#define TCPIP_HTTP_DEFLATE_END_MAX          10      // output bytes for the stream end: header, end of block, final block, Adler-32
+
+// compressor state of a connection: zlib stream with one fixed Huffman block
+typedef struct
+{
+    uint32_t                bitBuff;        // output bits not yet written, LSB first
+    uint16_t                bitCount;       // number of bits in bitBuff
+    uint32_t                adlerA;         // Adler-32 sums of the input
+    uint32_t                adlerB;
+    uint16_t                inPos;          // count of the input bytes, modulo 65536
+    uint16_t                histLen;        // bytes available in the window
+    uint8_t                 started;        // the stream header was written
+    uint8_t                 finished;       // the stream end was written
+    uint8_t*                pOut;           // current output position
+    uint16_t                hashHead[TCPIP_HTTP_DEFLATE_HASH_SIZE]; // inPos of the last sequence with this hash
+    uint8_t                 window[TCPIP_HTTP_NET_DEFLATE_WINDOW];  // the last input bytes, indexed by inPos
+}TCPIP_HTTP_DEFLATE_DCPT;
+#endif  // (_TCPIP_HTTP_NET_DEFLATE != 0)
+
+#if (_TCPIP_HTTP_NET_ROUTER != 0)
+#define TCPIP_HTTP_ROUTE_METHODS            2       // GET, POST: route flags 0x01, 0x02
+
+// a registered route
+typedef struct
+{
+    TCPIP_HTTP_NET_ROUTE_HANDLER handler;   // request handler; 0 if the entry is unused
+    const void*             routeParam;     // parameter passed to the handler
+    uint16_t                routeFlags;     // TCPIP_HTTP_NET_ROUTE_FLAGS
+}TCPIP_HTTP_ROUTE_ENTRY;
+
+// node of the route trie
+// the edge from the parent is labeled by a part of a registered pattern
+// node 0 is the root; a child/sibling index of 0 means none
+typedef struct
+{
+    const char*             label;          // edge label, not 0 terminated
+    uint16_t                labelLen;       // length of the label
+    uint8_t                 child;          // first child node
+    uint8_t                 sibling;        // next sibling node
+    uint8_t                 exactRoute[TCPIP_HTTP_ROUTE_METHODS];   // route of the name ending here: index + 1; 0 if none
+    uint8_t                 prefixRoute[TCPIP_HTTP_ROUTE_METHODS];  // route of the names starting here: index + 1; 0 if none
+}TCPIP_HTTP_ROUTE_NODE;
+#endif  // (_TCPIP_HTTP_NET_ROUTER != 0)
+
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+// initial number of directives a template recording has room for
+// grows as needed, up to TCPIP_HTTP_NET_TEMPLATE_MAX_DIRECTIVES
+#define TCPIP_HTTP_TMPL_BUILD_DIRECTIVES    8
+
+typedef enum
+{
+    TCPIP_HTTP_TMPL_DIR_FLAG_DYNVAR     = 0x00,         // directive is a dynamic variable
+    TCPIP_HTTP_TMPL_DIR_FLAG_SSI        = 0x01,         // directive is a SSI command
+    TCPIP_HTTP_TMPL_DIR_FLAG_BOUND      = 0x02,         // dynamic variable name resolved: keyIx and varId are valid
+}TCPIP_HTTP_TMPL_DIR_FLAGS;
+
+// compiled template directive: a dynamic variable or SSI command
+// the literal span of the file ends where the directive starts
+typedef struct
+{
+    uint32_t                offset;     // file offset where the directive starts
+    uint8_t                 dirFlags;   // TCPIP_HTTP_TMPL_DIR_FLAGS value
+    uint8_t                 keyIx;      // bound dynamic variable: keyword index + 1; 0 if not a keyword
+    uint16_t                varId;      // bound dynamic variable: user variable ID
+}TCPIP_HTTP_TMPL_DIRECTIVE;
+
+// compiled template of a dynamic file
+// recorded while the file is first served, then cached
+typedef struct
+{
+    uint32_t                fHash;      // file identity: hash of the file name
+    int32_t                 fSize;      // file identity: size of the file; < 0 if the entry is stale
+    uint32_t                fStamp;     // file identity: file date/time, (fdate << 16) | ftime; 0 if not known
+    uint32_t                lastUse;    // stamp of the last use, for the LRU replacement
+    uint16_t                refCount;   // number of file chunks currently using the template
+    uint16_t                nDirectives;// number of directives in the file
+    TCPIP_HTTP_TMPL_DIRECTIVE directives[];  // file directives, in file order
+}TCPIP_HTTP_TMPL_ENTRY;
+
+// template being recorded: the directives are added as the file parser finds them
+// the template is cached when the whole file was parsed without errors
+typedef struct
+{
+    uint32_t                fHash;      // identity of the file being recorded
+    uint32_t                fStamp;     // file date/time of the file being recorded
+    uint32_t                purgeCount; // cache purges when the recording started: a purge discards it
+    uint16_t                nDirectives;// directives recorded so far
+    uint16_t                maxDirectives;  // room in the directives array
+    TCPIP_HTTP_TMPL_DIRECTIVE directives[];  // recorded directives, in file order
+}TCPIP_HTTP_TMPL_BUILD;
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+
 // descriptor of a file chunk
 typedef struct
 {
@@ -351,10 +901,20 @@ typedef struct
     int32_t                 fOffset;    // current file offset: read pointer
     char*                   dynStart;   // pointer in the current line buffer where dynamic variable processing starts
     TCPIP_HTTP_FILE_BUFF_DCPT* fileBuffDcpt;    // associated file buffer descriptor
+#if (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+    TCPIP_HTTP_TMPL_ENTRY*  pTmpl;      // compiled template of a dynamic file, if available
+    TCPIP_HTTP_TMPL_BUILD*  pBuild;     // template recorded while the file is served, if not cached yet
+#endif  // (_TCPIP_HTTP_NET_TEMPLATE_CACHE != 0)
+#if (_TCPIP_HTTP_NET_FILE_MEMORY != 0)
+    const uint8_t*          fMapped;    // address of the file data, for a TCPIP_HTTP_CHUNK_FLAG_TYPE_FILE_MAPPED file
+#endif  // (_TCPIP_HTTP_NET_FILE_MEMORY != 0)
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+    TCPIP_HTTP_FILE_CACHE_ENTRY* pCache;// RAM cache entry the file data belongs to, if any
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
     uint16_t                fDynCount;  // current dynamic variable count in this file
     uint16_t                chunkOffset;// current chunk offset: read pointer    
     uint16_t                chunkEnd;   // end pointer of data in the chunk buffer
-    uint16_t                padding;    // unused
+    uint16_t                tmplIx;     // index of the next template directive to be processed
 }TCPIP_HTTP_FILE_CHUNK_DCPT;
 
 
@@ -380,19 +940,39 @@ typedef struct _tag_TCPIP_HTTP_CHUNK_DCPT
 
 typedef union
 {
-    uint16_t    val;
+    uint32_t    val;
     struct
     {
-        uint16_t    procPhase:      3;         // simple phase counter for processing functions
-        uint16_t    requestError:   1;         // an eror occurred while processing the requests (invalid file, buffer overflow, etc.)
+        uint32_t    procPhase:      3;         // simple phase counter for processing functions
+        uint32_t    requestError:   1;         // an eror occurred while processing the requests (invalid file, buffer overflow, etc.)
                                                     // the header parsing will just remove from the socket buffer, don't process
-        uint16_t    discardRxBuff:  1;         // socket RX buffer needs to be discarded before listening to a new request
+        uint32_t    discardRxBuff:  1;         // socket RX buffer needs to be discarded before listening to a new request
                                                     // set because of an error
-        uint16_t    uploadMemError: 1;         // an out of memory occurred during an upload operation
-        uint16_t    sktLocalReset:  1;         // socket reset/disconnect was initiated locally 
-        uint16_t    sktIsConnected: 1;         // socket connect persistent flag 
-        uint16_t    uploadPhase:    1;         // the upload procedure phase: is waiting for the signature
-        uint16_t    reserved:       7;         // not used
+        uint32_t    uploadMemError: 1;         // an out of memory occurred during an upload operation
+        uint32_t    sktLocalReset:  1;         // socket reset/disconnect was initiated locally 
+        uint32_t    sktIsConnected: 1;         // socket connect persistent flag 
+        uint32_t    uploadPhase:    1;         // the upload procedure phase: is waiting for the signature
+        uint32_t    fileCacheable:  1;         // the file served can be cached by the client: it has validators
+        uint32_t    condNoneMatch:  1;         // an If-None-Match header was present; If-Modified-Since is ignored
+        uint32_t    condMatch:      1;         // the conditional GET headers matched the file validators
+        uint32_t    rangeReq:       1;         // a valid single byte range was requested: rangeStart - rangeEnd
+        uint32_t    rangeBad:       1;         // the requested byte range cannot be satisfied
+        uint32_t    rangeIfFail:    1;         // the If-Range validator didn't match; the whole file is sent
+        uint32_t    fileGzipped:    1;         // the file served is gzip compressed
+        uint32_t    fileDynamic:    1;         // the file served is processed for dynamic variables/SSI
+        uint32_t    bodyIdentity:   1;         // the message body is sent with a Content-Length, without chunk framing
+        uint32_t    lineSkip:       1;         // the current request line is longer than the line buffer and is discarded
+        uint32_t    formMultipart:  1;         // the POST data is multipart/form-data
+        uint32_t    snapHit:        1;         // the body is served from a rendered snapshot, copied to the bodyBuff
+        uint32_t    dynCacheable:   1;         // the current dynamic variable declared its output cacheable
+        uint32_t    logPending:     1;         // the request is not yet recorded in the access log
+        uint32_t    logDump:        1;         // the request is for the access log dump
+        uint32_t    sessionNew:     1;         // the credentials were accepted: a session token is issued with the response
+        uint32_t    schedYield:     1;         // the body output stopped because the scheduling deficit is used up
+        uint32_t    acceptDeflate:  1;         // the request Accept-Encoding allows the deflate coding
+        uint32_t    bodyDeflate:    1;         // the dynamic output is deflate compressed
+        uint32_t    pipeBreak:      1;         // the request body length is not known: the next request can't be found
+        uint32_t    reserved:       2;         // not used
     };
 }TCPIP_HTTP_NET_CONN_FLAGS;
 
@@ -409,12 +989,7 @@ typedef struct _tag_TCPIP_HTTP_NET_CONN
     uint8_t*                    httpData;                       // General purpose data buffer
     const void*                 userData;                       // user supplied data; not used by the HTTP module
     NET_PRES_SIGNAL_HANDLE      socketSignal;                   // socket signal handler
-#if defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
-    uint8_t*                    uploadBufferStart;              // buffer used for the fs upload operation
-    uint8_t*                    uploadBufferEnd;                // end of buffer used for the fs upload operation
-    uint8_t*                    uploadBufferCurr;               // current pointer
-    SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE uploadBuffHandle;         // current SYS_MEDIA write buffer handle
-#endif  // defined(TCPIP_HTTP_NET_FILE_UPLOAD_ENABLE)
+    struct _tag_TCPIP_HTTP_NET_CONN* readyNext;                 // next connection in the ready queue
     SINGLE_LIST                 chunkList;                      // current list of chunk jobs: TCPIP_HTTP_CHUNK_DCPT
     // manually aligned members
     uint16_t                    httpStatus;                     // TCPIP_HTTP_NET_STATUS: Request method/status
@@ -422,7 +997,6 @@ typedef struct _tag_TCPIP_HTTP_NET_CONN
     uint16_t                    fileType;                       // TCPIP_HTTP_NET_FILE_TYPE: File type to return with Content-Type
     NET_PRES_SKT_HANDLE_T       socket;                         // Socket being served
     uint16_t                    connIx;                         // index of this connection in the HTTP server
-    uint16_t                    uploadSectNo;                   // current sector number for upload
     uint16_t                    smPost;                         // POST state machine variable  
     uint16_t                    listenPort;                     // server listening port
     uint8_t                     hasArgs;                        // True if there were get or cookie arguments
@@ -434,8 +1008,72 @@ typedef struct _tag_TCPIP_HTTP_NET_CONN
     uint16_t                    connActiveSec;                  // last second the connection was active                  
     TCPIP_HTTP_NET_CONN_FLAGS   flags;                          // connection flags
     uint8_t                     closeEvent;                     // the event for the reported connection close
-    // 
-    char                        fileName[SYS_FS_FILE_NAME_LEN + 1];  // file name storage
+    uint8_t                     readyQueued;                    // the connection is in the ready queue
+#if (_TCPIP_HTTP_NET_FILE_STAMP != 0)
+    uint32_t                    fileStamp;                      // file date/time, as reported by the file system: (fdate << 16) | ftime
+                                                                // 0 if not known
+#endif  // (_TCPIP_HTTP_NET_FILE_STAMP != 0)
+#if (_TCPIP_HTTP_NET_FILE_VALIDATORS != 0)
+    uint32_t                    fileSize;                       // file size, part of the file validators
+#endif  // (_TCPIP_HTTP_NET_FILE_VALIDATORS != 0)
+#if (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+    char*                       bodyBuff;                       // buffer collecting the dynamic output, sent as one chunk:
+                                                                // TCPIP_HTTP_CHUNK_HEADER_LEN + bodyBuffSize + TCPIP_HTTP_CHUNK_FINAL_TRAILER_LEN 
+    uint16_t                    bodyBuffSize;                   // data size of the bodyBuff
+    uint16_t                    bodyLen;                        // data currently collected in the bodyBuff
+#endif  // (_TCPIP_HTTP_NET_CHUNK_COALESCE != 0)
+#if (_TCPIP_HTTP_NET_DEFLATE != 0)
+    TCPIP_HTTP_DEFLATE_DCPT*    deflateDcpt;                    // compressor of the bodyBuff data; 0 if none
+#endif  // (_TCPIP_HTTP_NET_DEFLATE != 0)
+#if (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
+    uint32_t                    fileHash;                       // hash of the file name, for the header cache look up
+#endif  // (_TCPIP_HTTP_NET_HEADER_CACHE != 0)
+#if (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+    TCPIP_HTTP_FILE_CACHE_ENTRY* fileCache;                     // RAM copy of the file being served, instead of the file handle
+#endif  // (_TCPIP_HTTP_NET_FILE_CACHE != 0)
+#if defined(TCPIP_HTTP_NET_USE_RANGES)
+    uint32_t                    rangeStart;                     // first byte of the requested range
+    uint32_t                    rangeEnd;                       // last byte of the requested range
+#endif  // defined(TCPIP_HTTP_NET_USE_RANGES)
+    uint16_t                    lineLen;                        // current length of the partial line in lineBuff
+    const char*                 fileName;                       // name of the file being served; "" if none
+    TCPIP_HTTP_FILE_NAME*       pFileName;                      // interned storage of the fileName
+    TCPIP_HTTP_LINE_BUFF_DCPT*  lineBuffDcpt;                   // line buffer borrowed while parsing the request
+    char*                       lineBuff;                       // request line/header line being assembled
+#if (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+    TCPIP_HTTP_FORM_DCPT*       formDcpt;                       // form parser state, while parsing the POST data
+#endif  // (_TCPIP_HTTP_NET_FORM_PARSE != 0)
+#if (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+    uint32_t                    queryHash;                      // hash of the GET query string; 0 if none
+    TCPIP_HTTP_SNAP_ENTRY*      snapEntry;                      // snapshot entry the output is captured into, while rendering
+#endif  // (_TCPIP_HTTP_NET_SNAPSHOT != 0)
+#if (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+    uint8_t                     evChannel;                      // event channel requested by the connection: index + 1; 0 if none
+#endif  // (_TCPIP_HTTP_NET_EVENT_STREAM != 0)
+#if (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+    TCPIP_HTTP_WS_DCPT*         wsDcpt;                         // WebSocket state, if a WebSocket endpoint was requested
+#endif  // (_TCPIP_HTTP_NET_WEBSOCKET != 0)
+#if (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+    TCPIP_HTTP_SESSION_ENTRY*   sessionEntry;                   // session that authorized the request; 0 if none
+    char                        authCred[TCPIP_HTTP_AUTH_CRED_LEN + 1]; // Basic credentials, checked at the end of the headers if no session matched
+    uint8_t                     authContext;                    // fileAuthenticate result the credentials were checked for
+#endif  // (_TCPIP_HTTP_NET_AUTH_SESSION != 0)
+#if (_TCPIP_HTTP_NET_SCHED != 0)
+    int32_t                     schedDeficit;                   // body bytes the connection can still send in its turn
+    uint8_t                     schedClass;                     // TCPIP_HTTP_NET_SCHED_CLASS of the current request
+#endif  // (_TCPIP_HTTP_NET_SCHED != 0)
+#if (_TCPIP_HTTP_NET_ROUTER != 0)
+    uint8_t                     routeIx;                        // route resolved for the request: index + 1; 0 if none
+#endif  // (_TCPIP_HTTP_NET_ROUTER != 0)
+#if (_TCPIP_HTTP_NET_PIPELINE != 0)
+    uint32_t                    bodySkip;                       // bytes of a previous request body still to be skipped
+    uint8_t                     pipeCount;                      // requests answered in the current turn
+#endif  // (_TCPIP_HTTP_NET_PIPELINE != 0)
+#if (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
+    uint32_t                    logAccept;                      // SYS_TIME_CounterGet() when the request started: socket accept or first data; 0 if not yet
+    uint32_t                    logStamps[TCPIP_HTTP_NET_LOG_STAGE_CLOSE];  // SYS_TIME_CounterGet() at each stage; 0 if not reached
+    uint32_t                    logBytes;                       // message body bytes sent
+#endif  // (_TCPIP_HTTP_NET_ACCESS_LOG != 0)
 
 } TCPIP_HTTP_NET_CONN;
 
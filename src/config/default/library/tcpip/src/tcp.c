@@ -574,14 +574,14 @@ static TCPIP_MAC_PACKET* _TxSktFreeLockedV4Pkt(TCB_STUB* pSkt)
 #endif  // defined (TCPIP_STACK_USE_IPV4)
 
 // helper to set the socket retransmission timeout
-// if reload, it initializes it
+// if reload, it initializes it from the RTT estimation
 // else it doubles it (exp back off)
 static void _TCP_LoadRetxTmo(TCB_STUB* pSkt, bool reload)
 {
     uint32_t retxTmo;
     if(reload)
     {
-        retxTmo = _TCP_SOCKET_RETX_TMO;
+        retxTmo = pSkt->rto != 0 ? pSkt->rto : _TCP_SOCKET_RETX_TMO;
     }
     else
     {
@@ -596,6 +596,51 @@ static void _TCP_LoadRetxTmo(TCB_STUB* pSkt, bool reload)
     pSkt->retxTime = SYS_TMR_TickCountGet() + (pSkt->retxTmo * sysTickFreq)/1000;
 }
 
+// updates the RTT estimation with a new measurement and calculates the RTO
+// Jacobson/Karels, as in RFC 6298
+// srtt is kept scaled by 8 and rttVar by 4, so that 4 * RTTVAR is rttVar
+static void _TCP_RttUpdate(TCB_STUB* pSkt, uint32_t rttTicks)
+{
+    int32_t rtt, delta;
+    uint32_t rto;
+
+    rtt = (int32_t)((rttTicks * 1000) / sysTickFreq);
+    if(rtt == 0)
+    {
+        rtt = 1;
+    }
+
+    if(pSkt->srtt == 0)
+    {   // first measurement: SRTT = R, RTTVAR = R/2
+        pSkt->srtt = rtt << 3;
+        pSkt->rttVar = rtt << 1;
+    }
+    else
+    {   // SRTT = 7/8 SRTT + 1/8 R; RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|
+        delta = rtt - (int32_t)(pSkt->srtt >> 3);
+        pSkt->srtt += delta;
+        if(delta < 0)
+        {
+            delta = -delta;
+        }
+        pSkt->rttVar += delta - (int32_t)(pSkt->rttVar >> 2);
+    }
+
+    // RTO = SRTT + max(G, 4 * RTTVAR); G is the TCP task rate
+    rto = pSkt->rttVar > TCPIP_TCP_TASK_TICK_RATE ? pSkt->rttVar : TCPIP_TCP_TASK_TICK_RATE;
+    rto += pSkt->srtt >> 3;
+    if(rto < _TCP_SOCKET_MIN_RETX_TIME)
+    {
+        rto = _TCP_SOCKET_MIN_RETX_TIME;
+    }
+    else if(rto > _TCP_SOCKET_MAX_RETX_TIME)
+    {
+        rto = _TCP_SOCKET_MAX_RETX_TIME;
+    }
+
+    pSkt->rto = rto;
+}
+
 
 /*****************************************************************************
   Function:
@@ -2354,6 +2399,9 @@ bool TCPIP_TCP_SocketInfoGet(TCP_SOCKET hTCP, TCP_SOCKET_INFO* remoteInfo)
     remoteInfo->rxPending = _TCPIsGetReady(pSkt);
     remoteInfo->txPending = TCPIP_TCP_FifoTxFullGet(hTCP);
     remoteInfo->flags = _TCP_SktFlagsGet(pSkt);
+    remoteInfo->srtt = pSkt->srtt >> 3;
+    remoteInfo->rttVar = pSkt->rttVar >> 2;
+    remoteInfo->rto = pSkt->retxTmo != 0 ? pSkt->retxTmo : pSkt->rto != 0 ? pSkt->rto : _TCP_SOCKET_RETX_TMO;
 
     return true;
 }
@@ -3732,6 +3780,12 @@ static void TCPIP_TCP_Tick(void)
                     // Set the appropriate retry time
                     pSkt->retryCount++;
                     pSkt->retryInterval <<= 1;
+                    if(pSkt->retryInterval > (_TCP_SOCKET_MAX_RETX_TIME * sysTickFreq)/1000)
+                    {
+                        pSkt->retryInterval = (_TCP_SOCKET_MAX_RETX_TIME * sysTickFreq)/1000;
+                    }
+                    // Karn: the timed segment is sent again, its ACK is ambiguous
+                    pSkt->flags.rttTiming = 0;
 
                     // Calculate how many bytes we have to roll back and retransmit
                     w = pSkt->txUnackedTail - pSkt->txTail;
@@ -4152,9 +4206,9 @@ static _TCP_SEND_RES _TcpSend(TCB_STUB* pSkt, uint8_t vTCPFlags, uint8_t vSendFl
             }
 
             if(vSendFlags & SENDTCP_RESET_TIMERS)
-            {
+            {   // the RTO, once the RTT is measured
                 pSkt->retryCount = 0;
-                pSkt->retryInterval = (TCPIP_TCP_START_TIMEOUT_VAL * sysTickFreq)/1000;
+                pSkt->retryInterval = ((pSkt->rto != 0 ? pSkt->rto : TCPIP_TCP_START_TIMEOUT_VAL) * sysTickFreq)/1000;
             }   
 
             pSkt->eventTime = SYS_TMR_TickCountGet() + pSkt->retryInterval;
@@ -4199,9 +4253,22 @@ static _TCP_SEND_RES _TcpSend(TCB_STUB* pSkt, uint8_t vTCPFlags, uint8_t vSendFl
         header->UrgentPointer       = 0;
         header->Checksum            = 0;
 
+        // time a new data segment, one at a time
+        // retransmissions are not timed (Karn): they start below sndMax
+        if(len != 0 && pSkt->flags.rttTiming == 0 && (int32_t)(pSkt->MySEQ - pSkt->sndMax) >= 0)
+        {
+            pSkt->rttStart = SYS_TMR_TickCountGet();
+            pSkt->rttSeq = pSkt->MySEQ + (uint32_t)len;
+            pSkt->flags.rttTiming = 1;
+        }
+
         // Update our send sequence number and ensure retransmissions 
         // of SYNs and FINs use the right sequence number
         pSkt->MySEQ += (uint32_t)len;
+        if((int32_t)(pSkt->MySEQ - pSkt->sndMax) > 0)
+        {
+            pSkt->sndMax = pSkt->MySEQ;
+        }
         if(vTCPFlags & SYN)
         {
             hdrLen = sizeof(options);
@@ -4222,6 +4289,7 @@ static _TCP_SEND_RES _TcpSend(TCB_STUB* pSkt, uint8_t vTCPFlags, uint8_t vSendFl
             {
                 pSkt->MySEQ++;
                 pSkt->flags.bSYNSent = 1;
+                pSkt->sndMax = pSkt->MySEQ;
             }
         }
         else
@@ -4558,6 +4626,8 @@ static void _TcpSocketSetIdleState(TCB_STUB* pSkt)
     pSkt->flags.seqInc = 0;
     pSkt->flags.bSYNSent = 0;
     pSkt->retxTmo = pSkt->retxTime = 0;
+    pSkt->flags.rttTiming = 0;
+    pSkt->srtt = pSkt->rttVar = pSkt->rto = 0;
     pSkt->dupAckCnt = 0;    
     pSkt->MySEQ = 0;
     pSkt->sHoleSize = -1;
@@ -5195,6 +5265,11 @@ static void _TcpHandleSeg(TCB_STUB* pSkt, TCP_HEADER* h, uint16_t tcpLen, TCPIP_
             dwTemp = localAckNumber - dwTemp;
             if(((int32_t)(dwTemp) > 0) && (dwTemp <= pSkt->txEnd - pSkt->txStart))
             {   // ACK-ed some data
+                if(pSkt->flags.rttTiming != 0 && (int32_t)(localAckNumber - pSkt->rttSeq) >= 0)
+                {   // the timed segment is acknowledged
+                    _TCP_RttUpdate(pSkt, SYS_TMR_TickCountGet() - pSkt->rttStart);
+                    pSkt->flags.rttTiming = 0;
+                }
                 _TCP_LoadRetxTmo(pSkt, true);
                 pSkt->dupAckCnt = 0;    
                 pSkt->Flags.bHalfFullFlush = false;
@@ -5251,6 +5326,7 @@ static void _TcpHandleSeg(TCB_STUB* pSkt, TCP_HEADER* h, uint16_t tcpLen, TCPIP_
 
                     if(fastRetransmit)
                     {
+                        pSkt->flags.rttTiming = 0;  // Karn: no RTT sample from a retransmitted segment
                         // Set up to perform a fast retransmission
                         // Roll back unacknowledged TX tail pointer to cause retransmit to occur
                         pSkt->MySEQ -= (pSkt->txUnackedTail - pSkt->txTail);
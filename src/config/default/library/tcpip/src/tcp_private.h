@@ -93,7 +93,18 @@ Microchip or any third party.
 
 
 // maximum retransmission time for exp backoff - 64 seconds
+#if defined(TCPIP_TCP_RTO_MAX) && (TCPIP_TCP_RTO_MAX != 0)
+#define _TCP_SOCKET_MAX_RETX_TIME       TCPIP_TCP_RTO_MAX
+#else
 #define _TCP_SOCKET_MAX_RETX_TIME       64000
+#endif
+
+// minimum retransmission time computed from the RTT estimation
+#if defined(TCPIP_TCP_RTO_MIN) && (TCPIP_TCP_RTO_MIN != 0)
+#define _TCP_SOCKET_MIN_RETX_TIME       TCPIP_TCP_RTO_MIN
+#else
+#define _TCP_SOCKET_MIN_RETX_TIME       1000        // RFC 6298 value
+#endif
 
 #if defined(TCP_RETRANSMISSION_TMO) && (TCP_RETRANSMISSION_TMO != 0)
 #define _TCP_SOCKET_RETX_TMO    TCP_RETRANSMISSION_TMO
@@ -155,6 +166,12 @@ typedef struct
     uint32_t            closeWaitTime;              // TCP_CLOSE_WAIT, TCP_FIN_WAIT_2, TCP_TIME_WAIT timeout
     uint32_t            retxTmo;                    // current retransmission timeout, ms
     uint32_t            retxTime;                   // current retransmission time, ticks
+    uint32_t            rttStart;                   // time the timed segment was sent, ticks
+    uint32_t            rttSeq;                     // sequence number that acknowledges the timed segment
+    uint32_t            sndMax;                     // highest sequence number sent; lower segments are retransmissions
+    uint32_t            srtt;                       // smoothed round trip time, ms * 8; 0 if not measured yet
+    uint32_t            rttVar;                     // round trip time variation, ms * 4
+    uint32_t            rto;                        // retransmission timeout from the RTT estimation, ms; 0 if not measured yet
 
     TCP_SOCKET   sktIx;                             // socket number
     struct
@@ -205,7 +222,7 @@ typedef struct
         uint16_t openAddType    : 2;                // the address type used at open
         uint16_t bFINSent       : 1;                // A FIN has been sent
         uint16_t bSYNSent       : 1;                // A SYN has been sent
-        uint16_t res1           : 1;                // not used
+        uint16_t rttTiming      : 1;                // a segment is timed for the RTT estimation
         uint16_t res2           : 1;                // not used
         uint16_t nonLinger      : 1;                // linger option
         uint16_t nonGraceful    : 1;                // graceful close
@@ -4266,11 +4266,18 @@ static void _Command_HttpNetInfo(SYS_CMD_DEVICE_NODE* pCmdIO, int argc, char** a
     TCPIP_HTTP_NET_CHUNK_INFO   httpChunkInfo[6];
     TCPIP_HTTP_NET_CHUNK_INFO*  pChunkInfo;
     TCPIP_HTTP_NET_STAT_INFO    httpStat;
+    TCPIP_HTTP_NET_LOG_ENTRY    logEntry;
+    int logIx, nLogs, stage;
+    uint32_t p50, p90, p99;
     const void* cmdIoParam = pCmdIO->cmdIoParam;
+    static const char* logStageName[TCPIP_HTTP_NET_LOG_STAGES] = {"headers", "file open", "first byte", "close"};
+    TCPIP_HTTP_NET_SCHED_STAT   schedStat;
+    int classIx;
+    static const char* schedClassName[TCPIP_HTTP_NET_SCHED_CLASSES] = {"interactive", "bulk"};
 
     if (argc < 2)
     {
-        (*pCmdIO->pCmdApi->msg)(cmdIoParam, "Usage: http info/stat/chunk/disconnect\r\n");
+        (*pCmdIO->pCmdApi->msg)(cmdIoParam, "Usage: http info/stat/chunk/disconnect/log/sched\r\n");
         return;
     }
 
@@ -4321,6 +4328,16 @@ static void _Command_HttpNetInfo(SYS_CMD_DEVICE_NODE* pCmdIO, int argc, char** a
         {
             (*pCmdIO->pCmdApi->print)(cmdIoParam, "HTTP connections: %d, active: %d, open: %d\r\n", httpStat.nConns, httpStat.nActiveConns, httpStat.nOpenConns);
             (*pCmdIO->pCmdApi->print)(cmdIoParam, "HTTP pool empty: %d, max depth: %d, parse retries: %d\r\n", httpStat.dynPoolEmpty, httpStat.maxRecurseDepth, httpStat.dynParseRetry);
+            (*pCmdIO->pCmdApi->print)(cmdIoParam, "HTTP templates hits: %d, misses: %d, fails: %d\r\n", httpStat.tmplCacheHits, httpStat.tmplCacheMisses, httpStat.tmplCacheFails);
+            (*pCmdIO->pCmdApi->print)(cmdIoParam, "HTTP file cache hits: %d, misses: %d, bytes: %d\r\n", httpStat.fileCacheHits, httpStat.fileCacheMisses, httpStat.fileCacheBytes);
+            (*pCmdIO->pCmdApi->print)(cmdIoParam, "HTTP path cache hits: %d, misses: %d\r\n", httpStat.pathCacheHits, httpStat.pathCacheMisses);
+            (*pCmdIO->pCmdApi->print)(cmdIoParam, "HTTP snapshot cache hits: %d, misses: %d\r\n", httpStat.snapCacheHits, httpStat.snapCacheMisses);
+            (*pCmdIO->pCmdApi->print)(cmdIoParam, "HTTP event streams: %d, published: %d, dropped: %d\r\n", httpStat.evStreams, httpStat.evPublished, httpStat.evDropped);
+            (*pCmdIO->pCmdApi->print)(cmdIoParam, "HTTP websockets: %d, messages: %d\r\n", httpStat.wsConns, httpStat.wsMessages);
+            (*pCmdIO->pCmdApi->print)(cmdIoParam, "HTTP auth sessions: %d, hits: %d, issued: %d\r\n", httpStat.authSessions, httpStat.authSessionHits, httpStat.authSessionsIssued);
+            (*pCmdIO->pCmdApi->print)(cmdIoParam, "HTTP deflate responses: %d, low heap: %d, in: %d, out: %d\r\n", httpStat.deflateResponses, httpStat.deflateLowHeap, httpStat.deflateIn, httpStat.deflateOut);
+            (*pCmdIO->pCmdApi->print)(cmdIoParam, "HTTP pipelined requests: %d, breaks: %d\r\n", httpStat.pipelined, httpStat.pipeBreaks);
+            (*pCmdIO->pCmdApi->print)(cmdIoParam, "HTTP heap per connection: %d, line buffers: %d x %d, free: %d, waits: %d, file names: %d\r\n", httpStat.connSize, httpStat.nLineBuffers, httpStat.lineBuffSize, httpStat.lineBuffFree, httpStat.lineBuffEmpty, httpStat.fileNameBytes);
         }
         else
         {
@@ -4338,6 +4355,48 @@ static void _Command_HttpNetInfo(SYS_CMD_DEVICE_NODE* pCmdIO, int argc, char** a
 
         (*pCmdIO->pCmdApi->print)(cmdIoParam, "HTTP disconnected %d connections, active: %d\r\n", httpOpenConn, httpActiveConn);
     }
+    else if(strcmp(argv[1], "log") == 0)
+    {
+        if(argc > 2 && strcmp(argv[2], "clear") == 0)
+        {
+            TCPIP_HTTP_NET_LogClear();
+            (*pCmdIO->pCmdApi->msg)(cmdIoParam, "HTTP log cleared\r\n");
+            return;
+        }
+
+        nLogs = TCPIP_HTTP_NET_LogGet(0, 0, 0);
+        (*pCmdIO->pCmdApi->print)(cmdIoParam, "HTTP log entries: %d\r\n", nLogs);
+        // times are in us; -1 for a stage not reached
+        for(logIx = nLogs > 8 ? nLogs - 8 : 0; logIx < nLogs; logIx++)
+        {
+            if(TCPIP_HTTP_NET_LogGet(logIx, &logEntry, 1) != 0)
+            {
+                (*pCmdIO->pCmdApi->print)(cmdIoParam, "HTTP log conn: %d, uri: 0x%08x, status: %d, bytes: %d, hdr: %d, open: %d, first: %d, close: %d\r\n",
+                        logEntry.connIx, logEntry.uriHash, logEntry.httpStatus, logEntry.bodyBytes, (int)logEntry.stageUs[TCPIP_HTTP_NET_LOG_STAGE_HEADERS],
+                        (int)logEntry.stageUs[TCPIP_HTTP_NET_LOG_STAGE_FILE_OPEN], (int)logEntry.stageUs[TCPIP_HTTP_NET_LOG_STAGE_FIRST_BYTE], (int)logEntry.stageUs[TCPIP_HTTP_NET_LOG_STAGE_CLOSE]);
+            }
+        }
+
+        for(stage = 0; stage < TCPIP_HTTP_NET_LOG_STAGES; stage++)
+        {
+            if(TCPIP_HTTP_NET_LogPercentileGet(stage, 50, &p50) && TCPIP_HTTP_NET_LogPercentileGet(stage, 90, &p90) && TCPIP_HTTP_NET_LogPercentileGet(stage, 99, &p99))
+            {
+                (*pCmdIO->pCmdApi->print)(cmdIoParam, "HTTP %s us - p50: %d, p90: %d, p99: %d\r\n", logStageName[stage], p50, p90, p99);
+            }
+        }
+    }
+    else if(strcmp(argv[1], "sched") == 0)
+    {
+        for(classIx = 0; classIx < TCPIP_HTTP_NET_SCHED_CLASSES; classIx++)
+        {
+            if(!TCPIP_HTTP_NET_SchedStatGet(classIx, &schedStat))
+            {
+                (*pCmdIO->pCmdApi->msg)(cmdIoParam, "HTTP: scheduling not enabled\r\n");
+                break;
+            }
+            (*pCmdIO->pCmdApi->print)(cmdIoParam, "HTTP sched %s - requests: %d, bytes: %d, yields: %d\r\n", schedClassName[classIx], schedStat.requests, schedStat.bytes, schedStat.yields);
+        }
+    }
     else
     {
         (*pCmdIO->pCmdApi->msg)(cmdIoParam, "HTTP: unknown parameter\r\n");
@@ -5293,6 +5352,8 @@ static void _Command_Tcp(SYS_CMD_DEVICE_NODE* pCmdIO, int argc, char** argv)
                             ix, sktInfo.addressType, sktInfo.remotePort, sktInfo.localPort, sktInfo.flags);
                     (*pCmdIO->pCmdApi->print)(cmdIoParam, "\trxSize: %d, txSize: %d, state: %d, rxPend: %d, txPend: %d\r\n",
                             sktInfo.rxSize, sktInfo.txSize, sktInfo.state, sktInfo.rxPending, sktInfo.txPending);
+                    (*pCmdIO->pCmdApi->print)(cmdIoParam, "\tsrtt: %d ms, rttvar: %d ms, rto: %d ms\r\n",
+                            sktInfo.srtt, sktInfo.rttVar, sktInfo.rto);
                 }
             }
 
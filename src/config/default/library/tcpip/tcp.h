@@ -186,6 +186,9 @@ typedef struct
     uint16_t            rxPending;          // bytes pending in RX buffer
     uint16_t            txPending;          // bytes pending in TX buffer
     TCP_SOCKET_FLAGS    flags;              // socket flags
+    uint32_t            srtt;               // smoothed round trip time, ms; 0 if not measured yet
+    uint32_t            rttVar;             // round trip time variation, ms
+    uint32_t            rto;                // current retransmission timeout, ms
 } TCP_SOCKET_INFO;
 
 // *****************************************************************************
@@ -623,6 +623,32 @@ bool MPFS_EOF
     return false;
 }
 
+/* Returns the CPU address of the current file position.
+ * The media has to be memory mapped, i.e. the MPFS image is in program flash. */
+int MPFS_MappedAddressGet
+(
+    uintptr_t handle,
+    uintptr_t* pAddress
+)
+{
+#if (SYS_FS_MPFS_MAPPED_ENABLE != 0)
+    uint16_t index = 0;
+
+    if (MPFSIsHandleValid(handle) == false)
+    {
+        /* Invalid handle. */
+        return MPFS_INVALID_PARAMETER;
+    }
+
+    index = handle & 0xFFFF;
+    *pAddress = (uintptr_t)gSysMpfsObj.baseAddress + gSysMpfsFileObj[index].currentOffset;
+
+    return MPFS_OK;
+#else
+    return MPFS_NOT_ENABLED;
+#endif  // (SYS_FS_MPFS_MAPPED_ENABLE != 0)
+}
+
 /* Returns the File statistics. */
 int MPFS_Stat
 (
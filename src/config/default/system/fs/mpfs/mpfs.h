@@ -330,6 +330,29 @@ bool MPFS_EOF ( uintptr_t handle);
 
 int MPFS_Seek ( uintptr_t handle, uint32_t dwOffset );
 
+/*****************************************************************************
+  Function:
+    int MPFS_MappedAddressGet ( uintptr_t handle, uintptr_t* pAddress )
+
+  Description:
+    Returns the CPU address of the current file position.
+    Available only when the MPFS image is stored on a memory mapped media
+    (SYS_FS_MPFS_MAPPED_ENABLE).
+
+  Precondition:
+    The file handle referenced by handle is already open.
+
+  Parameters:
+    handle   - a valid handle to the file
+    pAddress - address to store the CPU address of the file data
+
+  Returns:
+    Success     - MPFS_OK
+    Failure     - MPFS_INVALID_PARAMETER, MPFS_NOT_ENABLED
+*/
+
+int MPFS_MappedAddressGet ( uintptr_t handle, uintptr_t* pAddress );
+
 /*****************************************************************************
   Function:
     int MPFS_Stat ( const char* filewithDisk, uintptr_t stat_str )
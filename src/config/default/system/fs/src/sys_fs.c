@@ -1364,6 +1364,82 @@ int32_t SYS_FS_FileSize
     return fileStatus;
 }
 
+//******************************************************************************
+/*Function:
+    SYS_FS_RESULT SYS_FS_FileMappedAddressGet
+    (
+        SYS_FS_HANDLE handle,
+        const void** ppAddress
+    );
+
+  Summary:
+    Returns the CPU address of the current file position.
+
+  Description:
+    This function returns the address of the data at the current position of
+    a file stored on a memory mapped media.
+
+  Remarks:
+    See sys_fs.h for usage information.
+***************************************************************************/
+SYS_FS_RESULT SYS_FS_FileMappedAddressGet
+(
+    SYS_FS_HANDLE handle,
+    const void** ppAddress
+)
+{
+    SYS_FS_OBJ *fileObj = (SYS_FS_OBJ *)handle;
+    int fileStatus = -1;
+    uintptr_t address = 0;
+    OSAL_RESULT osalResult = OSAL_RESULT_FAIL;
+
+    /* Check if the handle is valid. */
+    if (handle == SYS_FS_HANDLE_INVALID || ppAddress == NULL)
+    {
+        errorValue = SYS_FS_ERROR_INVALID_OBJECT;
+        return SYS_FS_RES_FAILURE;
+    }
+
+    /* Check if the file object is in use. */
+    if (fileObj->inUse == false)
+    {
+        errorValue = SYS_FS_ERROR_INVALID_OBJECT;
+        return SYS_FS_RES_FAILURE;
+    }
+
+    if (fileObj->mountPoint->fsFunctions->mappedAddr == NULL)
+    {
+        fileObj->errorValue = SYS_FS_ERROR_NOT_SUPPORTED_IN_NATIVE_FS;
+        return SYS_FS_RES_FAILURE;
+    }
+
+    /* Clear out the error. */
+    fileObj->errorValue = SYS_FS_ERROR_OK;
+
+    /* Acquire the volume mutex. */
+    osalResult = OSAL_MUTEX_Lock(&(fileObj->mountPoint->mutexDiskVolume), OSAL_WAIT_FOREVER);
+    if (osalResult == OSAL_RESULT_SUCCESS)
+    {
+        fileStatus = fileObj->mountPoint->fsFunctions->mappedAddr(fileObj->nativeFSFileObj, &address);
+        /* Release the acquired mutex. */
+        (void) OSAL_MUTEX_Unlock(&(fileObj->mountPoint->mutexDiskVolume));
+
+        if (fileStatus != 0)
+        {
+            fileObj->errorValue = SYS_FS_ERROR_NOT_SUPPORTED_IN_NATIVE_FS;
+            return SYS_FS_RES_FAILURE;
+        }
+    }
+    else
+    {
+        fileObj->errorValue = SYS_FS_ERROR_DENIED;
+        return SYS_FS_RES_FAILURE;
+    }
+
+    *ppAddress = (const void*)address;
+    return SYS_FS_RES_SUCCESS;
+}
+
 //******************************************************************************
 /*Function:
     bool SYS_FS_FileEOF
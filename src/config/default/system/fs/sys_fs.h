@@ -582,6 +582,9 @@ typedef struct
     /* Function pointer of native file system to get total sectors and free
      * sectors */
     int(*getCluster)(const char *path, uint32_t *tot_sec, uint32_t *free_sec);
+    /* Function pointer of native file system to get the CPU address of the
+     * current position in a file stored on a memory mapped media */
+    int(*mappedAddr)(uintptr_t handle, uintptr_t* pAddress);
 } SYS_FS_FUNCTIONS;
 
 // *****************************************************************************
@@ -1611,6 +1614,67 @@ int32_t SYS_FS_FileSize
     SYS_FS_HANDLE handle
 );
 
+//******************************************************************************
+/* Function:
+    SYS_FS_RESULT SYS_FS_FileMappedAddressGet
+    (
+        SYS_FS_HANDLE handle,
+        const void** ppAddress
+    );
+
+    Summary:
+      Returns the CPU address of the current file position.
+
+    Description:
+      This function returns the address, in the CPU address space, of the data
+      at the current position of the file pointed by the handle.
+      The data can then be accessed directly, without a file read.
+      This is possible only for files stored on a memory mapped media
+      (for example an MPFS image in the program flash).
+
+    Precondition:
+       A valid file handle must be obtained before.
+
+    Parameters:
+       handle    - File handle obtained during file Open.
+       ppAddress - address to store the data pointer
+
+    Returns:
+      SYS_FS_RES_SUCCESS - the file data is memory mapped and *ppAddress
+                           points to the current file position.
+      SYS_FS_RES_FAILURE - the file is not memory mapped or the handle is not
+                           valid. The reason for the failure can be retrieved
+                           with SYS_FS_Error or SYS_FS_FileError.
+
+    Example:
+      <code>
+        SYS_FS_HANDLE fileHandle;
+        const void* fileData;
+
+        fileHandle = SYS_FS_FileOpen("/mnt/myDrive/FILE.txt",
+                (SYS_FS_FILE_OPEN_READ));
+
+        if(fileHandle != SYS_FS_HANDLE_INVALID)
+        {
+            if(SYS_FS_FileMappedAddressGet(fileHandle, &fileData) == SYS_FS_RES_SUCCESS)
+            {
+                // fileData can be accessed for SYS_FS_FileSize(fileHandle) bytes
+            }
+        }
+      </code>
+
+    Remarks:
+      The returned address is valid as long as the file is open and the media
+      is not modified.
+      Reading the data directly does not update the file position.
+*/
+
+SYS_FS_RESULT SYS_FS_FileMappedAddressGet
+(
+    SYS_FS_HANDLE handle,
+    const void** ppAddress
+);
+
 //******************************************************************************
 /* Function:
     bool SYS_FS_FileEOF
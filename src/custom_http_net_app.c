@@ -117,27 +117,69 @@ Section:
 Function Prototypes and Memory Globalizers
  ****************************************************************************/
 
+static TCPIP_HTTP_NET_IO_RESULT HTTPGetForms(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam);
+static TCPIP_HTTP_NET_IO_RESULT HTTPGetCookies(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam);
+static TCPIP_HTTP_NET_IO_RESULT HTTPGetLeds(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam);
+static TCPIP_HTTP_NET_IO_RESULT HTTP_APP_RouteDispatch(TCPIP_HTTP_NET_CONN_HANDLE connHandle, TCPIP_HTTP_NET_ROUTE_FLAGS method);
+
 #if defined(TCPIP_HTTP_NET_USE_POST)
     #if defined(SYS_OUT_ENABLE)
-        static TCPIP_HTTP_NET_IO_RESULT HTTPPostLCD(TCPIP_HTTP_NET_CONN_HANDLE connHandle);
+        static TCPIP_HTTP_NET_IO_RESULT HTTPPostLCD(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam);
+        static bool HTTPPostLCDField(TCPIP_HTTP_NET_CONN_HANDLE connHandle, TCPIP_HTTP_NET_FORM_EVENT event,
+                                     const TCPIP_HTTP_NET_FORM_FIELD* pField, const uint8_t* data, uint16_t dataLen, const void* param);
     #endif
     #if !defined(HTTP_APP_USE_MD5)
-        static TCPIP_HTTP_NET_IO_RESULT HTTPPostMD5(TCPIP_HTTP_NET_CONN_HANDLE connHandle);
+        static TCPIP_HTTP_NET_IO_RESULT HTTPPostMD5(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam);
     #endif
     #if defined(HTTP_APP_USE_RECONFIG)
-        static TCPIP_HTTP_NET_IO_RESULT HTTPPostConfig(TCPIP_HTTP_NET_CONN_HANDLE connHandle);
+        static TCPIP_HTTP_NET_IO_RESULT HTTPPostConfig(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam);
         #if defined(TCPIP_STACK_USE_SNMP_SERVER)
-        static TCPIP_HTTP_NET_IO_RESULT HTTPPostSNMPCommunity(TCPIP_HTTP_NET_CONN_HANDLE connHandle);
+        static TCPIP_HTTP_NET_IO_RESULT HTTPPostSNMPCommunity(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam);
         #endif
     #endif
     #if (HTTP_APP_USE_EMAIL != 0) 
-        static TCPIP_HTTP_NET_IO_RESULT HTTPPostEmail(TCPIP_HTTP_NET_CONN_HANDLE connHandle);
+        static TCPIP_HTTP_NET_IO_RESULT HTTPPostEmail(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam);
     #endif
     #if defined(TCPIP_STACK_USE_DYNAMICDNS_CLIENT)
-        static TCPIP_HTTP_NET_IO_RESULT HTTPPostDDNSConfig(TCPIP_HTTP_NET_CONN_HANDLE connHandle);
+        static TCPIP_HTTP_NET_IO_RESULT HTTPPostDDNSConfig(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam);
     #endif
 #endif
 
+// the form handlers, registered with the HTTP router
+typedef struct
+{
+    const char*                     pattern;    // requested name
+    TCPIP_HTTP_NET_ROUTE_FLAGS      routeFlags; // method, virtual name
+    TCPIP_HTTP_NET_ROUTE_HANDLER    handler;    // form handler
+}HTTP_APP_ROUTE_ENTRY;
+
+static const HTTP_APP_ROUTE_ENTRY HTTP_APP_RouteTbl[] =
+{
+    {"forms.htm",           TCPIP_HTTP_NET_ROUTE_FLAG_GET,                                      HTTPGetForms},
+    {"cookies.htm",         TCPIP_HTTP_NET_ROUTE_FLAG_GET,                                      HTTPGetCookies},
+    {"leds.cgi",            TCPIP_HTTP_NET_ROUTE_FLAG_GET | TCPIP_HTTP_NET_ROUTE_FLAG_VIRTUAL,  HTTPGetLeds},
+#if defined(TCPIP_HTTP_NET_USE_POST)
+#if defined(SYS_OUT_ENABLE)
+    {"forms.htm",           TCPIP_HTTP_NET_ROUTE_FLAG_POST,                                     HTTPPostLCD},
+#endif
+#if !defined(HTTP_APP_USE_MD5)
+    {"upload.htm",          TCPIP_HTTP_NET_ROUTE_FLAG_POST,                                     HTTPPostMD5},
+#endif
+#if defined(HTTP_APP_USE_RECONFIG)
+    {"protect/config.htm",  TCPIP_HTTP_NET_ROUTE_FLAG_POST,                                     HTTPPostConfig},
+#if defined(TCPIP_STACK_USE_SNMP_SERVER)
+    {"snmp/snmpconfig.htm", TCPIP_HTTP_NET_ROUTE_FLAG_POST,                                     HTTPPostSNMPCommunity},
+#endif
+#endif
+#if (HTTP_APP_USE_EMAIL != 0) 
+    {"email/index.htm",     TCPIP_HTTP_NET_ROUTE_FLAG_POST,                                     HTTPPostEmail},
+#endif
+#if defined(TCPIP_STACK_USE_DYNAMICDNS_CLIENT)
+    {"dyndns/index.htm",    TCPIP_HTTP_NET_ROUTE_FLAG_POST,                                     HTTPPostDDNSConfig},
+#endif
+#endif  // defined(TCPIP_HTTP_NET_USE_POST)
+};
+
 extern const char *const ddnsServiceHosts[];
 // RAM allocated for DDNS parameters
 #if defined(TCPIP_STACK_USE_DYNAMICDNS_CLIENT)
@@ -239,79 +281,120 @@ bool TCPIP_HTTP_NET_SSINotification(TCPIP_HTTP_NET_CONN_HANDLE connHandle, TCPIP
  ****************************************************************************/
 TCPIP_HTTP_NET_IO_RESULT TCPIP_HTTP_NET_ConnectionGetExecute(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const TCPIP_HTTP_NET_USER_CALLBACK *pCBack)
 {
-    const uint8_t *ptr;
-    uint8_t *httpDataBuff;
-    uint8_t filename[20];
-
-    // Load the file name
-    // Make sure uint8_t filename[] above is large enough for your longest name
-    filename[0] = 0;
-    SYS_FS_FileNameGet(TCPIP_HTTP_NET_ConnectionFileGet(connHandle), filename, 20);
+    // the registered routes are dispatched by the server
+    // only a request that the router didn't resolve gets here
+    return HTTP_APP_RouteDispatch(connHandle, TCPIP_HTTP_NET_ROUTE_FLAG_GET);
+}
 
-    httpDataBuff = TCPIP_HTTP_NET_ConnectionDataBufferGet(connHandle);
+// processes the LED form on forms.htm
+static TCPIP_HTTP_NET_IO_RESULT HTTPGetForms(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam)
+{
+    const uint8_t *ptr;
+    uint8_t *httpDataBuff = TCPIP_HTTP_NET_ConnectionDataBufferGet(connHandle);
 
-    // If its the forms.htm page
-    if(!memcmp(filename, "forms.htm", 9))
+    // Seek out each of the four LED strings, and if it exists set the LED states
+    ptr = TCPIP_HTTP_NET_ArgGet(httpDataBuff, (const uint8_t *)"led2");
+    if(ptr)
     {
-        // Seek out each of the four LED strings, and if it exists set the LED states
-        ptr = TCPIP_HTTP_NET_ArgGet(httpDataBuff, (const uint8_t *)"led2");
-        if(ptr)
+        if(*ptr == '1')
         {
-            if(*ptr == '1')
-            {
-                APP_LED_2StateSet();
-            }
-            else
-            {
-                APP_LED_2StateClear();
-            }
+            APP_LED_2StateSet();
         }
+        else
+        {
+            APP_LED_2StateClear();
+        }
+    }
 
-        ptr = TCPIP_HTTP_NET_ArgGet(httpDataBuff, (const uint8_t *)"led1");
-        if(ptr)
-		{
-            if(*ptr == '1')
-            {
-                APP_LED_1StateSet();
-            }
-            else
-            {
-                APP_LED_1StateClear();
-            }
+    ptr = TCPIP_HTTP_NET_ArgGet(httpDataBuff, (const uint8_t *)"led1");
+    if(ptr)
+    {
+        if(*ptr == '1')
+        {
+            APP_LED_1StateSet();
+        }
+        else
+        {
+            APP_LED_1StateClear();
         }
     }
 
-    else if(!memcmp(filename, "cookies.htm", 11))
+    return TCPIP_HTTP_NET_IO_RES_DONE;
+}
+
+// stores the cookies.htm arguments as cookies
+static TCPIP_HTTP_NET_IO_RESULT HTTPGetCookies(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam)
+{
+    // This is very simple.  The names and values we want are already in
+    // the data array.  We just set the hasArgs value to indicate how many
+    // name/value pairs we want stored as cookies.
+    // To add the second cookie, just increment this value.
+    // remember to also add a dynamic variable callback to control the printout.
+    TCPIP_HTTP_NET_ConnectionHasArgsSet(connHandle, 0x01);
+    return TCPIP_HTTP_NET_IO_RES_DONE;
+}
+
+// the LED updater: leds.cgi?led=n toggles a LED
+// a virtual route: the page ignores the response, so no file is served
+static TCPIP_HTTP_NET_IO_RESULT HTTPGetLeds(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam)
+{
+    // Determine which LED to toggle
+    const uint8_t *ptr = TCPIP_HTTP_NET_ArgGet(TCPIP_HTTP_NET_ConnectionDataBufferGet(connHandle), (const uint8_t *)"led");
+
+    // Toggle the specified LED
+    if(ptr)
     {
-        // This is very simple.  The names and values we want are already in
-        // the data array.  We just set the hasArgs value to indicate how many
-        // name/value pairs we want stored as cookies.
-        // To add the second cookie, just increment this value.
-        // remember to also add a dynamic variable callback to control the printout.
-        TCPIP_HTTP_NET_ConnectionHasArgsSet(connHandle, 0x01);
+        switch(*ptr)
+        {
+            case '0':
+                APP_LED_1StateToggle();
+                break;
+            case '1':
+                APP_LED_2StateToggle();
+                break;
+            case '2':
+                APP_LED_3StateToggle();
+                break;
+        }
     }
 
-    // If it's the LED updater file
-    else if(!memcmp(filename, "leds.cgi", 8))
+    return TCPIP_HTTP_NET_IO_RES_DONE;
+}
+
+bool HTTP_APP_RoutesRegister(TCPIP_HTTP_NET_USER_HANDLE httpH)
+{
+    int ix;
+    const HTTP_APP_ROUTE_ENTRY* pEntry = HTTP_APP_RouteTbl;
+
+    for(ix = 0; ix < sizeof(HTTP_APP_RouteTbl)/sizeof(*HTTP_APP_RouteTbl); ix++, pEntry++)
     {
-        // Determine which LED to toggle
-        ptr = TCPIP_HTTP_NET_ArgGet(httpDataBuff, (const uint8_t *)"led");
+        if(!TCPIP_HTTP_NET_RouteRegister(httpH, pEntry->pattern, pEntry->routeFlags, pEntry->handler, 0))
+        {   // the remaining names are dispatched by HTTP_APP_RouteDispatch
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// dispatches a request that the server router didn't resolve:
+// the router is not enabled or out of room
+static TCPIP_HTTP_NET_IO_RESULT HTTP_APP_RouteDispatch(TCPIP_HTTP_NET_CONN_HANDLE connHandle, TCPIP_HTTP_NET_ROUTE_FLAGS method)
+{
+    int ix;
+    const HTTP_APP_ROUTE_ENTRY* pEntry = HTTP_APP_RouteTbl;
+    uint8_t filename[20];
+
+    // Load the file name
+    // Make sure uint8_t filename[] above is large enough for your longest name
+    filename[0] = 0;
+    SYS_FS_FileNameGet(TCPIP_HTTP_NET_ConnectionFileGet(connHandle), filename, sizeof(filename));
 
-        // Toggle the specified LED
-        if(ptr)
+    for(ix = 0; ix < sizeof(HTTP_APP_RouteTbl)/sizeof(*HTTP_APP_RouteTbl); ix++, pEntry++)
+    {
+        if((pEntry->routeFlags & method) != 0 && strcmp((char *)filename, pEntry->pattern) == 0)
         {
-            switch(*ptr)
-            {
-                case '0':
-                    APP_LED_1StateToggle();
-                    break;
-                case '1':
-                    APP_LED_2StateToggle();
-                    break;
-                case '2':
-                    APP_LED_3StateToggle();
-                    break;
-            }
+            return (*pEntry->handler)(connHandle, 0);
         }
     }
 
@@ -333,49 +416,14 @@ TCPIP_HTTP_NET_IO_RESULT TCPIP_HTTP_NET_ConnectionGetExecute(TCPIP_HTTP_NET_CONN
  ****************************************************************************/
 TCPIP_HTTP_NET_IO_RESULT TCPIP_HTTP_NET_ConnectionPostExecute(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const TCPIP_HTTP_NET_USER_CALLBACK *pCBack)
 {
-    // Resolve which function to use and pass along
-    uint8_t filename[20];
-
-    // Load the file name
-    // Make sure uint8_t filename[] above is large enough for your longest name
-    filename[0] = 0;
-    SYS_FS_FileNameGet(TCPIP_HTTP_NET_ConnectionFileGet(connHandle), filename, sizeof(filename));
-
-#if defined(SYS_OUT_ENABLE)
-    if(!memcmp(filename, "forms.htm", 9))
-        return HTTPPostLCD(connHandle);
-#endif
-
-#if !defined(HTTP_APP_USE_MD5)
-    if(!memcmp(filename, "upload.htm", 10))
-        return HTTPPostMD5(connHandle);
-#endif
-
-#if defined(HTTP_APP_USE_RECONFIG)
-    if(!memcmp(filename, "protect/config.htm", 18))
-        return HTTPPostConfig(connHandle);
-    #if defined(TCPIP_STACK_USE_SNMP_SERVER)
-    else if(!memcmp(filename, "snmp/snmpconfig.htm", 19))
-        return HTTPPostSNMPCommunity(connHandle);
-    #endif
-#endif
-
-#if (HTTP_APP_USE_EMAIL != 0) 
-    if(!strcmp((char *)filename, "email/index.htm"))
-        return HTTPPostEmail(connHandle);
-#endif
-
-#if defined(TCPIP_STACK_USE_DYNAMICDNS_CLIENT)
-    if(!strcmp((char *)filename, "dyndns/index.htm"))
-        return HTTPPostDDNSConfig(connHandle);
-#endif
-
-    return TCPIP_HTTP_NET_IO_RES_DONE;
+    // the registered routes are dispatched by the server
+    // only a request that the router didn't resolve gets here
+    return HTTP_APP_RouteDispatch(connHandle, TCPIP_HTTP_NET_ROUTE_FLAG_POST);
 }
 
 /*****************************************************************************
   Function:
-    static TCPIP_HTTP_NET_IO_RESULT HTTPPostLCD(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+    static TCPIP_HTTP_NET_IO_RESULT HTTPPostLCD(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam)
 
   Summary:
     Processes the LCD form on forms.htm
@@ -384,91 +432,81 @@ TCPIP_HTTP_NET_IO_RESULT TCPIP_HTTP_NET_ConnectionPostExecute(TCPIP_HTTP_NET_CON
     Locates the 'lcd' parameter and uses it to update the text displayed
     on the board's LCD display.
 
-    This function has four states.  The first reads a name from the data
-    string returned as part of the POST request.  If a name cannot
-    be found, it returns, asking for more data.  Otherwise, if the name
-    is expected, it reads the associated value and writes it to the LCD.
-    If the name is not expected, the value is discarded and the next name
-    parameter is read.
-
-    In the case where the expected string is never found, this function
-    will eventually return TCPIP_HTTP_NET_IO_RES_NEED_DATA when no data is left.  In that
-    case, the HTTP server will automatically trap the error and issue an
-    Internal Server Error to the browser.
+    The POST data is parsed by TCPIP_HTTP_NET_ConnectionFormParse as it
+    arrives.  The 'lcd' value fragments are collected in the connection
+    data buffer by HTTPPostLCDField; all the other fields are ignored.
+    When all the data has been parsed the browser is redirected to forms.htm.
 
   Precondition:
     None
 
   Parameters:
     connHandle  - HTTP connection handle
+    routeParam  - route parameter; not used
 
   Return Values:
-    TCPIP_HTTP_NET_IO_RES_DONE - the parameter has been found and saved
-    TCPIP_HTTP_NET_IO_RES_WAITING - the function is pausing to continue later
+    TCPIP_HTTP_NET_IO_RES_DONE - all the POST data has been parsed
     TCPIP_HTTP_NET_IO_RES_NEED_DATA - data needed by this function has not yet arrived
+    TCPIP_HTTP_NET_IO_RES_ERROR - the POST data could not be parsed
  ****************************************************************************/
 #if defined(SYS_OUT_ENABLE)
-static TCPIP_HTTP_NET_IO_RESULT HTTPPostLCD(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+static TCPIP_HTTP_NET_IO_RESULT HTTPPostLCD(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam)
 {
-    uint8_t *cDest;
-    uint8_t *httpDataBuff;
-    uint16_t httpBuffSize;
+    TCPIP_HTTP_NET_IO_RESULT ioRes;
 
-#define SM_POST_LCD_READ_NAME       (0u)
-#define SM_POST_LCD_READ_VALUE      (1u)
+    ioRes = TCPIP_HTTP_NET_ConnectionFormParse(connHandle, HTTPPostLCDField, 0);
 
-    httpDataBuff = TCPIP_HTTP_NET_ConnectionDataBufferGet(connHandle);
-    httpBuffSize = TCPIP_HTTP_NET_ConnectionDataBufferSizeGet(connHandle);
-    switch(TCPIP_HTTP_NET_ConnectionPostSmGet(connHandle))
+    if(ioRes == TCPIP_HTTP_NET_IO_RES_DONE)
     {
-        // Find the name
-        case SM_POST_LCD_READ_NAME:
-
-            // Read a name
-            if(TCPIP_HTTP_NET_ConnectionPostNameRead(connHandle, httpDataBuff, httpBuffSize) == TCPIP_HTTP_NET_READ_INCOMPLETE)
-                return TCPIP_HTTP_NET_IO_RES_NEED_DATA;
+        strcpy((char *)TCPIP_HTTP_NET_ConnectionDataBufferGet(connHandle), "/forms.htm");
+        TCPIP_HTTP_NET_ConnectionStatusSet(connHandle, TCPIP_HTTP_NET_STAT_REDIRECT);
+    }
 
-            TCPIP_HTTP_NET_ConnectionPostSmSet(connHandle, SM_POST_LCD_READ_VALUE);
-            // No break...continue reading value
+    return ioRes;
+}
 
-        // Found the value, so store the LCD and return
-        case SM_POST_LCD_READ_VALUE:
+// form callback for HTTPPostLCD
+// collects the 'lcd' value in the connection data buffer and displays it
+static bool HTTPPostLCDField(TCPIP_HTTP_NET_CONN_HANDLE connHandle, TCPIP_HTTP_NET_FORM_EVENT event,
+                             const TCPIP_HTTP_NET_FORM_FIELD* pField, const uint8_t* data, uint16_t dataLen, const void* param)
+{
+    uint8_t *httpDataBuff;
+    uint16_t httpBuffSize;
+    uint32_t valueLen;
 
-            // If value is expected, read it to data buffer,
-            // otherwise ignore it (by reading to NULL)
-            if(!strcmp((char *)httpDataBuff, (const char *)"lcd"))
-                cDest = httpDataBuff;
-            else
-                cDest = NULL;
+    if(strcmp(pField->name, "lcd") != 0)
+    {   // not interested
+        return true;
+    }
 
-            // Read a value string
-            if(TCPIP_HTTP_NET_ConnectionPostValueRead(connHandle, cDest, httpBuffSize) == TCPIP_HTTP_NET_READ_INCOMPLETE)
-                return TCPIP_HTTP_NET_IO_RES_NEED_DATA;
+    httpDataBuff = TCPIP_HTTP_NET_ConnectionDataBufferGet(connHandle);
+    httpBuffSize = TCPIP_HTTP_NET_ConnectionDataBufferSizeGet(connHandle);
 
-            // If this was an unexpected value, look for a new name
-            if(!cDest)
+    if(event == TCPIP_HTTP_NET_FORM_EVENT_VALUE)
+    {   // longer values are truncated
+        if(pField->valueOffset < httpBuffSize - 1)
+        {
+            if(dataLen > httpBuffSize - 1 - pField->valueOffset)
             {
-                TCPIP_HTTP_NET_ConnectionPostSmSet(connHandle, SM_POST_LCD_READ_NAME);
-                break;
+                dataLen = httpBuffSize - 1 - pField->valueOffset;
             }
-
-            SYS_OUT_MESSAGE((char *)cDest);
-
-            // This is the only expected value, so callback is done
-            strcpy((char *)httpDataBuff, "/forms.htm");
-            TCPIP_HTTP_NET_ConnectionStatusSet(connHandle, TCPIP_HTTP_NET_STAT_REDIRECT);
-            return TCPIP_HTTP_NET_IO_RES_DONE;
+            memcpy(httpDataBuff + pField->valueOffset, data, dataLen);
+        }
+    }
+    else if(event == TCPIP_HTTP_NET_FORM_EVENT_END)
+    {
+        valueLen = pField->valueOffset < httpBuffSize - 1 ? pField->valueOffset : httpBuffSize - 1;
+        httpDataBuff[valueLen] = 0;
+        SYS_OUT_MESSAGE((char *)httpDataBuff);
     }
 
-    // Default assumes that we're returning for state machine convenience.
-    // Function will be called again later.
-    return TCPIP_HTTP_NET_IO_RES_WAITING;
+    return true;
 }
 #endif
 
 /*****************************************************************************
   Function:
-    static TCPIP_HTTP_NET_IO_RESULT HTTPPostMD5(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+    static TCPIP_HTTP_NET_IO_RESULT HTTPPostMD5(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam)
 
   Summary:
     Processes the file upload form on upload.htm
@@ -496,6 +534,7 @@ static TCPIP_HTTP_NET_IO_RESULT HTTPPostLCD(TCPIP_HTTP_NET_CONN_HANDLE connHandl
 
   Parameters:
     connHandle  - HTTP connection handle
+    routeParam  - route parameter; not used
 
   Return Values:
     TCPIP_HTTP_NET_IO_RES_DONE - all parameters have been processed
@@ -503,7 +542,7 @@ static TCPIP_HTTP_NET_IO_RESULT HTTPPostLCD(TCPIP_HTTP_NET_CONN_HANDLE connHandl
     TCPIP_HTTP_NET_IO_RES_NEED_DATA - data needed by this function has not yet arrived
  ****************************************************************************/
 #if !defined(HTTP_APP_USE_MD5)
-static TCPIP_HTTP_NET_IO_RESULT HTTPPostMD5(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+static TCPIP_HTTP_NET_IO_RESULT HTTPPostMD5(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam)
 {
    // static CRYPT_MD5_CTX md5;
     uint8_t *httpDataBuff;
@@ -610,7 +649,7 @@ static TCPIP_HTTP_NET_IO_RESULT HTTPPostMD5(TCPIP_HTTP_NET_CONN_HANDLE connHandl
 
 /*****************************************************************************
   Function:
-    static TCPIP_HTTP_NET_IO_RESULT HTTPPostConfig(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+    static TCPIP_HTTP_NET_IO_RESULT HTTPPostConfig(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam)
 
   Summary:
     Processes the configuration form on config/index.htm
@@ -640,6 +679,7 @@ static TCPIP_HTTP_NET_IO_RESULT HTTPPostMD5(TCPIP_HTTP_NET_CONN_HANDLE connHandl
 
   Parameters:
     connHandle  - HTTP connection handle
+    routeParam  - route parameter; not used
 
   Return Values:
     TCPIP_HTTP_NET_IO_RES_DONE - all parameters have been processed
@@ -662,7 +702,7 @@ static struct
     TCPIP_NETWORK_CONFIG    netConfig;  // configuration in the interface requested format
 }httpNetData;
 
-static TCPIP_HTTP_NET_IO_RESULT HTTPPostConfig(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+static TCPIP_HTTP_NET_IO_RESULT HTTPPostConfig(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam)
 {
     bool bConfigFailure = false;
     uint8_t i;
@@ -828,7 +868,7 @@ static TCPIP_HTTP_NET_IO_RESULT HTTPPostConfig(TCPIP_HTTP_NET_CONN_HANDLE connHa
 }
 
 #if defined(TCPIP_STACK_USE_SNMP_SERVER)
-static TCPIP_HTTP_NET_IO_RESULT HTTPPostSNMPCommunity(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+static TCPIP_HTTP_NET_IO_RESULT HTTPPostSNMPCommunity(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam)
 {
     uint8_t len = 0;
     uint8_t vCommunityIndex;
@@ -903,7 +943,7 @@ static TCPIP_HTTP_NET_IO_RESULT HTTPPostSNMPCommunity(TCPIP_HTTP_NET_CONN_HANDLE
 
 /*****************************************************************************
   Function:
-    static TCPIP_HTTP_NET_IO_RESULT HTTPPostEmail(void)
+    static TCPIP_HTTP_NET_IO_RESULT HTTPPostEmail(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam)
 
   Summary:
     Processes the e-mail form on email/index.htm
@@ -921,6 +961,7 @@ static TCPIP_HTTP_NET_IO_RESULT HTTPPostSNMPCommunity(TCPIP_HTTP_NET_CONN_HANDLE
 
   Parameters:
     connHandle  - HTTP connection handle
+    routeParam  - route parameter; not used
 
   Return Values:
     TCPIP_HTTP_NET_IO_RES_DONE - the message has been sent
@@ -975,7 +1016,7 @@ static void postMailCallback(TCPIP_SMTPC_MESSAGE_HANDLE messageHandle, const TCP
     }
 }
 
-static TCPIP_HTTP_NET_IO_RESULT HTTPPostEmail(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+static TCPIP_HTTP_NET_IO_RESULT HTTPPostEmail(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam)
 {
 
     TCPIP_SMTPC_MAIL_MESSAGE mySMTPMessage;
@@ -1150,7 +1191,7 @@ static TCPIP_HTTP_NET_IO_RESULT HTTPPostEmail(TCPIP_HTTP_NET_CONN_HANDLE connHan
 
 /****************************************************************************
   Function:
-    TCPIP_HTTP_NET_IO_RESULT HTTPPostDDNSConfig(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+    TCPIP_HTTP_NET_IO_RESULT HTTPPostDDNSConfig(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam)
 
   Summary:
     Parsing and collecting http data received from http form
@@ -1169,6 +1210,7 @@ static TCPIP_HTTP_NET_IO_RESULT HTTPPostEmail(TCPIP_HTTP_NET_CONN_HANDLE connHan
 
   Parameters:
     connHandle  - HTTP connection handle
+    routeParam  - route parameter; not used
 
   Return Values:
     TCPIP_HTTP_NET_IO_RES_DONE      -  Finished with procedure
@@ -1177,7 +1219,7 @@ static TCPIP_HTTP_NET_IO_RESULT HTTPPostEmail(TCPIP_HTTP_NET_CONN_HANDLE connHan
                                         call again later
  ****************************************************************************/
 #if defined(TCPIP_STACK_USE_DYNAMICDNS_CLIENT)
-static TCPIP_HTTP_NET_IO_RESULT HTTPPostDDNSConfig(TCPIP_HTTP_NET_CONN_HANDLE connHandle)
+static TCPIP_HTTP_NET_IO_RESULT HTTPPostDDNSConfig(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam)
 {
     static uint8_t *ptrDDNS;
     uint8_t *httpDataBuff;
@@ -1447,6 +1489,7 @@ TCPIP_HTTP_DYN_PRINT_RES TCPIP_HTTP_Print_btn(TCPIP_HTTP_NET_CONN_HANDLE connHan
 
         // Print the output
         TCPIP_HTTP_NET_DynamicWriteString(vDcpt, (nBtn ? "up" : "dn"), false);
+        TCPIP_HTTP_NET_DynamicCacheable(vDcpt);
     }
     return TCPIP_HTTP_DYN_PRINT_RES_DONE;
 }
@@ -1479,6 +1522,7 @@ TCPIP_HTTP_DYN_PRINT_RES TCPIP_HTTP_Print_led(TCPIP_HTTP_NET_CONN_HANDLE connHan
         const char *ledMsg = nLed ? "1": "0";
 
         TCPIP_HTTP_NET_DynamicWriteString(vDcpt, ledMsg, false);
+        TCPIP_HTTP_NET_DynamicCacheable(vDcpt);
     }
 
     return TCPIP_HTTP_DYN_PRINT_RES_DONE;
@@ -1533,6 +1577,7 @@ TCPIP_HTTP_DYN_PRINT_RES TCPIP_HTTP_Print_pot(TCPIP_HTTP_NET_CONN_HANDLE connHan
     RandVal = (uint16_t)SYS_RANDOM_PseudoGet();
     nChars = sprintf(pDynBuffer->data, "%d", RandVal);
     TCPIP_HTTP_NET_DynamicWrite(vDcpt, pDynBuffer->data, nChars, true);
+    TCPIP_HTTP_NET_DynamicCacheable(vDcpt);
     return TCPIP_HTTP_DYN_PRINT_RES_DONE;
 }
 
@@ -1550,6 +1595,7 @@ TCPIP_HTTP_DYN_PRINT_RES TCPIP_HTTP_Print_bmps(TCPIP_HTTP_NET_CONN_HANDLE connHa
     RandVal = (uint16_t)SYS_RANDOM_PseudoGet();
     nChars = sprintf(pDynBuffer->data, "%d", RandVal);
     TCPIP_HTTP_NET_DynamicWrite(vDcpt, pDynBuffer->data, nChars, true);
+    TCPIP_HTTP_NET_DynamicCacheable(vDcpt);
     return TCPIP_HTTP_DYN_PRINT_RES_DONE;
 }
 
@@ -2071,4 +2117,57 @@ TCPIP_HTTP_DYN_PRINT_RES TCPIP_HTTP_Print_write_comm(TCPIP_HTTP_NET_CONN_HANDLE
     return TCPIP_HTTP_DYN_PRINT_RES_DONE;
 }
 
+void HTTP_APP_EventsTask(void)
+{
+    static char lastBtns[4] = "";
+    char btns[4];
+    char evData[12];
+
+    btns[0] = (char)APP_SWITCH_1StateGet() + '0';
+    btns[1] = (char)APP_SWITCH_2StateGet() + '0';
+    btns[2] = (char)APP_SWITCH_3StateGet() + '0';
+    btns[3] = 0;
+
+    if(strcmp(btns, lastBtns) != 0)
+    {   // send only the changes
+        strcpy(lastBtns, btns);
+        sprintf(evData, "%c,%c,%c", btns[0], btns[1], btns[2]);
+        TCPIP_HTTP_NET_EventPublish("status.evt", "btn", evData);
+    }
+}
+
+void HTTP_APP_LedsWebSocket(TCPIP_HTTP_NET_CONN_HANDLE connHandle, TCPIP_HTTP_NET_WS_EVENT wsEvent, const uint8_t* data, uint16_t dataLen)
+{
+    char leds[6];
+
+    if(wsEvent == TCPIP_HTTP_NET_WS_EVENT_TEXT && dataLen != 0)
+    {
+        switch(*data)
+        {
+            case '0':
+                APP_LED_1StateToggle();
+                break;
+            case '1':
+                APP_LED_2StateToggle();
+                break;
+            case '2':
+                APP_LED_3StateToggle();
+                break;
+        }
+    }
+    else if(wsEvent != TCPIP_HTTP_NET_WS_EVENT_OPEN)
+    {
+        return;
+    }
+
+    // report the current state
+    leds[0] = (char)APP_LED_1StateGet() + '0';
+    leds[1] = ',';
+    leds[2] = (char)APP_LED_2StateGet() + '0';
+    leds[3] = ',';
+    leds[4] = (char)APP_LED_3StateGet() + '0';
+    leds[5] = 0;
+    TCPIP_HTTP_NET_WebSocketSend(connHandle, true, leds, 5);
+}
+
 #endif // #if defined(TCPIP_STACK_USE_HTTP_SERVER)
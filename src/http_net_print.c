@@ -91,20 +91,33 @@ static HTTP_APP_DYNVAR_ENTRY HTTP_APP_DynVarTbl[] =
 {"bmps",					TCPIP_HTTP_Print_bmps},
 };
 
+// names of the HTTP_APP_DynVarTbl[] variables, registered with the HTTP module
+// the HTTP module resolves each dynamic variable to its index in this table
+static const char *HTTP_APP_DynVarNames[sizeof(HTTP_APP_DynVarTbl)/sizeof(*HTTP_APP_DynVarTbl)];
+
 // Function that processes the dynamic variables
 // It uses the HTTP_APP_DynVarTbl[] for detecting which variable is currently processed
 // and what function should be launched.
 //
-// Note: Again, this is just an example.
-// Processing a large number of dynamic variables using this approach is highly inneficient
-// and should be avoided.
-// Better methods should be emplyed rather than linearly polling each variable name until the required name was found.
+// The variable ID resolved by the HTTP module from the registered HTTP_APP_DynVarNames[]
+// is used to directly index the table.
+// A linear search is done only if the names registration failed.
 //
 TCPIP_HTTP_DYN_PRINT_RES TCPIP_HTTP_NET_DynPrint(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const TCPIP_HTTP_DYN_VAR_DCPT *vDcpt, const TCPIP_HTTP_NET_USER_CALLBACK *pCBack)
 {
     int ix;
     HTTP_APP_DYNVAR_ENTRY *pEntry;
 
+    if(vDcpt->varId < sizeof(HTTP_APP_DynVarTbl)/sizeof(*HTTP_APP_DynVarTbl))
+    {   // resolved by the HTTP module
+        return (*HTTP_APP_DynVarTbl[vDcpt->varId].varFnc)(connHandle, vDcpt);
+    }
+
+    if(HTTP_APP_DynVarNames[0] != 0)
+    {   // names registered; not one of ours
+        return TCPIP_HTTP_DYN_PRINT_RES_DONE;
+    }
+
     // search for a dynamic variable name
     pEntry = HTTP_APP_DynVarTbl;
     for(ix = 0; ix < sizeof(HTTP_APP_DynVarTbl)/sizeof(*HTTP_APP_DynVarTbl); ++ix, ++pEntry)
@@ -179,6 +192,43 @@ void HTTP_APP_Initialize(void)
     if(httpH == 0)
     {
         SYS_CONSOLE_MESSAGE("APP: Failed to register the HTTP callback! \r\n");
+        return;
+    }
+
+    // register the dynamic variable names for a direct dispatch
+    for(ix = 0; ix < sizeof(HTTP_APP_DynVarTbl)/sizeof(*HTTP_APP_DynVarTbl); ++ix)
+    {
+        HTTP_APP_DynVarNames[ix] = HTTP_APP_DynVarTbl[ix].varName;
+    }
+
+    if(!TCPIP_HTTP_NET_DynVarNamesRegister(httpH, HTTP_APP_DynVarNames, sizeof(HTTP_APP_DynVarNames)/sizeof(*HTTP_APP_DynVarNames)))
+    {
+        HTTP_APP_DynVarNames[0] = 0;
+        SYS_CONSOLE_MESSAGE("APP: Failed to register the HTTP dynamic variables! \r\n");
+    }
+
+    // status.xml is polled by every open page: share its output between the polls
+    if(!TCPIP_HTTP_NET_SnapshotFileRegister(httpH, "status.xml", 0))
+    {
+        SYS_CONSOLE_MESSAGE("APP: Failed to register the HTTP snapshot file! \r\n");
+    }
+
+    // button changes are pushed to the clients that request status.evt
+    if(!TCPIP_HTTP_NET_EventChannelRegister(httpH, "status.evt"))
+    {
+        SYS_CONSOLE_MESSAGE("APP: Failed to register the HTTP event channel! \r\n");
+    }
+
+    // the LEDs can be toggled over a WebSocket, without a leds.cgi request per toggle
+    if(!TCPIP_HTTP_NET_WebSocketRegister(httpH, "leds.ws", HTTP_APP_LedsWebSocket))
+    {
+        SYS_CONSOLE_MESSAGE("APP: Failed to register the HTTP WebSocket endpoint! \r\n");
+    }
+
+    // the form handlers are resolved by the server when the request is parsed
+    if(!HTTP_APP_RoutesRegister(httpH))
+    {
+        SYS_CONSOLE_MESSAGE("APP: Failed to register the HTTP routes! \r\n");
     }
 }
 
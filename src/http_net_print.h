@@ -194,6 +194,19 @@ typedef struct HTTP_APP_DYNVAR_BUFFER
 ****************************************************************************/
 void HTTP_APP_Initialize(void);
 
+// publishes the button changes on the status.evt event channel
+// called periodically by the application
+void HTTP_APP_EventsTask(void);
+
+// leds.ws WebSocket handler: a text message "0", "1" or "2" toggles that LED
+// the LED states are sent back as "l1,l2,l3"
+void HTTP_APP_LedsWebSocket(TCPIP_HTTP_NET_CONN_HANDLE connHandle, TCPIP_HTTP_NET_WS_EVENT wsEvent, const uint8_t* data, uint16_t dataLen);
+
+// registers the GET/POST form handlers with the HTTP router
+// returns false if not all handlers could be registered;
+// the rest are dispatched from the getExecute/postExecute callbacks
+bool HTTP_APP_RoutesRegister(TCPIP_HTTP_NET_USER_HANDLE httpH);
+
 // helper to get one of the application's dynamic buffer that are used in the
 // dynamic variables processing
 HTTP_APP_DYNVAR_BUFFER *HTTP_APP_GetDynamicBuffer(void);
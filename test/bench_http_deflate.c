@@ -0,0 +1,199 @@
+/*******************************************************************************
+  HTTP NET deflate host benchmark
+
+  Summary:
+    Compression ratio versus CPU cost of the dynamic response compressor
+
+  Description:
+    Compresses the pages of the demo web site (src/web_pages) with the
+    HTTP compressor, fed in pieces the size of the dynamic output,
+    and with zlib at levels 1 and 6 for reference.
+    Reports, for each page and overall, the compressed size
+    as a percentage of the original and the compression speed.
+*******************************************************************************/
+
+#include "http_net.c"
+
+#include <stdlib.h>
+#include <time.h>
+#include <zlib.h>
+#include "host_stubs.h"
+
+#define BENCH_PAGES_DIR     "../src/web_pages/"
+#define BENCH_FEED_SIZE     64          // bytes per compressor call, like the dynamic variables output
+#define BENCH_OUT_SIZE      TCPIP_HTTP_NET_CHUNK_COALESCE_SIZE
+#define BENCH_MIN_TIME      0.2         // seconds per measurement
+
+static const char* const benchPages[] =
+{
+    "index.htm",
+    "dynvars.htm",
+    "forms.htm",
+    "protect/config.htm",
+    "dyndns/index.htm",
+    "status.xml",
+    "mchp.css",
+    "mchp.js",
+};
+
+#define BENCH_PAGES_NO      (sizeof(benchPages) / sizeof(*benchPages))
+
+typedef size_t (*BENCH_COMPRESS_FNC)(const uint8_t* data, size_t dataLen, uint8_t* outBuff, size_t outSize);
+
+static double benchTimeSec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint8_t* benchFileRead(const char* name, size_t* pLen)
+{
+    char path[100];
+    long fLen;
+    uint8_t* data = 0;
+    FILE* fp;
+
+    snprintf(path, sizeof(path), BENCH_PAGES_DIR "%s", name);
+    if((fp = fopen(path, "rb")) == 0)
+    {
+        return 0;
+    }
+
+    if(fseek(fp, 0, SEEK_END) == 0 && (fLen = ftell(fp)) > 0 && fseek(fp, 0, SEEK_SET) == 0)
+    {
+        data = malloc(fLen);
+        if(fread(data, 1, fLen, fp) != (size_t)fLen)
+        {
+            free(data);
+            data = 0;
+        }
+        *pLen = fLen;
+    }
+
+    fclose(fp);
+    return data;
+}
+
+// the HTTP compressor, as used for a connection: small input pieces, a coalescing buffer for the output
+static size_t benchHttpCompress(const uint8_t* data, size_t dataLen, uint8_t* outBuff, size_t outSize)
+{
+    static TCPIP_HTTP_DEFLATE_DCPT deflDcpt;
+    size_t inPos, outPos, feedLen;
+    uint16_t outLen;
+
+    memset(&deflDcpt, 0, sizeof(deflDcpt));
+    deflDcpt.adlerA = 1;
+    inPos = outPos = 0;
+    while(inPos < dataLen)
+    {
+        feedLen = dataLen - inPos < BENCH_FEED_SIZE ? dataLen - inPos : BENCH_FEED_SIZE;
+        inPos += _HTTP_DeflateCompress(&deflDcpt, data + inPos, feedLen, outBuff + outPos, BENCH_OUT_SIZE, &outLen);
+        outPos += outLen;
+    }
+    outPos += _HTTP_DeflateFinish(&deflDcpt, outBuff + outPos);
+
+    return outPos;
+}
+
+static size_t benchZlibCompress(const uint8_t* data, size_t dataLen, uint8_t* outBuff, size_t outSize, int level)
+{
+    uLongf outLen = outSize;
+
+    return compress2(outBuff, &outLen, data, dataLen, level) == Z_OK ? outLen : 0;
+}
+
+static size_t benchZlib1Compress(const uint8_t* data, size_t dataLen, uint8_t* outBuff, size_t outSize)
+{
+    return benchZlibCompress(data, dataLen, outBuff, outSize, 1);
+}
+
+static size_t benchZlib6Compress(const uint8_t* data, size_t dataLen, uint8_t* outBuff, size_t outSize)
+{
+    return benchZlibCompress(data, dataLen, outBuff, outSize, 6);
+}
+
+// returns the compression speed in MB/s; *pOutLen is the compressed size
+static double benchMeasure(BENCH_COMPRESS_FNC compressFnc, const uint8_t* data, size_t dataLen, uint8_t* outBuff, size_t outSize, size_t* pOutLen)
+{
+    int nRuns = 0;
+    double startTime, runTime;
+
+    startTime = benchTimeSec();
+    do
+    {
+        *pOutLen = (*compressFnc)(data, dataLen, outBuff, outSize);
+        nRuns++;
+    }while((runTime = benchTimeSec() - startTime) < BENCH_MIN_TIME);
+
+    return (double)dataLen * nRuns / runTime / 1e6;
+}
+
+// checks that the HTTP compressor output inflates to the original data
+static bool benchVerify(const uint8_t* data, size_t dataLen, const uint8_t* compData, size_t compLen)
+{
+    bool res;
+    uLongf plainLen = dataLen;
+    uint8_t* plainBuff = malloc(dataLen);
+
+    res = uncompress(plainBuff, &plainLen, compData, compLen) == Z_OK && plainLen == dataLen && memcmp(plainBuff, data, dataLen) == 0;
+    free(plainBuff);
+    return res;
+}
+
+int main(void)
+{
+    static const BENCH_COMPRESS_FNC compressFncs[] = {benchHttpCompress, benchZlib1Compress, benchZlib6Compress};
+    size_t pageIx, fncIx, dataLen, outSize, compLen;
+    size_t totIn = 0, totOut[3] = {0};
+    double totTime[3] = {0}, speed;
+    uint8_t *data, *outBuff;
+    int failures = 0;
+
+    printf("bench_http_deflate: window %d bytes, fed %d bytes at a time\n", TCPIP_HTTP_NET_DEFLATE_WINDOW, BENCH_FEED_SIZE);
+    printf("%-20s %8s %16s %16s %16s\n", "page", "bytes", "http %  MB/s", "zlib-1 %  MB/s", "zlib-6 %  MB/s");
+
+    for(pageIx = 0; pageIx < BENCH_PAGES_NO; pageIx++)
+    {
+        if((data = benchFileRead(benchPages[pageIx], &dataLen)) == 0)
+        {
+            printf("bench_http_deflate: cannot read %s\n", benchPages[pageIx]);
+            failures++;
+            continue;
+        }
+        outSize = dataLen * 2 + BENCH_OUT_SIZE + 64;
+        outBuff = malloc(outSize);
+
+        printf("%-20s %8zu", benchPages[pageIx], dataLen);
+        for(fncIx = 0; fncIx < sizeof(compressFncs) / sizeof(*compressFncs); fncIx++)
+        {
+            speed = benchMeasure(compressFncs[fncIx], data, dataLen, outBuff, outSize, &compLen);
+            if(fncIx == 0 && !benchVerify(data, dataLen, outBuff, compLen))
+            {
+                printf("\nbench_http_deflate: %s does not inflate to the original\n", benchPages[pageIx]);
+                failures++;
+            }
+            printf(" %7.1f %8.1f", 100.0 * compLen / dataLen, speed);
+            totOut[fncIx] += compLen;
+            totTime[fncIx] += dataLen / speed;
+        }
+        printf("\n");
+        totIn += dataLen;
+
+        free(outBuff);
+        free(data);
+    }
+
+    if(totIn != 0)
+    {
+        printf("%-20s %8zu", "total", totIn);
+        for(fncIx = 0; fncIx < sizeof(compressFncs) / sizeof(*compressFncs); fncIx++)
+        {
+            printf(" %7.1f %8.1f", 100.0 * totOut[fncIx] / totIn, totIn / totTime[fncIx]);
+        }
+        printf("\n");
+    }
+
+    return failures != 0;
+}
@@ -0,0 +1,204 @@
+/*******************************************************************************
+  HTTP NET request parsing host benchmark
+
+  Summary:
+    Requests per second for typical browser requests
+
+  Description:
+    Runs the HTTP server on a fake socket and sends it a corpus of requests
+    with the headers of common browsers, on a persistent connection.
+    The requested file is small and served from the RAM file cache,
+    so the time is dominated by the request and header line parsing.
+    Each request is delivered:
+        - whole, as it would arrive in one TCP segment
+        - in small pieces, with the server running between them,
+          as it would arrive over a slow link
+*******************************************************************************/
+
+#include "http_net.c"
+
+#include <stdlib.h>
+#include <time.h>
+#include "host_stubs.h"
+
+#define BENCH_SKT           0
+#define BENCH_REQUESTS      20000       // requests per run
+#define BENCH_PIECE_SIZE    40          // bytes per piece, for the slow delivery
+
+static const char* const benchCorpus[] =
+{
+    // Chrome
+    "GET /style.css HTTP/1.1\r\n"
+    "Host: 192.168.1.100\r\n"
+    "Connection: keep-alive\r\n"
+    "sec-ch-ua: \"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\", \"Not-A.Brand\";v=\"99\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+    "sec-ch-ua-platform: \"Windows\"\r\n"
+    "Accept: text/css,*/*;q=0.1\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Dest: style\r\n"
+    "Referer: http://192.168.1.100/index.htm\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Accept-Language: en-US,en;q=0.9,de;q=0.8\r\n"
+    "\r\n",
+
+    // Firefox
+    "GET /style.css HTTP/1.1\r\n"
+    "Host: 192.168.1.100\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:125.0) Gecko/20100101 Firefox/125.0\r\n"
+    "Accept: text/css,*/*;q=0.1\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Connection: keep-alive\r\n"
+    "Referer: http://192.168.1.100/index.htm\r\n"
+    "Sec-Fetch-Dest: style\r\n"
+    "Sec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Pragma: no-cache\r\n"
+    "Cache-Control: no-cache\r\n"
+    "\r\n",
+
+    // Safari
+    "GET /style.css HTTP/1.1\r\n"
+    "Host: 192.168.1.100\r\n"
+    "Accept: text/css,*/*;q=0.1\r\n"
+    "Accept-Language: en-GB,en;q=0.9\r\n"
+    "Connection: keep-alive\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/17.4.1 Safari/605.1.15\r\n"
+    "Referer: http://192.168.1.100/index.htm\r\n"
+    "\r\n",
+
+    // curl
+    "GET /style.css HTTP/1.1\r\n"
+    "Host: 192.168.1.100\r\n"
+    "User-Agent: curl/8.5.0\r\n"
+    "Accept: */*\r\n"
+    "\r\n",
+};
+
+#define BENCH_CORPUS_SIZE   (sizeof(benchCorpus) / sizeof(*benchCorpus))
+
+static uint8_t benchFileAuthenticate(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const char* cFile, const TCPIP_HTTP_NET_USER_CALLBACK* pCBack)
+{
+    return 0x80;
+}
+
+static const TCPIP_HTTP_NET_USER_CALLBACK benchUserCback =
+{
+    .fileAuthenticate = benchFileAuthenticate,
+};
+
+static double benchTimeSec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// runs the server until the request is answered
+// returns false if no complete response
+static bool benchResponseWait(void)
+{
+    int loops;
+    size_t txLen;
+    const uint8_t* tx;
+    HOST_HTTP_RESP resp;
+
+    for(loops = 0; loops < 10; loops++)
+    {
+        host_Run(1);
+        tx = host_SktTx(BENCH_SKT, &txLen);
+        if(host_RespParse(tx, txLen, &resp))
+        {
+            host_RespFree(&resp);
+            host_SktTxClear(BENCH_SKT);
+            return resp.status == 200;
+        }
+    }
+
+    return false;
+}
+
+// sends BENCH_REQUESTS requests from the corpus
+// pieceSize == 0 sends each request whole
+// returns the number of requests answered
+static int benchRun(size_t pieceSize, size_t* pReqBytes)
+{
+    int ix;
+    size_t reqLen, pos;
+    const char* request;
+
+    *pReqBytes = 0;
+    for(ix = 0; ix < BENCH_REQUESTS; ix++)
+    {
+        request = benchCorpus[ix % BENCH_CORPUS_SIZE];
+        reqLen = strlen(request);
+        if(pieceSize == 0)
+        {
+            host_SktPush(BENCH_SKT, request, reqLen);
+        }
+        else
+        {
+            for(pos = 0; pos + pieceSize < reqLen; pos += pieceSize)
+            {
+                host_SktPush(BENCH_SKT, request + pos, pieceSize);
+                host_Run(1);
+            }
+            host_SktPush(BENCH_SKT, request + pos, reqLen - pos);
+        }
+
+        if(!benchResponseWait())
+        {
+            break;
+        }
+        *pReqBytes += reqLen;
+    }
+
+    return ix;
+}
+
+static void benchReport(const char* name, size_t pieceSize)
+{
+    int nReqs;
+    size_t reqBytes;
+    double startTime, runTime;
+
+    startTime = benchTimeSec();
+    nReqs = benchRun(pieceSize, &reqBytes);
+    runTime = benchTimeSec() - startTime;
+
+    if(nReqs != BENCH_REQUESTS)
+    {
+        printf("bench_http_parse: %s: request %d failed\n", name, nReqs);
+        hostFailures++;
+        return;
+    }
+
+    printf("bench_http_parse: %-8s %d requests, %.0f requests/s, %.1f MB/s of request headers\n",
+            name, nReqs, nReqs / runTime, reqBytes / runTime / 1e6);
+}
+
+int main(void)
+{
+    static char cssData[] = "body{font-family:sans-serif}\n";
+
+    if(!host_HttpStart(0))
+    {
+        printf("HTTP initialization failed\n");
+        return 1;
+    }
+    if(TCPIP_HTTP_NET_UserHandlerRegister(&benchUserCback) == 0 || !host_FileAdd("style.css", cssData, sizeof(cssData) - 1, 0x5a21, 0x6000))
+    {
+        printf("bench_http_parse: setup failed\n");
+        return 1;
+    }
+
+    benchReport("whole", 0);
+    benchReport("pieces", BENCH_PIECE_SIZE);
+
+    return hostFailures != 0;
+}
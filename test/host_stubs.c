@@ -0,0 +1,1067 @@
+/*******************************************************************************
+  HTTP NET host test support
+
+  Summary:
+    Host replacements for the stack services used by the HTTP server
+
+  Description:
+    See host_stubs.h
+*******************************************************************************/
+
+#define _GNU_SOURCE     // memmem
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+
+#include "configuration.h"
+#include "tcpip/src/tcpip_private.h"
+#include "system/fs/sys_fs_media_manager.h"
+#include "tcpip/src/common/sys_fs_shell.h"
+#include "net_pres/pres/net_pres_socketapi.h"
+
+#include "host_stubs.h"
+
+// fake socket
+typedef struct
+{
+    bool                isOpen;
+    bool                resetPending;   // WasReset() reports a reset
+    uint16_t            rxSize;         // RX window
+    uint16_t            txSize;         // TX buffer
+    uint16_t            txPending;      // written and not acknowledged
+    int                 disconnects;    // Disconnect() calls
+    size_t              rxCopied;       // bytes copied out by Peek() and Read()
+    size_t              wireLen;        // data sent by the client
+    size_t              txLen;          // captured response data
+    NET_PRES_SIGNAL_FUNCTION sigHandler;
+    uint16_t            sigMask;
+    const void*         sigParam;
+    uint8_t             wire[HOST_SKT_WIRE_SIZE];
+    uint8_t             txCapture[HOST_SKT_TX_CAPTURE + 1];
+}HOST_SKT;
+
+// RAM file
+typedef struct
+{
+    const char*         name;
+    const uint8_t*      data;
+    size_t              len;
+    uint16_t            fdate;
+    uint16_t            ftime;
+}HOST_FILE;
+
+// open RAM file
+typedef struct
+{
+    const HOST_FILE*    pFile;
+    size_t              pos;
+    bool                inUse;
+}HOST_FILE_HANDLE;
+
+int hostChecks = 0;
+int hostFailures = 0;
+
+static HOST_SKT         hostSkts[HOST_SOCKETS];
+static int              hostSktNo = 0;
+
+static HOST_FILE        hostFiles[HOST_FILES];
+static HOST_FILE_HANDLE hostFileHandles[HOST_FILES * 4];
+static bool             hostFileMapped = true;
+static int              hostFileOpens = 0;
+static int              hostFileReads = 0;
+static int              hostFileStats = 0;
+
+static uint32_t         hostTimeMs = 1;
+static TCPIP_MODULE_SIGNAL hostModSignals = 0;
+static bool             hostMediaBusy = false;
+
+// heap object over the C library
+// each block starts with its size, for the heap accounting
+typedef union
+{
+    size_t      nBytes;
+    max_align_t align;
+}HOST_HEAP_HDR;
+
+static size_t           hostHeapUsed = 0;
+static size_t           hostHeapLimit = 0;
+
+static void* _HostMalloc(TCPIP_STACK_HEAP_HANDLE heapH, size_t nBytes)
+{
+    HOST_HEAP_HDR* pHdr;
+
+    if(hostHeapLimit != 0 && hostHeapUsed + nBytes > hostHeapLimit)
+    {
+        return 0;
+    }
+    if((pHdr = (HOST_HEAP_HDR*)malloc(sizeof(*pHdr) + nBytes)) == 0)
+    {
+        return 0;
+    }
+    pHdr->nBytes = nBytes;
+    hostHeapUsed += nBytes;
+    return pHdr + 1;
+}
+
+static void* _HostCalloc(TCPIP_STACK_HEAP_HANDLE heapH, size_t nElems, size_t elemSize)
+{
+    void* pBuff = _HostMalloc(heapH, nElems * elemSize);
+
+    if(pBuff != 0)
+    {
+        memset(pBuff, 0, nElems * elemSize);
+    }
+    return pBuff;
+}
+
+static size_t _HostFree(TCPIP_STACK_HEAP_HANDLE heapH, const void* pBuff)
+{
+    HOST_HEAP_HDR* pHdr;
+
+    if(pBuff == 0)
+    {
+        return 0;
+    }
+    pHdr = (HOST_HEAP_HDR*)pBuff - 1;
+    hostHeapUsed -= pHdr->nBytes;
+    free(pHdr);
+    return 0;
+}
+
+static size_t _HostHeapSize(TCPIP_STACK_HEAP_HANDLE heapH)
+{
+    return 1024 * 1024;
+}
+
+static TCPIP_STACK_HEAP_RES _HostHeapLastError(TCPIP_STACK_HEAP_HANDLE heapH)
+{
+    return TCPIP_STACK_HEAP_RES_OK;
+}
+
+static const TCPIP_HEAP_OBJECT hostHeap =
+{
+    .TCPIP_HEAP_Malloc = _HostMalloc,
+    .TCPIP_HEAP_Calloc = _HostCalloc,
+    .TCPIP_HEAP_Free = _HostFree,
+    .TCPIP_HEAP_Size = _HostHeapSize,
+    .TCPIP_HEAP_MaxSize = _HostHeapSize,
+    .TCPIP_HEAP_FreeSize = _HostHeapSize,
+    .TCPIP_HEAP_HighWatermark = _HostHeapSize,
+    .TCPIP_HEAP_LastError = _HostHeapLastError,
+};
+
+void host_Check(bool res, const char* cond, const char* file, int line)
+{
+    hostChecks++;
+    if(!res)
+    {
+        hostFailures++;
+        printf("%s:%d: check failed: %s\n", file, line, cond);
+    }
+}
+
+int host_Result(const char* testName)
+{
+    printf("%s: %d checks, %d failed\n", testName, hostChecks, hostFailures);
+    return hostFailures == 0 ? 0 : 1;
+}
+
+bool host_HttpStart(int nConns)
+{
+    static TCPIP_STACK_MODULE_CTRL stackCtrl;
+    static TCPIP_HTTP_NET_MODULE_CONFIG httpConfig =
+    {
+        .nConnections   = TCPIP_HTTP_NET_MAX_CONNECTIONS,
+        .dataLen        = TCPIP_HTTP_NET_MAX_DATA_LEN,
+        .sktTxBuffSize  = TCPIP_HTTP_NET_SKT_TX_BUFF_SIZE,
+        .sktRxBuffSize  = TCPIP_HTTP_NET_SKT_RX_BUFF_SIZE,
+        .listenPort     = TCPIP_HTTP_NET_LISTEN_PORT,
+        .nDescriptors   = TCPIP_HTTP_NET_DYNVAR_DESCRIPTORS_NUMBER,
+        .nChunks        = TCPIP_HTTP_NET_CHUNKS_NUMBER,
+        .maxRecurseLevel= TCPIP_HTTP_NET_MAX_RECURSE_LEVEL,
+        .configFlags    = TCPIP_HTTP_NET_CONFIG_FLAGS,
+        .nFileBuffers   = TCPIP_HTTP_NET_FILE_PROCESS_BUFFERS_NUMBER,
+        .fileBufferSize = TCPIP_HTTP_NET_FILE_PROCESS_BUFFER_SIZE,
+        .chunkPoolRetries = TCPIP_HTTP_NET_CHUNK_RETRIES,
+        .fileBufferRetries = TCPIP_HTTP_NET_FILE_PROCESS_BUFFER_RETRIES,
+        .dynVarRetries  = TCPIP_HTTP_NET_DYNVAR_PROCESS_RETRIES,
+        .connTimeout    = TCPIP_HTTP_NET_CONNECTION_TIMEOUT,
+        .http_malloc_fnc = malloc,
+        .http_free_fnc  = free,
+        .web_dir        = TCPIP_HTTP_NET_WEB_DIR,
+    };
+
+    if(nConns > HOST_SOCKETS)
+    {
+        return false;
+    }
+    httpConfig.nConnections = nConns != 0 ? nConns : TCPIP_HTTP_NET_MAX_CONNECTIONS;
+
+    stackCtrl.memH = &hostHeap;
+    stackCtrl.stackAction = TCPIP_STACK_ACTION_INIT;
+    return TCPIP_HTTP_NET_Initialize(&stackCtrl, &httpConfig);
+}
+
+void host_HttpStop(void)
+{
+    static TCPIP_STACK_MODULE_CTRL stackCtrl;
+
+    stackCtrl.memH = &hostHeap;
+    stackCtrl.stackAction = TCPIP_STACK_ACTION_DEINIT;
+    TCPIP_HTTP_NET_Deinitialize(&stackCtrl);
+    hostSktNo = 0;
+}
+
+size_t host_HeapUsed(void)
+{
+    return hostHeapUsed;
+}
+
+void host_HeapLimitSet(size_t limit)
+{
+    hostHeapLimit = limit;
+}
+
+// delivers the socket signals and the module timeout
+void host_Run(int nLoops)
+{
+    int ix;
+    HOST_SKT* pSkt;
+
+    while(nLoops-- > 0)
+    {
+        for(ix = 0, pSkt = hostSkts; ix < hostSktNo; ix++, pSkt++)
+        {
+            if(pSkt->txPending != 0)
+            {   // the client acknowledged the data
+                pSkt->txPending = 0;
+                if(pSkt->sigHandler != 0 && (pSkt->sigMask & TCPIP_TCP_SIGNAL_TX_SPACE) != 0)
+                {
+                    (*pSkt->sigHandler)(ix, 0, TCPIP_TCP_SIGNAL_TX_SPACE, pSkt->sigParam);
+                }
+            }
+        }
+
+        hostModSignals |= TCPIP_MODULE_SIGNAL_TMO;
+        TCPIP_HTTP_NET_Task();
+        hostTimeMs += TCPIP_HTTP_NET_TASK_RATE;
+    }
+}
+
+void host_TimeAdvance(uint32_t ms)
+{
+    hostTimeMs += ms;
+}
+
+uint32_t host_TimeMs(void)
+{
+    return hostTimeMs;
+}
+
+static HOST_SKT* _HostSktGet(NET_PRES_SKT_HANDLE_T handle)
+{
+    if(handle >= 0 && handle < hostSktNo && hostSkts[handle].isOpen)
+    {
+        return hostSkts + handle;
+    }
+    return 0;
+}
+
+void host_SktPush(int skt, const void* data, size_t len)
+{
+    HOST_SKT* pSkt = hostSkts + skt;
+
+    if(pSkt->wireLen + len > sizeof(pSkt->wire))
+    {
+        printf("host_SktPush: wire overflow\n");
+        exit(2);
+    }
+    memcpy(pSkt->wire + pSkt->wireLen, data, len);
+    pSkt->wireLen += len;
+
+    if(pSkt->sigHandler != 0 && (pSkt->sigMask & TCPIP_TCP_SIGNAL_RX_DATA) != 0)
+    {
+        (*pSkt->sigHandler)(skt, 0, TCPIP_TCP_SIGNAL_RX_DATA, pSkt->sigParam);
+    }
+}
+
+void host_SktAccept(int skt)
+{
+    HOST_SKT* pSkt = hostSkts + skt;
+
+    if(pSkt->sigHandler != 0 && (pSkt->sigMask & TCPIP_TCP_SIGNAL_ESTABLISHED) != 0)
+    {
+        (*pSkt->sigHandler)(skt, 0, TCPIP_TCP_SIGNAL_ESTABLISHED, pSkt->sigParam);
+    }
+}
+
+void host_SktPushStr(int skt, const char* str)
+{
+    host_SktPush(skt, str, strlen(str));
+}
+
+const uint8_t* host_SktTx(int skt, size_t* pLen)
+{
+    HOST_SKT* pSkt = hostSkts + skt;
+
+    pSkt->txCapture[pSkt->txLen] = 0;
+    if(pLen)
+    {
+        *pLen = pSkt->txLen;
+    }
+    return pSkt->txCapture;
+}
+
+void host_SktTxClear(int skt)
+{
+    hostSkts[skt].txLen = 0;
+}
+
+void host_SktTxSpaceSet(int skt, uint16_t txSize)
+{
+    hostSkts[skt].txSize = txSize;
+}
+
+size_t host_SktRxPending(int skt)
+{
+    return hostSkts[skt].wireLen;
+}
+
+size_t host_SktRxCopied(int skt)
+{
+    return hostSkts[skt].rxCopied;
+}
+
+int host_SktDisconnects(int skt)
+{
+    return hostSkts[skt].disconnects;
+}
+
+void host_SktRemoteClose(int skt)
+{
+    HOST_SKT* pSkt = hostSkts + skt;
+
+    pSkt->resetPending = true;
+    pSkt->wireLen = 0;
+    if(pSkt->sigHandler != 0 && (pSkt->sigMask & TCPIP_TCP_SIGNAL_RX_RST) != 0)
+    {
+        (*pSkt->sigHandler)(skt, 0, TCPIP_TCP_SIGNAL_RX_RST, pSkt->sigParam);
+    }
+}
+
+bool host_RespParse(const uint8_t* data, size_t len, HOST_HTTP_RESP* pResp)
+{
+    const char* pEnd;
+    const char* hdrVal;
+    size_t hdrLen, pos, chunkLen;
+    char* pNext;
+
+    memset(pResp, 0, sizeof(*pResp));
+    pEnd = memmem(data, len, "\r\n\r\n", 4);
+    if(pEnd == 0 || sscanf((const char*)data, "HTTP/1.1 %d", &pResp->status) != 1)
+    {
+        return false;
+    }
+
+    hdrLen = pEnd - (const char*)data + 4;
+    memcpy(pResp->headers, data, hdrLen < sizeof(pResp->headers) ? hdrLen : sizeof(pResp->headers) - 1);
+    pResp->body = (uint8_t*)calloc(1, len + 1);
+    pos = hdrLen;
+
+    if((hdrVal = host_RespHeader(pResp, "Transfer-Encoding")) != 0 && strncmp(hdrVal, "chunked", 7) == 0)
+    {
+        while(true)
+        {
+            chunkLen = strtoul((const char*)data + pos, &pNext, 16);
+            if(pNext == (const char*)data + pos || (pEnd = memmem(pNext, len - (pNext - (const char*)data), "\r\n", 2)) == 0)
+            {
+                host_RespFree(pResp);
+                return false;
+            }
+            pos = pEnd - (const char*)data + 2;
+            if(pos + chunkLen + 2 > len)
+            {
+                host_RespFree(pResp);
+                return false;
+            }
+            memcpy(pResp->body + pResp->bodyLen, data + pos, chunkLen);
+            pResp->bodyLen += chunkLen;
+            pos += chunkLen + 2;
+            if(chunkLen == 0)
+            {
+                break;
+            }
+        }
+    }
+    else if((hdrVal = host_RespHeader(pResp, "Content-Length")) != 0)
+    {
+        chunkLen = strtoul(hdrVal, 0, 10);
+        if(pos + chunkLen > len)
+        {
+            host_RespFree(pResp);
+            return false;
+        }
+        memcpy(pResp->body, data + pos, chunkLen);
+        pResp->bodyLen = chunkLen;
+        pos += chunkLen;
+    }
+    else if(pResp->status >= 200 && pResp->status != 204 && pResp->status != 304)
+    {   // up to the connection close
+        memcpy(pResp->body, data + pos, len - pos);
+        pResp->bodyLen = len - pos;
+        pos = len;
+    }
+
+    pResp->respLen = pos;
+    return true;
+}
+
+void host_RespFree(HOST_HTTP_RESP* pResp)
+{
+    free(pResp->body);
+    pResp->body = 0;
+}
+
+const char* host_RespHeader(const HOST_HTTP_RESP* pResp, const char* name)
+{
+    static char value[256];
+    const char* pLine;
+    size_t nameLen = strlen(name);
+
+    for(pLine = strstr(pResp->headers, "\r\n"); pLine != 0; pLine = strstr(pLine, "\r\n"))
+    {
+        pLine += 2;
+        if(strncasecmp(pLine, name, nameLen) == 0 && pLine[nameLen] == ':')
+        {
+            pLine += nameLen + 1;
+            pLine += strspn(pLine, " ");
+            snprintf(value, sizeof(value), "%.*s", (int)strcspn(pLine, "\r"), pLine);
+            return value;
+        }
+    }
+    return 0;
+}
+
+// NET_PRES socket API
+NET_PRES_SKT_HANDLE_T NET_PRES_SocketOpen(NET_PRES_INDEX index, NET_PRES_SKT_T socketType, NET_PRES_SKT_ADDR_T addrType, NET_PRES_SKT_PORT_T port, NET_PRES_ADDRESS * addr, NET_PRES_SKT_ERROR_T* error)
+{
+    HOST_SKT* pSkt;
+
+    if(hostSktNo == HOST_SOCKETS)
+    {
+        return NET_PRES_INVALID_SOCKET;
+    }
+
+    pSkt = hostSkts + hostSktNo;
+    memset(pSkt, 0, sizeof(*pSkt));
+    pSkt->isOpen = true;
+    pSkt->rxSize = TCPIP_TCP_SOCKET_DEFAULT_RX_SIZE;
+    pSkt->txSize = TCPIP_TCP_SOCKET_DEFAULT_TX_SIZE;
+    return hostSktNo++;
+}
+
+void NET_PRES_SocketClose(NET_PRES_SKT_HANDLE_T handle)
+{
+    HOST_SKT* pSkt = _HostSktGet(handle);
+    if(pSkt)
+    {
+        pSkt->isOpen = false;
+    }
+}
+
+bool NET_PRES_SocketOptionsSet(NET_PRES_SKT_HANDLE_T handle, NET_PRES_SKT_OPTION_TYPE option, void* optParam)
+{
+    HOST_SKT* pSkt = _HostSktGet(handle);
+
+    if(pSkt == 0)
+    {
+        return false;
+    }
+    if((int)option == TCP_OPTION_RX_BUFF)
+    {
+        pSkt->rxSize = (uint16_t)(uintptr_t)optParam;
+    }
+    else if((int)option == TCP_OPTION_TX_BUFF)
+    {
+        pSkt->txSize = (uint16_t)(uintptr_t)optParam;
+    }
+    return true;
+}
+
+bool NET_PRES_SocketOptionsGet(NET_PRES_SKT_HANDLE_T handle, NET_PRES_SKT_OPTION_TYPE option, void* optParam)
+{
+    HOST_SKT* pSkt = _HostSktGet(handle);
+
+    if(pSkt == 0)
+    {
+        return false;
+    }
+    if((int)option == TCP_OPTION_RX_BUFF)
+    {
+        *(uint16_t*)optParam = pSkt->rxSize;
+        return true;
+    }
+    if((int)option == TCP_OPTION_TX_BUFF)
+    {
+        *(uint16_t*)optParam = pSkt->txSize;
+        return true;
+    }
+    return false;
+}
+
+bool NET_PRES_SocketIsConnected(NET_PRES_SKT_HANDLE_T handle)
+{
+    HOST_SKT* pSkt = _HostSktGet(handle);
+    return pSkt != 0 && pSkt->wireLen != 0;
+}
+
+bool NET_PRES_SocketWasReset(NET_PRES_SKT_HANDLE_T handle)
+{
+    HOST_SKT* pSkt = _HostSktGet(handle);
+
+    if(pSkt != 0 && pSkt->resetPending)
+    {
+        pSkt->resetPending = false;
+        return true;
+    }
+    return false;
+}
+
+bool NET_PRES_SocketWasDisconnected(NET_PRES_SKT_HANDLE_T handle)
+{
+    return false;
+}
+
+// the server socket goes back to listen
+bool NET_PRES_SocketDisconnect(NET_PRES_SKT_HANDLE_T handle)
+{
+    HOST_SKT* pSkt = _HostSktGet(handle);
+
+    if(pSkt == 0)
+    {
+        return false;
+    }
+    pSkt->disconnects++;
+    pSkt->resetPending = true;
+    pSkt->txPending = 0;
+    return true;
+}
+
+bool NET_PRES_SocketInfoGet(NET_PRES_SKT_HANDLE_T handle, void * info)
+{
+    TCP_SOCKET_INFO* pInfo = (TCP_SOCKET_INFO*)info;
+    HOST_SKT* pSkt = _HostSktGet(handle);
+
+    if(pSkt == 0)
+    {
+        return false;
+    }
+    memset(pInfo, 0, sizeof(*pInfo));
+    pInfo->rxSize = pSkt->rxSize;
+    pInfo->txSize = pSkt->txSize;
+    pInfo->rxPending = pSkt->wireLen < pSkt->rxSize ? pSkt->wireLen : pSkt->rxSize;
+    pInfo->txPending = pSkt->txPending;
+    pInfo->localPort = TCPIP_HTTP_NET_LISTEN_PORT;
+    return true;
+}
+
+uint16_t NET_PRES_SocketWriteIsReady(NET_PRES_SKT_HANDLE_T handle, uint16_t reqSize, uint16_t minSize)
+{
+    uint16_t txSpace;
+    HOST_SKT* pSkt = _HostSktGet(handle);
+
+    if(pSkt == 0)
+    {
+        return 0;
+    }
+
+    txSpace = pSkt->txSize - pSkt->txPending;
+    if(txSpace >= reqSize || (minSize != 0 && txSpace >= minSize))
+    {
+        return txSpace;
+    }
+    return 0;
+}
+
+uint16_t NET_PRES_SocketWrite(NET_PRES_SKT_HANDLE_T handle, const void * buffer, uint16_t size)
+{
+    uint16_t txSpace;
+    HOST_SKT* pSkt = _HostSktGet(handle);
+
+    if(pSkt == 0)
+    {
+        return 0;
+    }
+
+    txSpace = pSkt->txSize - pSkt->txPending;
+    if(size > txSpace)
+    {
+        size = txSpace;
+    }
+    if(pSkt->txLen + size > HOST_SKT_TX_CAPTURE)
+    {   // keep the latest data
+        pSkt->txLen = 0;
+    }
+    memcpy(pSkt->txCapture + pSkt->txLen, buffer, size);
+    pSkt->txLen += size;
+    pSkt->txPending += size;
+    return size;
+}
+
+uint16_t NET_PRES_SocketFlush(NET_PRES_SKT_HANDLE_T handle)
+{
+    HOST_SKT* pSkt = _HostSktGet(handle);
+    return pSkt ? pSkt->txPending : 0;
+}
+
+uint16_t NET_PRES_SocketReadIsReady(NET_PRES_SKT_HANDLE_T handle)
+{
+    HOST_SKT* pSkt = _HostSktGet(handle);
+
+    if(pSkt == 0)
+    {
+        return 0;
+    }
+    return pSkt->wireLen < pSkt->rxSize ? pSkt->wireLen : pSkt->rxSize;
+}
+
+uint16_t NET_PRES_SocketPeek(NET_PRES_SKT_HANDLE_T handle, void * buffer, uint16_t size)
+{
+    uint16_t avlbl = NET_PRES_SocketReadIsReady(handle);
+
+    if(size > avlbl)
+    {
+        size = avlbl;
+    }
+    if(size != 0)
+    {
+        memcpy(buffer, hostSkts[handle].wire, size);
+        hostSkts[handle].rxCopied += size;
+    }
+    return size;
+}
+
+uint16_t NET_PRES_SocketRead(NET_PRES_SKT_HANDLE_T handle, void * buffer, uint16_t size)
+{
+    HOST_SKT* pSkt;
+    uint16_t avlbl = NET_PRES_SocketReadIsReady(handle);
+
+    if(size > avlbl)
+    {
+        size = avlbl;
+    }
+    if(size != 0)
+    {
+        pSkt = hostSkts + handle;
+        if(buffer != 0)
+        {
+            memcpy(buffer, pSkt->wire, size);
+            pSkt->rxCopied += size;
+        }
+        memmove(pSkt->wire, pSkt->wire + size, pSkt->wireLen - size);
+        pSkt->wireLen -= size;
+    }
+    return size;
+}
+
+uint16_t NET_PRES_SocketDiscard(NET_PRES_SKT_HANDLE_T handle)
+{
+    return NET_PRES_SocketRead(handle, 0, NET_PRES_SocketReadIsReady(handle));
+}
+
+NET_PRES_SIGNAL_HANDLE NET_PRES_SocketSignalHandlerRegister(NET_PRES_SKT_HANDLE_T handle, uint16_t sigMask, NET_PRES_SIGNAL_FUNCTION handler, const void* hParam)
+{
+    HOST_SKT* pSkt = _HostSktGet(handle);
+
+    if(pSkt == 0)
+    {
+        return 0;
+    }
+    pSkt->sigHandler = handler;
+    pSkt->sigMask = sigMask;
+    pSkt->sigParam = hParam;
+    return pSkt;
+}
+
+bool NET_PRES_SocketSignalHandlerDeregister(NET_PRES_SKT_HANDLE_T handle, NET_PRES_SIGNAL_HANDLE hSig)
+{
+    HOST_SKT* pSkt = _HostSktGet(handle);
+
+    if(pSkt == 0 || hSig != pSkt)
+    {
+        return false;
+    }
+    pSkt->sigHandler = 0;
+    return true;
+}
+
+NET_PRES_SKT_HANDLE_T NET_PRES_SocketGetTransportHandle(NET_PRES_SKT_HANDLE_T handle)
+{
+    return handle;
+}
+
+void TCPIP_TCP_Abort(TCP_SOCKET hTCP, bool killSocket)
+{
+    HOST_SKT* pSkt = _HostSktGet(hTCP);
+    if(pSkt)
+    {
+        pSkt->wireLen = 0;
+        pSkt->txPending = 0;
+    }
+}
+
+// RAM file system shell
+static const HOST_FILE* _HostFileFind(const char* fname)
+{
+    int ix;
+
+    while(*fname == '/' || (fname[0] == '.' && fname[1] == '/'))
+    {
+        fname += *fname == '/' ? 1 : 2;
+    }
+
+    for(ix = 0; ix < HOST_FILES; ix++)
+    {
+        if(hostFiles[ix].name != 0 && strcmp(hostFiles[ix].name, fname) == 0)
+        {
+            return hostFiles + ix;
+        }
+    }
+    return 0;
+}
+
+static HOST_FILE_HANDLE* _HostHandleGet(SYS_FS_HANDLE handle)
+{
+    uintptr_t ix = (uintptr_t)handle - 1;
+
+    if(ix < sizeof(hostFileHandles) / sizeof(*hostFileHandles) && hostFileHandles[ix].inUse)
+    {
+        return hostFileHandles + ix;
+    }
+    return 0;
+}
+
+bool host_FileAdd(const char* name, const void* data, size_t len, uint16_t fdate, uint16_t ftime)
+{
+    int ix;
+
+    for(ix = 0; ix < HOST_FILES; ix++)
+    {
+        if(hostFiles[ix].name == 0)
+        {
+            hostFiles[ix].name = name;
+            return host_FileUpdate(name, data, len, fdate, ftime);
+        }
+    }
+    return false;
+}
+
+bool host_FileUpdate(const char* name, const void* data, size_t len, uint16_t fdate, uint16_t ftime)
+{
+    HOST_FILE* pFile = (HOST_FILE*)_HostFileFind(name);
+
+    if(pFile == 0)
+    {
+        return false;
+    }
+    pFile->data = (const uint8_t*)data;
+    pFile->len = len;
+    pFile->fdate = fdate;
+    pFile->ftime = ftime;
+    return true;
+}
+
+void host_FileMappedSet(bool isMapped)
+{
+    hostFileMapped = isMapped;
+}
+
+int host_FileOpenCount(void)
+{
+    return hostFileOpens;
+}
+
+int host_FileReadBytes(void)
+{
+    return hostFileReads;
+}
+
+int host_FileStatCount(void)
+{
+    return hostFileStats;
+}
+
+static SYS_FS_HANDLE _HostFileOpen(const SYS_FS_SHELL_OBJ* pObj, const char *fname, SYS_FS_FILE_OPEN_ATTRIBUTES attributes)
+{
+    int ix;
+    const HOST_FILE* pFile = _HostFileFind(fname);
+
+    if(pFile == 0 || attributes != SYS_FS_FILE_OPEN_READ)
+    {
+        return SYS_FS_HANDLE_INVALID;
+    }
+
+    for(ix = 0; ix < sizeof(hostFileHandles) / sizeof(*hostFileHandles); ix++)
+    {
+        if(!hostFileHandles[ix].inUse)
+        {
+            hostFileHandles[ix].inUse = true;
+            hostFileHandles[ix].pFile = pFile;
+            hostFileHandles[ix].pos = 0;
+            hostFileOpens++;
+            return (SYS_FS_HANDLE)(uintptr_t)(ix + 1);
+        }
+    }
+    return SYS_FS_HANDLE_INVALID;
+}
+
+static SYS_FS_RESULT _HostFileStat(const SYS_FS_SHELL_OBJ* pObj, const char *fname, SYS_FS_FSTAT *buf)
+{
+    const HOST_FILE* pFile = _HostFileFind(fname);
+
+    hostFileStats++;
+    if(pFile == 0)
+    {
+        return SYS_FS_RES_FAILURE;
+    }
+    memset(buf, 0, sizeof(*buf));
+    buf->fsize = pFile->len;
+    buf->fdate = pFile->fdate;
+    buf->ftime = pFile->ftime;
+    strncpy(buf->fname, pFile->name, sizeof(buf->fname) - 1);
+    return SYS_FS_RES_SUCCESS;
+}
+
+static SYS_FS_RESULT _HostFileClose(const SYS_FS_SHELL_OBJ* pObj, SYS_FS_HANDLE handle)
+{
+    HOST_FILE_HANDLE* pHndl = _HostHandleGet(handle);
+
+    if(pHndl == 0)
+    {
+        return SYS_FS_RES_FAILURE;
+    }
+    pHndl->inUse = false;
+    return SYS_FS_RES_SUCCESS;
+}
+
+static int32_t _HostFileSize(const SYS_FS_SHELL_OBJ* pObj, SYS_FS_HANDLE handle)
+{
+    HOST_FILE_HANDLE* pHndl = _HostHandleGet(handle);
+    return pHndl ? (int32_t)pHndl->pFile->len : -1;
+}
+
+static int32_t _HostFileSeek(const SYS_FS_SHELL_OBJ* pObj, SYS_FS_HANDLE handle, int32_t offset, SYS_FS_FILE_SEEK_CONTROL whence)
+{
+    int32_t pos;
+    HOST_FILE_HANDLE* pHndl = _HostHandleGet(handle);
+
+    if(pHndl == 0)
+    {
+        return -1;
+    }
+
+    pos = whence == SYS_FS_SEEK_SET ? offset : whence == SYS_FS_SEEK_CUR ? (int32_t)pHndl->pos + offset : (int32_t)pHndl->pFile->len + offset;
+    if(pos < 0 || pos > (int32_t)pHndl->pFile->len)
+    {
+        return -1;
+    }
+    pHndl->pos = pos;
+    return pos;
+}
+
+static int32_t _HostFileTell(const SYS_FS_SHELL_OBJ* pObj, SYS_FS_HANDLE handle)
+{
+    HOST_FILE_HANDLE* pHndl = _HostHandleGet(handle);
+    return pHndl ? (int32_t)pHndl->pos : -1;
+}
+
+static bool _HostFileEof(const SYS_FS_SHELL_OBJ* pObj, SYS_FS_HANDLE handle)
+{
+    HOST_FILE_HANDLE* pHndl = _HostHandleGet(handle);
+    return pHndl == 0 || pHndl->pos >= pHndl->pFile->len;
+}
+
+static size_t _HostFileRead(const SYS_FS_SHELL_OBJ* pObj, SYS_FS_HANDLE handle, void *buf, size_t nbyte)
+{
+    HOST_FILE_HANDLE* pHndl = _HostHandleGet(handle);
+
+    if(pHndl == 0)
+    {
+        return (size_t)-1;
+    }
+    if(nbyte > pHndl->pFile->len - pHndl->pos)
+    {
+        nbyte = pHndl->pFile->len - pHndl->pos;
+    }
+    memcpy(buf, pHndl->pFile->data + pHndl->pos, nbyte);
+    pHndl->pos += nbyte;
+    hostFileReads += nbyte;
+    return nbyte;
+}
+
+static SYS_FS_RESULT _HostFileMappedAddress(const SYS_FS_SHELL_OBJ* pObj, SYS_FS_HANDLE handle, const void** ppAddress)
+{
+    HOST_FILE_HANDLE* pHndl = _HostHandleGet(handle);
+
+    if(pHndl == 0 || !hostFileMapped)
+    {
+        return SYS_FS_RES_FAILURE;
+    }
+    *ppAddress = pHndl->pFile->data;
+    return SYS_FS_RES_SUCCESS;
+}
+
+static SYS_FS_SHELL_RES _HostShellDelete(const SYS_FS_SHELL_OBJ* pObj)
+{
+    return SYS_FS_SHELL_RES_OK;
+}
+
+static const SYS_FS_SHELL_OBJ hostShell =
+{
+    .fileOpen = _HostFileOpen,
+    .fileStat = _HostFileStat,
+    .fileClose = _HostFileClose,
+    .fileSize = _HostFileSize,
+    .fileSeek = _HostFileSeek,
+    .fileTell = _HostFileTell,
+    .fileEof = _HostFileEof,
+    .fileRead = _HostFileRead,
+    .fileMappedAddress = _HostFileMappedAddress,
+    .delete = _HostShellDelete,
+};
+
+const SYS_FS_SHELL_OBJ* SYS_FS_Shell_Create(const char* rootDir, SYS_FS_SHELL_CREATE_FLAGS flags, void*(*malloc_func)(size_t), void(*free_fnc)(void*), SYS_FS_SHELL_RES* pRes)
+{
+    if(pRes)
+    {
+        *pRes = SYS_FS_SHELL_RES_OK;
+    }
+    return &hostShell;
+}
+
+// file system calls of the image upload
+// the media takes the commands and completes them when not busy
+SYS_FS_RESULT SYS_FS_Mount(const char *devName, const char *mountName, SYS_FS_FILE_SYSTEM_TYPE filesystemtype, unsigned long mountflags, const void *data)
+{
+    return SYS_FS_RES_FAILURE;
+}
+
+SYS_FS_RESULT SYS_FS_Unmount(const char *fname)
+{
+    return SYS_FS_RES_FAILURE;
+}
+
+void host_MediaBusySet(bool isBusy)
+{
+    hostMediaBusy = isBusy;
+}
+
+SYS_FS_MEDIA_COMMAND_STATUS SYS_FS_MEDIA_MANAGER_CommandStatusGet(uint16_t diskNum, SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE commandHandle)
+{
+    return hostMediaBusy ? SYS_FS_MEDIA_COMMAND_IN_PROGRESS : SYS_FS_MEDIA_COMMAND_COMPLETED;
+}
+
+SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE SYS_FS_MEDIA_MANAGER_SectorRead(uint16_t diskNum, uint8_t *dataBuffer, uint32_t sector, uint32_t numSectors)
+{
+    return SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID;
+}
+
+SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE SYS_FS_MEDIA_MANAGER_SectorWrite(uint16_t diskNum, uint32_t sector, uint8_t *dataBuffer, uint32_t numSectors)
+{
+    return (SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE)1;
+}
+
+// stack manager services
+tcpipSignalHandle _TCPIPStackSignalHandlerRegister(TCPIP_STACK_MODULE modId, tcpipModuleSignalHandler signalHandler, int16_t asyncTmoMs)
+{
+    return (tcpipSignalHandle)signalHandler;
+}
+
+void _TCPIPStackSignalHandlerDeregister(tcpipSignalHandle handle)
+{
+}
+
+TCPIP_MODULE_SIGNAL _TCPIPStackModuleSignalGet(TCPIP_STACK_MODULE modId, TCPIP_MODULE_SIGNAL clrMask)
+{
+    TCPIP_MODULE_SIGNAL sigPend = hostModSignals;
+    hostModSignals &= ~clrMask;
+    return sigPend;
+}
+
+bool _TCPIPStackModuleSignalRequest(TCPIP_STACK_MODULE modId, TCPIP_MODULE_SIGNAL signal, bool noMgrAlert)
+{
+    hostModSignals |= signal;
+    return true;
+}
+
+uint32_t _TCPIP_SecCountGet(void)
+{
+    return hostTimeMs / 1000;
+}
+
+// system services
+uint32_t SYS_TMR_TickCountGet(void)
+{
+    return hostTimeMs;
+}
+
+uint32_t SYS_TMR_TickCounterFrequencyGet(void)
+{
+    return 1000;
+}
+
+uint32_t SYS_TIME_CounterGet(void)
+{
+    return hostTimeMs * 1000;
+}
+
+uint32_t SYS_TIME_FrequencyGet(void)
+{
+    return 1000000;
+}
+
+uint32_t SYS_RANDOM_CryptoGet(void)
+{
+    static uint32_t seed = 0x2545f491;
+
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+bool SYS_INT_Disable(void)
+{
+    return true;
+}
+
+void SYS_INT_Restore(bool state)
+{
+}
+
+TCPIP_MAC_DATA_SEGMENT* TCPIP_PKT_DataSegmentGet(TCPIP_MAC_PACKET* pPkt, const uint8_t* dataAddress, bool srchTransport)
+{
+    return 0;
+}
+
+void SYS_CONSOLE_Print(const SYS_CONSOLE_HANDLE handle, const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+SYS_ERROR_LEVEL SYS_DEBUG_ErrorLevelGet(void)
+{
+    return SYS_ERROR_WARNING;
+}
+
+SYS_MODULE_INDEX SYS_DEBUG_ConsoleInstanceGet(void)
+{
+    return 0;
+}
@@ -0,0 +1,97 @@
+/*******************************************************************************
+  HTTP NET host test support
+
+  Summary:
+    Host replacements for the stack services used by the HTTP server
+
+  Description:
+    The HTTP server module (http_net.c) is built natively and linked with:
+        - a fake NET_PRES socket layer: RX data is pushed by the test,
+          TX data is captured and the TX space is settable
+        - a heap object over the C library malloc/calloc/free,
+          keeping count of the bytes in use
+        - a RAM file system shell serving the files added by the test
+        - the stack signal, timer and random services
+    A test program includes http_net.c, so the static functions are reachable.
+*******************************************************************************/
+
+#ifndef _HOST_STUBS_H_
+#define _HOST_STUBS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define HOST_SOCKETS            16          // fake sockets available
+#define HOST_SKT_WIRE_SIZE      (64 * 1024) // data queued by the client, not yet in the RX window
+#define HOST_SKT_TX_CAPTURE     (256 * 1024)// response data captured per socket
+#define HOST_FILES              16          // RAM files
+
+// test result accounting
+extern int hostChecks;
+extern int hostFailures;
+
+#define HOST_CHECK(cond)    host_Check((cond) != 0, #cond, __FILE__, __LINE__)
+void        host_Check(bool res, const char* cond, const char* file, int line);
+int         host_Result(const char* testName);
+
+// runs the HTTP module: initializes it with the default configuration
+// nConns == 0 selects TCPIP_HTTP_NET_MAX_CONNECTIONS
+bool        host_HttpStart(int nConns);
+// deinitializes the HTTP module; the sockets are reused by the next start
+void        host_HttpStop(void);
+
+// stack heap: the bytes currently allocated
+// a limit != 0 fails the allocations that would go past it
+size_t      host_HeapUsed(void);
+void        host_HeapLimitSet(size_t limit);
+
+// runs the HTTP task nLoops times, advancing the time by the task rate
+// the TX data written by the server is acknowledged between the loops
+void        host_Run(int nLoops);
+
+// advances the time without running the HTTP task
+void        host_TimeAdvance(uint32_t ms);
+uint32_t    host_TimeMs(void);
+
+// fake sockets; skt is the index of the socket, in the HTTP connection order
+void        host_SktAccept(int skt);                   // a client connected, no data yet
+void        host_SktPush(int skt, const void* data, size_t len);
+void        host_SktPushStr(int skt, const char* str);
+const uint8_t* host_SktTx(int skt, size_t* pLen);       // captured response data; 0 terminated
+void        host_SktTxClear(int skt);
+void        host_SktTxSpaceSet(int skt, uint16_t txSize);    // socket TX buffer size
+size_t      host_SktRxPending(int skt);                 // client data not read by the server
+int         host_SktDisconnects(int skt);              // server disconnect calls
+size_t      host_SktRxCopied(int skt);                 // bytes the server copied out of the RX data, peeked or read
+void        host_SktRemoteClose(int skt);              // client reset the connection
+
+// response sent by the server
+typedef struct
+{
+    int         status;         // status code
+    char        headers[1024];  // header lines, 0 terminated
+    uint8_t*    body;           // body, chunked coding removed; 0 terminated
+    size_t      bodyLen;
+    size_t      respLen;        // bytes of the response: a pipelined response starts here
+}HOST_HTTP_RESP;
+
+// parses the response at the start of data; the body is allocated
+// returns false if the response is not complete; nothing is allocated then
+bool        host_RespParse(const uint8_t* data, size_t len, HOST_HTTP_RESP* pResp);
+void        host_RespFree(HOST_HTTP_RESP* pResp);
+// returns the value of a response header, 0 if not present
+const char* host_RespHeader(const HOST_HTTP_RESP* pResp, const char* name);
+
+// RAM files; the data is not copied
+bool        host_FileAdd(const char* name, const void* data, size_t len, uint16_t fdate, uint16_t ftime);
+bool        host_FileUpdate(const char* name, const void* data, size_t len, uint16_t fdate, uint16_t ftime);
+void        host_FileMappedSet(bool isMapped);         // files are reported as memory mapped
+int         host_FileOpenCount(void);                   // fileOpen calls
+int         host_FileReadBytes(void);                   // bytes read with fileRead
+int         host_FileStatCount(void);                   // fileStat calls
+
+// image upload media
+void        host_MediaBusySet(bool isBusy);             // the sector writes stay in progress
+
+#endif  // _HOST_STUBS_H_
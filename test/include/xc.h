@@ -0,0 +1,4 @@
+// host build: the XC32 device header is not used
+#ifndef _HOST_XC_H_
+#define _HOST_XC_H_
+#endif
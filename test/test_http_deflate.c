@@ -0,0 +1,278 @@
+/*******************************************************************************
+  HTTP NET deflate host test
+
+  Summary:
+    Compression of the dynamic responses
+
+  Description:
+    Checks the compressor output against zlib:
+        - text, runs, random data and empty input are restored exactly,
+          whatever the input feed size and the room for the output
+    Runs the HTTP server on fake sockets and checks:
+        - a dynamic file is sent compressed when "deflate" is accepted
+          and the compressed body inflates to the plain response
+        - "deflate;q=0" or no Accept-Encoding gets the plain response
+        - a snapshot file polled by a client that accepts deflate
+          is served from its compressed snapshot, kept apart from the plain one
+*******************************************************************************/
+
+#include "http_net.c"
+
+#include <stdlib.h>
+#include <zlib.h>
+#include "host_stubs.h"
+
+#define DEFL_SKT        0
+#define DEFL_DATA_SIZE  20000
+
+static TCPIP_HTTP_NET_USER_HANDLE hHttp;
+
+static int deflRowNo;
+static int deflRenders;
+
+static uint8_t deflFileAuthenticate(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const char* cFile, const TCPIP_HTTP_NET_USER_CALLBACK* pCBack)
+{
+    return 0x80;
+}
+
+// ~row~: a table row, like the dynamic pages do; numbered from 0 for each request
+static TCPIP_HTTP_DYN_PRINT_RES deflDynamicPrint(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const TCPIP_HTTP_DYN_VAR_DCPT* varDcpt, const TCPIP_HTTP_NET_USER_CALLBACK* pCBack)
+{
+    static char rowBuff[80];
+
+    if(strcmp(varDcpt->dynName, "row") == 0)
+    {
+        sprintf(rowBuff, "<tr><td>%d</td><td>%d</td></tr>", deflRowNo, deflRowNo * 37 % 1000);
+        deflRowNo++;
+        TCPIP_HTTP_NET_DynamicWriteString(varDcpt, rowBuff, false);
+    }
+    else if(strcmp(varDcpt->dynName, "poll") == 0)
+    {   // shared by the clients: the number of renderings
+        sprintf(rowBuff, "<count>%d</count>", ++deflRenders);
+        TCPIP_HTTP_NET_DynamicCacheable(varDcpt);
+        TCPIP_HTTP_NET_DynamicWriteString(varDcpt, rowBuff, false);
+    }
+    return TCPIP_HTTP_DYN_PRINT_RES_DONE;
+}
+
+static const TCPIP_HTTP_NET_USER_CALLBACK deflUserCback =
+{
+    .fileAuthenticate = deflFileAuthenticate,
+    .dynamicPrint = deflDynamicPrint,
+};
+
+// compresses the data feeding feedSize bytes at a time
+// with outSize bytes of room for each output piece
+// returns the size of the zlib stream
+static size_t deflCompress(const uint8_t* data, size_t dataLen, size_t feedSize, uint16_t outSize, uint8_t* outBuff)
+{
+    size_t inPos, outPos, feedLen;
+    uint16_t outLen;
+    TCPIP_HTTP_DEFLATE_DCPT* pDcpt = calloc(1, sizeof(*pDcpt));
+
+    pDcpt->adlerA = 1;
+    inPos = outPos = 0;
+    while(inPos < dataLen)
+    {
+        feedLen = dataLen - inPos < feedSize ? dataLen - inPos : feedSize;
+        inPos += _HTTP_DeflateCompress(pDcpt, data + inPos, feedLen, outBuff + outPos, outSize, &outLen);
+        outPos += outLen;
+    }
+    outPos += _HTTP_DeflateFinish(pDcpt, outBuff + outPos);
+
+    free(pDcpt);
+    return outPos;
+}
+
+// compresses and inflates the data with zlib
+static bool deflRoundTrip(const uint8_t* data, size_t dataLen, size_t feedSize, uint16_t outSize)
+{
+    bool res;
+    size_t compLen;
+    uLongf plainLen = dataLen + 1;
+    uint8_t* compBuff = malloc(dataLen * 2 + 64);
+    uint8_t* plainBuff = malloc(dataLen + 1);
+
+    compLen = deflCompress(data, dataLen, feedSize, outSize, compBuff);
+    res = uncompress(plainBuff, &plainLen, compBuff, compLen) == Z_OK && plainLen == dataLen && memcmp(plainBuff, data, dataLen) == 0;
+
+    free(compBuff);
+    free(plainBuff);
+    return res;
+}
+
+static void testRoundTrip(void)
+{
+    size_t ix, feedIx, outIx;
+    uint8_t* textData = malloc(DEFL_DATA_SIZE);
+    uint8_t* runData = malloc(DEFL_DATA_SIZE);
+    uint8_t* randData = malloc(DEFL_DATA_SIZE);
+    static const size_t feedSizes[] = {1, 7, 100, 1500, DEFL_DATA_SIZE};
+    static const uint16_t outSizes[] = {16, 100, 1024};
+    static const char textPattern[] = "<tr><td class=\"name\">Temperature</td><td>%d C</td></tr>\n";
+
+    for(ix = 0; ix < DEFL_DATA_SIZE; )
+    {   // text with repeats near and beyond the window size
+        ix += snprintf((char*)textData + ix, DEFL_DATA_SIZE - ix, textPattern, (int)(ix * 7919 % 100));
+    }
+    for(ix = 0; ix < DEFL_DATA_SIZE; ix++)
+    {
+        runData[ix] = (ix / 500) & 1 ? 'a' : 'b';
+        randData[ix] = rand();
+    }
+
+    HOST_CHECK(deflRoundTrip(textData, 0, 1, 16));
+    for(feedIx = 0; feedIx < sizeof(feedSizes) / sizeof(*feedSizes); feedIx++)
+    {
+        for(outIx = 0; outIx < sizeof(outSizes) / sizeof(*outSizes); outIx++)
+        {
+            HOST_CHECK(deflRoundTrip(textData, DEFL_DATA_SIZE, feedSizes[feedIx], outSizes[outIx]));
+            HOST_CHECK(deflRoundTrip(runData, DEFL_DATA_SIZE, feedSizes[feedIx], outSizes[outIx]));
+            HOST_CHECK(deflRoundTrip(randData, DEFL_DATA_SIZE, feedSizes[feedIx], outSizes[outIx]));
+        }
+    }
+
+    free(textData);
+    free(runData);
+    free(randData);
+}
+
+// GETs a file with the extra headers; returns the status code, 0 if no complete response
+// the response is freed by the caller when a status is returned
+static int deflGet(const char* uri, const char* headers, HOST_HTTP_RESP* pResp)
+{
+    char request[200];
+    size_t txLen;
+    const uint8_t* tx;
+
+    host_SktTxClear(DEFL_SKT);
+    deflRowNo = 0;
+    sprintf(request, "GET %s HTTP/1.1\r\nHost: test\r\n%s\r\n", uri, headers);
+    host_SktPushStr(DEFL_SKT, request);
+    host_Run(40);
+
+    tx = host_SktTx(DEFL_SKT, &txLen);
+    if(!host_RespParse(tx, txLen, pResp))
+    {
+        return 0;
+    }
+    return pResp->status;
+}
+
+static void testResponse(void)
+{
+    static char pageData[4000];
+    size_t ix;
+    uLongf plainLen;
+    uint8_t* plainBuff;
+    uint32_t responses;
+    HOST_HTTP_RESP plainResp, deflResp, noResp;
+
+    strcpy(pageData, "<html><body><table>\n");
+    for(ix = 0; ix < 100; ix++)
+    {
+        strcat(pageData, "~row~\n");
+    }
+    strcat(pageData, "</table></body></html>\n");
+    HOST_CHECK(host_FileAdd("table.htm", pageData, strlen(pageData), 0x5a21, 0x6000));
+
+    HOST_CHECK(deflGet("/table.htm", "", &plainResp) == 200);
+    HOST_CHECK(host_RespHeader(&plainResp, "Content-Encoding") == 0);
+
+    responses = httpDeflateResponses;
+    HOST_CHECK(deflGet("/table.htm", "Accept-Encoding: gzip, deflate\r\n", &deflResp) == 200);
+    HOST_CHECK(host_RespHeader(&deflResp, "Content-Encoding") != 0 && strcmp(host_RespHeader(&deflResp, "Content-Encoding"), "deflate") == 0);
+    HOST_CHECK(httpDeflateResponses == responses + 1);
+    HOST_CHECK(deflResp.bodyLen < plainResp.bodyLen / 2);
+
+    plainBuff = malloc(plainResp.bodyLen + 1);
+    plainLen = plainResp.bodyLen + 1;
+    HOST_CHECK(uncompress(plainBuff, &plainLen, deflResp.body, deflResp.bodyLen) == Z_OK);
+    HOST_CHECK(plainLen == plainResp.bodyLen && memcmp(plainBuff, plainResp.body, plainLen) == 0);
+    free(plainBuff);
+
+    HOST_CHECK(deflGet("/table.htm", "Accept-Encoding: gzip, deflate;q=0\r\n", &noResp) == 200);
+    HOST_CHECK(host_RespHeader(&noResp, "Content-Encoding") == 0);
+    HOST_CHECK(httpDeflateResponses == responses + 1);
+
+    host_RespFree(&plainResp);
+    host_RespFree(&deflResp);
+    host_RespFree(&noResp);
+}
+
+// inflates a compressed response body; returns 0 if it is not a valid zlib stream
+static char* deflInflate(const HOST_HTTP_RESP* pResp)
+{
+    uLongf plainLen = 4000;
+    char* plainBuff = calloc(1, plainLen + 1);
+
+    if(uncompress((uint8_t*)plainBuff, &plainLen, pResp->body, pResp->bodyLen) != Z_OK)
+    {
+        free(plainBuff);
+        return 0;
+    }
+    return plainBuff;
+}
+
+static void testSnapshot(void)
+{
+    static char pollData[2000];
+    size_t ix;
+    char *body1, *body2;
+    int renders;
+    uint32_t snapHits;
+    HOST_HTTP_RESP resp1, resp2, plainResp;
+
+    strcpy(pollData, "<response>\n~poll~\n");
+    for(ix = 0; ix < 20; ix++)
+    {
+        strcat(pollData, "<led>1</led><pot>512</pot>\n");
+    }
+    strcat(pollData, "</response>\n");
+    HOST_CHECK(host_FileAdd("poll.xml", pollData, strlen(pollData), 0x5a21, 0x6000));
+    HOST_CHECK(TCPIP_HTTP_NET_SnapshotFileRegister(hHttp, "poll.xml", 30000));
+
+    // rendered once, then served from the compressed snapshot
+    renders = deflRenders;
+    snapHits = httpSnapHits;
+    HOST_CHECK(deflGet("/poll.xml", "Accept-Encoding: gzip, deflate\r\n", &resp1) == 200);
+    HOST_CHECK(deflGet("/poll.xml", "Accept-Encoding: gzip, deflate\r\n", &resp2) == 200);
+    HOST_CHECK(deflRenders == renders + 1);
+    HOST_CHECK(httpSnapHits == snapHits + 1);
+    HOST_CHECK(host_RespHeader(&resp2, "Content-Encoding") != 0 && strcmp(host_RespHeader(&resp2, "Content-Encoding"), "deflate") == 0);
+    body1 = deflInflate(&resp1);
+    body2 = deflInflate(&resp2);
+    HOST_CHECK(body1 != 0 && body2 != 0 && strstr(body1, "<count>") != 0 && strcmp(body1, body2) == 0);
+
+    // the plain snapshot is a different one
+    HOST_CHECK(deflGet("/poll.xml", "", &plainResp) == 200);
+    HOST_CHECK(host_RespHeader(&plainResp, "Content-Encoding") == 0);
+    HOST_CHECK(deflRenders == renders + 2);
+    HOST_CHECK(strstr((char*)plainResp.body, "<count>") != 0);
+    host_RespFree(&plainResp);
+    HOST_CHECK(deflGet("/poll.xml", "", &plainResp) == 200);
+    HOST_CHECK(deflRenders == renders + 2);
+    HOST_CHECK(httpSnapHits == snapHits + 2);
+
+    free(body1);
+    free(body2);
+    host_RespFree(&resp1);
+    host_RespFree(&resp2);
+    host_RespFree(&plainResp);
+}
+
+int main(void)
+{
+    if(!host_HttpStart(0))
+    {
+        printf("HTTP initialization failed\n");
+        return 1;
+    }
+    HOST_CHECK((hHttp = TCPIP_HTTP_NET_UserHandlerRegister(&deflUserCback)) != 0);
+
+    testRoundTrip();
+    testResponse();
+    testSnapshot();
+
+    return host_Result("test_http_deflate");
+}
@@ -0,0 +1,172 @@
+/*******************************************************************************
+  HTTP NET form parser host test
+
+  Summary:
+    multipart/form-data POST bodies
+
+  Description:
+    Runs the HTTP server on fake sockets, with a postExecute callback
+    that parses the body with TCPIP_HTTP_NET_ConnectionFormParse, and checks:
+        - the parts are delimited by the Content-Type boundary parameter,
+          token or quoted, with the body arriving in small pieces
+          so that the delimiters are split across reads
+        - "--" lines in the preamble, including a longer boundary,
+          do not start a part
+        - a multipart request without a boundary is rejected with 400
+*******************************************************************************/
+
+#include "http_net.c"
+
+#include <stdlib.h>
+#include "host_stubs.h"
+
+#define FORM_SKT        0
+
+static char formFields[1000];   // the parsed fields: name[filename]=value;
+static int  formCalls;          // postExecute calls
+
+static uint8_t formFileAuthenticate(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const char* cFile, const TCPIP_HTTP_NET_USER_CALLBACK* pCBack)
+{
+    return 0x80;
+}
+
+static bool formFieldEvent(TCPIP_HTTP_NET_CONN_HANDLE connHandle, TCPIP_HTTP_NET_FORM_EVENT event,
+                           const TCPIP_HTTP_NET_FORM_FIELD* pField, const uint8_t* data, uint16_t dataLen, const void* param)
+{
+    size_t len = strlen(formFields);
+
+    if(event == TCPIP_HTTP_NET_FORM_EVENT_NAME)
+    {
+        snprintf(formFields + len, sizeof(formFields) - len, pField->fileName[0] != 0 ? "%s[%s]=" : "%s=", pField->name, pField->fileName);
+    }
+    else if(event == TCPIP_HTTP_NET_FORM_EVENT_VALUE)
+    {
+        snprintf(formFields + len, sizeof(formFields) - len, "%.*s", dataLen, data);
+    }
+    else
+    {
+        snprintf(formFields + len, sizeof(formFields) - len, ";");
+    }
+    return true;
+}
+
+static TCPIP_HTTP_NET_IO_RESULT formPostExecute(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const TCPIP_HTTP_NET_USER_CALLBACK* pCBack)
+{
+    formCalls++;
+    return TCPIP_HTTP_NET_ConnectionFormParse(connHandle, formFieldEvent, 0);
+}
+
+static const TCPIP_HTTP_NET_USER_CALLBACK formUserCback =
+{
+    .fileAuthenticate = formFileAuthenticate,
+    .postExecute = formPostExecute,
+};
+
+// POSTs the body, pieceSize bytes at a time; returns the status code, 0 if no complete response
+static int formPost(const char* contentType, const char* body, size_t pieceSize)
+{
+    char request[300];
+    size_t bodyLen = strlen(body), pos, txLen;
+    const uint8_t* tx;
+    int status;
+    HOST_HTTP_RESP resp;
+
+    formFields[0] = 0;
+    formCalls = 0;
+    host_SktTxClear(FORM_SKT);
+    sprintf(request, "POST /form.htm HTTP/1.1\r\nHost: test\r\nContent-Type: %s\r\nContent-Length: %zu\r\n\r\n", contentType, bodyLen);
+    host_SktPushStr(FORM_SKT, request);
+    host_Run(2);
+    for(pos = 0; pos < bodyLen; pos += pieceSize)
+    {
+        host_SktPush(FORM_SKT, body + pos, bodyLen - pos < pieceSize ? bodyLen - pos : pieceSize);
+        host_Run(1);
+    }
+    host_Run(10);
+
+    tx = host_SktTx(FORM_SKT, &txLen);
+    if(!host_RespParse(tx, txLen, &resp))
+    {
+        return 0;
+    }
+    status = resp.status;
+    host_RespFree(&resp);
+    return status;
+}
+
+static void testSplitBoundary(void)
+{
+    static const char body[] =
+        "--XyZ\r\n"
+        "Content-Disposition: form-data; name=\"a\"\r\n"
+        "\r\n"
+        "hello\r\n--Xy not a delimiter\r\n"
+        "--XyZ\r\n"
+        "Content-Disposition: form-data; name=\"f\"; filename=\"f.txt\"\r\n"
+        "Content-Type: text/plain\r\n"
+        "\r\n"
+        "file data\r\n"
+        "--XyZ--\r\n";
+    size_t pieceSize;
+
+    for(pieceSize = 1; pieceSize <= 7; pieceSize += 3)
+    {
+        HOST_CHECK(formPost("multipart/form-data; boundary=XyZ", body, pieceSize) == 200);
+        HOST_CHECK(formCalls > 1);
+        HOST_CHECK(strcmp(formFields, "a=hello\r\n--Xy not a delimiter;f[f.txt]=file data;") == 0);
+    }
+}
+
+static void testPreamble(void)
+{
+    static const char body[] =
+        "This is the preamble.\r\n"
+        "--other\r\n"
+        "--Xy Zlonger\r\n"
+        "\r\n"
+        "--Xy Z\r\n"
+        "Content-Disposition: form-data; name=\"b\"\r\n"
+        "\r\n"
+        "value\r\n"
+        "--Xy Z--\r\n"
+        "epilogue\r\n";
+
+    HOST_CHECK(formPost("multipart/form-data; charset=utf-8; BOUNDARY=\"Xy Z\"", body, 20) == 200);
+    HOST_CHECK(strcmp(formFields, "b=value;") == 0);
+}
+
+static void testNoBoundary(void)
+{
+    static const char body[] =
+        "--XyZ\r\n"
+        "Content-Disposition: form-data; name=\"a\"\r\n"
+        "\r\n"
+        "hello\r\n"
+        "--XyZ--\r\n";
+
+    HOST_CHECK(formPost("multipart/form-data", body, sizeof(body)) == 400);
+    HOST_CHECK(formCalls == 0);
+    HOST_CHECK(formFields[0] == 0);
+
+    HOST_CHECK(formPost("multipart/form-data; boundary=\"XyZ", body, sizeof(body)) == 400);
+    HOST_CHECK(formCalls == 0);
+}
+
+int main(void)
+{
+    static const char formData[] = "<html>done</html>";
+
+    if(!host_HttpStart(0))
+    {
+        printf("HTTP initialization failed\n");
+        return 1;
+    }
+    HOST_CHECK(TCPIP_HTTP_NET_UserHandlerRegister(&formUserCback) != 0);
+    HOST_CHECK(host_FileAdd("form.htm", formData, sizeof(formData) - 1, 0x5a21, 0x6000));
+
+    testSplitBoundary();
+    testPreamble();
+    testNoBoundary();
+
+    return host_Result("test_http_form");
+}
@@ -0,0 +1,247 @@
+/*******************************************************************************
+  HTTP NET request line buffers host test
+
+  Summary:
+    Request line buffers shared by the connections
+
+  Description:
+    Runs the HTTP server on fake sockets and checks:
+        - the pool has fewer buffers than there are connections
+        - a connection waiting between request lines does not hold a line buffer
+        - a line arriving in pieces keeps its buffer until complete
+          and each byte of it is copied out of the socket only once
+        - clients stalled between header lines on all the other connections
+          do not keep the last connection from being served
+        - a connection finding the pool empty waits for a buffer, then is served
+        - a header line that does not fit TCPIP_HTTP_NET_MAX_LINE_LEN gets 400,
+          one that just fits is parsed
+        - the stack heap the connections take: more connections than
+          TCPIP_HTTP_NET_MAX_CONNECTIONS run in the heap that the layout
+          embedding a file name and a line buffer in each connection needed
+*******************************************************************************/
+
+#include "http_net.c"
+
+#include <stdlib.h>
+#include "host_stubs.h"
+
+static uint8_t linesFileAuthenticate(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const char* cFile, const TCPIP_HTTP_NET_USER_CALLBACK* pCBack)
+{
+    return 0x80;
+}
+
+static const TCPIP_HTTP_NET_USER_CALLBACK linesUserCback =
+{
+    .fileAuthenticate = linesFileAuthenticate,
+};
+
+static int linesBuffFree(void)
+{
+    return TCPIP_Helper_SingleListCount(&httpLineBuffers);
+}
+
+// returns the status of the response on the socket, 0 if none
+static int linesStatus(int skt)
+{
+    int status;
+    HOST_HTTP_RESP resp;
+    size_t txLen;
+    const uint8_t* tx = host_SktTx(skt, &txLen);
+
+    if(!host_RespParse(tx, txLen, &resp))
+    {
+        return 0;
+    }
+    status = resp.status;
+    host_RespFree(&resp);
+    host_SktTxClear(skt);
+    return status;
+}
+
+static void testLinePieces(void)
+{
+    size_t copied = host_SktRxCopied(0);
+    static const char* const reqPieces[] = {"GET /index.h", "tm HTTP/1.1\r\n", "Host: te", "st\r\n\r\n"};
+    size_t reqLen = strlen(reqPieces[0]) + strlen(reqPieces[1]) + strlen(reqPieces[2]) + strlen(reqPieces[3]);
+
+    // shared: fewer buffers than connections
+    HOST_CHECK(TCPIP_HTTP_NET_LINE_BUFFERS < TCPIP_HTTP_NET_MAX_CONNECTIONS - 1);
+    HOST_CHECK(linesBuffFree() == TCPIP_HTTP_NET_LINE_BUFFERS);
+
+    // a partial line keeps the buffer
+    host_SktPushStr(0, reqPieces[0]);
+    host_Run(2);
+    HOST_CHECK(linesBuffFree() == TCPIP_HTTP_NET_LINE_BUFFERS - 1);
+
+    // waiting for the next header line: the buffer is returned
+    host_SktPushStr(0, reqPieces[1]);
+    host_Run(2);
+    HOST_CHECK(httpConnCtrl[0].connState == TCPIP_HTTP_CONN_STATE_PARSE_HEADERS);
+    HOST_CHECK(linesBuffFree() == TCPIP_HTTP_NET_LINE_BUFFERS);
+
+    host_SktPushStr(0, reqPieces[2]);
+    host_Run(2);
+    HOST_CHECK(linesBuffFree() == TCPIP_HTTP_NET_LINE_BUFFERS - 1);
+    host_SktPushStr(0, reqPieces[3]);
+    host_Run(4);
+    HOST_CHECK(linesStatus(0) == 200);
+    HOST_CHECK(linesBuffFree() == TCPIP_HTTP_NET_LINE_BUFFERS);
+
+    // each request byte is copied out of the socket once
+    HOST_CHECK(host_SktRxCopied(0) - copied == reqLen);
+}
+
+static void testSlowClients(void)
+{
+    int skt, nConns = TCPIP_HTTP_NET_MAX_CONNECTIONS;
+    uint32_t waits = httpLineBuffEmpty;
+
+    // all but the last connection stall between header lines
+    for(skt = 0; skt < nConns - 1; skt++)
+    {
+        host_SktPushStr(skt, "GET /index.htm HTTP/1.1\r\nX-Slow: a\r\n");
+    }
+    host_Run(2);
+    HOST_CHECK(linesBuffFree() == TCPIP_HTTP_NET_LINE_BUFFERS);
+
+    // the last one is served
+    host_SktPushStr(nConns - 1, "GET /index.htm HTTP/1.1\r\nHost: test\r\n\r\n");
+    host_Run(4);
+    HOST_CHECK(linesStatus(nConns - 1) == 200);
+    HOST_CHECK(httpLineBuffEmpty == waits);
+
+    // partial lines take all the buffers: the next one waits
+    for(skt = 0; skt < TCPIP_HTTP_NET_LINE_BUFFERS; skt++)
+    {
+        host_SktPushStr(skt, "X-Part: b");
+    }
+    host_Run(2);
+    HOST_CHECK(linesBuffFree() == 0);
+    host_SktPushStr(TCPIP_HTTP_NET_LINE_BUFFERS, "X-Part: c\r\n\r\n");
+    host_Run(2);
+    HOST_CHECK(httpLineBuffEmpty > waits);
+    HOST_CHECK(linesStatus(TCPIP_HTTP_NET_LINE_BUFFERS) == 0);
+
+    // a line completes and frees a buffer
+    host_SktPushStr(0, "b\r\n\r\n");
+    host_Run(4);
+    HOST_CHECK(linesStatus(0) == 200);
+    HOST_CHECK(linesStatus(TCPIP_HTTP_NET_LINE_BUFFERS) == 200);
+
+    // the slow ones complete
+    for(skt = 1; skt < TCPIP_HTTP_NET_LINE_BUFFERS; skt++)
+    {
+        host_SktPushStr(skt, "b\r\n\r\n");
+    }
+    for(skt = TCPIP_HTTP_NET_LINE_BUFFERS + 1; skt < nConns - 1; skt++)
+    {
+        host_SktPushStr(skt, "\r\n");
+    }
+    host_Run(4);
+    for(skt = 1; skt < nConns - 1; skt++)
+    {
+        if(skt != TCPIP_HTTP_NET_LINE_BUFFERS)
+        {
+            HOST_CHECK(linesStatus(skt) == 200);
+        }
+    }
+    HOST_CHECK(linesBuffFree() == TCPIP_HTTP_NET_LINE_BUFFERS);
+}
+
+// sends a request with a header line of lineLen characters, CRLF included
+static int linesLongHeader(int skt, int lineLen)
+{
+    char request[TCPIP_HTTP_NET_MAX_LINE_LEN * 2 + 100];
+    int reqLen;
+
+    reqLen = sprintf(request, "GET /index.htm HTTP/1.1\r\nX-Long: ");
+    memset(request + reqLen, 'a', lineLen - 10);
+    reqLen += lineLen - 10;
+    strcpy(request + reqLen, "\r\nHost: test\r\n\r\n");
+    host_SktPushStr(skt, request);
+    host_Run(4);
+    return linesStatus(skt);
+}
+
+static void testLongHeader(void)
+{
+    int skt = TCPIP_HTTP_NET_MAX_CONNECTIONS - 1;
+
+    HOST_CHECK(linesLongHeader(skt, TCPIP_HTTP_NET_MAX_LINE_LEN) == 200);
+    HOST_CHECK(linesLongHeader(skt, TCPIP_HTTP_NET_MAX_LINE_LEN + 1) == 400);
+    HOST_CHECK(linesBuffFree() == TCPIP_HTTP_NET_LINE_BUFFERS);
+}
+
+// the previous layout embedded these in each connection, instead of the pointers to the pool and the interned name
+#define LINES_CONN_EMBEDDED     ((SYS_FS_FILE_NAME_LEN + 1) + (TCPIP_HTTP_NET_MAX_LINE_LEN + 1) - 4 * sizeof(void*))
+
+// the stack heap per connection, measured;
+// the heap the previous layout needed for TCPIP_HTTP_NET_MAX_CONNECTIONS
+// is then used as the heap limit for more connections
+static void testConnHeap(void)
+{
+    size_t heap1, connHeap, fixedHeap, oldHeap, idleHeap;
+    int skt, nConns, round;
+
+    host_HttpStop();
+    HOST_CHECK(host_HeapUsed() == 0);
+
+    HOST_CHECK(host_HttpStart(1));
+    heap1 = host_HeapUsed();
+    host_HttpStop();
+    HOST_CHECK(host_HttpStart(2));
+    connHeap = host_HeapUsed() - heap1;
+    host_HttpStop();
+    fixedHeap = heap1 - connHeap;
+
+    oldHeap = fixedHeap - TCPIP_HTTP_NET_LINE_BUFFERS * sizeof(TCPIP_HTTP_LINE_BUFF_DCPT) + TCPIP_HTTP_NET_MAX_CONNECTIONS * (connHeap + LINES_CONN_EMBEDDED);
+    nConns = (oldHeap - fixedHeap) / connHeap;
+    printf("test_http_lines: %zu heap bytes per connection, %zu before; %d connections in the heap of %d\n",
+            connHeap, connHeap + LINES_CONN_EMBEDDED, nConns, TCPIP_HTTP_NET_MAX_CONNECTIONS);
+    HOST_CHECK(nConns > TCPIP_HTTP_NET_MAX_CONNECTIONS);
+    if(nConns > HOST_SOCKETS)
+    {
+        nConns = HOST_SOCKETS;
+    }
+
+    // all connections run in the limited heap; kept alive, they hold no more heap
+    host_HeapLimitSet(oldHeap);
+    HOST_CHECK(host_HttpStart(nConns));
+    HOST_CHECK(TCPIP_HTTP_NET_UserHandlerRegister(&linesUserCback) != 0);
+    idleHeap = host_HeapUsed();
+    HOST_CHECK(idleHeap <= oldHeap);
+    for(round = 0; round < 2; round++)
+    {
+        for(skt = 0; skt < nConns; skt++)
+        {
+            host_SktPushStr(skt, "GET /index.htm HTTP/1.1\r\nHost: test\r\n\r\n");
+        }
+        host_Run(4 + nConns / TCPIP_HTTP_NET_LINE_BUFFERS);
+        for(skt = 0; skt < nConns; skt++)
+        {
+            HOST_CHECK(linesStatus(skt) == 200);
+        }
+        HOST_CHECK(host_HeapUsed() == idleHeap);
+    }
+    host_HeapLimitSet(0);
+}
+
+int main(void)
+{
+    static const char indexData[] = "<html>index</html>";
+
+    if(!host_HttpStart(0))
+    {
+        printf("HTTP initialization failed\n");
+        return 1;
+    }
+    HOST_CHECK(TCPIP_HTTP_NET_UserHandlerRegister(&linesUserCback) != 0);
+    HOST_CHECK(host_FileAdd("index.htm", indexData, sizeof(indexData) - 1, 0x5a21, 0x6000));
+
+    testLinePieces();
+    testSlowClients();
+    testLongHeader();
+    testConnHeap();
+
+    return host_Result("test_http_lines");
+}
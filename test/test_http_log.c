@@ -0,0 +1,124 @@
+/*******************************************************************************
+  HTTP NET access log host test
+
+  Summary:
+    Request latency records
+
+  Description:
+    Runs the HTTP server on fake sockets and checks:
+        - the first request of a connection is timed from the socket accept,
+          so the time the client takes to send the request is included
+        - a following request on the persistent connection
+          is timed from the arrival of its data, not from the accept
+        - the stages are recorded in order
+*******************************************************************************/
+
+#include "http_net.c"
+
+#include <stdlib.h>
+#include "host_stubs.h"
+
+#define LOG_SKT         0
+
+static uint8_t logFileAuthenticate(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const char* cFile, const TCPIP_HTTP_NET_USER_CALLBACK* pCBack)
+{
+    return 0x80;
+}
+
+static const TCPIP_HTTP_NET_USER_CALLBACK logUserCback =
+{
+    .fileAuthenticate = logFileAuthenticate,
+};
+
+// GETs the file; returns the status code, 0 if no complete response
+static int logGet(const char* uri)
+{
+    char request[100];
+    size_t txLen;
+    const uint8_t* tx;
+    int status;
+    HOST_HTTP_RESP resp;
+
+    host_SktTxClear(LOG_SKT);
+    sprintf(request, "GET %s HTTP/1.1\r\nHost: test\r\n\r\n", uri);
+    host_SktPushStr(LOG_SKT, request);
+    host_Run(10);
+
+    tx = host_SktTx(LOG_SKT, &txLen);
+    if(!host_RespParse(tx, txLen, &resp))
+    {
+        return 0;
+    }
+    status = resp.status;
+    host_RespFree(&resp);
+    return status;
+}
+
+// gets the newest log record
+static bool logLast(TCPIP_HTTP_NET_LOG_ENTRY* pEntry)
+{
+    int nEntries = TCPIP_HTTP_NET_LogGet(0, 0, 0);
+
+    return nEntries != 0 && TCPIP_HTTP_NET_LogGet(nEntries - 1, pEntry, 1) == 1;
+}
+
+// checks that the stages are in order
+static bool logStagesCheck(const TCPIP_HTTP_NET_LOG_ENTRY* pEntry)
+{
+    int stage;
+
+    for(stage = 1; stage < TCPIP_HTTP_NET_LOG_STAGES; stage++)
+    {
+        if(pEntry->stageUs[stage] == TCPIP_HTTP_NET_LOG_TIME_NONE || pEntry->stageUs[stage] < pEntry->stageUs[stage - 1])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void testAccept(void)
+{
+    uint32_t tAccept, tData;
+    TCPIP_HTTP_NET_LOG_ENTRY entry;
+
+    TCPIP_HTTP_NET_LogClear();
+
+    // the client connects, then takes 80 ms to send the request
+    tAccept = SYS_TIME_CounterGet();
+    host_SktAccept(LOG_SKT);
+    host_Run(2);
+    host_TimeAdvance(80);
+    HOST_CHECK(logGet("/index.htm") == 200);
+    HOST_CHECK(logLast(&entry));
+    HOST_CHECK(entry.tAccept == tAccept);
+    HOST_CHECK(entry.stageUs[TCPIP_HTTP_NET_LOG_STAGE_HEADERS] >= 80000);
+    HOST_CHECK(logStagesCheck(&entry));
+
+    // the next request on the connection, after a pause
+    host_TimeAdvance(500);
+    tData = SYS_TIME_CounterGet();
+    HOST_CHECK(logGet("/index.htm") == 200);
+    HOST_CHECK(TCPIP_HTTP_NET_LogGet(0, 0, 0) == 2);
+    HOST_CHECK(logLast(&entry));
+    HOST_CHECK(entry.tAccept == tData);
+    HOST_CHECK(entry.stageUs[TCPIP_HTTP_NET_LOG_STAGE_HEADERS] < 80000);
+    HOST_CHECK(logStagesCheck(&entry));
+}
+
+int main(void)
+{
+    static const char indexData[] = "<html>index</html>";
+
+    if(!host_HttpStart(0))
+    {
+        printf("HTTP initialization failed\n");
+        return 1;
+    }
+    HOST_CHECK(TCPIP_HTTP_NET_UserHandlerRegister(&logUserCback) != 0);
+    HOST_CHECK(host_FileAdd("index.htm", indexData, sizeof(indexData) - 1, 0x5a21, 0x6000));
+
+    testAccept();
+
+    return host_Result("test_http_log");
+}
@@ -0,0 +1,288 @@
+/*******************************************************************************
+  HTTP NET byte range host test
+
+  Summary:
+    Byte range requests for static files
+
+  Description:
+    Runs the HTTP server on fake sockets and checks:
+        - a static file advertises the validators and "Accept-Ranges: bytes"
+        - first-last, first- and -suffix ranges return 206 with the right
+          Content-Range and bytes, for a file read from the file system
+          and for a file served from the RAM cache
+        - a range past the end of the file returns 416
+        - multiple ranges and malformed ranges get the whole file
+        - If-Range with the current entity tag or date returns the range,
+          a stale validator gets the whole file
+        - If-None-Match returns 304 for the current entity tag anywhere
+          in the list, weak or strong, or for "*" as the whole value;
+          a tag that only contains the current one or a "*" inside
+          another tag gets the file
+        - a file rewritten with the same size and invalidated
+          gets a new entity tag and its old tag no longer returns 304
+*******************************************************************************/
+
+#include "http_net.c"
+
+#include <stdlib.h>
+#include "host_stubs.h"
+
+#define RANGE_SKT           0
+#define RANGE_LARGE_SIZE    20000       // read from the file system
+#define RANGE_SMALL_SIZE    1000        // fits the RAM file cache
+
+static char largeData[RANGE_LARGE_SIZE];
+static char smallData[RANGE_SMALL_SIZE];
+
+static uint8_t rangeFileAuthenticate(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const char* cFile, const TCPIP_HTTP_NET_USER_CALLBACK* pCBack)
+{
+    return 0x80;
+}
+
+static const TCPIP_HTTP_NET_USER_CALLBACK rangeUserCback =
+{
+    .fileAuthenticate = rangeFileAuthenticate,
+};
+
+// GETs a file with the extra headers; returns the status code, 0 if no complete response
+// the response is freed by the caller when a status is returned
+static int rangeGet(const char* uri, const char* headers, HOST_HTTP_RESP* pResp)
+{
+    char request[300];
+    size_t txLen;
+    const uint8_t* tx;
+
+    host_SktTxClear(RANGE_SKT);
+    sprintf(request, "GET %s HTTP/1.1\r\nHost: test\r\n%s\r\n", uri, headers);
+    host_SktPushStr(RANGE_SKT, request);
+    host_Run(40);
+
+    tx = host_SktTx(RANGE_SKT, &txLen);
+    if(!host_RespParse(tx, txLen, pResp))
+    {
+        return 0;
+    }
+    return pResp->status;
+}
+
+// checks a 206 response: Content-Range and the bytes of the window
+static bool rangeCheck(const char* uri, const char* headers, const char* fileData, size_t fileSize, size_t first, size_t last)
+{
+    char contentRange[60];
+    const char* hdrVal;
+    bool rangeOk;
+    HOST_HTTP_RESP resp;
+
+    if(rangeGet(uri, headers, &resp) == 0)
+    {
+        return false;
+    }
+
+    sprintf(contentRange, "bytes %zu-%zu/%zu", first, last, fileSize);
+    hdrVal = host_RespHeader(&resp, "Content-Range");
+    rangeOk = resp.status == 206 && hdrVal != 0 && strcmp(hdrVal, contentRange) == 0;
+    rangeOk = rangeOk && resp.bodyLen == last - first + 1 && memcmp(resp.body, fileData + first, resp.bodyLen) == 0;
+    host_RespFree(&resp);
+    return rangeOk;
+}
+
+// checks that the whole file is returned
+static bool rangeFullCheck(const char* uri, const char* headers, const char* fileData, size_t fileSize)
+{
+    bool fullOk;
+    HOST_HTTP_RESP resp;
+
+    if(rangeGet(uri, headers, &resp) == 0)
+    {
+        return false;
+    }
+
+    fullOk = resp.status == 200 && host_RespHeader(&resp, "Content-Range") == 0;
+    fullOk = fullOk && resp.bodyLen == fileSize && memcmp(resp.body, fileData, fileSize) == 0;
+    host_RespFree(&resp);
+    return fullOk;
+}
+
+static void testRanges(const char* uri, const char* fileData, size_t fileSize)
+{
+    char headers[100];
+
+    HOST_CHECK(rangeCheck(uri, "Range: bytes=100-199\r\n", fileData, fileSize, 100, 199));
+    HOST_CHECK(rangeCheck(uri, "Range: bytes=0-0\r\n", fileData, fileSize, 0, 0));
+    HOST_CHECK(rangeCheck(uri, "Range: bytes=500-\r\n", fileData, fileSize, 500, fileSize - 1));
+    HOST_CHECK(rangeCheck(uri, "Range: bytes=-10\r\n", fileData, fileSize, fileSize - 10, fileSize - 1));
+    // clipped to the file size
+    sprintf(headers, "Range: bytes=%zu-%zu\r\n", fileSize - 5, fileSize + 100);
+    HOST_CHECK(rangeCheck(uri, headers, fileData, fileSize, fileSize - 5, fileSize - 1));
+    sprintf(headers, "Range: bytes=-%zu\r\n", fileSize + 100);
+    HOST_CHECK(rangeCheck(uri, headers, fileData, fileSize, 0, fileSize - 1));
+
+    // ignored
+    HOST_CHECK(rangeFullCheck(uri, "Range: bytes=0-1,5-6\r\n", fileData, fileSize));
+    HOST_CHECK(rangeFullCheck(uri, "Range: bytes=20-10\r\n", fileData, fileSize));
+    HOST_CHECK(rangeFullCheck(uri, "Range: items=0-10\r\n", fileData, fileSize));
+}
+
+static void testNotSatisfiable(const char* uri, size_t fileSize)
+{
+    char headers[100], contentRange[40];
+    const char* hdrVal;
+    HOST_HTTP_RESP resp;
+
+    sprintf(headers, "Range: bytes=%zu-\r\n", fileSize);
+    HOST_CHECK(rangeGet(uri, headers, &resp) == 416);
+    sprintf(contentRange, "bytes */%zu", fileSize);
+    hdrVal = host_RespHeader(&resp, "Content-Range");
+    HOST_CHECK(hdrVal != 0 && strcmp(hdrVal, contentRange) == 0);
+    host_RespFree(&resp);
+}
+
+static void testIfRange(const char* uri, const char* fileData, size_t fileSize)
+{
+    char eTag[40], lastModified[40], headers[200];
+    const char* hdrVal;
+    HOST_HTTP_RESP resp;
+
+    // the validators
+    HOST_CHECK(rangeGet(uri, "", &resp) == 200);
+    hdrVal = host_RespHeader(&resp, "Accept-Ranges");
+    HOST_CHECK(hdrVal != 0 && strcmp(hdrVal, "bytes") == 0);
+    hdrVal = host_RespHeader(&resp, "ETag");
+    HOST_CHECK(hdrVal != 0);
+    snprintf(eTag, sizeof(eTag), "%s", hdrVal != 0 ? hdrVal : "");
+    hdrVal = host_RespHeader(&resp, "Last-Modified");
+    HOST_CHECK(hdrVal != 0);
+    snprintf(lastModified, sizeof(lastModified), "%s", hdrVal != 0 ? hdrVal : "");
+    host_RespFree(&resp);
+
+    // current validators
+    sprintf(headers, "Range: bytes=10-19\r\nIf-Range: %s\r\n", eTag);
+    HOST_CHECK(rangeCheck(uri, headers, fileData, fileSize, 10, 19));
+    sprintf(headers, "If-Range: %s\r\nRange: bytes=10-19\r\n", lastModified);
+    HOST_CHECK(rangeCheck(uri, headers, fileData, fileSize, 10, 19));
+
+    // stale validators
+    HOST_CHECK(rangeFullCheck(uri, "Range: bytes=10-19\r\nIf-Range: \"0000\"\r\n", fileData, fileSize));
+    HOST_CHECK(rangeFullCheck(uri, "Range: bytes=10-19\r\nIf-Range: Thu, 01 Jan 1998 00:00:00 GMT\r\n", fileData, fileSize));
+}
+
+// returns the status of a GET with an If-None-Match header
+static int rangeNoneMatchGet(const char* uri, const char* tagList)
+{
+    char headers[200];
+    int status;
+    HOST_HTTP_RESP resp;
+
+    sprintf(headers, "If-None-Match: %s\r\n", tagList);
+    if((status = rangeGet(uri, headers, &resp)) != 0)
+    {
+        host_RespFree(&resp);
+    }
+    return status;
+}
+
+static void testIfNoneMatch(const char* uri)
+{
+    char eTag[40], tagList[150], partTag[40];
+    const char* hdrVal;
+    HOST_HTTP_RESP resp;
+
+    HOST_CHECK(rangeGet(uri, "", &resp) == 200);
+    hdrVal = host_RespHeader(&resp, "ETag");
+    HOST_CHECK(hdrVal != 0 && strlen(hdrVal) > 4);
+    snprintf(eTag, sizeof(eTag), "%s", hdrVal != 0 ? hdrVal : "");
+    host_RespFree(&resp);
+
+    // matches
+    HOST_CHECK(rangeNoneMatchGet(uri, eTag) == 304);
+    sprintf(tagList, "\"1234\", %s", eTag);
+    HOST_CHECK(rangeNoneMatchGet(uri, tagList) == 304);
+    sprintf(tagList, "\"1234\",W/%s ,\"abcd\"", eTag);
+    HOST_CHECK(rangeNoneMatchGet(uri, tagList) == 304);
+    HOST_CHECK(rangeNoneMatchGet(uri, "*") == 304);
+    HOST_CHECK(rangeNoneMatchGet(uri, "* ") == 304);
+
+    // no match
+    HOST_CHECK(rangeNoneMatchGet(uri, "\"1234\", \"abcd\"") == 200);
+    sprintf(tagList, "\"x%s", eTag + 1);
+    HOST_CHECK(rangeNoneMatchGet(uri, tagList) == 200);
+    snprintf(partTag, sizeof(partTag), "%.*s\"", (int)strlen(eTag) - 2, eTag);
+    HOST_CHECK(rangeNoneMatchGet(uri, partTag) == 200);
+    sprintf(tagList, "%sx", eTag);
+    HOST_CHECK(rangeNoneMatchGet(uri, tagList) == 200);
+    HOST_CHECK(rangeNoneMatchGet(uri, "\"a*b\"") == 200);
+    HOST_CHECK(rangeNoneMatchGet(uri, "\"1234\", *") == 200);
+}
+
+// rewrites the file in place, with the same size and a new date, as FTP STOR does
+static void testFileChanged(const char* uri, char* fileData, size_t fileSize)
+{
+    char oldTag[40], headers[100];
+    const char* hdrVal;
+    HOST_HTTP_RESP resp;
+
+    HOST_CHECK(rangeGet(uri, "", &resp) == 200);
+    hdrVal = host_RespHeader(&resp, "ETag");
+    HOST_CHECK(hdrVal != 0);
+    snprintf(oldTag, sizeof(oldTag), "%s", hdrVal != 0 ? hdrVal : "");
+    host_RespFree(&resp);
+    sprintf(headers, "If-None-Match: %s\r\n", oldTag);
+    HOST_CHECK(rangeGet(uri, headers, &resp) == 304);
+    host_RespFree(&resp);
+
+    fileData[0] ^= 0x20;
+    HOST_CHECK(host_FileUpdate(uri + 1, fileData, fileSize, 0x5a22, 0x6100));
+    TCPIP_HTTP_NET_FileCacheInvalidate(uri + 1);
+
+    HOST_CHECK(rangeGet(uri, headers, &resp) == 200);
+    hdrVal = host_RespHeader(&resp, "ETag");
+    HOST_CHECK(hdrVal != 0 && strcmp(hdrVal, oldTag) != 0);
+    HOST_CHECK(resp.bodyLen == fileSize && memcmp(resp.body, fileData, fileSize) == 0);
+    host_RespFree(&resp);
+    HOST_CHECK(rangeFullCheck(uri, "", fileData, fileSize));
+}
+
+int main(void)
+{
+    size_t ix;
+    uint32_t cacheHits;
+
+    for(ix = 0; ix < sizeof(largeData); ix++)
+    {
+        largeData[ix] = 'a' + (ix * 7 + ix / 26) % 26;
+    }
+    for(ix = 0; ix < sizeof(smallData); ix++)
+    {
+        smallData[ix] = 'A' + (ix * 5 + ix / 26) % 26;
+    }
+
+    if(!host_HttpStart(0))
+    {
+        printf("HTTP initialization failed\n");
+        return 1;
+    }
+    HOST_CHECK(TCPIP_HTTP_NET_UserHandlerRegister(&rangeUserCback) != 0);
+    HOST_CHECK(host_FileAdd("large.txt", largeData, sizeof(largeData), 0x5a21, 0x6000));
+    HOST_CHECK(host_FileAdd("small.txt", smallData, sizeof(smallData), 0x5a21, 0x6000));
+
+    // from the file system
+    testRanges("/large.txt", largeData, sizeof(largeData));
+    testNotSatisfiable("/large.txt", sizeof(largeData));
+    testIfRange("/large.txt", largeData, sizeof(largeData));
+
+    // from the RAM file cache, after the first request
+    HOST_CHECK(rangeFullCheck("/small.txt", "", smallData, sizeof(smallData)));
+    cacheHits = httpFileCacheHits;
+    testRanges("/small.txt", smallData, sizeof(smallData));
+    HOST_CHECK(httpFileCacheHits > cacheHits);
+    testNotSatisfiable("/small.txt", sizeof(smallData));
+    testIfRange("/small.txt", smallData, sizeof(smallData));
+
+    testIfNoneMatch("/large.txt");
+    testIfNoneMatch("/small.txt");
+
+    testFileChanged("/large.txt", largeData, sizeof(largeData));
+    testFileChanged("/small.txt", smallData, sizeof(smallData));
+
+    return host_Result("test_http_range");
+}
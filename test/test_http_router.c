@@ -0,0 +1,201 @@
+/*******************************************************************************
+  HTTP NET URL router host test
+
+  Summary:
+    Route registration and request matching
+
+  Description:
+    Registers routes and checks:
+        - bad parameters and a second registration of a pattern
+          for the same method are rejected, another method is accepted
+        - a rejected registration leaves the trie unchanged,
+          including when the nodes run out part way
+    Runs the HTTP server on fake sockets and checks:
+        - a name route is served by its handler, for its methods only
+        - a prefix route matches the names starting with the prefix,
+          a name route and a longer prefix take precedence
+*******************************************************************************/
+
+#include "http_net.c"
+
+#include <stdlib.h>
+#include "host_stubs.h"
+
+#define ROUTE_SKT       0
+
+static TCPIP_HTTP_NET_USER_HANDLE hHttp;
+
+static const char* routeCalled;     // routeParam of the last handler call
+
+static uint8_t routeFileAuthenticate(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const char* cFile, const TCPIP_HTTP_NET_USER_CALLBACK* pCBack)
+{
+    return 0x80;
+}
+
+static const TCPIP_HTTP_NET_USER_CALLBACK routeUserCback =
+{
+    .fileAuthenticate = routeFileAuthenticate,
+};
+
+static TCPIP_HTTP_NET_IO_RESULT routeHandler(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const void* routeParam)
+{
+    routeCalled = (const char*)routeParam;
+    return TCPIP_HTTP_NET_IO_RES_DONE;
+}
+
+// sends a request; returns the status code, 0 if no complete response
+static int routeRequest(const char* method, const char* uri)
+{
+    char request[200];
+    size_t txLen;
+    const uint8_t* tx;
+    int status;
+    HOST_HTTP_RESP resp;
+
+    routeCalled = 0;
+    host_SktTxClear(ROUTE_SKT);
+    if(strcmp(method, "POST") == 0)
+    {
+        sprintf(request, "POST %s HTTP/1.1\r\nHost: test\r\nContent-Length: 3\r\n\r\na=1", uri);
+    }
+    else
+    {
+        sprintf(request, "%s %s HTTP/1.1\r\nHost: test\r\n\r\n", method, uri);
+    }
+    host_SktPushStr(ROUTE_SKT, request);
+    host_Run(20);
+
+    tx = host_SktTx(ROUTE_SKT, &txLen);
+    if(!host_RespParse(tx, txLen, &resp))
+    {
+        return 0;
+    }
+    status = resp.status;
+    host_RespFree(&resp);
+    return status;
+}
+
+// checks that the request is served by the route with routeParam; 0 for none
+static bool routeCheck(const char* method, const char* uri, const char* routeParam)
+{
+    int status = routeRequest(method, uri);
+
+    if(routeParam == 0)
+    {
+        return routeCalled == 0;
+    }
+    return status == 204 && routeCalled != 0 && strcmp(routeCalled, routeParam) == 0;
+}
+
+// removes all the routes
+static void routeReset(void)
+{
+    HOST_CHECK(TCPIP_HTTP_NET_UserHandlerDeregister(hHttp));
+    HOST_CHECK((hHttp = TCPIP_HTTP_NET_UserHandlerRegister(&routeUserCback)) != 0);
+    HOST_CHECK(httpRouteNodesNo == 1);
+}
+
+static void testRegister(void)
+{
+    uint16_t nodesNo;
+    const TCPIP_HTTP_NET_ROUTE_FLAGS vGet = TCPIP_HTTP_NET_ROUTE_FLAG_GET | TCPIP_HTTP_NET_ROUTE_FLAG_VIRTUAL;
+    const TCPIP_HTTP_NET_ROUTE_FLAGS vPost = TCPIP_HTTP_NET_ROUTE_FLAG_POST | TCPIP_HTTP_NET_ROUTE_FLAG_VIRTUAL;
+
+    routeReset();
+
+    // bad parameters
+    HOST_CHECK(!TCPIP_HTTP_NET_RouteRegister(0, "a.htm", vGet, routeHandler, "a"));
+    HOST_CHECK(!TCPIP_HTTP_NET_RouteRegister(hHttp, 0, vGet, routeHandler, "a"));
+    HOST_CHECK(!TCPIP_HTTP_NET_RouteRegister(hHttp, "a.htm", TCPIP_HTTP_NET_ROUTE_FLAG_VIRTUAL, routeHandler, "a"));
+    HOST_CHECK(!TCPIP_HTTP_NET_RouteRegister(hHttp, "a.htm", vGet, 0, "a"));
+    HOST_CHECK(!TCPIP_HTTP_NET_RouteRegister(hHttp, "/", vGet, routeHandler, "a"));
+    HOST_CHECK(httpRouteNodesNo == 1);
+
+    HOST_CHECK(TCPIP_HTTP_NET_RouteRegister(hHttp, "/api/led", vGet, routeHandler, "led"));
+    HOST_CHECK(TCPIP_HTTP_NET_RouteRegister(hHttp, "api/l*", vGet, routeHandler, "l*"));
+    HOST_CHECK(TCPIP_HTTP_NET_RouteRegister(hHttp, "api/lamp", vGet, routeHandler, "lamp"));
+
+    // duplicates: the trie does not change
+    nodesNo = httpRouteNodesNo;
+    HOST_CHECK(!TCPIP_HTTP_NET_RouteRegister(hHttp, "api/led", vGet, routeHandler, "led2"));
+    HOST_CHECK(!TCPIP_HTTP_NET_RouteRegister(hHttp, "/api/led", vGet | TCPIP_HTTP_NET_ROUTE_FLAG_POST, routeHandler, "led2"));
+    HOST_CHECK(!TCPIP_HTTP_NET_RouteRegister(hHttp, "api/l*", vGet, routeHandler, "l2*"));
+    HOST_CHECK(httpRouteNodesNo == nodesNo);
+
+    // another method or a prefix of the same name
+    HOST_CHECK(TCPIP_HTTP_NET_RouteRegister(hHttp, "api/led", vPost, routeHandler, "led post"));
+    HOST_CHECK(TCPIP_HTTP_NET_RouteRegister(hHttp, "api/led*", vGet, routeHandler, "led*"));
+    HOST_CHECK(httpRouteNodesNo == nodesNo);
+
+    HOST_CHECK(routeCheck("GET", "/api/led", "led"));
+    HOST_CHECK(routeCheck("POST", "/api/led", "led post"));
+    HOST_CHECK(routeCheck("GET", "/api/led/1", "led*"));
+    HOST_CHECK(routeCheck("GET", "/api/lamp", "lamp"));
+}
+
+static void testNoRoom(void)
+{
+    uint16_t nodesNo;
+    const TCPIP_HTTP_NET_ROUTE_FLAGS vGet = TCPIP_HTTP_NET_ROUTE_FLAG_GET | TCPIP_HTTP_NET_ROUTE_FLAG_VIRTUAL;
+
+    routeReset();
+
+    // the routes run out before the nodes: take the other nodes, but for one
+    HOST_CHECK(TCPIP_HTTP_NET_RouteRegister(hHttp, "a.htm", vGet, routeHandler, "a.htm"));
+    httpRouteNodesNo = TCPIP_HTTP_NET_ROUTE_NODES - 1;
+
+    // an edge split plus a leaf: no room, nothing changes
+    nodesNo = httpRouteNodesNo;
+    HOST_CHECK(!TCPIP_HTTP_NET_RouteRegister(hHttp, "a.xml", vGet, routeHandler, "a.xml"));
+    HOST_CHECK(httpRouteNodesNo == nodesNo);
+    HOST_CHECK(routeCheck("GET", "/a.htm", "a.htm"));
+    HOST_CHECK(routeCheck("GET", "/a.xml", 0));
+
+    // a split only fits
+    HOST_CHECK(TCPIP_HTTP_NET_RouteRegister(hHttp, "a.*", vGet, routeHandler, "a.*"));
+    HOST_CHECK(httpRouteNodesNo == nodesNo + 1);
+    HOST_CHECK(routeCheck("GET", "/a.xml", "a.*"));
+    HOST_CHECK(routeCheck("GET", "/a.htm", "a.htm"));
+    HOST_CHECK(!TCPIP_HTTP_NET_RouteRegister(hHttp, "z", vGet, routeHandler, "z"));
+    HOST_CHECK(httpRouteNodesNo == nodesNo + 1);
+}
+
+static void testWildcard(void)
+{
+    const TCPIP_HTTP_NET_ROUTE_FLAGS vGet = TCPIP_HTTP_NET_ROUTE_FLAG_GET | TCPIP_HTTP_NET_ROUTE_FLAG_VIRTUAL;
+
+    routeReset();
+
+    HOST_CHECK(TCPIP_HTTP_NET_RouteRegister(hHttp, "*", vGet, routeHandler, "*"));
+    HOST_CHECK(TCPIP_HTTP_NET_RouteRegister(hHttp, "api*", vGet, routeHandler, "api*"));
+    HOST_CHECK(TCPIP_HTTP_NET_RouteRegister(hHttp, "api/v2/*", vGet, routeHandler, "api/v2/*"));
+    HOST_CHECK(TCPIP_HTTP_NET_RouteRegister(hHttp, "api/v2/status", vGet, routeHandler, "status"));
+    HOST_CHECK(TCPIP_HTTP_NET_RouteRegister(hHttp, "apx", TCPIP_HTTP_NET_ROUTE_FLAG_POST | TCPIP_HTTP_NET_ROUTE_FLAG_VIRTUAL, routeHandler, "apx"));
+
+    HOST_CHECK(routeCheck("GET", "/api", "api*"));
+    HOST_CHECK(routeCheck("GET", "/api/v1/x", "api*"));
+    HOST_CHECK(routeCheck("GET", "/api/v2/", "api/v2/*"));
+    HOST_CHECK(routeCheck("GET", "/api/v2/led", "api/v2/*"));
+    HOST_CHECK(routeCheck("GET", "/api/v2/status", "status"));
+    HOST_CHECK(routeCheck("GET", "/api/v2/statusx", "api/v2/*"));
+    HOST_CHECK(routeCheck("GET", "/ap", "*"));
+    HOST_CHECK(routeCheck("GET", "/apx", "*"));
+    HOST_CHECK(routeCheck("POST", "/apx", "apx"));
+    HOST_CHECK(routeCheck("POST", "/api/v2/led", 0));
+}
+
+int main(void)
+{
+    if(!host_HttpStart(0))
+    {
+        printf("HTTP initialization failed\n");
+        return 1;
+    }
+    HOST_CHECK((hHttp = TCPIP_HTTP_NET_UserHandlerRegister(&routeUserCback)) != 0);
+
+    testRegister();
+    testNoRoom();
+    testWildcard();
+
+    return host_Result("test_http_router");
+}
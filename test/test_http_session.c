@@ -0,0 +1,145 @@
+/*******************************************************************************
+  HTTP NET authentication session host test
+
+  Summary:
+    Session tokens issued for accepted credentials
+
+  Description:
+    Runs the HTTP server on fake sockets and checks:
+        - accepted credentials open a session, carried in a cookie
+        - a request with a valid session token is authorized without
+          calling userAuthenticate, whatever the order of the
+          Authorization and Cookie headers
+        - a session opened for one protected area does not authorize another
+*******************************************************************************/
+
+#include "http_net.c"
+
+#include <stdlib.h>
+#include "host_stubs.h"
+
+#define SESS_SKT        0
+
+// "admin:pass"
+#define SESS_CRED       "Authorization: Basic YWRtaW46cGFzcw==\r\n"
+// "admin:wrong"
+#define SESS_BAD_CRED   "Authorization: Basic YWRtaW46d3Jvbmc=\r\n"
+
+static int sessUserAuths;
+
+// files under "a/" and "b/" are in separate protected areas
+static uint8_t sessFileAuthenticate(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const char* cFile, const TCPIP_HTTP_NET_USER_CALLBACK* pCBack)
+{
+    if(strncmp(cFile, "a/", 2) == 0)
+    {
+        return 0x01;
+    }
+    if(strncmp(cFile, "b/", 2) == 0)
+    {
+        return 0x02;
+    }
+    return 0x80;
+}
+
+static uint8_t sessUserAuthenticate(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const char* cUser, const char* cPass, const TCPIP_HTTP_NET_USER_CALLBACK* pCBack)
+{
+    sessUserAuths++;
+    return strcmp(cUser, "admin") == 0 && strcmp(cPass, "pass") == 0 ? 0x80 : 0x00;
+}
+
+static const TCPIP_HTTP_NET_USER_CALLBACK sessUserCback =
+{
+    .fileAuthenticate = sessFileAuthenticate,
+    .userAuthenticate = sessUserAuthenticate,
+};
+
+// GETs a file with the extra headers; returns the status code, 0 if no complete response
+// the session cookie issued, if any, is stored in cookie
+static int sessGet(const char* uri, const char* headers, char* cookie)
+{
+    char request[300];
+    size_t txLen;
+    const uint8_t* tx;
+    const char* setCookie;
+    HOST_HTTP_RESP resp;
+
+    host_SktTxClear(SESS_SKT);
+    sprintf(request, "GET %s HTTP/1.1\r\nHost: test\r\n%s\r\n", uri, headers);
+    host_SktPushStr(SESS_SKT, request);
+    host_Run(4);
+
+    tx = host_SktTx(SESS_SKT, &txLen);
+    if(!host_RespParse(tx, txLen, &resp))
+    {
+        return 0;
+    }
+
+    if(cookie != 0)
+    {
+        *cookie = 0;
+        if((setCookie = host_RespHeader(&resp, "Set-Cookie")) != 0)
+        {
+            sscanf(setCookie, "%63[^;]", cookie);
+        }
+    }
+    host_RespFree(&resp);
+    return resp.status;
+}
+
+static void testSession(void)
+{
+    char cookie[64], headers[200];
+    int auths;
+
+    // credentials open a session
+    auths = sessUserAuths;
+    HOST_CHECK(sessGet("/a/index.htm", SESS_CRED, cookie) == 200);
+    HOST_CHECK(sessUserAuths == auths + 1);
+    HOST_CHECK(strncmp(cookie, TCPIP_HTTP_SESSION_COOKIE "=", sizeof(TCPIP_HTTP_SESSION_COOKIE)) == 0);
+
+    // the session authorizes the request; the credentials are not decoded
+    auths = sessUserAuths;
+    sprintf(headers, "Cookie: %s\r\n", cookie);
+    HOST_CHECK(sessGet("/a/index.htm", headers, 0) == 200);
+    HOST_CHECK(sessUserAuths == auths);
+
+    // credentials before the cookie: not checked either
+    sprintf(headers, SESS_BAD_CRED "Cookie: %s\r\n", cookie);
+    HOST_CHECK(sessGet("/a/index.htm", headers, 0) == 200);
+    HOST_CHECK(sessUserAuths == auths);
+
+    // credentials after the cookie
+    sprintf(headers, "Cookie: %s\r\n" SESS_BAD_CRED, cookie);
+    HOST_CHECK(sessGet("/a/index.htm", headers, 0) == 200);
+    HOST_CHECK(sessUserAuths == auths);
+
+    // another protected area
+    sprintf(headers, "Cookie: %s\r\n", cookie);
+    HOST_CHECK(sessGet("/b/index.htm", headers, 0) == 401);
+    sprintf(headers, "Cookie: %s\r\n" SESS_BAD_CRED, cookie);
+    HOST_CHECK(sessGet("/b/index.htm", headers, 0) == 401);
+    HOST_CHECK(sessUserAuths == auths + 1);
+
+    // no session: the credentials are checked
+    HOST_CHECK(sessGet("/a/index.htm", SESS_BAD_CRED, 0) == 401);
+    HOST_CHECK(sessGet("/a/index.htm", "Cookie: " TCPIP_HTTP_SESSION_COOKIE "=00000000000000000000000000000000\r\n" SESS_CRED, 0) == 200);
+    HOST_CHECK(sessUserAuths == auths + 3);
+}
+
+int main(void)
+{
+    static const char indexData[] = "<html>index</html>";
+
+    if(!host_HttpStart(0))
+    {
+        printf("HTTP initialization failed\n");
+        return 1;
+    }
+    HOST_CHECK(TCPIP_HTTP_NET_UserHandlerRegister(&sessUserCback) != 0);
+    HOST_CHECK(host_FileAdd("a/index.htm", indexData, sizeof(indexData) - 1, 0x5a21, 0x6000));
+    HOST_CHECK(host_FileAdd("b/index.htm", indexData, sizeof(indexData) - 1, 0x5a21, 0x6000));
+
+    testSession();
+
+    return host_Result("test_http_session");
+}
@@ -0,0 +1,136 @@
+/*******************************************************************************
+  HTTP NET snapshot host test
+
+  Summary:
+    Shared rendered output of polled dynamic files
+
+  Description:
+    Runs the HTTP server on fake sockets and checks:
+        - a registered dynamic file is rendered once within the fresh window
+        - a snapshot is sent even when it doesn't fit in the socket TX buffer
+          together with the chunk framing
+        - a snapshot is rendered again when it expires
+*******************************************************************************/
+
+#include "http_net.c"
+
+#include <stdlib.h>
+#include "host_stubs.h"
+
+#define SNAP_FRESH_MS   1000
+
+static TCPIP_HTTP_NET_USER_HANDLE hHttp;
+
+static int snapRenders;
+
+static uint8_t snapFileAuthenticate(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const char* cFile, const TCPIP_HTTP_NET_USER_CALLBACK* pCBack)
+{
+    return 0x80;
+}
+
+// ~count~: the number of renderings; shared by the connections
+static TCPIP_HTTP_DYN_PRINT_RES snapDynamicPrint(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const TCPIP_HTTP_DYN_VAR_DCPT* varDcpt, const TCPIP_HTTP_NET_USER_CALLBACK* pCBack)
+{
+    static char countBuff[12];
+
+    if(strcmp(varDcpt->dynName, "count") == 0)
+    {
+        sprintf(countBuff, "%d", ++snapRenders);
+        TCPIP_HTTP_NET_DynamicCacheable(varDcpt);
+        TCPIP_HTTP_NET_DynamicWriteString(varDcpt, countBuff, false);
+    }
+    return TCPIP_HTTP_DYN_PRINT_RES_DONE;
+}
+
+static const TCPIP_HTTP_NET_USER_CALLBACK snapUserCback =
+{
+    .fileAuthenticate = snapFileAuthenticate,
+    .dynamicPrint = snapDynamicPrint,
+};
+
+// GETs a file and returns the response body; 0 if no complete response
+static char* snapGet(int skt, const char* uri, int nLoops)
+{
+    char request[100];
+    size_t txLen;
+    const uint8_t* tx;
+    HOST_HTTP_RESP resp;
+
+    host_SktTxClear(skt);
+    sprintf(request, "GET %s HTTP/1.1\r\nHost: test\r\n\r\n", uri);
+    host_SktPushStr(skt, request);
+    host_Run(nLoops);
+
+    tx = host_SktTx(skt, &txLen);
+    if(!host_RespParse(tx, txLen, &resp))
+    {
+        return 0;
+    }
+    HOST_CHECK(resp.status == 200);
+    HOST_CHECK(resp.respLen == txLen);
+    return (char*)resp.body;
+}
+
+// a snapshot is reused; its size is given by the file
+static void testSnapshot(const char* fileName, size_t fileSize)
+{
+    char uri[40];
+    char *fileData, *body1, *body2, *body3;
+    size_t ix;
+    int renders;
+    uint32_t hits;
+
+    fileData = malloc(fileSize + 1);
+    // the lines have to fit the file process buffer
+    memset(fileData, 'a', fileSize - 7);
+    for(ix = 63; ix < fileSize - 7; ix += 64)
+    {
+        fileData[ix] = '\n';
+    }
+    strcpy(fileData + fileSize - 7, "~count~");
+    HOST_CHECK(host_FileAdd(fileName, fileData, fileSize, 0x5a21, 0x6000));
+    HOST_CHECK(TCPIP_HTTP_NET_SnapshotFileRegister(hHttp, fileName, SNAP_FRESH_MS));
+
+    sprintf(uri, "/%s", fileName);
+    renders = snapRenders;
+    hits = httpSnapHits;
+
+    // rendered
+    body1 = snapGet(0, uri, 20);
+    HOST_CHECK(body1 != 0 && strlen(body1) == fileSize - 7 + strlen("1"));
+    HOST_CHECK(snapRenders == renders + 1);
+
+    // shared, from another connection
+    body2 = snapGet(1, uri, 20);
+    HOST_CHECK(body2 != 0 && body1 != 0 && strcmp(body1, body2) == 0);
+    HOST_CHECK(snapRenders == renders + 1);
+    HOST_CHECK(httpSnapHits == hits + 1);
+
+    // rendered again when expired
+    host_TimeAdvance(SNAP_FRESH_MS);
+    body3 = snapGet(2, uri, 20);
+    HOST_CHECK(body3 != 0 && body1 != 0 && strcmp(body1, body3) != 0);
+    HOST_CHECK(snapRenders == renders + 2);
+
+    free(body1);
+    free(body2);
+    free(body3);
+}
+
+int main(void)
+{
+    if(!host_HttpStart(0))
+    {
+        printf("HTTP initialization failed\n");
+        return 1;
+    }
+    hHttp = TCPIP_HTTP_NET_UserHandlerRegister(&snapUserCback);
+    HOST_CHECK(hHttp != 0);
+
+    // fits in the socket with the chunk framing
+    testSnapshot("small.htm", 200);
+    // the snapshot and the framing exceed the socket TX buffer
+    testSnapshot("large.htm", TCPIP_HTTP_SNAPSHOT_MAX_SIZE - 1);
+
+    return host_Result("test_http_snapshot");
+}
@@ -0,0 +1,164 @@
+/*******************************************************************************
+  HTTP NET template cache host test
+
+  Summary:
+    Compiled templates of the dynamic files
+
+  Description:
+    Runs the HTTP server on fake sockets and checks:
+        - a dynamic file is recorded while first served, then served from the template
+        - a file with more directives than the initial recording room is recorded
+        - a template hit needs no file system metadata: no fileStat call
+        - a file changed in place, with the same size but a new date/time,
+          is not served using the old template once it is invalidated,
+          as FTP does after a STOR; an included file is checked at each include
+*******************************************************************************/
+
+#include "http_net.c"
+
+#include <stdlib.h>
+#include "host_stubs.h"
+
+#define TMPL_SKT        0
+
+static uint8_t tmplFileAuthenticate(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const char* cFile, const TCPIP_HTTP_NET_USER_CALLBACK* pCBack)
+{
+    return 0x80;
+}
+
+// ~v~: prints "X"
+static TCPIP_HTTP_DYN_PRINT_RES tmplDynamicPrint(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const TCPIP_HTTP_DYN_VAR_DCPT* varDcpt, const TCPIP_HTTP_NET_USER_CALLBACK* pCBack)
+{
+    if(strcmp(varDcpt->dynName, "v") == 0)
+    {
+        TCPIP_HTTP_NET_DynamicWriteString(varDcpt, "X", false);
+    }
+    return TCPIP_HTTP_DYN_PRINT_RES_DONE;
+}
+
+static const TCPIP_HTTP_NET_USER_CALLBACK tmplUserCback =
+{
+    .fileAuthenticate = tmplFileAuthenticate,
+    .dynamicPrint = tmplDynamicPrint,
+};
+
+// GETs a file and checks the response body
+static bool tmplGetCheck(const char* uri, const char* expected)
+{
+    char request[100];
+    size_t txLen;
+    const uint8_t* tx;
+    bool bodyOk;
+    HOST_HTTP_RESP resp;
+
+    host_SktTxClear(TMPL_SKT);
+    sprintf(request, "GET %s HTTP/1.1\r\nHost: test\r\n\r\n", uri);
+    host_SktPushStr(TMPL_SKT, request);
+    host_Run(10);
+
+    tx = host_SktTx(TMPL_SKT, &txLen);
+    if(!host_RespParse(tx, txLen, &resp))
+    {
+        return false;
+    }
+    bodyOk = resp.status == 200 && strcmp((char*)resp.body, expected) == 0;
+    host_RespFree(&resp);
+    return bodyOk;
+}
+
+static void testRecord(void)
+{
+    static const char fileData[] = "aaaa~v~bbbb\ncccc~v~\n";
+    uint32_t hits = httpTmplCacheHits, misses = httpTmplCacheMisses, fails = httpTmplCacheFails;
+    int stats;
+
+    HOST_CHECK(host_FileAdd("rec.htm", fileData, sizeof(fileData) - 1, 0x5a21, 0x6000));
+
+    // recorded while served
+    HOST_CHECK(tmplGetCheck("/rec.htm", "aaaaXbbbb\nccccX\n"));
+    HOST_CHECK(httpTmplCacheMisses == misses + 1);
+    HOST_CHECK(httpTmplCacheHits == hits);
+
+    // served from the template
+    stats = host_FileStatCount();
+    HOST_CHECK(tmplGetCheck("/rec.htm", "aaaaXbbbb\nccccX\n"));
+    HOST_CHECK(host_FileStatCount() == stats);
+    HOST_CHECK(httpTmplCacheMisses == misses + 1);
+    HOST_CHECK(httpTmplCacheHits == hits + 1);
+    HOST_CHECK(httpTmplCacheFails == fails);
+}
+
+static void testManyDirectives(void)
+{
+    char fileData[200], expected[100];
+    int ix, nDirs = TCPIP_HTTP_TMPL_BUILD_DIRECTIVES * 2 + 3;
+    uint32_t hits = httpTmplCacheHits, fails = httpTmplCacheFails;
+
+    fileData[0] = expected[0] = 0;
+    for(ix = 0; ix < nDirs; ix++)
+    {
+        strcat(fileData, "a~v~\n");
+        strcat(expected, "aX\n");
+    }
+    HOST_CHECK(host_FileAdd("many.htm", fileData, strlen(fileData), 0x5a21, 0x6000));
+
+    HOST_CHECK(tmplGetCheck("/many.htm", expected));
+    HOST_CHECK(tmplGetCheck("/many.htm", expected));
+    HOST_CHECK(httpTmplCacheHits == hits + 1);
+    HOST_CHECK(httpTmplCacheFails == fails);
+}
+
+static void testFileChanged(void)
+{
+    static const char oldData[] = "aaaa~v~bbbb\n";
+    static const char newData[] = "aa~v~bbbbbb\n";
+    uint32_t misses;
+
+    HOST_CHECK(sizeof(oldData) == sizeof(newData));
+    HOST_CHECK(host_FileAdd("chg.htm", oldData, sizeof(oldData) - 1, 0x5a21, 0x6000));
+    HOST_CHECK(tmplGetCheck("/chg.htm", "aaaaXbbbb\n"));
+    HOST_CHECK(tmplGetCheck("/chg.htm", "aaaaXbbbb\n"));
+
+    // same name and size, new date/time
+    misses = httpTmplCacheMisses;
+    HOST_CHECK(host_FileUpdate("chg.htm", newData, sizeof(newData) - 1, 0x5a21, 0x6010));
+    TCPIP_HTTP_NET_FileCacheInvalidate("chg.htm");
+    HOST_CHECK(tmplGetCheck("/chg.htm", "aaXbbbbbb\n"));
+    HOST_CHECK(httpTmplCacheMisses == misses + 1);
+    HOST_CHECK(tmplGetCheck("/chg.htm", "aaXbbbbbb\n"));
+    HOST_CHECK(httpTmplCacheMisses == misses + 1);
+}
+
+static void testIncludeChanged(void)
+{
+    static const char outerData[] = "<p>~inc:part.htm~</p>\n";
+    static const char oldData[] = "aaaa~v~bbbb\n";
+    static const char newData[] = "aa~v~bbbbbb\n";
+
+    HOST_CHECK(host_FileAdd("outer.htm", outerData, sizeof(outerData) - 1, 0x5a21, 0x6000));
+    HOST_CHECK(host_FileAdd("part.htm", oldData, sizeof(oldData) - 1, 0x5a21, 0x6000));
+    HOST_CHECK(tmplGetCheck("/outer.htm", "<p>aaaaXbbbb\n</p>\n"));
+    HOST_CHECK(tmplGetCheck("/outer.htm", "<p>aaaaXbbbb\n</p>\n"));
+
+    HOST_CHECK(host_FileUpdate("part.htm", newData, sizeof(newData) - 1, 0x5a21, 0x6010));
+    TCPIP_HTTP_NET_FileCacheInvalidate("part.htm");
+    HOST_CHECK(tmplGetCheck("/outer.htm", "<p>aaXbbbbbb\n</p>\n"));
+    HOST_CHECK(tmplGetCheck("/outer.htm", "<p>aaXbbbbbb\n</p>\n"));
+}
+
+int main(void)
+{
+    if(!host_HttpStart(0))
+    {
+        printf("HTTP initialization failed\n");
+        return 1;
+    }
+    HOST_CHECK(TCPIP_HTTP_NET_UserHandlerRegister(&tmplUserCback) != 0);
+
+    testRecord();
+    testManyDirectives();
+    testFileChanged();
+    testIncludeChanged();
+
+    return host_Result("test_http_template");
+}
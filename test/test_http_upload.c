@@ -0,0 +1,122 @@
+/*******************************************************************************
+  HTTP NET FS image upload host test
+
+  Summary:
+    One upload at a time
+
+  Description:
+    Runs the HTTP server on fake sockets and checks:
+        - an upload in progress holds the upload buffers
+        - a second upload gets 503 Service Unavailable with Retry-After,
+          not the out of memory error, and the first upload is not disturbed
+        - once the first upload is aborted and the media is idle,
+          a new upload is accepted
+*******************************************************************************/
+
+#include "http_net.c"
+
+#include <stdlib.h>
+#include "host_stubs.h"
+
+#define UPL_SKT1        0
+#define UPL_SKT2        1
+#define UPL_DATA_SIZE   200
+
+static uint8_t uplFileAuthenticate(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const char* cFile, const TCPIP_HTTP_NET_USER_CALLBACK* pCBack)
+{
+    return 0x80;
+}
+
+static const TCPIP_HTTP_NET_USER_CALLBACK uplUserCback =
+{
+    .fileAuthenticate = uplFileAuthenticate,
+};
+
+// starts an upload: sends the headers and the part headers, then the image signature and some data
+// contentLen is the announced Content-Length; 0 for exactly the data sent
+static void uplStart(int skt, size_t contentLen)
+{
+    static const char partHdr[] = "--XyZ\r\nContent-Disposition: form-data; name=\"i\"; filename=\"img.bin\"\r\n\r\n";
+    char request[300];
+    uint8_t data[UPL_DATA_SIZE];
+    size_t bodyLen = sizeof(partHdr) - 1 + sizeof(MPFS_SIGNATURE) - 1 + sizeof(data);
+
+    memset(data, 0x5a, sizeof(data));
+    host_SktTxClear(skt);
+    sprintf(request, "POST /" TCPIP_HTTP_NET_FILE_UPLOAD_NAME " HTTP/1.1\r\nHost: test\r\n"
+                     "Content-Type: multipart/form-data; boundary=XyZ\r\nContent-Length: %zu\r\n\r\n", contentLen != 0 ? contentLen : bodyLen);
+    host_SktPushStr(skt, request);
+    host_SktPushStr(skt, partHdr);
+    host_Run(5);
+    host_SktPushStr(skt, MPFS_SIGNATURE);
+    host_SktPush(skt, data, sizeof(data));
+    host_Run(10);
+}
+
+// returns the response status, 0 if no complete response
+static int uplStatus(int skt, char* retryAfter, size_t retrySize)
+{
+    size_t txLen;
+    const uint8_t* tx;
+    const char* hdrVal;
+    int status;
+    HOST_HTTP_RESP resp;
+
+    tx = host_SktTx(skt, &txLen);
+    if(!host_RespParse(tx, txLen, &resp))
+    {
+        return 0;
+    }
+    status = resp.status;
+    hdrVal = host_RespHeader(&resp, "Retry-After");
+    snprintf(retryAfter, retrySize, "%s", hdrVal != 0 ? hdrVal : "");
+    host_RespFree(&resp);
+    return status;
+}
+
+static void testBusy(void)
+{
+    char retryAfter[20];
+    TCPIP_HTTP_UPLOAD_DCPT* pUpload;
+
+    // the first upload is in progress, waiting for the rest of the image
+    host_MediaBusySet(true);
+    uplStart(UPL_SKT1, 100000);
+    pUpload = httpUploadDcpt;
+    HOST_CHECK(pUpload != 0 && pUpload->owner == httpConnCtrl + UPL_SKT1);
+    HOST_CHECK(uplStatus(UPL_SKT1, retryAfter, sizeof(retryAfter)) == 0);
+
+    // the second one is told to come back later
+    uplStart(UPL_SKT2, 0);
+    HOST_CHECK(uplStatus(UPL_SKT2, retryAfter, sizeof(retryAfter)) == 503);
+    HOST_CHECK(retryAfter[0] != 0 && atoi(retryAfter) > 0);
+    HOST_CHECK(strstr((const char*)host_SktTx(UPL_SKT2, 0), "Allocation") == 0);
+    HOST_CHECK(httpUploadDcpt == pUpload && pUpload->owner == httpConnCtrl + UPL_SKT1);
+    HOST_CHECK(httpConnCtrl[UPL_SKT1].httpStatus == TCPIP_HTTP_NET_STAT_UPLOAD_WRITE);
+
+    // the first client gives up; the buffers go once the media is idle
+    host_SktRemoteClose(UPL_SKT1);
+    host_Run(5);
+    HOST_CHECK(httpUploadDcpt != 0 && httpUploadDcpt->owner == 0);
+    host_MediaBusySet(false);
+    host_Run(5);
+
+    // a new upload can start
+    uplStart(UPL_SKT2, 100000);
+    HOST_CHECK(httpUploadDcpt != 0 && httpUploadDcpt->owner == httpConnCtrl + UPL_SKT2);
+    HOST_CHECK(httpConnCtrl[UPL_SKT2].httpStatus == TCPIP_HTTP_NET_STAT_UPLOAD_WRITE);
+}
+
+int main(void)
+{
+    if(!host_HttpStart(0))
+    {
+        printf("HTTP initialization failed\n");
+        return 1;
+    }
+    HOST_CHECK(TCPIP_HTTP_NET_UserHandlerRegister(&uplUserCback) != 0);
+
+    testBusy();
+
+    return host_Result("test_http_upload");
+}
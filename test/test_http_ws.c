@@ -0,0 +1,304 @@
+/*******************************************************************************
+  HTTP NET WebSocket host test
+
+  Summary:
+    WebSocket handshake and frame parsing
+
+  Description:
+    Runs the HTTP server on fake sockets and checks:
+        - the Sec-WebSocket-Accept value (RFC 6455 example)
+        - text messages, fragmented messages, ping/pong and close
+        - protocol errors: unmasked frames, bad continuations
+        - hostile lengths: 16 and 64 bit lengths larger than the message buffer,
+          including a 64 bit length that wraps the 32 bit arithmetic around
+    The test is built with the address sanitizer:
+    a frame written past the message buffer aborts the test.
+*******************************************************************************/
+
+#include "http_net.c"
+
+#include <stdlib.h>
+#include "host_stubs.h"
+
+#define WS_SKT      0       // socket used by the test connection
+
+// all files are public
+static uint8_t wsFileAuthenticate(TCPIP_HTTP_NET_CONN_HANDLE connHandle, const char* cFile, const TCPIP_HTTP_NET_USER_CALLBACK* pCBack)
+{
+    return 0x80;
+}
+
+static const TCPIP_HTTP_NET_USER_CALLBACK wsUserCback =
+{
+    .fileAuthenticate = wsFileAuthenticate,
+};
+
+// events reported to the endpoint handler
+static int      wsOpenEvents, wsCloseEvents, wsMessages;
+static TCPIP_HTTP_NET_WS_EVENT wsLastEvent;
+static uint8_t  wsLastMsg[TCPIP_HTTP_NET_WEBSOCKET_MAX_MESSAGE];
+static uint16_t wsLastLen;
+
+static void wsHandler(TCPIP_HTTP_NET_CONN_HANDLE connHandle, TCPIP_HTTP_NET_WS_EVENT wsEvent, const uint8_t* data, uint16_t dataLen)
+{
+    switch(wsEvent)
+    {
+        case TCPIP_HTTP_NET_WS_EVENT_OPEN:
+            wsOpenEvents++;
+            break;
+
+        case TCPIP_HTTP_NET_WS_EVENT_CLOSE:
+            wsCloseEvents++;
+            break;
+
+        default:
+            wsMessages++;
+            wsLastEvent = wsEvent;
+            wsLastLen = dataLen;
+            if(dataLen <= sizeof(wsLastMsg))
+            {
+                memcpy(wsLastMsg, data, dataLen);
+            }
+            break;
+    }
+}
+
+// sends a masked client frame
+// payloadLen is the length written in the header; only dataLen bytes follow
+static void wsFrameSend(uint8_t b0, bool masked, uint64_t payloadLen, const void* data, size_t dataLen)
+{
+    static const uint8_t mask[4] = {0x37, 0xfa, 0x21, 0x3d};
+    uint8_t frame[1024];
+    size_t frameLen, ix;
+
+    frame[0] = b0;
+    frameLen = 2;
+    if(payloadLen < 126)
+    {
+        frame[1] = (uint8_t)payloadLen;
+    }
+    else if(payloadLen <= 0xffff)
+    {
+        frame[1] = 126;
+        frame[frameLen++] = (uint8_t)(payloadLen >> 8);
+        frame[frameLen++] = (uint8_t)payloadLen;
+    }
+    else
+    {
+        frame[1] = 127;
+        for(ix = 0; ix < 8; ix++)
+        {
+            frame[frameLen++] = (uint8_t)(payloadLen >> (56 - 8 * ix));
+        }
+    }
+
+    if(masked)
+    {
+        frame[1] |= 0x80;
+        memcpy(frame + frameLen, mask, sizeof(mask));
+        frameLen += sizeof(mask);
+    }
+
+    for(ix = 0; ix < dataLen; ix++)
+    {
+        frame[frameLen++] = ((const uint8_t*)data)[ix] ^ (masked ? mask[ix & 3] : 0);
+    }
+
+    host_SktPush(WS_SKT, frame, frameLen);
+}
+
+// opens a WebSocket on the test socket
+static bool wsOpen(void)
+{
+    const char* resp;
+
+    host_SktTxClear(WS_SKT);
+    host_SktPushStr(WS_SKT, "GET /ws HTTP/1.1\r\nHost: server.example.com\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                            "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n");
+    host_Run(4);
+
+    resp = (const char*)host_SktTx(WS_SKT, 0);
+    host_SktTxClear(WS_SKT);
+    return strstr(resp, "101 Switching Protocols") != 0 && strstr(resp, "Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n") != 0;
+}
+
+// checks that the server sent a close frame with closeCode and dropped the connection
+static void wsCheckClosed(uint16_t closeCode, int discBefore)
+{
+    size_t txLen;
+    const uint8_t* tx = host_SktTx(WS_SKT, &txLen);
+
+    HOST_CHECK(txLen == 4);
+    HOST_CHECK(tx[0] == 0x88 && tx[1] == 0x02);
+    HOST_CHECK(tx[2] == (closeCode >> 8) && tx[3] == (closeCode & 0xff));
+    HOST_CHECK(host_SktDisconnects(WS_SKT) == discBefore + 1);
+    HOST_CHECK(host_SktRxPending(WS_SKT) == 0);
+    host_SktTxClear(WS_SKT);
+}
+
+static void testHandshake(void)
+{
+    HOST_CHECK(wsOpen());
+    HOST_CHECK(wsOpenEvents == 1);
+    HOST_CHECK(httpConnCtrl[WS_SKT].connState == TCPIP_HTTP_CONN_STATE_WEBSOCKET);
+}
+
+static void testMessages(void)
+{
+    size_t txLen;
+    const uint8_t* tx;
+    int msgs = wsMessages;
+
+    // single frame text
+    wsFrameSend(0x81, true, 5, "Hello", 5);
+    host_Run(1);
+    HOST_CHECK(wsMessages == msgs + 1);
+    HOST_CHECK(wsLastEvent == TCPIP_HTTP_NET_WS_EVENT_TEXT);
+    HOST_CHECK(wsLastLen == 5 && memcmp(wsLastMsg, "Hello", 5) == 0);
+
+    // fragmented binary message, with a ping in between
+    wsFrameSend(0x02, true, 3, "abc", 3);
+    wsFrameSend(0x89, true, 4, "ping", 4);
+    wsFrameSend(0x80, true, 2, "de", 2);
+    host_Run(1);
+    HOST_CHECK(wsMessages == msgs + 2);
+    HOST_CHECK(wsLastEvent == TCPIP_HTTP_NET_WS_EVENT_BINARY);
+    HOST_CHECK(wsLastLen == 5 && memcmp(wsLastMsg, "abcde", 5) == 0);
+
+    // unmasked pong
+    tx = host_SktTx(WS_SKT, &txLen);
+    HOST_CHECK(txLen == 6 && memcmp(tx, "\x8a\x04ping", 6) == 0);
+    host_SktTxClear(WS_SKT);
+
+    // a 16 bit length message that fits exactly
+    uint8_t msg[TCPIP_HTTP_NET_WEBSOCKET_MAX_MESSAGE];
+    memset(msg, 'x', sizeof(msg));
+    wsFrameSend(0x81, true, sizeof(msg), msg, sizeof(msg));
+    host_Run(1);
+    HOST_CHECK(wsMessages == msgs + 3);
+    HOST_CHECK(wsLastLen == sizeof(msg) && memcmp(wsLastMsg, msg, sizeof(msg)) == 0);
+
+    // a frame arriving in pieces is parsed when complete
+    uint8_t frame[] = {0x81, 0x83, 0, 0, 0, 0, 'a', 'b', 'c'};
+    host_SktPush(WS_SKT, frame, 1);
+    host_Run(1);
+    host_SktPush(WS_SKT, frame + 1, 5);
+    host_Run(1);
+    HOST_CHECK(wsMessages == msgs + 3);
+    host_SktPush(WS_SKT, frame + 6, 3);
+    host_Run(1);
+    HOST_CHECK(wsMessages == msgs + 4);
+    HOST_CHECK(wsLastLen == 3 && memcmp(wsLastMsg, "abc", 3) == 0);
+}
+
+static void testClose(void)
+{
+    int disc = host_SktDisconnects(WS_SKT);
+    int closes = wsCloseEvents;
+
+    // the close status code is echoed
+    wsFrameSend(0x88, true, 2, "\x03\xe8", 2);
+    host_Run(2);
+    wsCheckClosed(1000, disc);
+    HOST_CHECK(wsCloseEvents == closes + 1);
+    HOST_CHECK(httpConnCtrl[WS_SKT].wsDcpt == 0);
+}
+
+static void testProtocolErrors(void)
+{
+    int disc;
+
+    // unmasked client frame
+    HOST_CHECK(wsOpen());
+    disc = host_SktDisconnects(WS_SKT);
+    wsFrameSend(0x81, false, 5, "Hello", 5);
+    host_Run(2);
+    wsCheckClosed(TCPIP_HTTP_WS_CLOSE_PROTOCOL, disc);
+
+    // continuation without a started message
+    HOST_CHECK(wsOpen());
+    disc = host_SktDisconnects(WS_SKT);
+    wsFrameSend(0x80, true, 1, "a", 1);
+    host_Run(2);
+    wsCheckClosed(TCPIP_HTTP_WS_CLOSE_PROTOCOL, disc);
+
+    // fragmented control frame
+    HOST_CHECK(wsOpen());
+    disc = host_SktDisconnects(WS_SKT);
+    wsFrameSend(0x09, true, 1, "a", 1);
+    host_Run(2);
+    wsCheckClosed(TCPIP_HTTP_WS_CLOSE_PROTOCOL, disc);
+}
+
+static void testHostileLengths(void)
+{
+    int disc, msgs;
+    uint8_t junk[200];
+
+    memset(junk, 0x5a, sizeof(junk));
+
+    // 16 bit length over the message buffer
+    HOST_CHECK(wsOpen());
+    disc = host_SktDisconnects(WS_SKT);
+    msgs = wsMessages;
+    wsFrameSend(0x81, true, TCPIP_HTTP_NET_WEBSOCKET_MAX_MESSAGE + 1, junk, sizeof(junk));
+    host_Run(2);
+    wsCheckClosed(TCPIP_HTTP_WS_CLOSE_TOO_BIG, disc);
+    HOST_CHECK(wsMessages == msgs);
+
+    // 64 bit length over 32 bits
+    HOST_CHECK(wsOpen());
+    disc = host_SktDisconnects(WS_SKT);
+    wsFrameSend(0x82, true, 0x100000000ULL, junk, sizeof(junk));
+    host_Run(2);
+    wsCheckClosed(TCPIP_HTTP_WS_CLOSE_TOO_BIG, disc);
+
+    // a fragment over the room left in the message buffer
+    HOST_CHECK(wsOpen());
+    disc = host_SktDisconnects(WS_SKT);
+    wsFrameSend(0x01, true, 100, junk, 100);
+    wsFrameSend(0x80, true, 29, junk, 29);
+    host_Run(2);
+    wsCheckClosed(TCPIP_HTTP_WS_CLOSE_TOO_BIG, disc);
+    HOST_CHECK(wsMessages == msgs);
+
+    // 1 byte fragment, then a continuation with the length 0x00000000ffffffff:
+    // msgLen + payloadLen and hdrLen + payloadLen wrap around in 32 bits
+    HOST_CHECK(wsOpen());
+    disc = host_SktDisconnects(WS_SKT);
+    wsFrameSend(0x01, true, 1, "a", 1);
+    host_Run(1);
+    wsFrameSend(0x80, true, 0xffffffffULL, junk, sizeof(junk));
+    host_Run(2);
+    wsCheckClosed(TCPIP_HTTP_WS_CLOSE_TOO_BIG, disc);
+    HOST_CHECK(wsMessages == msgs);
+
+    // the connection serves requests again
+    HOST_CHECK(wsOpen());
+    wsFrameSend(0x81, true, 2, "ok", 2);
+    host_Run(1);
+    HOST_CHECK(wsMessages == msgs + 1);
+    HOST_CHECK(wsLastLen == 2 && memcmp(wsLastMsg, "ok", 2) == 0);
+}
+
+int main(void)
+{
+    TCPIP_HTTP_NET_USER_HANDLE hHttp;
+
+    if(!host_HttpStart(0))
+    {
+        printf("HTTP initialization failed\n");
+        return 1;
+    }
+    hHttp = TCPIP_HTTP_NET_UserHandlerRegister(&wsUserCback);
+    HOST_CHECK(hHttp != 0);
+    HOST_CHECK(TCPIP_HTTP_NET_WebSocketRegister(hHttp, "/ws", wsHandler));
+
+    testHandshake();
+    testMessages();
+    testClose();
+    testProtocolErrors();
+    testHostileLengths();
+
+    return host_Result("test_http_ws");
+}